@@ -66,14 +66,20 @@ LOCAL_SRC_FILES += $(SOURCE_PATH)/platform-android/nativeactivity.android.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/core/base64.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/core/conversion.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/core/dictionary.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/core/internedname.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/core/log.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/core/objectscache.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/core/plist.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/core/profiler.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/core/tools.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/core/transformable.cpp
 
 LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/animation.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/animationsampler.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/baseelement.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/boundingvolumehierarchy.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/cameraelement.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/elementregistry.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/material.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/mesh.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/particlesystem.cpp
@@ -81,8 +87,10 @@ LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/scene3d.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/serialization.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/storage.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/supportmesh.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/scene3d/transformhierarchy.cpp
 
 LOCAL_SRC_FILES += $(SOURCE_PATH)/primitives/primitives.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/primitives/primitives-parallel.cpp
 
 LOCAL_SRC_FILES += $(SOURCE_PATH)/locale/locale.cpp
 
@@ -126,6 +134,7 @@ LOCAL_SRC_FILES += $(SOURCE_PATH)/vertexbuffer/vertexarray.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/vertexbuffer/vertexdatachunk.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/vertexbuffer/vertexdeclaration.cpp
 
+LOCAL_SRC_FILES += $(SOURCE_PATH)/rendering/drawcommandbuffer.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/rendering/renderer.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/rendering/rendering.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/rendering/renderstate.cpp
@@ -133,6 +142,8 @@ LOCAL_SRC_FILES += $(SOURCE_PATH)/rendering/rendercontext.cpp
 
 LOCAL_SRC_FILES += $(SOURCE_PATH)/opengl/opengl.common.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/opengl/openglcaps.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/opengl/streamingbuffer.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/opengl/uniformbufferring.cpp
 
 LOCAL_SRC_FILES += $(SOURCE_PATH)/app/backgroundthread.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/app/appevironment.cpp
@@ -143,6 +154,8 @@ LOCAL_SRC_FILES += $(SOURCE_PATH)/app/runloop.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/app/pathresolver.cpp
 
 LOCAL_SRC_FILES += $(SOURCE_PATH)/collision/collision.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/collision/collisionmesh.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/collision/trianglebatch.cpp
 
 LOCAL_SRC_FILES += $(SOURCE_PATH)/platform-unix/criticalsection.unix.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/platform-unix/mutex.unix.cpp
@@ -150,14 +163,20 @@ LOCAL_SRC_FILES += $(SOURCE_PATH)/platform-unix/atomiccounter.unix.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/platform-unix/thread.unix.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/platform-unix/threading.unix.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/platform-unix/tools.unix.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/platform-unix/mappedfile.unix.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/platform-unix/filewatcher.unix.cpp
 
 LOCAL_SRC_FILES += $(SOURCE_PATH)/geometry/geometry.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/geometry/rectplacer.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/helpers/particles-soa.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/helpers/streamedterrain.cpp
 
+LOCAL_SRC_FILES += $(SOURCE_PATH)/sound/mixer.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/sound/player.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/sound/sound.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/sound/streamingthread.cpp
 LOCAL_SRC_FILES += $(SOURCE_PATH)/sound/track.cpp
+LOCAL_SRC_FILES += $(SOURCE_PATH)/sound/trackcache.cpp
 
 LOCAL_STATIC_LIBRARIES := android_native_app_glue openal libpng libzip libxml libcurl libvorbis libjpeg
 
@@ -79,6 +79,13 @@ namespace et
 		void setShouldSilentPathResolverErrors(bool);
 		
 		void setPathResolver(PathResolver::Pointer);
+		
+		/*
+		 * Existence checks answered from standard path resolver snapshots
+		 */
+		bool cachedFileExists(const std::string&);
+		void invalidatePathResolverCache();
+		StandardPathResolver::CacheStatistics pathResolverCacheStatistics();
 
 		void setTitle(const std::string& s);
 		void setFrameRateLimit(size_t value);
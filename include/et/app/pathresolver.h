@@ -9,7 +9,11 @@
 
 #include <set>
 #include <deque>
+#include <unordered_map>
+#include <unordered_set>
 #include <et/core/et.h>
+#include <et/core/filewatcher.h>
+#include <et/threading/criticalsection.h>
 
 namespace et
 {
@@ -28,12 +32,32 @@ namespace et
 		virtual ~PathResolver() { }
 	};
 	
+	/*
+	 * Folders of search paths are listed once into hashed snapshots, so existence checks
+	 * and resolved names are served from memory. Snapshot is dropped when FileWatcher
+	 * reports change of folder entries, or, where notifications are not available,
+	 * when modification date of its folder changes (checked not more often than
+	 * validation interval); and on explicit invalidation. Other folders and folders
+	 * which could not be listed (e.g. Android assets) are checked directly.
+	 */
 	class StandardPathResolver : PathResolver
 	{
 	public:
 		ET_DECLARE_POINTER(StandardPathResolver)
 		
+		struct CacheStatistics
+		{
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			uint64_t snapshotProbes = 0;
+			uint64_t fileSystemProbes = 0;
+			uint64_t snapshotsCreated = 0;
+			uint64_t invalidations = 0;
+		};
+		
 	public:
+		StandardPathResolver();
+		
 		void setRenderContext(RenderContext*);
 		
 		std::string resolveFilePath(const std::string&);
@@ -49,13 +73,61 @@ namespace et
 		void setSilentErrors(bool e)
 			{ _silentErrors = e; }
 		
+		bool cachedFileExists(const std::string&);
+		bool cachedFolderExists(const std::string&);
+		
+		void setCacheEnabled(bool);
+		void setCacheValidationInterval(float seconds);
+		
+		void invalidateCache();
+		void invalidateCache(const std::string& folder);
+		
+		CacheStatistics cacheStatistics();
+		void resetCacheStatistics();
+		
+	private:
+		struct FolderSnapshot
+		{
+			std::unordered_set<std::string> files;
+			std::unordered_set<std::string> folders;
+			std::string watchedFolder;
+			uint64_t date = 0;
+			bool listed = false;
+		};
+		
+		struct ResolvedFile
+		{
+			std::string path;
+			bool exists = false;
+		};
+		
 	private:
 		void validateCaches();
+		void validateSnapshots();
+		void clearResolvedNames();
+		void clearSnapshots();
+		
+		bool isSearchPathFolder(const std::string&) const;
+		const FolderSnapshot& folderSnapshot(const std::string&);
+		bool probeFile(const std::string&);
+		bool probeFolder(const std::string&);
+		
+		std::set<std::string> resolveFolderPathsInternal(const std::string&);
 		
 	private:
 		RenderContext* _rc = nullptr;
 		std::deque<std::string> _searchPath;
 		
+		CriticalSection _lock;
+		std::unordered_map<std::string, FolderSnapshot> _snapshots;
+		FileWatcher _watcher;
+		std::unordered_map<std::string, ResolvedFile> _resolvedFiles;
+		std::unordered_map<std::string, std::string> _resolvedFolders;
+		std::unordered_map<std::string, std::set<std::string>> _resolvedFolderSets;
+		CacheStatistics _statistics;
+		uint64_t _lastValidationTime = 0;
+		uint64_t _validationInterval = 1000;
+		
 		std::string _cachedLang;
 		std::string _cachedSubLang;
 		std::string _cachedLanguage;
@@ -65,5 +137,6 @@ namespace et
 		
 		size_t _cachedScreenScaleFactor = 0;
 		bool _silentErrors = false;
+		bool _cacheEnabled = true;
 	};
 }
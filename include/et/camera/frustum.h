@@ -23,8 +23,53 @@ namespace et
 		FrustumPlane_max
 	};
 
+	enum FrustumTestResult : uint8_t
+	{
+		FrustumTestResult_Outside,
+		FrustumTestResult_Intersects,
+		FrustumTestResult_Inside
+	};
+
 	class Frustum
 	{
+	public:
+		/*
+		 * Structure-of-arrays input for batch tests, all arrays have the same length
+		 */
+		struct SphereArrays
+		{
+			const float* centerX = nullptr;
+			const float* centerY = nullptr;
+			const float* centerZ = nullptr;
+			const float* radius = nullptr;
+		};
+
+		struct AABBArrays
+		{
+			const float* centerX = nullptr;
+			const float* centerY = nullptr;
+			const float* centerZ = nullptr;
+			const float* halfDimensionX = nullptr;
+			const float* halfDimensionY = nullptr;
+			const float* halfDimensionZ = nullptr;
+		};
+
+		/*
+		 * axisX[i] is i-th component of box x axis (first row of OBB::transform), etc.
+		 */
+		struct OBBArrays
+		{
+			const float* centerX = nullptr;
+			const float* centerY = nullptr;
+			const float* centerZ = nullptr;
+			const float* dimensionX = nullptr;
+			const float* dimensionY = nullptr;
+			const float* dimensionZ = nullptr;
+			const float* axisX[3] = { };
+			const float* axisY[3] = { };
+			const float* axisZ[3] = { };
+		};
+
 	public:
 		Frustum();
 		Frustum(const mat4& mvpMatrix);
@@ -33,9 +78,37 @@ namespace et
 		bool containsAABB(const AABB& aabb) const;
 		bool containsOBB(const OBB& obb) const;
 
+		FrustumTestResult classifySphere(const Sphere&) const;
+		FrustumTestResult classifyAABB(const AABB&) const;
+		FrustumTestResult classifyOBB(const OBB&) const;
+
+		/*
+		 * Batch tests, four objects at once. Classify functions write result for every object,
+		 * cull functions write indices of objects which are not outside and return their count.
+		 */
+		void classifySpheres(const SphereArrays&, size_t count, FrustumTestResult* results) const;
+		void classifyAABBs(const AABBArrays&, size_t count, FrustumTestResult* results) const;
+		void classifyOBBs(const OBBArrays&, size_t count, FrustumTestResult* results) const;
+
+		size_t cullSpheres(const SphereArrays&, size_t count, uint32_t* visibleIndices) const;
+		size_t cullAABBs(const AABBArrays&, size_t count, uint32_t* visibleIndices) const;
+		size_t cullOBBs(const OBBArrays&, size_t count, uint32_t* visibleIndices) const;
+
+		const StaticDataStorage<vec4, FrustumPlane_max>& planes() const
+			{ return _planes; }
+
+	private:
+		void buildPlaneArrays();
+
 	private:
 		StaticDataStorage<vec4, FrustumPlane_max> _planes;
 		StaticDataStorage<vec4, 8> _corners;
+
+		/*
+		 * Plane components (x, y, z, w) and absolute values of normal components,
+		 * one array per component
+		 */
+		float _planeArrays[7][FrustumPlane_max] = { };
 	};
 
 }
@@ -0,0 +1,122 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/collision/trianglebatch.h>
+
+namespace et
+{
+	/*
+	 * Static triangle soup indexed by bounding volume hierarchy, which is built once
+	 * with surface area heuristic. Triangles are stored in leaf order and each leaf
+	 * is packed into triangle batch, reported triangle indices refer to the source array.
+	 */
+	class CollisionMesh
+	{
+	public:
+		enum : uint32_t
+		{
+			MaxTrianglesPerLeaf = TriangleBatch::Width,
+			InvalidIndex = static_cast<uint32_t>(-1)
+		};
+
+		struct RayHit
+		{
+			vec3 point;
+			vec3 normal;
+			float distance = 0.0f;
+			uint32_t triangleIndex = InvalidIndex;
+		};
+
+		struct Contact
+		{
+			vec3 point;
+			vec3 normal;
+			float penetration = 0.0f;
+			uint32_t triangleIndex = InvalidIndex;
+		};
+
+		struct SweepHit
+		{
+			vec3 point;
+			vec3 normal;
+			float time = 0.0f;
+			uint32_t triangleIndex = InvalidIndex;
+		};
+
+	public:
+		CollisionMesh() = default;
+		CollisionMesh(const triangle*, size_t triangleCount);
+
+		void build(const triangle*, size_t triangleCount);
+		void clear();
+
+		/*
+		 * Ray direction should be normalized, triangles facing away
+		 * from ray are ignored unless two sided test is requested
+		 */
+		bool rayClosestHit(const ray3d&, float maxDistance, RayHit&, bool twoSided = false) const;
+		bool rayAnyHit(const ray3d&, float maxDistance, bool twoSided = false) const;
+
+		/*
+		 * Reports contact with the deepest penetration
+		 */
+		bool sphereOverlap(const Sphere&, Contact&) const;
+
+		/*
+		 * Appends all contacts to provided vector, returns number of added contacts
+		 */
+		size_t sphereContacts(const Sphere&, std::vector<Contact>&) const;
+
+		/*
+		 * Sphere is moved by velocity during unit time, the earliest contact is reported.
+		 * Sphere which intersects geometry at start reports contact at zero time.
+		 */
+		bool sphereSweep(const Sphere&, const vec3& velocity, SweepHit&) const;
+
+		size_t triangleCount() const
+			{ return _triangles.size(); }
+
+		size_t nodeCount() const
+			{ return _nodes.size(); }
+
+		AABB bounds() const;
+
+	private:
+		/*
+		 * First child of leaf node is index of its triangle batch
+		 */
+		struct Node
+		{
+			vec3 minVertex;
+			uint32_t firstChild = 0;
+			vec3 maxVertex;
+			uint32_t triangleCount = 0;
+		};
+
+		struct BuildItem
+		{
+			vec3 minVertex;
+			vec3 maxVertex;
+			vec3 centroid;
+		};
+
+		void buildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth,
+			std::vector<BuildItem>&, std::vector<uint32_t>& order);
+
+		template <typename F>
+		void queryBox(const vec3& minVertex, const vec3& maxVertex, F callback) const;
+
+	private:
+		std::vector<Node> _nodes;
+		std::vector<triangle> _triangles;
+		std::vector<uint32_t> _triangleIndices;
+		std::vector<TriangleBatch> _batches;
+		std::vector<uint32_t> _batchFirstTriangle;
+	};
+}
@@ -0,0 +1,110 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/collision/collision.h>
+
+namespace et
+{
+	/*
+	 * Triangles stored as structure of arrays with precomputed edges and normals,
+	 * tested all at once with AVX, or by four with SSE and NEON where available.
+	 * Width does not depend on compiler options, so layout is the same in all
+	 * translation units.
+	 */
+	struct ET_ALIGNED(16) TriangleBatch
+	{
+	public:
+		enum : uint32_t
+		{
+			Width = 8,
+			InvalidLane = static_cast<uint32_t>(-1)
+		};
+
+		struct ET_ALIGNED(16) Vector
+		{
+			float x[Width];
+			float y[Width];
+			float z[Width];
+
+			vec3 at(uint32_t lane) const
+				{ return vec3(x[lane], y[lane], z[lane]); }
+
+			void set(uint32_t lane, const vec3& v)
+				{ x[lane] = v.x; y[lane] = v.y; z[lane] = v.z; }
+		};
+
+		/*
+		 * Lanes without intersection have infinite distance
+		 */
+		struct RayResult
+		{
+			ET_ALIGNED(16) float distance[Width];
+			uint32_t hitMask = 0;
+			uint32_t backFaceMask = 0;
+		};
+
+		struct SphereResult
+		{
+			Vector point;
+			Vector normal;
+			ET_ALIGNED(16) float penetration[Width];
+			uint32_t hitMask = 0;
+		};
+
+		struct PointResult
+		{
+			Vector point;
+			ET_ALIGNED(16) float distanceSquared[Width];
+		};
+
+	public:
+		TriangleBatch()
+			{ clear(); }
+
+		/*
+		 * Packs up to Width triangles, returns number of packed triangles
+		 */
+		uint32_t pack(const triangle*, size_t count);
+
+		void clear();
+		void set(uint32_t lane, const triangle&);
+
+		uint32_t count() const
+			{ return _count; }
+
+		/*
+		 * Return lane with the closest hit, the deepest penetration or the closest point,
+		 * or InvalidLane. Ray is tested with Moller-Trumbore algorithm, the same way
+		 * as in rayTriangleTwoSided, sphere and point tests follow
+		 * intersect::sphereTriangle and closestPointOnTriangle.
+		 */
+		uint32_t intersectRay(const ray3d&, float maxDistance, bool twoSided, RayResult&) const;
+		uint32_t intersectSphere(const vec3& center, float radius, SphereResult&) const;
+		uint32_t closestPoint(const vec3& p, PointResult&) const;
+
+	private:
+		Vector _v1;
+		Vector _v2;
+		Vector _v3;
+		Vector _edge2to1;
+		Vector _edge3to1;
+		Vector _edge3to2;
+		Vector _normal;
+
+		/*
+		 * Dot products of edges used to find closest point
+		 */
+		ET_ALIGNED(16) float _edge2to1Square[Width];
+		ET_ALIGNED(16) float _edgesDot[Width];
+		ET_ALIGNED(16) float _edge3to1Square[Width];
+		ET_ALIGNED(16) float _determinant[Width];
+
+		uint32_t _count = 0;
+	};
+}
@@ -34,10 +34,19 @@ namespace et
 	bool copyFile(const std::string& fromName, const std::string& toName);
 	
 	void getFolderContent(const std::string& folder, StringList& list);
+	
+	/*
+	 * Names of files and subfolders, returns false if folder could not be listed
+	 */
+	bool getFolderEntries(const std::string& folder, StringList& files, StringList& folders);
+	
 	void findFiles(const std::string& folder, const std::string& mask, bool recursive, StringList& list);
 	void findSubfolders(const std::string& folder, bool recursive, StringList& list);
 	void openUrl(const std::string& url);
 
+	/*
+	 * Modification date with full precision of the file system, units depend on platform
+	 */
 	uint64_t getFileDate(const std::string& path);
 	
 	std::string getFilePath(const std::string& name);
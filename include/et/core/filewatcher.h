@@ -0,0 +1,65 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/core/et.h>
+
+namespace et
+{
+	/*
+	 * Reports changes of watched files using notifications from system (inotify on Android).
+	 * Folders containing watched files are monitored on background thread, file is reported
+	 * by takeChanges once no writes to it were seen during debounce interval.
+	 *
+	 * available() returns false when system notifications are not supported,
+	 * in this case files should be polled by caller.
+	 */
+	class FileWatcherPrivate;
+	class FileWatcher
+	{
+	public:
+		FileWatcher();
+		~FileWatcher();
+
+		bool available() const;
+
+		bool watch(const std::string& fileName);
+		void unwatch(const std::string& fileName);
+
+		/*
+		 * Folder is reported by takeChanges (with trailing slash) when its entries
+		 * are created, removed or renamed, or when folder itself is removed or moved
+		 */
+		bool watchFolder(const std::string& folder);
+		void unwatchFolder(const std::string& folder);
+
+		void unwatchAll();
+
+		/*
+		 * Returns false if file (or folder) is not watched or its folder was removed or moved,
+		 * in this case file should be watched again or polled by caller
+		 */
+		bool watching(const std::string& fileName) const;
+
+		void setDebounceInterval(uint64_t milliseconds);
+
+		/*
+		 * Does not touch file system and could be called each frame
+		 */
+		bool hasChanges() const;
+
+		StringList takeChanges();
+
+		size_t watchedFilesCount() const;
+		size_t watchedFoldersCount() const;
+
+	private:
+		ET_DENY_COPY(FileWatcher)
+		ET_DECLARE_PIMPL(FileWatcher, 512)
+	};
+}
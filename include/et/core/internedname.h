@@ -0,0 +1,71 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/core/et.h>
+
+namespace et
+{
+	/*
+	 * Identifier of string stored in global table. Interned names are compared
+	 * and hashed as integers; strings are never removed from the table.
+	 */
+	class InternedName
+	{
+	public:
+		enum : uint32_t
+		{
+			EmptyIdentifier = 0,
+			MissingIdentifier = static_cast<uint32_t>(-1)
+		};
+
+	public:
+		InternedName() = default;
+
+		/*
+		 * Adds string to table if needed
+		 */
+		explicit InternedName(const std::string&);
+
+		/*
+		 * Does not modify table, returns name which is not equal
+		 * to any interned name if string was never interned
+		 */
+		static InternedName find(const std::string&);
+
+		uint32_t identifier() const
+			{ return _identifier; }
+
+		const std::string& string() const;
+
+		bool empty() const
+			{ return _identifier == EmptyIdentifier; }
+
+		bool operator == (const InternedName& n) const
+			{ return _identifier == n._identifier; }
+
+		bool operator != (const InternedName& n) const
+			{ return _identifier != n._identifier; }
+
+		bool operator < (const InternedName& n) const
+			{ return _identifier < n._identifier; }
+
+	private:
+		uint32_t _identifier = EmptyIdentifier;
+	};
+}
+
+namespace std
+{
+	template <>
+	struct hash<et::InternedName>
+	{
+		size_t operator()(const et::InternedName& n) const
+			{ return static_cast<size_t>(n.identifier()); }
+	};
+}
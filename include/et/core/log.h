@@ -29,6 +29,30 @@ namespace et
 		
 		void addOutput(Output::Pointer);
 		void removeOutput(Output::Pointer);
+
+		/*
+		 * Asynchronous output: calling thread packs format string and arguments
+		 * into its own lock-free ring, background thread formats messages
+		 * and passes them to outputs in timestamp order. Rings are drained
+		 * on flush, on disable and when process receives fatal signal.
+		 */
+		enum : uint32_t
+		{
+			bytesPerThread = 64 * 1024
+		};
+
+		enum class OverflowPolicy : uint32_t
+		{
+			DropMessage,
+			WaitForSpace
+		};
+
+		void enableAsyncOutput(OverflowPolicy = OverflowPolicy::DropMessage);
+		void disableAsyncOutput();
+		bool asyncOutputEnabled();
+
+		void flush();
+		uint64_t droppedMessages();
 		
 		class FileOutput : public Output
 		{
@@ -0,0 +1,46 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/core/et.h>
+
+namespace et
+{
+	/*
+	 * Read-only view of whole file mapped into address space,
+	 * pages are loaded by system on first access and could be read from any thread
+	 */
+	class MappedFilePrivate;
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		MappedFile(const std::string& fileName);
+		~MappedFile();
+
+		bool open(const std::string& fileName);
+		void close();
+
+		bool valid() const
+			{ return _data != nullptr; }
+
+		const char* data() const
+			{ return _data; }
+
+		uint64_t size() const
+			{ return _size; }
+
+	private:
+		ET_DENY_COPY(MappedFile)
+		ET_DECLARE_PIMPL(MappedFile, 32)
+
+	private:
+		const char* _data = nullptr;
+		uint64_t _size = 0;
+	};
+}
@@ -25,7 +25,17 @@ namespace et
 			{ }
 
 	public:
-		ET_DECLARE_PROPERTY_GET_REF_SET_REF(std::string, name, setName)
+		const std::string& name() const
+			{ return _name; }
+
+		/*
+		 * Virtual, so derived objects could keep data depending on name up to date
+		 */
+		virtual void setName(const std::string& aName)
+			{ _name = aName; }
+
+	private:
+		std::string _name;
 	};
 
 	class RenderContext;
@@ -60,6 +70,12 @@ namespace et
 
 		bool canBeReloaded() const
 			{ return !(_origin.empty() && _distributedOrigins.empty()); }
+		
+		/*
+		 * Size in bytes used by ObjectsCache to keep objects within memory budget
+		 */
+		virtual uint64_t memoryUsage() const
+			{ return 0; }
 	
 	private:
 		std::string _origin;
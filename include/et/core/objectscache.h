@@ -7,15 +7,49 @@
 
 #pragma once
 
+#include <list>
+#include <typeindex>
 #include <unordered_map>
 #include <et/core/et.h>
 #include <et/threading/criticalsection.h>
+#include <et/core/filewatcher.h>
 #include <et/timers/timedobject.h>
 
 namespace et
 {
+	/*
+	 * Reloads managed objects when their files change. Files are watched with FileWatcher
+	 * where it is available and polled every half a second otherwise, reloading is performed
+	 * on run loop where monitoring was started.
+	 *
+	 * Objects are accounted by LoadableObject::memoryUsage and grouped by their dynamic type.
+	 * When type exceeds its memory budget, least recently used objects of this type, which are
+	 * referenced only by cache and are not pinned, are evicted. Types are not limited by default.
+	 *
+	 * Removed objects are destroyed outside of the lock and only on the main thread, since
+	 * destruction of rendering objects requires render context. Objects removed on other threads
+	 * are kept until the next call made on the main thread, including update of the cache.
+	 */
 	class ObjectsCache : public TimedObject
 	{
+	public:
+		enum : uint64_t
+		{
+			UnlimitedMemoryBudget = std::numeric_limits<uint64_t>::max()
+		};
+
+		struct Statistics
+		{
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			uint64_t evictions = 0;
+			uint64_t residentObjects = 0;
+			uint64_t residentMemory = 0;
+
+			float hitRate() const
+				{ return (hits + misses > 0) ? static_cast<float>(hits) / static_cast<float>(hits + misses) : 0.0f; }
+		};
+
 	public:
 		ObjectsCache();
 		~ObjectsCache();
@@ -29,6 +63,33 @@ namespace et
 		std::vector<LoadableObject::Pointer> findObjects(const std::string& key);
 		LoadableObject::Pointer findAnyObject(const std::string& key, uint64_t* property = nullptr);
 
+		/*
+		 * Pinned objects are never evicted or flushed, pins are counted
+		 */
+		void pin(const LoadableObject::Pointer&);
+		void unpin(const LoadableObject::Pointer&);
+
+		void setMemoryBudget(const std::type_index&, uint64_t);
+		uint64_t memoryBudget(const std::type_index&);
+		uint64_t memoryUsage(const std::type_index&);
+
+		template <typename T>
+		void setMemoryBudget(uint64_t budget)
+			{ setMemoryBudget(std::type_index(typeid(T)), budget); }
+
+		/*
+		 * Should be called when size of object changes outside of reloading,
+		 * size is also updated each time object is found in cache
+		 */
+		void updateMemoryUsage(const LoadableObject::Pointer&);
+
+		/*
+		 * Misses are not attributed to types and are reported only in overall statistics
+		 */
+		Statistics statistics();
+		Statistics statistics(const std::type_index&);
+		void resetStatistics();
+
 		void startMonitoring();
 		void stopMonitoring();
 		void report();
@@ -40,6 +101,7 @@ namespace et
 		ET_DENY_COPY(ObjectsCache)
 
 		void performUpdate();
+		void reloadChangedFiles(const StringList&);
 		void update(float t);
 
 	private:
@@ -48,30 +110,58 @@ namespace et
 			LoadableObject::Pointer object;
 			ObjectLoader::Pointer loader;
 			std::unordered_map<std::string, uint64_t> identifiers;
+			std::string key;
+			std::type_index type;
+			uint64_t memoryUsage = 0;
+			uint32_t pins = 0;
+			bool watched = false;
 
-			ObjectProperty()
-				{ }
-			
 			ObjectProperty(LoadableObject::Pointer o, ObjectLoader::Pointer l) :
-				object(o), loader(l) { }
+				object(o), loader(l), key(o->origin()), type(typeid(o.reference())) { }
 		};
 		
-		typedef std::vector
+		typedef std::list
 		<
 			ObjectProperty
 		> ObjectPropertyList;
+
+		struct TypeEntry
+		{
+			ObjectPropertyList objects;
+			uint64_t memoryBudget = UnlimitedMemoryBudget;
+			uint64_t memoryUsage = 0;
+			uint64_t hits = 0;
+			uint64_t evictions = 0;
+		};
 		
 		typedef std::unordered_map
 		<
 			std::string,
-			ObjectPropertyList,
+			std::vector<ObjectPropertyList::iterator>,
 			std::hash<std::string>,
 			std::equal_to<std::string>,
-			SharedBlockAllocatorSTDProxy< std::pair<const std::string, ObjectPropertyList> >
+			SharedBlockAllocatorSTDProxy< std::pair<const std::string, std::vector<ObjectPropertyList::iterator>> >
 		> ObjectMap;
 
+		TypeEntry& typeEntry(const std::type_index&);
+		void touch(ObjectPropertyList::iterator);
+		void refreshMemoryUsage(ObjectProperty&);
+		void evict(TypeEntry&);
+		void remove(ObjectPropertyList::iterator);
+		void releaseObjects();
+
+		void watchFiles(ObjectProperty&);
+		void releaseFiles(const ObjectProperty&);
+
+	private:
 		CriticalSection _lock;
+		std::unordered_map<std::type_index, TypeEntry> _types;
+		std::unordered_map<const LoadableObject*, ObjectPropertyList::iterator> _entries;
 		ObjectMap _objects;
+		std::vector<LoadableObject::Pointer> _releasedObjects;
+		FileWatcher _watcher;
+		std::atomic<size_t> _polledObjects;
+		uint64_t _misses = 0;
 		float _updateTime = 0.0f;
 	};
 }
@@ -0,0 +1,92 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/core/et.h>
+
+#define ET_PROFILE_CONCAT_IMPL(A, B)	A##B
+#define ET_PROFILE_CONCAT(A, B)			ET_PROFILE_CONCAT_IMPL(A, B)
+#define ET_PROFILE_SCOPE(NAME)			et::profiler::Scope ET_PROFILE_CONCAT(etProfileScope, __LINE__)(NAME)
+
+namespace et
+{
+	namespace profiler
+	{
+		/*
+		 * Each thread writes completed scopes into its own fixed-size ring buffer,
+		 * oldest events are overwritten when buffer is full.
+		 */
+		enum : size_t
+		{
+			eventsPerThread = 16384
+		};
+
+		struct Event
+		{
+			const char* name = nullptr;
+			uint64_t begin = 0;
+			uint64_t end = 0;
+		};
+
+		extern std::atomic<bool> enabledFlag;
+
+		inline bool enabled()
+			{ return enabledFlag.load(std::memory_order_relaxed); }
+
+		void setEnabled(bool);
+
+		/*
+		 * Monotonic time in nanoseconds
+		 */
+		uint64_t timestamp();
+
+		/*
+		 * Name is displayed in trace viewer for events of the calling thread.
+		 * Pointer should remain valid for entire application lifetime.
+		 * Ignored while profiling is disabled.
+		 */
+		void setThreadName(const char*);
+
+		void submit(const char* name, uint64_t begin, uint64_t end);
+
+		/*
+		 * Capture window: events which begin after beginCapture and end
+		 * before endCapture are written to trace
+		 */
+		void beginCapture();
+		void endCapture();
+
+		/*
+		 * Writes events from capture window in Chrome trace_event format
+		 * (could be opened in chrome://tracing)
+		 */
+		void writeChromeTrace(std::ostream&);
+		void writeChromeTrace(std::ostream&, uint64_t from, uint64_t to);
+		bool writeChromeTrace(const std::string& fileName);
+
+		class Scope
+		{
+		public:
+			explicit Scope(const char* name) :
+				_name(name), _begin(enabled() ? timestamp() : 0) { }
+
+			~Scope()
+			{
+				if (_begin > 0)
+					submit(_name, _begin, timestamp());
+			}
+
+		private:
+			ET_DENY_COPY(Scope)
+
+		private:
+			const char* _name = nullptr;
+			uint64_t _begin = 0;
+		};
+	}
+}
@@ -24,6 +24,14 @@ namespace et
 		
 		size_t maxConcurrentThreads();
 		
+		/*
+		 * Splits [0, count) into ranges of at least minimalRange elements and processes
+		 * them on shared worker threads and calling thread, returns when all ranges are done.
+		 * Nested calls and calls made while workers are busy are executed on calling thread.
+		 */
+		using RangeFunction = std::function<void(size_t begin, size_t end)>;
+		void parallelFor(size_t count, size_t minimalRange, const RangeFunction&);
+		
 		ThreadIdentifier currentThread();
 		
 		void sleep(float seconds);
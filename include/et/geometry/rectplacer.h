@@ -11,27 +11,110 @@
 
 namespace et
 {
+	/*
+	 * Packs rectangles into fixed size area. MaxRects keeps list of maximal free rectangles
+	 * and chooses one with the best short side fit, Skyline keeps upper contour of placed
+	 * rectangles and chooses the lowest position. MaxRects gives denser packing,
+	 * Skyline is faster and uses less memory.
+	 */
 	class RectPlacer
 	{
 	public:
 		typedef std::vector<recti> RectList;
+		typedef std::vector<RectPlacer> List;
+
+		enum class Method : uint32_t
+		{
+			MaxRects,
+			Skyline
+		};
+
+		enum : uint32_t
+		{
+			InvalidPage = static_cast<uint32_t>(-1)
+		};
+
+		struct BatchItem
+		{
+			vec2i size;
+			recti place;
+			uint32_t page = InvalidPage;
+			bool rotated = false;
+
+			BatchItem() = default;
+			BatchItem(const vec2i& s) :
+				size(s) { }
+		};
 
 	public:
-		RectPlacer(const vec2i& contextSize, bool addSpace);
+		RectPlacer(const vec2i& contextSize, bool addSpace, Method = Method::MaxRects,
+			bool allowRotation = false);
 		
-		bool place(const vec2i& size, recti& placedPosition);
+		/*
+		 * Placed rect includes space if requested, rotated rect has swapped size
+		 */
+		bool place(const vec2i& size, recti& placedPosition, bool* rotated = nullptr);
 
 		const RectList& placedItems() const 
 			{ return _placedItems; }
 		
+		/*
+		 * Marks area as occupied, Skyline method also discards free space below it
+		 */
 		void addPlacedRect(const recti&);
 		
 		const vec2i& contextSize() const
 			{ return _contextSize; }
 
+		Method method() const
+			{ return _method; }
+
+		/*
+		 * Ratio of occupied area to area of context
+		 */
+		float occupancy() const;
+
+		void reset();
+
+		/*
+		 * Places items sorted by area starting from the largest, new page is opened when item
+		 * does not fit into existing pages. Items larger than page and items exceeding
+		 * maximum number of pages keep invalid page index.
+		 */
+		static List placeBatch(std::vector<BatchItem>& items, const vec2i& pageSize, bool addSpace,
+			Method = Method::MaxRects, bool allowRotation = false, uint32_t maxPages = InvalidPage);
+
+	private:
+		struct SkylineNode
+		{
+			int x = 0;
+			int y = 0;
+			int width = 0;
+
+			SkylineNode() = default;
+			SkylineNode(int ax, int ay, int w) :
+				x(ax), y(ay), width(w) { }
+		};
+
+		void occupy(const recti&);
+
+		bool findMaxRectsPosition(int w, int h, recti&, bool& rotated) const;
+		void splitFreeRects(const recti&);
+		void pruneFreeRects(size_t firstNewRect);
+
+		bool findSkylinePosition(int w, int h, recti&, bool& rotated) const;
+		bool skylineFits(size_t nodeIndex, int w, int h, int& y) const;
+		void splitSkyline(int x);
+		void raiseSkyline(const recti&);
+
 	private:
 		vec2i _contextSize;
 		RectList _placedItems;
-		bool _addSpace;
+		RectList _freeRects;
+		std::vector<SkylineNode> _skyline;
+		int64_t _usedArea = 0;
+		Method _method = Method::MaxRects;
+		bool _addSpace = false;
+		bool _allowRotation = false;
 	};
 }
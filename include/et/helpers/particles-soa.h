@@ -0,0 +1,148 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/core/containers.h>
+#include <et/helpers/particles.h>
+
+namespace et
+{
+	namespace particles
+	{
+		/*
+		 * Batched xorshift generator, produces four independent streams at once
+		 */
+		class RandomGenerator
+		{
+		public:
+			RandomGenerator(uint32_t seed = 0);
+
+			/*
+			 * Fills output with uniformly distributed values in [low, up)
+			 */
+			void generate(float* output, size_t count, float low, float up);
+
+		private:
+			ET_ALIGNED(16) uint32_t _state[4];
+		};
+
+		/*
+		 * PointSprite emitter with particles stored as separate aligned streams.
+		 * Movement and variation are fixed to defaultMovementFunction and
+		 * defaultVariationFunction, which allows to update particles four at once.
+		 * Dead particles are removed by moving last active particle in their place,
+		 * so order of particles is not preserved.
+		 */
+		class SoAEmitter
+		{
+		public:
+			enum Stream : size_t
+			{
+				Stream_PositionX,
+				Stream_PositionY,
+				Stream_PositionZ,
+				Stream_VelocityX,
+				Stream_VelocityY,
+				Stream_VelocityZ,
+				Stream_AccelerationX,
+				Stream_AccelerationY,
+				Stream_AccelerationZ,
+				Stream_ColorR,
+				Stream_ColorG,
+				Stream_ColorB,
+				Stream_ColorA,
+				Stream_Size,
+				Stream_EmitTime,
+				Stream_LifeTime,
+
+				Stream_max
+			};
+
+			/*
+			 * Interleaved vec3 position and vec4 color, written by writeVertices
+			 */
+			enum : size_t
+			{
+				VertexSize = 7 * sizeof(float)
+			};
+
+		public:
+			SoAEmitter(size_t capacity);
+
+			size_t capacity() const
+				{ return _capacity; }
+
+			size_t activeParticlesCount() const
+				{ return _activeParticles; }
+
+			const float* stream(Stream s) const
+				{ return _streams[s]; }
+
+			PointSprite particle(size_t) const;
+
+			void setShouldAutoRenewParticles(bool a)
+				{ _autoRenewParticles = a; }
+
+			PointSprite& base()
+				{ return _base; }
+
+			const PointSprite& base() const
+				{ return _base; }
+
+			PointSprite& variation()
+				{ return _variation; }
+
+			const PointSprite& variation() const
+				{ return _variation; }
+
+			void setBase(const PointSprite& p)
+				{ _base = p; }
+
+			void setVariation(const PointSprite& v)
+				{ _variation = v; }
+
+			bool emit(const PointSprite&);
+			size_t emit(size_t count, float t);
+			size_t emit(size_t count, float t, const PointSprite& base, const PointSprite& var);
+			size_t emitMissingParticles(float t);
+
+			void clear()
+				{ _activeParticles = 0; }
+
+			void update(float t);
+
+			/*
+			 * Writes VertexSize bytes per active particle. Uses non-temporal stores
+			 * when output is 16-byte aligned, intended for mapped vertex buffers.
+			 */
+			void writeVertices(void* output) const;
+
+		private:
+			ET_DENY_COPY(SoAEmitter)
+
+			void integrate(float t, float dt);
+			void respawnDeadParticles(float t);
+			void removeDeadParticles();
+
+		private:
+			DataStorage<float> _storage;
+			float* _streams[Stream_max] = { };
+			DataStorage<float> _random;
+			std::vector<uint32_t> _deadParticles;
+
+			RandomGenerator _rng;
+			PointSprite _base;
+			PointSprite _variation;
+
+			size_t _capacity = 0;
+			size_t _activeParticles = 0;
+			float _updateTime = 0.0f;
+			bool _autoRenewParticles = true;
+		};
+	}
+}
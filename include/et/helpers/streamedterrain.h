@@ -0,0 +1,96 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/helpers/terraindata.h>
+#include <et/rendering/rendercontext.h>
+
+namespace et
+{
+	/*
+	 * Terrain for heightmaps which do not fit into memory. RAW heightmap is memory mapped
+	 * and covered by quadtree of tiles with the same number of vertices, each level
+	 * of quadtree samples heightmap twice as sparse as the level below. Tiles around camera
+	 * are built on worker threads, uploaded in update and evicted when memory budget
+	 * is exceeded. Root tile is built on open and always stays resident.
+	 *
+	 * Queries use the finest resident tiles and should be called from the thread
+	 * which calls update.
+	 */
+	class StreamedTerrainPrivate;
+	class StreamedTerrain : public Shared
+	{
+	public:
+		ET_DECLARE_POINTER(StreamedTerrain)
+
+		struct Parameters
+		{
+			vec2i dimension;
+			TerrainData::Format format = TerrainData::Format_16bit;
+
+			/*
+			 * Heightmap is stretched over size, y component is height of the highest sample
+			 */
+			vec3 origin = vec3(0.0f);
+			vec3 size = vec3(1.0f);
+
+			/*
+			 * Cells per tile side, power of two not greater than 128
+			 */
+			uint32_t tileSize = 64;
+
+			/*
+			 * Tile is split while distance to camera is less than its size multiplied by factor
+			 */
+			float detailFactor = 2.0f;
+
+			size_t memoryBudget = 128 * 1024 * 1024;
+			uint32_t maxUploadsPerUpdate = 4;
+		};
+
+	public:
+		/*
+		 * Render context could be null to use terrain for queries only
+		 */
+		StreamedTerrain(RenderContext*);
+		~StreamedTerrain();
+
+		bool open(const std::string& fileName, const Parameters&);
+		void close();
+
+		bool isOpen() const;
+
+		/*
+		 * Selects tiles to render, requests missing tiles, uploads loaded ones
+		 * and evicts least recently used tiles over memory budget
+		 */
+		void update(const vec3& cameraPosition);
+		void render(RenderContext*);
+
+		/*
+		 * Return false for points outside of terrain
+		 */
+		bool heightAtPoint(const vec3&, float& height) const;
+		bool normalAtPoint(const vec3&, vec3& normal) const;
+
+		TerrainContact contactForSphere(const Sphere&) const;
+		void gatherContactsForSphere(const Sphere&, TerrainDataDelegate* contactDelegate) const;
+
+		const Parameters& parameters() const;
+		AABB bounds() const;
+
+		size_t visibleTileCount() const;
+		size_t residentTileCount() const;
+		size_t pendingTileCount() const;
+		size_t residentMemory() const;
+
+	private:
+		ET_DENY_COPY(StreamedTerrain)
+		ET_DECLARE_PIMPL(StreamedTerrain, 1024)
+	};
+}
@@ -10,6 +10,7 @@
 #include <et/core/containers.h>
 #include <et/collision/collision.h>
 #include <et/primitives/primitives.h>
+#include <et/camera/camera.h>
 #include <et/rendering/rendercontext.h>
 #include <et/helpers/terraindata.h>
 
@@ -26,6 +27,21 @@ namespace et
 			{ return 0; };
 	};
 
+	/*
+	 * Terrain is split into chunks of 32x32 cells, each chunk is rendered with one of LodLevel_max
+	 * levels of detail, level N skips every 2^N - 1 of 2^N rows and columns. Chunk borders are
+	 * stitched to the coarser of two neighbor levels, so there are no cracks between any levels.
+	 *
+	 * Vertices store offset to the position they take on the coarser level in TexCoord1.xyz
+	 * and level at which they disappear plus 8 * border category in TexCoord1.w. For geomorphing
+	 * programs passed to render receive vec2 morphParameters[5] (level and morph factor)
+	 * for chunk interior, vertical even and odd chunk borders, horizontal even and odd ones:
+	 *
+	 *   float category = floor(morph.w / 8.0);
+	 *   vec2 parameters = morphParameters[int(category)];
+	 *   float factor = (morph.w - 8.0 * category == parameters.x + 1.0) ? parameters.y : 0.0;
+	 *   position += factor * morph.xyz;
+	 */
 	class Terrain : public Shared
 	{
 	public:
@@ -47,8 +63,30 @@ namespace et
 		void loadFromRAWFile(const std::string& fileName, const vec2i& dimension, TerrainData::Format format);
 		void loadFromStream(std::istream& stream, const vec2i& dimension, TerrainData::Format format);
 
+		/*
+		 * Levels are chosen by delegate, without geomorphing
+		 */
 		void recomputeLodLevels();
+
+		/*
+		 * Chooses the coarsest level with projected geometric error below screenSpaceError pixels
+		 * and morphs chunks towards the next level as its projected error approaches the limit
+		 */
+		void recomputeLodLevels(const Camera& camera, float viewportHeight);
+
 		void render(RenderContext* rc);
+		void render(RenderContext* rc, Program::Pointer program);
+
+		float screenSpaceError() const
+			{ return _screenSpaceError; }
+
+		void setScreenSpaceError(float pixels)
+			{ _screenSpaceError = etMax(pixels, std::numeric_limits<float>::epsilon()); }
+
+		/*
+		 * Number of triangles in visible chunks with currently selected levels
+		 */
+		size_t triangleCount() const;
 
 		inline const TerrainDataRef terrainData() const
 			{ return _tdata; }
@@ -59,7 +97,21 @@ namespace et
 
 		void generateBuffer();
 		void generateChunks();
+		void generateMorphData();
 		void validateLODLevels();
+		void morphParameters(const TerrainChunk*, vec2* parameters) const;
+
+#if (ET_DEBUG)
+		/*
+		 * Rebuilds indices of all chunks with currently selected levels and checks
+		 * that there are no cracks or overlaps: every edge inside terrain is shared
+		 * by two triangles, edge on terrain border belongs to one and every vertex
+		 * morphs to the same position in all chunks using it.
+		 */
+		bool validateStitching() const;
+#endif
+
+		void renderChunk(RenderContext* rc, TerrainChunk*);
 
 		void releaseData();
 
@@ -73,10 +125,11 @@ namespace et
 		TerrainChunkList _chunks;
 
 		VertexBuffer::Pointer _vertexBuffer;
-		IndexBuffer _indexBuffer;
+		IndexBuffer::Pointer _indexBuffer;
 		VertexArrayObject _vao;
 
 		vec2i _chunkSizes;
+		float _screenSpaceError = 2.0f;
 	};
 
 	typedef IntrusivePtr<Terrain> TerrainRef;
@@ -19,7 +19,7 @@ namespace et
 		typedef std::vector<TextureDescription::Pointer> List;
 
 	public:
-		vec2i sizeForMipLevel(size_t level)
+		vec2i sizeForMipLevel(size_t level) const
 		{
 			vec2i result = size;
 			for (size_t i = 0; i < level; ++i)
@@ -27,14 +27,14 @@ namespace et
 			return result;
 		}
 
-		size_t dataSizeForMipLevel(size_t level)
+		size_t dataSizeForMipLevel(size_t level) const
 		{
 			size_t actualSize = static_cast<size_t>(sizeForMipLevel(level).square()) * bitsPerPixel / 8;
 			size_t minimumSize = static_cast<size_t>(minimalSizeForCompressedFormat.square()) * bitsPerPixel / 8;
 			return compressed ? etMax(minimalDataSize, etMax(minimumSize, actualSize)) : actualSize;
 		}
 
-		size_t dataSizeForAllMipLevels()
+		size_t dataSizeForAllMipLevels() const
 		{
 			size_t result = 0;
 			for (size_t i = 0; i < mipMapCount; ++i)
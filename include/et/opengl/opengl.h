@@ -134,6 +134,7 @@ namespace et
 		OpenGLFeature_DrawElementsBaseVertex = 0x00000008,
 		OpenGLFeature_VertexArrayObjects = 0x00000010,
 		OpenGLFeature_VertexTextureFetch = 0x00000020,
+		OpenGLFeature_ProgramBinary = 0x00000040,
 	};
 	
 	struct OpenGLDebugScope
@@ -170,6 +171,7 @@ namespace et
 	void etDrawElements(uint32_t mode, GLsizei count, uint32_t type, const GLvoid* indices);
 	void etDrawElementsInstanced(uint32_t mode, GLsizei count, uint32_t type, const GLvoid* indices, GLsizei instanceCount);
 	void etDrawElementsBaseVertex(uint32_t mode, GLsizei count, uint32_t type, const GLvoid* indices, int base);
+	void etMultiDrawElements(uint32_t mode, const GLsizei* count, uint32_t type, const GLvoid* const* indices, GLsizei drawCount);
 	void etBindTexture(uint32_t target, uint32_t texture);
 	void etBindBuffer(uint32_t target, uint32_t buffer);
 	void etBindFramebuffer(uint32_t target, uint32_t framebuffer);
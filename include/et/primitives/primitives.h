@@ -16,6 +16,12 @@ namespace et
 {
 	namespace primitives
 	{
+		enum class NormalsWeighting : uint32_t
+		{
+			Area,
+			Angle
+		};
+
 		size_t primitiveCountForIndexCount(size_t numIndexes, PrimitiveType geometryType);
 		
 		uint32_t indexCountForRegularMesh(const vec2i& meshSize, PrimitiveType geometryType);
@@ -61,6 +67,21 @@ namespace et
 		void calculateTangents(VertexStorage::Pointer data, const IndexArray::Pointer& buffer,
 			uint32_t first, uint32_t last);
 
+		/*
+		 * Split triangles between worker threads, each vertex is accumulated by single thread
+		 * in the same order as serial versions do. Index buffers of other primitive types
+		 * are processed with serial versions.
+		 */
+		void calculateNormalsParallel(VertexArray::Pointer data, const IndexArray::Pointer& buffer,
+			size_t first, size_t last, NormalsWeighting weighting = NormalsWeighting::Area);
+		void calculateNormalsParallel(VertexStorage::Pointer data, const IndexArray::Pointer& buffer,
+			size_t first, size_t last, NormalsWeighting weighting = NormalsWeighting::Area);
+
+		void calculateTangentsParallel(VertexArray::Pointer data, const IndexArray::Pointer& buffer,
+			uint32_t first, uint32_t last);
+		void calculateTangentsParallel(VertexStorage::Pointer data, const IndexArray::Pointer& buffer,
+			uint32_t first, uint32_t last);
+
 		void smoothTangents(VertexArray::Pointer data, const IndexArray::Pointer& buffer,
 			uint32_t first, uint32_t last);
 		
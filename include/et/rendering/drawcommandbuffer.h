@@ -0,0 +1,141 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/rendering/renderstate.h>
+
+namespace et
+{
+	/*
+	 * Collects draw packets during frame, sorts them by state key and submits
+	 * them with minimal number of state changes. Adjacent packets with the same
+	 * state and vertex array object are merged into single or multi-draw calls.
+	 * Objects referenced by packets should stay alive until submit.
+	 */
+	class DrawCommandBuffer
+	{
+	public:
+		enum : size_t
+		{
+			MaxTextures = 4
+		};
+
+		struct Packet;
+
+		/*
+		 * Called after state of packet is bound and before it is drawn,
+		 * packets with callback are never merged
+		 */
+		typedef void(*PacketCallback)(const Packet&);
+
+		/*
+		 * Texture units with null texture are left unchanged
+		 */
+		struct Packet
+		{
+			Program* program = nullptr;
+			VertexArrayObjectData* vertexArrayObject = nullptr;
+			Texture* textures[MaxTextures] = { };
+			BlendState blendState = BlendState::Disabled;
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			uint32_t instanceCount = 1;
+			PacketCallback callback = nullptr;
+			void* userData = nullptr;
+		};
+
+		struct Statistics
+		{
+			size_t packets = 0;
+			size_t drawCalls = 0;
+			size_t stateChanges = 0;
+			size_t drawCallsSaved = 0;
+			size_t stateChangesSaved = 0;
+		};
+
+		/*
+		 * Receives draw calls and state changes produced by submit.
+		 * Only actual changes of state are passed to backend.
+		 */
+		class Backend
+		{
+		public:
+			virtual ~Backend() { }
+
+			virtual void bindProgram(Program*) = 0;
+			virtual void bindVertexArray(VertexArrayObjectData*) = 0;
+			virtual void bindTexture(uint32_t unit, Texture*) = 0;
+			virtual void setBlendState(BlendState) = 0;
+
+			virtual void drawElements(VertexArrayObjectData*, uint32_t first, uint32_t count,
+				uint32_t instances) = 0;
+
+			virtual void multiDrawElements(VertexArrayObjectData*, const uint32_t* first,
+				const uint32_t* count, size_t drawCount) = 0;
+		};
+
+	public:
+		DrawCommandBuffer() = default;
+
+		/*
+		 * Removes recorded packets, keeps allocated memory
+		 */
+		void reset();
+
+		/*
+		 * Packets with blending enabled are drawn after opaque ones in recorded order
+		 */
+		void record(const Packet&);
+
+		/*
+		 * Sorts and submits recorded packets through render state of context
+		 * and removes them from buffer
+		 */
+		void submit(RenderContext*);
+		void submit(Backend&);
+
+		size_t packetsCount() const
+			{ return _packets.size(); }
+
+		/*
+		 * Statistics of the last submit
+		 */
+		const Statistics& statistics() const
+			{ return _statistics; }
+
+	private:
+		ET_DENY_COPY(DrawCommandBuffer)
+
+		struct SortEntry
+		{
+			uint64_t key = 0;
+			uint32_t firstIndex = 0;
+			uint32_t packetIndex = 0;
+		};
+
+		struct BoundState
+		{
+			Program* program = nullptr;
+			VertexArrayObjectData* vertexArrayObject = nullptr;
+			Texture* textures[MaxTextures] = { };
+			BlendState blendState = BlendState::Current;
+		};
+
+		uint64_t sortKey(const Packet&, uint32_t packetIndex) const;
+		size_t applyState(const Packet&, BoundState&, Backend*);
+		size_t countUnsortedStateChanges();
+		bool canMerge(const Packet&, const Packet&) const;
+
+	private:
+		std::vector<Packet> _packets;
+		std::vector<SortEntry> _sortEntries;
+		std::vector<uint32_t> _drawFirst;
+		std::vector<uint32_t> _drawCount;
+		Statistics _statistics;
+	};
+}
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <unordered_map>
+#include <et/core/internedname.h>
 #include <et/rendering/apiobject.h>
 #include <et/rendering/rendering.h>
 
@@ -37,7 +38,14 @@ namespace et
 				name(aName), usage(aUsage), builtIn(isBuiltIn ? 1 : 0) { }
 		};
 		
+		struct UniformBlock
+		{
+			uint32_t index = 0;
+			uint32_t dataSize = 0;
+		};
+		
 		typedef std::unordered_map<std::string, Uniform> UniformMap;
+		typedef std::unordered_map<std::string, UniformBlock> UniformBlockMap;
 		
 	public:
 		Program(RenderContext*);
@@ -46,11 +54,19 @@ namespace et
 			const std::string& fragmentShader, const std::string& objName, const std::string& origin,
 			const StringList& defines);
 
+		/*
+		 * Creates program object without shaders, it should be
+		 * built from source code or loaded from binary later
+		 */
+		Program(RenderContext*, const std::string& objName, const std::string& origin,
+			const StringList& defines);
+
 		~Program();
 
 		int getUniformLocation(const std::string& uniform) const;
 		uint32_t getUniformType(const std::string& uniform) const;
 		Program::Uniform getUniform(const std::string& uniform) const;
+		Program::Uniform getUniform(const InternedName& uniform) const;
 
 		bool validate() const;
 		
@@ -84,6 +100,14 @@ namespace et
 		const Program::UniformMap& uniforms() const 
 			{ return _uniforms; }
 
+		/*
+		 * Uniform blocks are sourced from uniform buffers bound to binding points
+		 */
+		const Program::UniformBlockMap& uniformBlocks() const
+			{ return _uniformBlocks; }
+
+		bool setUniformBlockBinding(const std::string& block, uint32_t bindingPoint);
+
 		void setUniform(int, uint32_t, const int32_t, bool);
 		void setUniform(int, uint32_t, const uint32_t, bool);
 		void setUniform(int, uint32_t, const int64_t, bool);
@@ -128,6 +152,25 @@ namespace et
 				setUniform(i->second.location, i->second.type, value, amount);
 		}
 		
+		/*
+		 * Interned names are looked up without hashing strings
+		 */
+		template <typename T>
+		void setUniform(const InternedName& name, const T& value, bool force = false)
+		{
+			auto i = _uniformsByName.find(name);
+			if (i != _uniformsByName.end())
+				setUniform(i->second.location, i->second.type, value, force);
+		}
+		
+		template <typename T>
+		void setUniform(const InternedName& name, const T* value, size_t amount)
+		{
+			auto i = _uniformsByName.find(name);
+			if (i != _uniformsByName.end())
+				setUniform(i->second.location, i->second.type, value, amount);
+		}
+		
 		template <typename T>
 		void setUniform(const Program::Uniform& u, const T& value, bool force = false)
 			{ setUniform(u.location, u.type, value, force); }
@@ -143,20 +186,48 @@ namespace et
 		void buildProgram(const std::string& vertex_source, const std::string& geom_source,
 			const std::string& frag_source);
 		
+		/*
+		 * Program binaries are specific to driver and its version,
+		 * loading fails if binary was produced by another driver
+		 */
+		bool loadBinary(uint32_t format, const BinaryDataStorage&);
+		bool retrieveBinary(uint32_t& format, BinaryDataStorage&) const;
+		
 		const StringList& defines() const
 			{ return _defines; }
 
+		/*
+		 * Size of linked binary reported by driver when program was linked
+		 * and size of last values kept for uniforms
+		 */
+		uint64_t memoryUsage() const override
+			{ return _binarySize + _uniformShadowData.dataSize(); }
+
 	private:
 		Program::UniformMap::const_iterator findUniform(const std::string& name) const;
 		
 		int link();
+		void enumerateAttributes(bool bindLocations);
+		void enumerateUniforms();
+		void buildUniformShadows();
+		bool shouldUpdateUniform(int location, const void* value, size_t size, bool force);
+		void invalidateUniform(int location);
 		void printShaderLog(uint32_t, size_t, const char*);
 		void printShaderSource(uint32_t, size_t, const char*);
 
 	private:
 		RenderContext* _rc;
 		
+		struct UniformShadow
+		{
+			uint32_t offset = 0;
+			uint32_t size = 0;
+			bool initialized = false;
+		};
+		
 		Program::UniformMap _uniforms;
+		Program::UniformBlockMap _uniformBlocks;
+		std::unordered_map<InternedName, Uniform> _uniformsByName;
 		std::vector<Attribute> _attributes;
 
 		int _mModelViewLocation;
@@ -166,15 +237,12 @@ namespace et
 		int _mLightProjectionMatrixLocation;
 		int _mTransformLocation;
 
-		std::map<int, float> _floatCache;
-		std::map<int, vec2> _vec2Cache;
-		std::map<int, vec3> _vec3Cache;
-		std::map<int, vec4> _vec4Cache;
-		std::map<int, vec2i> _vec2iCache;
-		std::map<int, vec3i> _vec3iCache;
-		std::map<int, vec4i> _vec4iCache;
-		std::map<int, mat3> _mat3Cache;
-		std::map<int, mat4> _mat4Cache;
+		/*
+		 * Last values set to uniforms, indexed by location
+		 */
+		std::vector<UniformShadow> _uniformShadows;
+		BinaryDataStorage _uniformShadowData;
+		uint64_t _binarySize = 0;
 
 		StringList _defines;
 	};
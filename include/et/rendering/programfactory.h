@@ -18,6 +18,15 @@ namespace et
 	public:
 		ET_DECLARE_POINTER(ProgramFactory)
 		
+		struct ProgramRequest
+		{
+			std::string file;
+			StringList defines;
+
+			ProgramRequest(const std::string& aFile, const StringList& aDefines = StringList()) :
+				file(aFile), defines(aDefines) { }
+		};
+		
 	public:
 		ProgramFactory(RenderContext* rc);
 		~ProgramFactory();
@@ -28,6 +37,13 @@ namespace et
 		Program::Pointer loadProgram(const std::string& file, ObjectsCache&,
 			const StringList& defines);
 
+		/*
+		 * File names are resolved on calling thread, sources of programs are loaded
+		 * and preprocessed in parallel, programs are built or loaded from binary cache
+		 * on calling thread
+		 */
+		std::vector<Program::Pointer> loadPrograms(const std::vector<ProgramRequest>&, ObjectsCache&);
+
 		Program ::Pointer genProgram(const std::string& name, const std::string&, const std::string&,
 			const StringList& defines = StringList(), const std::string& workFolder = ".");
 		
@@ -37,6 +53,14 @@ namespace et
 		Program ::Pointer genProgram(const std::string& name, const std::string& vs, const std::string& gs,
 			const std::string& fs, const StringList& defines = StringList(), const std::string& workFolder = ".");
 
+		/*
+		 * Linked programs are stored in binary cache when driver supports program binaries,
+		 * binaries are keyed by preprocessed source code, defines and driver version.
+		 * By default cache is located in application documents folder.
+		 */
+		void setBinaryCacheFolder(const std::string&);
+		void setBinaryCacheEnabled(bool);
+
 	private:
 		enum ShaderType
 		{
@@ -45,6 +69,13 @@ namespace et
 			ShaderType_Fragment,
 		};
 		
+		struct ProgramSourceFiles
+		{
+			std::string vertex;
+			std::string geometry;
+			std::string fragment;
+		};
+		
 	private:
 		ET_DENY_COPY(ProgramFactory)
 		friend class ProgramFactoryPrivate;
@@ -52,8 +83,23 @@ namespace et
 		void parseSourceCode(ShaderType type, std::string& code,
 			const StringList& defines, const std::string& workFolder);
 		
+		bool preprocessProgram(const std::string& file, const ProgramSourceFiles&, const StringList& defines,
+			std::string& vs, std::string& gs, std::string& fs, StringList& sourceFiles);
+		
+		Program::Pointer findCachedProgram(const std::string& file, ObjectsCache&, const StringList& defines);
+		
+		Program::Pointer createProgram(const std::string& vs, const std::string& gs, const std::string& fs,
+			const std::string& name, const std::string& origin, const StringList& defines);
+		
 		void reloadObject(LoadableObject::Pointer, ObjectsCache&);
 		
+		/*
+		 * Uses application path resolver, should be called on main thread
+		 */
+		bool resolveProgramSources(const std::string& file, ProgramSourceFiles&);
+		
+		StringList loadProgramSources(const ProgramSourceFiles&, std::string&, std::string&, std::string&);
+		
 		StringList loadProgramSources(const std::string&, std::string&, std::string&, std::string&,
 			const StringList& defines = StringList());
 		
@@ -63,6 +109,6 @@ namespace et
 		std::string _fragShaderHeader;
 		std::string _vertShaderHeader;
 		
-		ET_DECLARE_PIMPL(ProgramFactory, 32)
+		ET_DECLARE_PIMPL(ProgramFactory, 256)
 	};
 }
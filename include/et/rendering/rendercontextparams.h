@@ -47,6 +47,7 @@ namespace et
         bool enableHighResolutionContext = true;
 
 		size_t swapInterval = 1;
+		size_t streamingBufferSize = 4 * 1024 * 1024;
         size_t supportedInterfaceOrientations = InterfaceOrientation_Any;
 
 		vec2i contextSize;
@@ -46,6 +46,12 @@ namespace et
 		void drawElementsInstanced(const IndexBuffer::Pointer& ib, size_t first, size_t count, size_t instances);
 		void drawElementsBaseIndex(const VertexArrayObject& vao, int base, size_t first, size_t count);
 		void drawElementsSequentially(PrimitiveType, size_t first, size_t count);
+
+		/*
+		 * Draws several ranges of index buffer with single call where supported
+		 */
+		void multiDrawElements(const IndexBuffer::Pointer& ib, const uint32_t* first, const uint32_t* count,
+			size_t drawCount);
 		
 		BinaryDataStorage readFramebufferData(const vec2i&, TextureFormat, DataType);
 		void readFramebufferData(const vec2i&, TextureFormat, DataType, BinaryDataStorage&);
@@ -55,6 +61,20 @@ namespace et
 		
 		void finishRendering();
 
+		/*
+		 * Shared buffer for geometry which changes every frame
+		 */
+		StreamingBuffer::Pointer& streamingBuffer()
+			{ return _streamingBuffer; }
+
+		const StreamingBuffer::Pointer& streamingBuffer() const
+			{ return _streamingBuffer; }
+
+		/*
+		 * Called by application when frame is presented
+		 */
+		void endFrame();
+
 		ET_DECLARE_PROPERTY_GET_COPY_SET_COPY(uint32_t, defaultTextureBindingUnit, setDefaultTextureBindingUnit)
 		
 	private:
@@ -65,6 +85,9 @@ namespace et
 		RenderContext* _rc;
 		ObjectsCache _sharedCache;
 		VertexArrayObject _fullscreenQuadVao;
+		StreamingBuffer::Pointer _streamingBuffer;
+		std::vector<int32_t> _multiDrawCounts;
+		std::vector<const void*> _multiDrawOffsets;
 
 		Program::Pointer _fullscreenProgram[TextureTarget_max];
 		Program::Pointer _fullscreenDepthProgram;
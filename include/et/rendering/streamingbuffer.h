@@ -0,0 +1,91 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/core/containers.h>
+#include <et/rendering/apiobject.h>
+
+namespace et
+{
+	/*
+	 * Buffer for data which changes every frame, split into segments,
+	 * one per frame in flight. Data written during frame is sub-allocated
+	 * from current segment, segment is reused when GPU finished reading it.
+	 * Buffer is mapped persistently where supported, otherwise written data
+	 * is kept in memory and uploaded on flush, buffer storage is orphaned
+	 * instead of waiting for GPU.
+	 */
+	class StreamingBuffer : public APIObject
+	{
+	public:
+		ET_DECLARE_POINTER(StreamingBuffer)
+
+		enum : size_t
+		{
+			FramesInFlight = 3
+		};
+
+		struct Allocation
+		{
+			void* data = nullptr;
+			size_t offset = 0;
+			size_t size = 0;
+
+			bool valid() const
+				{ return data != nullptr; }
+		};
+
+	public:
+		StreamingBuffer(RenderContext*, size_t capacityPerFrame, const std::string& name = emptyString);
+		~StreamingBuffer();
+
+		/*
+		 * Offset of allocation is aligned within the whole buffer, returns
+		 * invalid allocation if segment of current frame is full
+		 */
+		Allocation allocate(size_t size, size_t alignment);
+		Allocation upload(const void* data, size_t size, size_t alignment);
+
+		/*
+		 * Makes data written to allocations visible to GPU,
+		 * allocations should be filled before flush
+		 */
+		void flush();
+
+		/*
+		 * Called when all draw calls of frame are issued
+		 */
+		void nextFrame();
+
+		size_t capacityPerFrame() const
+			{ return _capacityPerFrame; }
+
+		size_t usedSize() const
+			{ return _offset; }
+
+		bool persistentlyMapped() const
+			{ return _persistentlyMapped; }
+
+	private:
+		ET_DENY_COPY(StreamingBuffer)
+
+		void bindForWriting();
+		void waitForSegment();
+
+	private:
+		RenderContext* _rc = nullptr;
+		BinaryDataStorage _stagingData;
+		uint8_t* _mappedData = nullptr;
+		void* _fences[FramesInFlight] = { };
+		size_t _capacityPerFrame = 0;
+		size_t _segment = 0;
+		size_t _offset = 0;
+		size_t _flushedOffset = 0;
+		bool _persistentlyMapped = false;
+	};
+}
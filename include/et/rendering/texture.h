@@ -74,6 +74,9 @@ namespace et
 		const TextureDescription::Pointer description() const
 			{ return _desc; }
 
+		uint64_t memoryUsage() const override
+			{ return _desc->dataSizeForAllMipLevels() * etMax(1u, _desc->layersCount); }
+
 	private:
 		void generateTexture(RenderContext* rc);
 		void buildProperies();
@@ -0,0 +1,59 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/rendering/streamingbuffer.h>
+
+namespace et
+{
+	/*
+	 * Per-frame and per-material constants sub-allocated from streaming buffer
+	 * with uniform buffer offset alignment and bound to uniform block binding points by offset
+	 */
+	class UniformBufferRing : public Shared
+	{
+	public:
+		ET_DECLARE_POINTER(UniformBufferRing)
+
+		typedef StreamingBuffer::Allocation Allocation;
+
+	public:
+		UniformBufferRing(RenderContext*, size_t capacityPerFrame, const std::string& name = emptyString);
+
+		/*
+		 * Returns invalid allocation if segment of current frame is full
+		 */
+		Allocation allocate(size_t size)
+			{ return _buffer->allocate(size, _alignment); }
+
+		Allocation upload(const void* data, size_t size)
+			{ return _buffer->upload(data, size, _alignment); }
+
+		template <typename T>
+		Allocation upload(const T& value)
+			{ return upload(&value, sizeof(T)); }
+
+		void bind(uint32_t bindingPoint, const Allocation&);
+
+		/*
+		 * Called when all draw calls of frame are issued
+		 */
+		void nextFrame()
+			{ _buffer->nextFrame(); }
+
+		const StreamingBuffer::Pointer& buffer() const
+			{ return _buffer; }
+
+	private:
+		ET_DENY_COPY(UniformBufferRing)
+
+	private:
+		StreamingBuffer::Pointer _buffer;
+		size_t _alignment = 256;
+	};
+}
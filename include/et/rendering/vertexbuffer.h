@@ -7,7 +7,7 @@
 
 #pragma once
 
-#include <et/rendering/apiobject.h>
+#include <et/rendering/streamingbuffer.h>
 #include <et/vertexbuffer/vertexarray.h>
 #include <et/vertexbuffer/vertexstorage.h>
 
@@ -27,6 +27,13 @@ namespace et
 		VertexBuffer(RenderContext*, const VertexArray::Description&, BufferDrawType,
 			const std::string& = emptyString);
 
+		/*
+		 * Uses storage of streaming buffer, vertices are sourced from
+		 * allocations by setting vertex attributes with base index
+		 */
+		VertexBuffer(RenderContext*, const VertexDeclaration&, const StreamingBuffer::Pointer&,
+			const std::string& = emptyString);
+
 		~VertexBuffer();
 		
 		size_t vertexCount() const
@@ -56,6 +63,7 @@ namespace et
 	private:
 		RenderContext* _rc = nullptr;
 		VertexDeclaration _decl;
+		StreamingBuffer::Pointer _streamingBuffer;
 		AtomicBool _mapped;
 		size_t _dataSize = 0;
 		std::string _sourceObjectName;
@@ -54,6 +54,14 @@ namespace et
 			
 			void setOutOfRangeMode(OutOfRangeMode);
 			
+			/*
+			 * Maps arbitrary time into [startTime, stopTime] according to out of range mode
+			 */
+			float normalizedTime(float) const;
+			
+			const std::vector<Frame>& frames() const
+				{ return _frames; }
+			
 			OutOfRangeMode outOfRangeMode() const
 				{ return _outOfRangeMode; }
 			
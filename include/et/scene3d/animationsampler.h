@@ -0,0 +1,194 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/scene3d/baseelement.h>
+
+namespace et
+{
+	namespace s3d
+	{
+		/*
+		 * Immutable animation prepared for sampling: key frames are stored as separate
+		 * channels, orientations are made continuous (neighbour keys have positive dot product).
+		 * Optionally keys are reduced (removed while linear interpolation of neighbours
+		 * stays within tolerance) and quantized to 16 bits per component.
+		 */
+		class AnimationClip : public Shared
+		{
+		public:
+			ET_DECLARE_POINTER(AnimationClip)
+
+			enum Channel : size_t
+			{
+				Channel_TranslationX,
+				Channel_TranslationY,
+				Channel_TranslationZ,
+				Channel_OrientationX,
+				Channel_OrientationY,
+				Channel_OrientationZ,
+				Channel_OrientationW,
+				Channel_ScaleX,
+				Channel_ScaleY,
+				Channel_ScaleZ,
+
+				Channel_max
+			};
+
+			enum class Compression : uint32_t
+			{
+				None,
+				Quantized
+			};
+
+		public:
+			AnimationClip(const Animation&, Compression = Compression::None, float tolerance = 0.0f);
+
+			size_t keyFramesCount() const
+				{ return _times.size(); }
+
+			float keyFrameTime(size_t i) const
+				{ return _times[i]; }
+
+			float value(size_t channel, size_t key) const
+			{
+				size_t i = channel * _times.size() + key;
+				return _quantizedValues.empty() ? _values[i] :
+					_channelOffset[channel] + _channelScale[channel] * static_cast<float>(_quantizedValues[i]);
+			}
+
+			float startTime() const
+				{ return _startTime; }
+
+			float stopTime() const
+				{ return _stopTime; }
+
+			float duration() const
+				{ return _stopTime - _startTime; }
+
+			Animation::OutOfRangeMode outOfRangeMode() const
+				{ return _outOfRangeMode; }
+
+			Compression compression() const
+				{ return _compression; }
+
+			/*
+			 * Size of key frames data in bytes
+			 */
+			size_t dataSize() const;
+
+			float normalizedTime(float) const;
+
+			/*
+			 * Returns index of key frame at or before (normalized) time.
+			 * Search starts from cursor, which is updated, so sequential lookups are O(1).
+			 */
+			size_t findKeyFrame(float time, uint32_t& cursor) const;
+
+		private:
+			void reduceKeyFrames(std::vector<Animation::Frame>&, float tolerance);
+			void quantize();
+
+		private:
+			std::vector<float> _times;
+			std::vector<float> _values;
+			std::vector<uint16_t> _quantizedValues;
+			float _channelOffset[Channel_max] = { };
+			float _channelScale[Channel_max] = { };
+			float _startTime = 0.0f;
+			float _stopTime = 0.0f;
+			Animation::OutOfRangeMode _outOfRangeMode = Animation::OutOfRangeMode_Loop;
+			Compression _compression = Compression::None;
+		};
+
+		/*
+		 * Samples animations of many elements in a single pass: finds key frames
+		 * using per-layer cursors, interpolates all samples four at once
+		 * (lerp for translation and scale, nlerp for orientation),
+		 * blends layers of each element by weights and sets resulting
+		 * transforms to elements. Replaces per-element animation timers.
+		 */
+		class AnimationSampler
+		{
+		public:
+			enum : size_t
+			{
+				MaxLayers = 4,
+				InvalidInstance = static_cast<size_t>(-1)
+			};
+
+		public:
+			AnimationSampler() = default;
+
+			size_t addInstance(BaseElement::Pointer);
+			void removeInstance(size_t);
+
+			size_t instancesCount() const
+				{ return _instances.size() - _freeInstances.size(); }
+
+			/*
+			 * Weights of layers are normalized during blending
+			 */
+			void setLayer(size_t instance, size_t layer, AnimationClip::Pointer,
+				float weight = 1.0f, float speed = 1.0f);
+			void removeLayer(size_t instance, size_t layer);
+
+			void setLayerWeight(size_t instance, size_t layer, float);
+			void setLayerSpeed(size_t instance, size_t layer, float);
+			void setLayerTime(size_t instance, size_t layer, float);
+
+			float layerTime(size_t instance, size_t layer) const
+				{ return _instances[instance].layers[layer].time; }
+
+			/*
+			 * Advances all layers by dt, samples and applies transforms
+			 */
+			void update(float dt);
+
+			/*
+			 * Samples and applies transforms at current layer times
+			 */
+			void sample();
+
+		private:
+			ET_DENY_COPY(AnimationSampler)
+
+			struct Layer
+			{
+				AnimationClip::Pointer clip;
+				float time = 0.0f;
+				float speed = 1.0f;
+				float weight = 1.0f;
+				uint32_t cursor = 0;
+			};
+
+			struct Instance
+			{
+				BaseElement::Pointer element;
+				Layer layers[MaxLayers];
+				uint32_t firstSample = 0;
+				uint32_t samplesCount = 0;
+			};
+
+			void gatherKeyFrames(size_t begin, size_t end);
+			void interpolate(size_t beginBlock, size_t endBlock);
+			void blend(size_t begin, size_t end);
+
+		private:
+			std::vector<Instance> _instances;
+			std::vector<size_t> _freeInstances;
+			std::vector<mat4> _transforms;
+
+			/*
+			 * Per sample streams: lower and upper key values, interpolation factor, weight
+			 */
+			std::vector<float> _samples;
+			size_t _samplesCapacity = 0;
+		};
+	}
+}
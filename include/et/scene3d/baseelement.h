@@ -15,6 +15,7 @@
 #include <et/scene3d/base.h>
 #include <et/scene3d/serialization.h>
 #include <et/scene3d/animation.h>
+#include <et/scene3d/transformhierarchy.h>
 
 namespace et
 {
@@ -37,6 +38,7 @@ namespace et
 
 		public:
 			BaseElement(const std::string& name, BaseElement* parent);
+			~BaseElement();
 			
 			void animate();
 			void stopAnimation();
@@ -44,6 +46,11 @@ namespace et
 			void stopAnimationRecursive();
 			void setAnimationTime(float);
 			void setAnimationTimeRecursive(float);
+			
+			/*
+			 * Used by AnimationSampler, replaces local transform until removeAnimations is called
+			 */
+			void setAnimationTransform(const mat4&);
 
 			bool animating() const;
 			bool anyChildAnimating() const;
@@ -52,6 +59,14 @@ namespace et
 			const Animation& defaultAnimation() const;
 
 			bool isKindOf(ElementType t) const;
+			
+			/*
+			 * Keeps interned name and scene registry up to date
+			 */
+			void setName(const std::string&) override;
+			
+			const InternedName& internedName() const
+				{ return _internedName; }
 
 			const mat4& finalTransform();
 			const mat4& finalInverseTransform();
@@ -106,18 +121,27 @@ namespace et
 			void childrenHavingFlagCallback(size_t flag, BaseElement::List& list, Pointer root);
 			
 			void buildTransform();
+			TransformHierarchy* activeTransformHierarchy();
+			const ElementRegistry* activeRegistry() const;
+			bool hasAncestor(const BaseElement*) const;
 
 		private:
+			friend class TransformHierarchy;
+			
 			Animation _emptyAnimation;
 			NotifyTimer _animationTimer;
 			
 			std::set<std::string> _properites;
+			InternedName _internedName;
 			std::vector<Animation> _animations;
 			
 			mat4 _animationTransform = mat4(1.0f);
 			mat4 _cachedLocalTransform = mat4(1.0f);
 			mat4 _cachedFinalTransform = mat4(1.0f);
 			mat4 _cachedFinalInverseTransform = mat4(1.0f);
+			
+			TransformHierarchy* _transformHierarchy = nullptr;
+			uint32_t _transformIndex = 0;
 		};
 	}
 }
@@ -0,0 +1,121 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/camera/frustum.h>
+#include <et/scene3d/mesh.h>
+
+namespace et
+{
+	namespace s3d
+	{
+		class TransformHierarchy;
+
+		/*
+		 * Four-way BVH over world space bounding boxes of meshes.
+		 * Bounds of children are stored per node as separate arrays,
+		 * so queries test four boxes at once. Meshes moved by transform hierarchy
+		 * are refitted in place, other meshes are not visited. Tree is rebuilt when
+		 * elements are added or removed, or when refitted bounds become too loose.
+		 * Query results are appended to provided vectors.
+		 */
+		class BoundingVolumeHierarchy
+		{
+		public:
+			enum : size_t
+			{
+				Arity = 4
+			};
+
+		public:
+			BoundingVolumeHierarchy() = default;
+
+			/*
+			 * Indexes all meshes managed by transform hierarchy
+			 */
+			void attach(TransformHierarchy*);
+			void detach();
+
+			/*
+			 * Synchronizes tree with the scene, called by every query
+			 */
+			void update();
+
+			void query(const Frustum&, std::vector<Mesh*>&);
+			void query(const AABB&, std::vector<Mesh*>&);
+			void query(const Sphere&, std::vector<Mesh*>&);
+
+			/*
+			 * Mesh with closest bounding box intersected by ray
+			 */
+			Mesh* pick(const ray3d&, float* distance = nullptr);
+
+			/*
+			 * Up to count meshes with bounding boxes closest to point, sorted by distance
+			 */
+			void nearest(const vec3& point, size_t count, std::vector<Mesh*>&);
+
+			size_t meshesCount() const
+				{ return _items.size(); }
+
+			size_t nodesCount() const
+				{ return _nodes.size(); }
+
+		private:
+			ET_DENY_COPY(BoundingVolumeHierarchy)
+
+			struct ET_ALIGNED(16) Node
+			{
+				float minX[Arity] = { };
+				float minY[Arity] = { };
+				float minZ[Arity] = { };
+				float maxX[Arity] = { };
+				float maxY[Arity] = { };
+				float maxZ[Arity] = { };
+
+				/*
+				 * Non-negative values are node indices, negative are ~itemIndex
+				 */
+				int32_t children[Arity] = { };
+				uint32_t parent = 0;
+				uint32_t parentSlot = 0;
+				uint32_t childrenCount = 0;
+				bool dirty = false;
+			};
+
+			struct Item
+			{
+				Mesh* mesh = nullptr;
+				vec3 minVertex;
+				vec3 maxVertex;
+				vec3 centroid;
+				uint32_t node = 0;
+				uint32_t slot = 0;
+			};
+
+			void gatherMeshes();
+			void rebuild();
+			void refit();
+			uint32_t buildNode(uint32_t* items, size_t count, uint32_t parent, uint32_t parentSlot);
+			void setChildBounds(Node&, size_t slot, const vec3& minVertex, const vec3& maxVertex);
+			void nodeBounds(const Node&, vec3& minVertex, vec3& maxVertex) const;
+			void collectItems(int32_t child, std::vector<Mesh*>&) const;
+
+		private:
+			TransformHierarchy* _hierarchy = nullptr;
+			std::vector<Node> _nodes;
+			std::vector<Item> _items;
+			std::vector<uint32_t> _itemByElement;
+			std::vector<uint32_t> _movedElements;
+			std::vector<uint32_t> _buildItems;
+			std::vector<int32_t> _stack;
+			size_t _structureVersion = 0;
+			float _builtSurfaceArea = 0.0f;
+		};
+	}
+}
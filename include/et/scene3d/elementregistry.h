@@ -0,0 +1,99 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <et/core/internedname.h>
+#include <et/scene3d/base.h>
+
+namespace et
+{
+	namespace s3d
+	{
+		class BaseElement;
+
+		/*
+		 * Elements of a tree grouped by type and by interned name.
+		 * Rebuilt by TransformHierarchy when elements are added, removed or renamed,
+		 * elements are stored in hierarchy order (parents before children).
+		 */
+		class ElementRegistry
+		{
+		public:
+			typedef std::vector<BaseElement*> ElementList;
+
+			/*
+			 * Iterates elements of registry as pointers to derived type,
+			 * invalidated when registry is rebuilt
+			 */
+			template <typename T>
+			class View
+			{
+			public:
+				class Iterator
+				{
+				public:
+					Iterator(ElementList::const_iterator i) :
+						_i(i) { }
+
+					T* operator * () const
+						{ return static_cast<T*>(*_i); }
+
+					Iterator& operator ++ ()
+						{ ++_i; return *this; }
+
+					bool operator != (const Iterator& r) const
+						{ return _i != r._i; }
+
+				private:
+					ElementList::const_iterator _i;
+				};
+
+			public:
+				View(const ElementList& elements) :
+					_elements(elements) { }
+
+				Iterator begin() const
+					{ return Iterator(_elements.begin()); }
+
+				Iterator end() const
+					{ return Iterator(_elements.end()); }
+
+				size_t size() const
+					{ return _elements.size(); }
+
+				bool empty() const
+					{ return _elements.empty(); }
+
+			private:
+				const ElementList& _elements;
+			};
+
+		public:
+			void rebuild(const ElementList&);
+			void clear();
+
+			const ElementList& elementsOfType(ElementType) const;
+
+			template <typename T>
+			View<T> elementsOfType(ElementType t) const
+				{ return View<T>(elementsOfType(t)); }
+
+			/*
+			 * Returns element closest to root if several elements have the same name
+			 */
+			BaseElement* elementWithName(const InternedName&, ElementType = ElementType::DontCare) const;
+			const ElementList& elementsWithName(const InternedName&) const;
+
+		private:
+			ElementList _elementsByType[ElementType_Max];
+			ElementList _emptyList;
+			std::unordered_map<InternedName, ElementList> _elementsByName;
+		};
+	}
+}
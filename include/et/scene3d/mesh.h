@@ -108,6 +108,12 @@ namespace et
 			bool skinned() const;
 			VertexStorage::Pointer bakeDeformations();
 			
+			/*
+			 * Writes deformed vertices into storage with the same declaration and capacity,
+			 * so it could be reused between calls. Vertices are processed on worker threads.
+			 */
+			void bakeDeformations(VertexStorage::Pointer);
+			
 		protected:
 			void duplicateMeshPropertiesToMesh(s3d::Mesh*);
 			
@@ -7,20 +7,35 @@
 
 #pragma once
 
-#include <et/helpers/particles.h>
+#include <et/helpers/particles-soa.h>
 #include <et/scene3d/baseelement.h>
 
 namespace et
 {
 	namespace s3d
 	{
+		/*
+		 * Vertices of active particles are written to streaming buffer of renderer
+		 * on every update, system should be updated every frame it is rendered
+		 */
 		class ParticleSystem : public BaseElement, public EventReceiver
 		{
 		public:
 			ET_DECLARE_POINTER(ParticleSystem)
+			
+			/*
+			 * StructureOfArrays uses SoAEmitter with fixed movement and variation functions,
+			 * emitter() is empty in this mode and soaEmitter() is empty otherwise
+			 */
+			enum class StorageMode
+			{
+				ArrayOfStructures,
+				StructureOfArrays
+			};
 						
 		public:
-			ParticleSystem(RenderContext*, size_t, const std::string&, BaseElement*);
+			ParticleSystem(RenderContext*, size_t, const std::string&, BaseElement*,
+				StorageMode = StorageMode::ArrayOfStructures);
 			
 			ElementType type() const
 				{ return ElementType::ParticleSystem; }
@@ -34,7 +49,13 @@ namespace et
 				{ return _vao->indexBuffer(); }
 			
 			size_t activeParticlesCount() const
-				{ return _emitter.activeParticlesCount(); }
+			{
+				return (_storageMode == StorageMode::StructureOfArrays) ?
+					_soaEmitter.activeParticlesCount() : _emitter.activeParticlesCount();
+			}
+			
+			StorageMode storageMode() const
+				{ return _storageMode; }
 			
 			particles::PointSpriteEmitter& emitter()
 				{ return _emitter; }
@@ -42,21 +63,30 @@ namespace et
 			const particles::PointSpriteEmitter& emitter() const
 				{ return _emitter; }
 			
+			particles::SoAEmitter& soaEmitter()
+				{ return _soaEmitter; }
+			
+			const particles::SoAEmitter& soaEmitter() const
+				{ return _soaEmitter; }
+			
 			template <typename F>
 			void setUpdateFunction(const F& func)
 				{ _emitter.setUpdateFunction(func); }
 			
 		private:
 			void onTimerUpdated(NotifyTimer*);
+			StreamingBuffer::Allocation allocateVertices();
+			void setVertexSource(const StreamingBuffer::Allocation&);
 						
 		private:
 			RenderContext* _rc = nullptr;
 			
 			VertexArrayObject _vao;
 			VertexDeclaration _decl;
-			VertexArray::Description _vertexData;
 			
 			particles::PointSpriteEmitter _emitter;
+			particles::SoAEmitter _soaEmitter;
+			StorageMode _storageMode = StorageMode::ArrayOfStructures;
 			NotifyTimer _timer;
 		};
 	}
@@ -17,6 +17,7 @@
 #include <et/scene3d/particlesystem.h>
 #include <et/scene3d/lineelement.h>
 #include <et/scene3d/skeletonelement.h>
+#include <et/scene3d/boundingvolumehierarchy.h>
 
 namespace et
 {
@@ -40,6 +41,21 @@ namespace et
 
 			const Storage& storage() const
 				{ return _storage; }
+			
+			TransformHierarchy& transformHierarchy()
+				{ return _transformHierarchy; }
+			
+			/*
+			 * Elements of scene by type and by name, without reference counting
+			 */
+			const ElementRegistry& registry()
+				{ return _transformHierarchy.registry(); }
+			
+			/*
+			 * Spatial index over world bounds of all meshes in scene
+			 */
+			BoundingVolumeHierarchy& boundingVolumeHierarchy()
+				{ return _boundingVolumeHierarchy; }
 
 		public:
 			ET_DECLARE_EVENT1(deserializationFinished, bool)
@@ -63,6 +79,8 @@ namespace et
 						
 		private:
 			Storage _storage;
+			TransformHierarchy _transformHierarchy;
+			BoundingVolumeHierarchy _boundingVolumeHierarchy;
 			std::string _serializationBasePath;
 			std::vector<VertexArrayObject> _vertexArrays;
 			IndexBuffer::Pointer _mainIndexBuffer;
@@ -0,0 +1,119 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/scene3d/elementregistry.h>
+
+namespace et
+{
+	namespace s3d
+	{
+		class BaseElement;
+
+		/*
+		 * Flat storage of transformations for a tree of elements.
+		 * Elements are sorted by depth, so world transforms are updated
+		 * in a single linear pass, level by level (levels are processed in parallel).
+		 * Changing local transform only marks element as dirty,
+		 * inverse world transforms are computed on request.
+		 */
+		class TransformHierarchy
+		{
+		public:
+			enum : uint32_t
+			{
+				InvalidIndex = static_cast<uint32_t>(-1)
+			};
+
+		public:
+			TransformHierarchy() = default;
+			~TransformHierarchy();
+
+			/*
+			 * Root (top-level element, like Scene) and all its descendants,
+			 * including added later, are managed by hierarchy.
+			 * Adding, removing and renaming elements invalidates structure
+			 */
+			void attach(BaseElement* root);
+			void detach();
+
+			void update();
+
+			const mat4& worldTransform(uint32_t index) const
+				{ return _worldTransforms[index]; }
+
+			const mat4& worldInverseTransform(uint32_t index);
+
+			size_t size() const
+				{ return _elements.size(); }
+
+			size_t levelsCount() const
+				{ return _levels.empty() ? 0 : _levels.size() - 1; }
+
+			BaseElement* element(uint32_t index) const
+				{ return _elements[index]; }
+
+			/*
+			 * Elements grouped by type and name, rebuilt with hierarchy
+			 */
+			const ElementRegistry& registry();
+
+			/*
+			 * Incremented each time elements are reordered
+			 */
+			size_t structureVersion() const
+				{ return _structureVersion; }
+
+			/*
+			 * Moves indices of elements whose world transform changed since previous call
+			 * (or since structure was rebuilt) to provided vector, each index is reported once.
+			 * Intended for a single consumer, such as bounding volume hierarchy
+			 */
+			void takeMovedElements(std::vector<uint32_t>&);
+
+		private:
+			ET_DENY_COPY(TransformHierarchy)
+
+			friend class BaseElement;
+
+			void invalidateStructure()
+				{ _structureValid = false; }
+
+			void invalidateLocalTransform(uint32_t index);
+			void elementDestroyed(uint32_t index);
+
+			void rebuild();
+			void releaseElements();
+			void updateRange(size_t begin, size_t end);
+
+		private:
+			enum : uint8_t
+			{
+				Flag_LocalDirty = 0x01,
+				Flag_WorldChanged = 0x02,
+				Flag_InverseValid = 0x04,
+				Flag_Moved = 0x08,
+			};
+
+			BaseElement* _root = nullptr;
+			std::vector<BaseElement*> _elements;
+			std::vector<uint32_t> _parents;
+			std::vector<mat4> _localTransforms;
+			std::vector<mat4> _worldTransforms;
+			std::vector<mat4> _worldInverseTransforms;
+			std::vector<uint8_t> _flags;
+			std::vector<uint32_t> _movedElements;
+			std::vector<size_t> _levels;
+			ElementRegistry _registry;
+			size_t _structureVersion = 0;
+			bool _structureValid = false;
+			bool _hasDirtyElements = false;
+			bool _updating = false;
+		};
+	}
+}
@@ -0,0 +1,103 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/threading/criticalsection.h>
+#include <et/sound/pcmdata.h>
+
+namespace et
+{
+	namespace audio
+	{
+		/*
+		 * Software mixer: many virtual voices are mixed on CPU into a single
+		 * stereo stream. Only the most important voices are actually mixed,
+		 * the rest are virtualized (advanced in time, but not rendered).
+		 * Could be used offline (mix, renderToWAV) or streamed into OpenAL source.
+		 */
+		class MixerPrivate;
+		class Mixer : public Shared
+		{
+		public:
+			ET_DECLARE_POINTER(Mixer)
+
+			using Voice = uint32_t;
+
+			enum : Voice
+			{
+				InvalidVoice = 0
+			};
+
+			struct Statistics
+			{
+				size_t playingVoices = 0;
+				size_t audibleVoices = 0;
+				size_t virtualVoices = 0;
+				size_t voicesStarted = 0;
+				size_t voicesFinished = 0;
+				size_t voicesRejected = 0;
+				uint64_t framesMixed = 0;
+				uint64_t mixTimeInNanoseconds = 0;
+				float cpuLoad = 0.0f;
+			};
+
+		public:
+			Mixer(size_t sampleRate = 44100, size_t maxAudibleVoices = 32, size_t maxVoices = 1024);
+			~Mixer();
+
+			/*
+			 * Higher priority voices are never virtualized in favor of lower priority ones
+			 */
+			Voice play(PCMData::Pointer, float volume = 1.0f, float pan = 0.0f, int priority = 0,
+				bool looped = false);
+
+			void stop(Voice);
+			void stopAll();
+
+			void setVolume(Voice, float value, float duration = 0.0f);
+			void setPan(Voice, float);
+			void setPitch(Voice, float);
+
+			bool playing(Voice) const;
+			bool audible(Voice) const;
+
+			/*
+			 * Output is interleaved stereo
+			 */
+			void mix(float* output, size_t frames);
+			void mix(int16_t* output, size_t frames);
+
+			BinaryDataStorage renderToWAV(float duration);
+
+			Statistics statistics() const;
+			void resetStatistics();
+
+			size_t sampleRate() const;
+
+			void setMaxAudibleVoices(size_t);
+			size_t maxAudibleVoices() const;
+
+			/*
+			 * Streaming mixed output into OpenAL source
+			 */
+			void startOutput();
+			void stopOutput();
+
+		private:
+			ET_DENY_COPY(Mixer)
+
+			void handleProcessedBuffers();
+			float timeToNextUpdate() const;
+
+		private:
+			friend class StreamingThread;
+
+			ET_DECLARE_PIMPL(Mixer, 512)
+		};
+	}
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/core/et.h>
+#include <et/core/containers.h>
+
+namespace et
+{
+	namespace audio
+	{
+		/*
+		 * Decoded, immutable 16-bit interleaved PCM
+		 */
+		class PCMData : public Shared
+		{
+		public:
+			ET_DECLARE_POINTER(PCMData)
+
+		public:
+			/*
+			 * Contents of data are moved into PCMData
+			 */
+			PCMData(size_t channels, size_t sampleRate, BinaryDataStorage& data) :
+				_data(std::move(data)), _channels(channels), _sampleRate(sampleRate)
+			{
+				ET_ASSERT((channels == 1) || (channels == 2));
+				_frames = _data.size() / (sizeof(int16_t) * _channels);
+			}
+
+			const int16_t* samples() const
+				{ return reinterpret_cast<const int16_t*>(_data.data()); }
+
+			const BinaryDataStorage& data() const
+				{ return _data; }
+
+			size_t channels() const
+				{ return _channels; }
+
+			size_t sampleRate() const
+				{ return _sampleRate; }
+
+			size_t frames() const
+				{ return _frames; }
+
+			size_t dataSize() const
+				{ return _data.size(); }
+
+			float duration() const
+				{ return static_cast<float>(_frames) / static_cast<float>(_sampleRate); }
+
+		private:
+			ET_DENY_COPY(PCMData)
+
+		private:
+			BinaryDataStorage _data;
+			size_t _channels = 0;
+			size_t _sampleRate = 0;
+			size_t _frames = 0;
+		};
+	}
+}
@@ -57,6 +57,8 @@ namespace et
 			void handleProcessedBuffers();
 			void handleProcessedSamples();
 			
+			float timeToNextUpdate() const;
+			
         private:
 			friend class Manager;
 			friend class StreamingThread;
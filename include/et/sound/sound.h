@@ -8,6 +8,7 @@
 #pragma once
 
 #include <et/core/singleton.h>
+#include <et/core/objectscache.h>
 #include <et/sound/streamingthread.h>
 #include <et/sound/player.h>
 
@@ -19,7 +20,19 @@ namespace et
         class Manager : public Singleton<Manager>
         {
         public:
+			/*
+			 * Short (non-streamed) tracks are decoded once and share
+			 * PCM and OpenAL buffer through the track cache
+			 */
 			Track::Pointer loadTrack(const std::string& fileName);
+			
+			/*
+			 * Returns short track already managed by ObjectsCache if its file was not modified
+			 */
+			Track::Pointer loadTrack(const std::string& fileName, ObjectsCache&);
+			
+			TrackCache& trackCache()
+				{ return _trackCache; }
 
 			Player::Pointer genPlayer(Track::Pointer track);
 			Player::Pointer genPlayer();
@@ -44,10 +57,12 @@ namespace et
         private:
             friend class ManagerPrivate;
 			friend class Player;
+			friend class Mixer;
 			
 			ET_DECLARE_PIMPL(Manager, 32)
 			
 			StreamingThread _streamingThread;
+			TrackCache _trackCache;
         };
 
 		inline Manager& manager()
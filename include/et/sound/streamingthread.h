@@ -17,6 +17,9 @@ namespace et
 		class Player;
 		typedef IntrusivePtr<Player> PlayerPointer;
 		
+		class Mixer;
+		typedef IntrusivePtr<Mixer> MixerPointer;
+		
 		class StreamingThreadPrivate;
 		class StreamingThread : public Thread
 		{
@@ -24,15 +27,19 @@ namespace et
 			StreamingThread();
 			
 			void release();
+			void wake();
 			
 			void addPlayer(PlayerPointer);
 			void removePlayer(PlayerPointer);
 			
+			void addMixer(MixerPointer);
+			void removeMixer(MixerPointer);
+			
 		private:
 			uint64_t main();
 			
 		private:
-			ET_DECLARE_PIMPL(StreamingThread, 256)
+			ET_DECLARE_PIMPL(StreamingThread, 512)
 		};
 	}
 }
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <et/sound/trackcache.h>
+
 namespace et
 {
     namespace audio
@@ -19,6 +21,11 @@ namespace et
             
 		public:
 			Track(const std::string& fileName);
+			
+			/*
+			 * Static track which shares already decoded data
+			 */
+			Track(const std::string& fileName, DecodedTrack::Pointer);
 			~Track();
 
 			float duration() const;
@@ -27,6 +34,7 @@ namespace et
 			size_t sampleRate() const;
 			size_t bitDepth() const;
 			size_t samples() const;
+			size_t samplesPerBuffer() const;
 			
 			int totalBuffersCount() const;
 			int actualBuffersCount() const;
@@ -37,16 +45,31 @@ namespace et
 			void preloadBuffers();
 			void rewind();
 			
+			/*
+			 * OpenAL buffers and decoded chunks of this track, decoded data
+			 * shared between static tracks is accounted by each of them
+			 */
+			uint64_t memoryUsage() const override;
+			
 		private:
 			unsigned int buffer() const;
 			unsigned int* buffers() const;
 			
+			bool decodeAheadRequired();
+			bool scheduleDecodeAhead();
+			void decodeAhead();
+			
+			PCMData::Pointer decodePCM();
+			void attachDecodedTrack(DecodedTrack::Pointer);
+			
 		private:
 			friend class Player;
 			friend class Manager;
+			friend class StreamingThread;
+			friend class StreamingThreadPrivate;
 			
 			ET_DENY_COPY(Track)
-			ET_DECLARE_PIMPL(Track, 1536)
+			ET_DECLARE_PIMPL(Track, 2048)
         };
 	}
 }
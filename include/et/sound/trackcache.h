@@ -0,0 +1,104 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <et/threading/criticalsection.h>
+#include <et/sound/openal.h>
+#include <et/sound/pcmdata.h>
+
+namespace et
+{
+	namespace audio
+	{
+		/*
+		 * Fully decoded short track: immutable PCM and OpenAL buffer with the same contents.
+		 * Shared between all tracks loaded from files with identical contents.
+		 */
+		class DecodedTrack : public Shared
+		{
+		public:
+			ET_DECLARE_POINTER(DecodedTrack)
+
+		public:
+			DecodedTrack(PCMData::Pointer pcm, uint64_t contentHash);
+			~DecodedTrack();
+
+			PCMData::Pointer pcm() const
+				{ return _pcm; }
+
+			ALuint buffer() const
+				{ return _buffer; }
+
+			uint64_t contentHash() const
+				{ return _contentHash; }
+
+		private:
+			ET_DENY_COPY(DecodedTrack)
+
+		private:
+			PCMData::Pointer _pcm;
+			ALuint _buffer = 0;
+			uint64_t _contentHash = 0;
+		};
+
+		/*
+		 * Decoded tracks are looked up by file name (validated with file property)
+		 * and deduplicated by contents. Least recently used tracks are evicted
+		 * when memory budget is exceeded; evicted data stays alive while tracks use it.
+		 */
+		class TrackCache
+		{
+		public:
+			enum : size_t
+			{
+				DefaultMemoryBudget = 32 * 1024 * 1024
+			};
+
+		public:
+			DecodedTrack::Pointer find(const std::string& fileName, uint64_t fileProperty);
+			DecodedTrack::Pointer insert(const std::string& fileName, uint64_t fileProperty, PCMData::Pointer);
+
+			void invalidate(const std::string& fileName);
+			void flush();
+
+			void setMemoryBudget(size_t);
+
+			size_t memoryBudget() const
+				{ return _memoryBudget; }
+
+			size_t memoryUsage() const
+				{ return _memoryUsage; }
+
+		private:
+			void evict(size_t requiredSize);
+
+		private:
+			struct ContentEntry
+			{
+				DecodedTrack::Pointer track;
+				StringList fileNames;
+			};
+			using ContentList = std::list<ContentEntry>;
+
+			struct FileEntry
+			{
+				uint64_t fileProperty = 0;
+				uint64_t contentHash = 0;
+			};
+
+			CriticalSection _lock;
+			ContentList _contents;
+			std::unordered_map<uint64_t, ContentList::iterator> _contentMap;
+			std::unordered_map<std::string, FileEntry> _files;
+			size_t _memoryBudget = DefaultMemoryBudget;
+			size_t _memoryUsage = 0;
+		};
+	}
+}
@@ -104,6 +104,7 @@ void Application::performRendering()
 	_renderContext->beginRender();
 	_delegate->render(_renderContext);
 	_renderContext->endRender();
+	_renderContext->renderer()->endFrame();
 #endif
 }
 
@@ -230,7 +231,7 @@ std::string Application::resolveFileName(const std::string& path)
 	if (_customPathResolver.valid())
 		result = _customPathResolver->resolveFilePath(path);
 	
-	if (!fileExists(result))
+	if (!_standardPathResolver.cachedFileExists(result))
 		result = _standardPathResolver.resolveFilePath(path);
 	
 	return result;
@@ -243,7 +244,7 @@ std::string Application::resolveFolderName(const std::string& path)
 	if (_customPathResolver.valid())
 		result = _customPathResolver->resolveFolderPath(path);
 	
-	if (!folderExists(result))
+	if (!_standardPathResolver.cachedFolderExists(result))
 		result = _standardPathResolver.resolveFolderPath(path);
 	
 	return result;
@@ -292,6 +293,21 @@ void Application::setShouldSilentPathResolverErrors(bool e)
 	_standardPathResolver.setSilentErrors(e);
 }
 
+bool Application::cachedFileExists(const std::string& path)
+{
+	return _standardPathResolver.cachedFileExists(path);
+}
+
+void Application::invalidatePathResolverCache()
+{
+	_standardPathResolver.invalidateCache();
+}
+
+StandardPathResolver::CacheStatistics Application::pathResolverCacheStatistics()
+{
+	return _standardPathResolver.cacheStatistics();
+}
+
 const ApplicationIdentifier& Application::identifier() const
 {
 	return _identifier;
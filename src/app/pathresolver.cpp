@@ -12,8 +12,38 @@
 
 using namespace et;
 
+namespace
+{
+	/*
+	 * Windows file system is case insensitive
+	 */
+	std::string snapshotKey(const std::string& name)
+	{
+#	if (ET_PLATFORM_WIN)
+		return lowercase(name);
+#	else
+		return name;
+#	endif
+	}
+
+	std::string folderDatePath(const std::string& folder)
+	{
+		return ((folder.size() > 1) && (folder.back() == pathDelimiter)) ? folder.substr(0, folder.size() - 1) : folder;
+	}
+}
+
+StandardPathResolver::StandardPathResolver()
+{
+	/*
+	 * Snapshot should be dropped as soon as its folder changes
+	 */
+	_watcher.setDebounceInterval(0);
+}
+
 void StandardPathResolver::setRenderContext(RenderContext* rc)
 {
+	CriticalSectionScope lock(_lock);
+	
 	_rc = rc;
 	_baseFolder = application().environment().applicationInputDataFolder();
 	
@@ -25,6 +55,7 @@ void StandardPathResolver::validateCaches()
 {
 	ET_ASSERT(_rc != nullptr);
 	
+	bool changed = false;
 	if (Locale::instance().currentLocale() != _cachedLocale)
 	{
 		_cachedLocale = Locale::instance().currentLocale();
@@ -36,17 +67,225 @@ void StandardPathResolver::validateCaches()
 		
 		if (!_cachedSubLang.empty())
 			_cachedLanguage += "-" + _cachedSubLang;
+		
+		changed = true;
+	}
+	
+	size_t screenScaleFactor = _rc->screenScaleFactor();
+	if (screenScaleFactor != _cachedScreenScaleFactor)
+	{
+		_cachedScreenScaleFactor = screenScaleFactor;
+		_cachedScreenScale = (_cachedScreenScaleFactor > 1) ?
+			"@" + intToStr(_cachedScreenScaleFactor) + "x" : emptyString;
+		changed = true;
 	}
 	
-	_cachedScreenScaleFactor = _rc->screenScaleFactor();
-	_cachedScreenScale = (_cachedScreenScaleFactor > 1) ?
-		"@" + intToStr(_cachedScreenScaleFactor) + "x" : emptyString;
+	if (changed)
+		clearResolvedNames();
+	
+	validateSnapshots();
+}
+
+void StandardPathResolver::validateSnapshots()
+{
+	bool changed = false;
+	
+	if (_watcher.hasChanges())
+	{
+		for (const auto& folder : _watcher.takeChanges())
+		{
+			auto i = _snapshots.find(snapshotKey(folder));
+			if (i != _snapshots.end())
+			{
+				_watcher.unwatchFolder(i->second.watchedFolder);
+				_snapshots.erase(i);
+				++_statistics.invalidations;
+				changed = true;
+			}
+		}
+	}
+	
+	/*
+	 * Watched folders are invalidated by notifications, others are checked by date
+	 */
+	uint64_t currentTime = queryContiniousTimeInMilliSeconds();
+	if ((_lastValidationTime == 0) || (currentTime - _lastValidationTime >= _validationInterval))
+	{
+		_lastValidationTime = currentTime;
+		
+		for (auto i = _snapshots.begin(); i != _snapshots.end(); )
+		{
+			if (i->second.listed && i->second.watchedFolder.empty() &&
+				(getFileDate(folderDatePath(i->first)) != i->second.date))
+			{
+				i = _snapshots.erase(i);
+				++_statistics.invalidations;
+				changed = true;
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+	
+	if (changed)
+		clearResolvedNames();
+}
+
+void StandardPathResolver::clearResolvedNames()
+{
+	_resolvedFiles.clear();
+	_resolvedFolders.clear();
+	_resolvedFolderSets.clear();
+}
+
+void StandardPathResolver::clearSnapshots()
+{
+	_watcher.unwatchAll();
+	_snapshots.clear();
+}
+
+/*
+ * Only folders of search paths are snapshotted, other paths
+ * (absolute or returned by custom resolver) are checked directly
+ */
+bool StandardPathResolver::isSearchPathFolder(const std::string& folder) const
+{
+	auto key = snapshotKey(folder);
+	for (const auto& path : _searchPath)
+	{
+		auto base = snapshotKey(path);
+		if (!base.empty() && (key.size() >= base.size()) && (key.compare(0, base.size(), base) == 0) &&
+			((key.size() == base.size()) || (base.back() == pathDelimiter) || (key[base.size()] == pathDelimiter)))
+		{
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+const StandardPathResolver::FolderSnapshot& StandardPathResolver::folderSnapshot(const std::string& folder)
+{
+	std::string key = snapshotKey(folder);
+	
+	auto i = _snapshots.find(key);
+	if (i != _snapshots.end())
+		return i->second;
+	
+	/*
+	 * Folder is watched before listing, so changes made during listing are reported.
+	 * Without notifications date is taken before listing, and such changes are found
+	 * by the next validation only if file system records them with a different date.
+	 */
+	FolderSnapshot& snapshot = _snapshots[key];
+	if (_watcher.watchFolder(folder))
+		snapshot.watchedFolder = addTrailingSlash(folder);
+	
+	uint64_t date = getFileDate(folderDatePath(folder));
+	
+	StringList files;
+	StringList folders;
+	snapshot.listed = getFolderEntries(folder, files, folders);
+	
+	if (!snapshot.listed && !snapshot.watchedFolder.empty())
+	{
+		_watcher.unwatchFolder(snapshot.watchedFolder);
+		snapshot.watchedFolder.clear();
+	}
+	
+	if (snapshot.listed)
+	{
+		snapshot.date = date;
+		
+		for (const auto& f : files)
+			snapshot.files.insert(snapshotKey(f));
+		
+		for (const auto& f : folders)
+			snapshot.folders.insert(snapshotKey(f));
+		
+		++_statistics.snapshotsCreated;
+	}
+	
+	return snapshot;
+}
+
+bool StandardPathResolver::probeFolder(const std::string& path)
+{
+	if (path.empty())
+		return false;
+	
+	if (_cacheEnabled)
+	{
+		auto folder = folderDatePath(normalizeFilePath(path));
+		auto parent = getFilePath(folder);
+		auto name = getFileName(folder);
+		
+		if (!parent.empty() && !name.empty() && (name != ".") && (name != "..") && isSearchPathFolder(parent))
+		{
+			const auto& snapshot = folderSnapshot(parent);
+			if (snapshot.listed)
+			{
+				++_statistics.snapshotProbes;
+				return snapshot.folders.count(snapshotKey(name)) > 0;
+			}
+		}
+	}
+	
+	++_statistics.fileSystemProbes;
+	return folderExists(path);
+}
+
+bool StandardPathResolver::probeFile(const std::string& path)
+{
+	if (path.empty())
+		return false;
+	
+	if (_cacheEnabled)
+	{
+		auto normalized = normalizeFilePath(path);
+		auto folder = getFilePath(normalized);
+		
+		if (!folder.empty() && isSearchPathFolder(folder))
+		{
+			const auto& snapshot = folderSnapshot(folder);
+			if (snapshot.listed)
+			{
+				++_statistics.snapshotProbes;
+				return snapshot.files.count(snapshotKey(getFileName(normalized))) > 0;
+			}
+			
+			if (!probeFolder(folder))
+				return false;
+		}
+	}
+	
+	++_statistics.fileSystemProbes;
+	return fileExists(path);
 }
 
 std::string StandardPathResolver::resolveFilePath(const std::string& input)
 {
+	CriticalSectionScope lock(_lock);
 	validateCaches();
 	
+	if (_cacheEnabled)
+	{
+		auto cached = _resolvedFiles.find(input);
+		if (cached != _resolvedFiles.end())
+		{
+			++_statistics.hits;
+			
+			if (!_silentErrors && !cached->second.exists)
+				log::warning("Unable to resolve file name: %s", input.c_str());
+			
+			return cached->second.path;
+		}
+	}
+	
+	++_statistics.misses;
+	
 	auto ext = "." + getFileExt(input);
 	auto name = removeFileExt(getFileName(input));
 	auto path = getFilePath(input);
@@ -54,9 +293,11 @@ std::string StandardPathResolver::resolveFilePath(const std::string& input)
 	std::string suggested = input;
 	
 	auto paths = resolveFolderPaths(path);
-	pushSearchPaths(paths);
+	
+	std::vector<std::string> folders(paths.begin(), paths.end());
+	folders.insert(folders.end(), _searchPath.begin(), _searchPath.end());
 
-	for (const auto& folder : _searchPath)
+	for (const auto& folder : folders)
 	{
 		auto baseName = folder + name;
 		
@@ -64,47 +305,54 @@ std::string StandardPathResolver::resolveFilePath(const std::string& input)
 		{
 			// path/file@Sx.ln-sb.ext
 			suggested = baseName + _cachedScreenScale + _cachedLanguage + ext;
-			if (fileExists(suggested))
+			if (probeFile(suggested))
 				break;
 
 			// path/file@Sx.ln.ext
 			suggested = baseName + _cachedScreenScale + _cachedLang + ext;
-			if (fileExists(suggested))
+			if (probeFile(suggested))
 				break;
 			
 			// path/file@Sx.ext
 			suggested = baseName + _cachedScreenScale + ext;
-			if (fileExists(suggested))
+			if (probeFile(suggested))
 				break;
 		}
 		
 		// path/file.ln-sb.ext
 		suggested = baseName + _cachedLanguage + ext;
-		if (fileExists(suggested))
+		if (probeFile(suggested))
 			break;
 
 		// path/file.ln.ext
 		suggested = baseName + _cachedLanguage + ext;
-		if (fileExists(suggested))
+		if (probeFile(suggested))
 			break;
 		
 		if (_cachedScreenScaleFactor > 0)
 		{
 			// path/file@Sx.ext
 			suggested = baseName + _cachedScreenScale + ext;
-			if (fileExists(suggested))
+			if (probeFile(suggested))
 				break;
 		}
 		
 		// path/file.ext
 		suggested = baseName + ext;
-		if (fileExists(suggested))
+		if (probeFile(suggested))
 			break;
 	}
 	
-	popSearchPaths(paths.size());
+	bool exists = probeFile(suggested);
 	
-	if (!_silentErrors && !fileExists(suggested))
+	if (_cacheEnabled)
+	{
+		ResolvedFile& resolved = _resolvedFiles[input];
+		resolved.path = suggested;
+		resolved.exists = exists;
+	}
+	
+	if (!_silentErrors && !exists)
 		log::warning("Unable to resolve file name: %s", input.c_str());
 
 	return suggested;
@@ -112,8 +360,31 @@ std::string StandardPathResolver::resolveFilePath(const std::string& input)
 
 std::set<std::string> StandardPathResolver::resolveFolderPaths(const std::string& input)
 {
+	CriticalSectionScope lock(_lock);
 	validateCaches();
+	
+	if (_cacheEnabled)
+	{
+		auto cached = _resolvedFolderSets.find(input);
+		if (cached != _resolvedFolderSets.end())
+		{
+			++_statistics.hits;
+			return cached->second;
+		}
+	}
+	
+	++_statistics.misses;
+	
+	auto result = resolveFolderPathsInternal(input);
+	
+	if (_cacheEnabled)
+		_resolvedFolderSets[input] = result;
+	
+	return result;
+}
 
+std::set<std::string> StandardPathResolver::resolveFolderPathsInternal(const std::string& input)
+{
 	auto normalizedInput = normalizeFilePath(input);
 
 	if (!normalizedInput.empty() && normalizedInput.back() == pathDelimiter)
@@ -124,14 +395,14 @@ std::set<std::string> StandardPathResolver::resolveFolderPaths(const std::string
 		result.insert(_baseFolder);
 	
 	auto suggested = addTrailingSlash(normalizedInput + _cachedLanguage);
-	if (folderExists(suggested))
+	if (probeFolder(suggested))
 		result.insert(suggested);
 	
 	suggested = addTrailingSlash(normalizedInput + _cachedLang);
-	if (folderExists(suggested))
+	if (probeFolder(suggested))
 		result.insert(suggested);
 	
-	if (folderExists(normalizedInput))
+	if (probeFolder(normalizedInput))
 		result.insert(addTrailingSlash(normalizedInput));
 	
 	for (const auto& path : _searchPath)
@@ -144,28 +415,28 @@ std::set<std::string> StandardPathResolver::resolveFolderPaths(const std::string
 		if (_cachedScreenScaleFactor > 0)
 		{
 			suggested = addTrailingSlash(base + _cachedScreenScale + _cachedLanguage);
-			if (fileExists(suggested))
+			if (probeFile(suggested))
 				result.insert(suggested);
 
 			suggested = addTrailingSlash(base + _cachedScreenScale + _cachedLang);
-			if (fileExists(suggested))
+			if (probeFile(suggested))
 				result.insert(suggested);
 
 			suggested = addTrailingSlash(base + _cachedScreenScale);
-			if (fileExists(suggested))
+			if (probeFile(suggested))
 				result.insert(suggested);
 		}
 
 		suggested = addTrailingSlash(base + _cachedLanguage);
-		if (folderExists(suggested))
+		if (probeFolder(suggested))
 			result.insert(suggested);
 		
 		suggested = addTrailingSlash(base + _cachedLang);
-		if (folderExists(suggested))
+		if (probeFolder(suggested))
 			result.insert(suggested);
 		
 		suggested = addTrailingSlash(base);
-		if (folderExists(suggested))
+		if (probeFolder(suggested))
 			result.insert(suggested);
 	}
 	
@@ -174,61 +445,158 @@ std::set<std::string> StandardPathResolver::resolveFolderPaths(const std::string
 
 std::string StandardPathResolver::resolveFolderPath(const std::string& input)
 {
+	CriticalSectionScope lock(_lock);
 	validateCaches();
 	
 	if (input.empty())
 		return _baseFolder;
 	
-	auto suggested = addTrailingSlash(input + _cachedLanguage);
-	if (folderExists(suggested))
-		return suggested;
-
-	suggested = addTrailingSlash(input + _cachedLang);
-	if (folderExists(suggested))
-		return suggested;
+	if (_cacheEnabled)
+	{
+		auto cached = _resolvedFolders.find(input);
+		if (cached != _resolvedFolders.end())
+		{
+			++_statistics.hits;
+			return cached->second;
+		}
+	}
 	
-	if (folderExists(input))
-		return input;
+	++_statistics.misses;
 	
-	for (const auto& path : _searchPath)
+	std::string result = input;
+	auto suggested = addTrailingSlash(input + _cachedLanguage);
+	if (probeFolder(suggested))
 	{
-		suggested = addTrailingSlash(path + input + _cachedLanguage);
-		if (folderExists(suggested))
-			return suggested;
-		
-		suggested = addTrailingSlash(path + input + _cachedLang);
-		if (folderExists(suggested))
-			return suggested;
-		
-		suggested = addTrailingSlash(path + input);
-		if (folderExists(suggested))
-			return suggested;
+		result = suggested;
 	}
+	else
+	{
+		suggested = addTrailingSlash(input + _cachedLang);
+		if (probeFolder(suggested))
+			result = suggested;
+		else if (!probeFolder(input))
+		{
+			for (const auto& path : _searchPath)
+			{
+				suggested = addTrailingSlash(path + input + _cachedLanguage);
+				if (probeFolder(suggested))
+					{ result = suggested; break; }
+				
+				suggested = addTrailingSlash(path + input + _cachedLang);
+				if (probeFolder(suggested))
+					{ result = suggested; break; }
+				
+				suggested = addTrailingSlash(path + input);
+				if (probeFolder(suggested))
+					{ result = suggested; break; }
+			}
+		}
+	}
+	
+	if (_cacheEnabled)
+		_resolvedFolders[input] = result;
 	
-	return input;
+	return result;
 }
 
 void StandardPathResolver::pushSearchPath(const std::string& path)
 {
+	CriticalSectionScope lock(_lock);
+	clearResolvedNames();
+	
 	_searchPath.push_front(addTrailingSlash(normalizeFilePath(path)));
 }
 
 void StandardPathResolver::pushSearchPaths(const std::set<std::string>& paths)
 {
+	CriticalSectionScope lock(_lock);
+	clearResolvedNames();
+	
 	_searchPath.insert(_searchPath.begin(), paths.begin(), paths.end());
 }
 
 void StandardPathResolver::pushRelativeSearchPath(const std::string& path)
 {
+	CriticalSectionScope lock(_lock);
+	clearResolvedNames();
+	
 	_searchPath.emplace_front(addTrailingSlash(normalizeFilePath(application().environment().applicationPath() + path)));
 	_searchPath.emplace_front(addTrailingSlash(normalizeFilePath(application().environment().applicationInputDataFolder() + path)));
 }
 
 void StandardPathResolver::popSearchPaths(size_t amount)
 {
+	CriticalSectionScope lock(_lock);
+	clearResolvedNames();
+	
 	for (size_t i = 0; i < amount; ++i)
 	{
 		if (_searchPath.size() > 1)
 			_searchPath.pop_front();
 	}
 }
+
+bool StandardPathResolver::cachedFileExists(const std::string& path)
+{
+	CriticalSectionScope lock(_lock);
+	validateSnapshots();
+	return probeFile(path);
+}
+
+bool StandardPathResolver::cachedFolderExists(const std::string& path)
+{
+	CriticalSectionScope lock(_lock);
+	validateSnapshots();
+	return probeFolder(path);
+}
+
+void StandardPathResolver::setCacheEnabled(bool enabled)
+{
+	CriticalSectionScope lock(_lock);
+	
+	_cacheEnabled = enabled;
+	clearSnapshots();
+	clearResolvedNames();
+}
+
+void StandardPathResolver::setCacheValidationInterval(float seconds)
+{
+	CriticalSectionScope lock(_lock);
+	_validationInterval = static_cast<uint64_t>(1000.0f * etMax(0.0f, seconds));
+}
+
+void StandardPathResolver::invalidateCache()
+{
+	CriticalSectionScope lock(_lock);
+	
+	_statistics.invalidations += _snapshots.size();
+	clearSnapshots();
+	clearResolvedNames();
+}
+
+void StandardPathResolver::invalidateCache(const std::string& folder)
+{
+	CriticalSectionScope lock(_lock);
+	
+	auto i = _snapshots.find(snapshotKey(addTrailingSlash(normalizeFilePath(folder))));
+	if (i != _snapshots.end())
+	{
+		_watcher.unwatchFolder(i->second.watchedFolder);
+		_snapshots.erase(i);
+		++_statistics.invalidations;
+	}
+	
+	clearResolvedNames();
+}
+
+StandardPathResolver::CacheStatistics StandardPathResolver::cacheStatistics()
+{
+	CriticalSectionScope lock(_lock);
+	return _statistics;
+}
+
+void StandardPathResolver::resetCacheStatistics()
+{
+	CriticalSectionScope lock(_lock);
+	_statistics = CacheStatistics();
+}
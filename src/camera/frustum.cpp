@@ -7,8 +7,246 @@
 
 #include <et/camera/frustum.h>
 
+#if (ET_PLATFORM_MAC || ET_PLATFORM_WIN)
+#	include <xmmintrin.h>
+#	define ET_FRUSTUM_SSE	1
+#endif
+
 using namespace et;
 
+namespace
+{
+	enum PlaneArray
+	{
+		PlaneArray_X,
+		PlaneArray_Y,
+		PlaneArray_Z,
+		PlaneArray_W,
+		PlaneArray_AbsX,
+		PlaneArray_AbsY,
+		PlaneArray_AbsZ,
+		PlaneArray_max
+	};
+
+	typedef float PlaneArrays[PlaneArray_max][FrustumPlane_max];
+
+#if (ET_FRUSTUM_SSE)
+	inline __m128 absps(__m128 v)
+		{ return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+#endif
+
+	/*
+	 * Every shape is tested as its center and its radius projected onto plane normal.
+	 * Shapes load four objects (or one) and compute projected radius for each plane.
+	 */
+	struct SphereShape
+	{
+		const Frustum::SphereArrays& a;
+
+		SphereShape(const Frustum::SphereArrays& arrays) :
+			a(arrays) { }
+
+		vec3 center(size_t i) const
+			{ return vec3(a.centerX[i], a.centerY[i], a.centerZ[i]); }
+
+		float radius(size_t i, const PlaneArrays&, size_t) const
+			{ return a.radius[i]; }
+
+#	if (ET_FRUSTUM_SSE)
+		__m128 cx, cy, cz, r;
+
+		void load(size_t i)
+		{
+			cx = _mm_loadu_ps(a.centerX + i);
+			cy = _mm_loadu_ps(a.centerY + i);
+			cz = _mm_loadu_ps(a.centerZ + i);
+			r = _mm_loadu_ps(a.radius + i);
+		}
+
+		__m128 radius(const PlaneArrays&, size_t) const
+			{ return r; }
+#	endif
+	};
+
+	struct AABBShape
+	{
+		const Frustum::AABBArrays& a;
+
+		AABBShape(const Frustum::AABBArrays& arrays) :
+			a(arrays) { }
+
+		vec3 center(size_t i) const
+			{ return vec3(a.centerX[i], a.centerY[i], a.centerZ[i]); }
+
+		float radius(size_t i, const PlaneArrays& p, size_t k) const
+		{
+			return p[PlaneArray_AbsX][k] * a.halfDimensionX[i] + p[PlaneArray_AbsY][k] * a.halfDimensionY[i] +
+				p[PlaneArray_AbsZ][k] * a.halfDimensionZ[i];
+		}
+
+#	if (ET_FRUSTUM_SSE)
+		__m128 cx, cy, cz, ex, ey, ez;
+
+		void load(size_t i)
+		{
+			cx = _mm_loadu_ps(a.centerX + i);
+			cy = _mm_loadu_ps(a.centerY + i);
+			cz = _mm_loadu_ps(a.centerZ + i);
+			ex = _mm_loadu_ps(a.halfDimensionX + i);
+			ey = _mm_loadu_ps(a.halfDimensionY + i);
+			ez = _mm_loadu_ps(a.halfDimensionZ + i);
+		}
+
+		__m128 radius(const PlaneArrays& p, size_t k) const
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[PlaneArray_AbsX][k]), ex),
+				_mm_mul_ps(_mm_set1_ps(p[PlaneArray_AbsY][k]), ey)), _mm_mul_ps(_mm_set1_ps(p[PlaneArray_AbsZ][k]), ez));
+		}
+#	endif
+	};
+
+	struct OBBShape
+	{
+		const Frustum::OBBArrays& a;
+
+		OBBShape(const Frustum::OBBArrays& arrays) :
+			a(arrays) { }
+
+		vec3 center(size_t i) const
+			{ return vec3(a.centerX[i], a.centerY[i], a.centerZ[i]); }
+
+		float radius(size_t i, const PlaneArrays& p, size_t k) const
+		{
+			vec3 n(p[PlaneArray_X][k], p[PlaneArray_Y][k], p[PlaneArray_Z][k]);
+			return std::abs(n.x * a.axisX[0][i] + n.y * a.axisX[1][i] + n.z * a.axisX[2][i]) * a.dimensionX[i] +
+				std::abs(n.x * a.axisY[0][i] + n.y * a.axisY[1][i] + n.z * a.axisY[2][i]) * a.dimensionY[i] +
+				std::abs(n.x * a.axisZ[0][i] + n.y * a.axisZ[1][i] + n.z * a.axisZ[2][i]) * a.dimensionZ[i];
+		}
+
+#	if (ET_FRUSTUM_SSE)
+		__m128 cx, cy, cz, ex, ey, ez;
+		__m128 axes[3][3];
+
+		void load(size_t i)
+		{
+			cx = _mm_loadu_ps(a.centerX + i);
+			cy = _mm_loadu_ps(a.centerY + i);
+			cz = _mm_loadu_ps(a.centerZ + i);
+			ex = _mm_loadu_ps(a.dimensionX + i);
+			ey = _mm_loadu_ps(a.dimensionY + i);
+			ez = _mm_loadu_ps(a.dimensionZ + i);
+			for (size_t c = 0; c < 3; ++c)
+			{
+				axes[0][c] = _mm_loadu_ps(a.axisX[c] + i);
+				axes[1][c] = _mm_loadu_ps(a.axisY[c] + i);
+				axes[2][c] = _mm_loadu_ps(a.axisZ[c] + i);
+			}
+		}
+
+		__m128 radius(const PlaneArrays& p, size_t k) const
+		{
+			__m128 nx = _mm_set1_ps(p[PlaneArray_X][k]);
+			__m128 ny = _mm_set1_ps(p[PlaneArray_Y][k]);
+			__m128 nz = _mm_set1_ps(p[PlaneArray_Z][k]);
+			__m128 extents[3] = { ex, ey, ez };
+			__m128 result = _mm_setzero_ps();
+			for (size_t j = 0; j < 3; ++j)
+			{
+				__m128 projection = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, axes[j][0]), _mm_mul_ps(ny, axes[j][1])),
+					_mm_mul_ps(nz, axes[j][2]));
+				result = _mm_add_ps(result, _mm_mul_ps(absps(projection), extents[j]));
+			}
+			return result;
+		}
+#	endif
+	};
+
+	struct ClassificationSink
+	{
+		FrustumTestResult* results = nullptr;
+
+		ClassificationSink(FrustumTestResult* r) :
+			results(r) { }
+
+		void operator()(size_t base, size_t count, uint32_t outsideMask, uint32_t insideMask)
+		{
+			for (size_t j = 0; j < count; ++j)
+			{
+				results[base + j] = (outsideMask & (1 << j)) ? FrustumTestResult_Outside :
+					((insideMask & (1 << j)) ? FrustumTestResult_Inside : FrustumTestResult_Intersects);
+			}
+		}
+	};
+
+	struct CullingSink
+	{
+		uint32_t* visibleIndices = nullptr;
+		size_t visibleCount = 0;
+
+		CullingSink(uint32_t* v) :
+			visibleIndices(v) { }
+
+		void operator()(size_t base, size_t count, uint32_t outsideMask, uint32_t)
+		{
+			for (size_t j = 0; j < count; ++j)
+			{
+				if ((outsideMask & (1 << j)) == 0)
+					visibleIndices[visibleCount++] = static_cast<uint32_t>(base + j);
+			}
+		}
+	};
+
+	/*
+	 * Object is outside if it is behind any plane and inside if it is in front of all planes
+	 */
+	template <typename Shape, typename Sink>
+	void classifyBatch(const PlaneArrays& p, Shape& shape, size_t count, Sink&& sink)
+	{
+		size_t i = 0;
+
+#	if (ET_FRUSTUM_SSE)
+		__m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4)
+		{
+			shape.load(i);
+
+			__m128 outside = zero;
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (size_t k = 0; k < FrustumPlane_max; ++k)
+			{
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[PlaneArray_X][k]), shape.cx), _mm_mul_ps(_mm_set1_ps(p[PlaneArray_Y][k]), shape.cy)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[PlaneArray_Z][k]), shape.cz), _mm_set1_ps(p[PlaneArray_W][k])));
+				__m128 radius = shape.radius(p, k);
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_sub_ps(distance, radius), zero));
+			}
+
+			sink(i, 4, static_cast<uint32_t>(_mm_movemask_ps(outside)), static_cast<uint32_t>(_mm_movemask_ps(inside)));
+		}
+#	endif
+
+		for (; i < count; ++i)
+		{
+			vec3 c = shape.center(i);
+
+			uint32_t outside = 0;
+			uint32_t inside = 1;
+			for (size_t k = 0; k < FrustumPlane_max; ++k)
+			{
+				float distance = p[PlaneArray_X][k] * c.x + p[PlaneArray_Y][k] * c.y + p[PlaneArray_Z][k] * c.z + p[PlaneArray_W][k];
+				float radius = shape.radius(i, p, k);
+				if (distance + radius < 0.0f)
+					outside = 1;
+				if (distance - radius < 0.0f)
+					inside = 0;
+			}
+
+			sink(i, 1, outside, inside);
+		}
+	}
+}
+
 Frustum::Frustum()
 {
 }
@@ -32,6 +270,22 @@ Frustum::Frustum(const mat4& mvp)
 	_corners[5] = invMVP * vec4( 1.0f, -1.0f,  1.0f, 1.0f);
 	_corners[6] = invMVP * vec4( 1.0f,  1.0f, -1.0f, 1.0f);
 	_corners[7] = invMVP * vec4( 1.0f,  1.0f,  1.0f, 1.0f);
+	
+	buildPlaneArrays();
+}
+
+void Frustum::buildPlaneArrays()
+{
+	for (size_t k = 0; k < FrustumPlane_max; ++k)
+	{
+		_planeArrays[PlaneArray_X][k] = _planes[k].x;
+		_planeArrays[PlaneArray_Y][k] = _planes[k].y;
+		_planeArrays[PlaneArray_Z][k] = _planes[k].z;
+		_planeArrays[PlaneArray_W][k] = _planes[k].w;
+		_planeArrays[PlaneArray_AbsX][k] = std::abs(_planes[k].x);
+		_planeArrays[PlaneArray_AbsY][k] = std::abs(_planes[k].y);
+		_planeArrays[PlaneArray_AbsZ][k] = std::abs(_planes[k].z);
+	}
 }
 
 bool Frustum::containsSphere(const Sphere& sphere) const
@@ -47,17 +301,102 @@ bool Frustum::containsSphere(const Sphere& sphere) const
 
 bool Frustum::containsAABB(const AABB& aabb) const
 {
-	for (const auto& frustumPlane : _planes)
+	return classifyAABB(aabb) != FrustumTestResult_Outside;
+}
+
+bool Frustum::containsOBB(const OBB& obb) const
+{
+	return classifyOBB(obb) != FrustumTestResult_Outside;
+}
+
+FrustumTestResult Frustum::classifySphere(const Sphere& sphere) const
+{
+	SphereArrays arrays;
+	arrays.centerX = &sphere.center().x;
+	arrays.centerY = &sphere.center().y;
+	arrays.centerZ = &sphere.center().z;
+	float radius = sphere.radius();
+	arrays.radius = &radius;
+
+	FrustumTestResult result = FrustumTestResult_Outside;
+	classifySpheres(arrays, 1, &result);
+	return result;
+}
+
+FrustumTestResult Frustum::classifyAABB(const AABB& aabb) const
+{
+	AABBArrays arrays;
+	arrays.centerX = &aabb.center.x;
+	arrays.centerY = &aabb.center.y;
+	arrays.centerZ = &aabb.center.z;
+	arrays.halfDimensionX = &aabb.halfDimension.x;
+	arrays.halfDimensionY = &aabb.halfDimension.y;
+	arrays.halfDimensionZ = &aabb.halfDimension.z;
+
+	FrustumTestResult result = FrustumTestResult_Outside;
+	classifyAABBs(arrays, 1, &result);
+	return result;
+}
+
+FrustumTestResult Frustum::classifyOBB(const OBB& obb) const
+{
+	OBBArrays arrays;
+	arrays.centerX = &obb.center.x;
+	arrays.centerY = &obb.center.y;
+	arrays.centerZ = &obb.center.z;
+	arrays.dimensionX = &obb.dimension.x;
+	arrays.dimensionY = &obb.dimension.y;
+	arrays.dimensionZ = &obb.dimension.z;
+	for (size_t i = 0; i < 3; ++i)
 	{
-		if (dot(aabb.center, frustumPlane.xyz()) + 2.0 * dot(aabb.halfDimension, absv(frustumPlane.xyz())) < -frustumPlane.w)
-			return false;
+		arrays.axisX[i] = &obb.transform[0][i];
+		arrays.axisY[i] = &obb.transform[1][i];
+		arrays.axisZ[i] = &obb.transform[2][i];
 	}
-	
-	return true;
+
+	FrustumTestResult result = FrustumTestResult_Outside;
+	classifyOBBs(arrays, 1, &result);
+	return result;
+}
+
+void Frustum::classifySpheres(const SphereArrays& arrays, size_t count, FrustumTestResult* results) const
+{
+	SphereShape shape(arrays);
+	classifyBatch(_planeArrays, shape, count, ClassificationSink(results));
+}
+
+void Frustum::classifyAABBs(const AABBArrays& arrays, size_t count, FrustumTestResult* results) const
+{
+	AABBShape shape(arrays);
+	classifyBatch(_planeArrays, shape, count, ClassificationSink(results));
+}
+
+void Frustum::classifyOBBs(const OBBArrays& arrays, size_t count, FrustumTestResult* results) const
+{
+	OBBShape shape(arrays);
+	classifyBatch(_planeArrays, shape, count, ClassificationSink(results));
+}
+
+size_t Frustum::cullSpheres(const SphereArrays& arrays, size_t count, uint32_t* visibleIndices) const
+{
+	SphereShape shape(arrays);
+	CullingSink sink(visibleIndices);
+	classifyBatch(_planeArrays, shape, count, sink);
+	return sink.visibleCount;
+}
+
+size_t Frustum::cullAABBs(const AABBArrays& arrays, size_t count, uint32_t* visibleIndices) const
+{
+	AABBShape shape(arrays);
+	CullingSink sink(visibleIndices);
+	classifyBatch(_planeArrays, shape, count, sink);
+	return sink.visibleCount;
 }
 
-bool Frustum::containsOBB(const OBB&) const
+size_t Frustum::cullOBBs(const OBBArrays& arrays, size_t count, uint32_t* visibleIndices) const
 {
-	ET_FAIL("Not implemented")
-	return false;
+	OBBShape shape(arrays);
+	CullingSink sink(visibleIndices);
+	classifyBatch(_planeArrays, shape, count, sink);
+	return sink.visibleCount;
 }
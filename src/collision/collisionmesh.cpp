@@ -0,0 +1,614 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/collision/collisionmesh.h>
+
+namespace et
+{
+	namespace
+	{
+		enum : uint32_t
+		{
+			BinsCount = 12,
+			MaxSurfaceAreaHeuristicDepth = 64,
+			MaxStackSize = 128,
+		};
+
+		inline float surfaceArea(const vec3& minVertex, const vec3& maxVertex)
+		{
+			vec3 d = maxv(maxVertex - minVertex, vec3(0.0f));
+			return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+
+		inline bool boxesOverlap(const vec3& minA, const vec3& maxA, const vec3& minB, const vec3& maxB)
+		{
+			return (minA.x <= maxB.x) && (maxA.x >= minB.x) && (minA.y <= maxB.y) &&
+				(maxA.y >= minB.y) && (minA.z <= maxB.z) && (maxA.z >= minB.z);
+		}
+
+		inline bool rayBox(const vec3& origin, const vec3& invDirection, const vec3& minVertex,
+			const vec3& maxVertex, float maxDistance, float& entry)
+		{
+			vec3 t0 = (minVertex - origin) * invDirection;
+			vec3 t1 = (maxVertex - origin) * invDirection;
+			vec3 tNear = minv(t0, t1);
+			vec3 tFar = maxv(t0, t1);
+			entry = etMax(etMax(tNear.x, tNear.y), etMax(tNear.z, 0.0f));
+			return entry <= etMin(etMin(tFar.x, tFar.y), etMin(tFar.z, maxDistance));
+		}
+
+		inline bool lowestRoot(float a, float b, float c, float maxRoot, float& root)
+		{
+			float determinant = b * b - 4.0f * a * c;
+			if ((determinant < 0.0f) || (a == 0.0f))
+				return false;
+
+			float sqrtD = std::sqrt(determinant);
+			float r1 = (-b - sqrtD) / (2.0f * a);
+			float r2 = (-b + sqrtD) / (2.0f * a);
+			if (r1 > r2)
+				std::swap(r1, r2);
+
+			if ((r1 > 0.0f) && (r1 < maxRoot))
+			{
+				root = r1;
+				return true;
+			}
+
+			if ((r2 > 0.0f) && (r2 < maxRoot))
+			{
+				root = r2;
+				return true;
+			}
+
+			return false;
+		}
+
+		/*
+		 * Face of triangle is tested first, if sphere does not hit the face
+		 * it could only touch vertices or edges
+		 */
+		bool sweepSphereTriangle(const vec3& center, float radius, const vec3& velocity, const triangle& t,
+			float maxTime, CollisionMesh::SweepHit& hit)
+		{
+			vec3 normal = t.normalizedNormal();
+			float distance = dot(center - t.v1(), normal);
+			if (distance < 0.0f)
+			{
+				distance = -distance;
+				normal = -normal;
+			}
+
+			float approachSpeed = -dot(normal, velocity);
+			if (approachSpeed > 0.0f)
+			{
+				float time = (distance - radius) / approachSpeed;
+				if ((time >= 0.0f) && (time < maxTime))
+				{
+					vec3 planePoint = center + time * velocity - radius * normal;
+					if (pointInsideTriangle(planePoint, t, normal))
+					{
+						hit.point = planePoint;
+						hit.normal = normal;
+						hit.time = time;
+						return true;
+					}
+				}
+			}
+
+			float velocitySquared = velocity.dotSelf();
+			if (velocitySquared <= std::numeric_limits<float>::epsilon())
+				return false;
+
+			float radiusSquared = sqr(radius);
+			float bestTime = maxTime;
+			bool found = false;
+
+			const vec3* vertices[3] = { &t.v1(), &t.v2(), &t.v3() };
+			for (const vec3* v : vertices)
+			{
+				vec3 toCenter = center - *v;
+				float b = 2.0f * dot(velocity, toCenter);
+				float c = toCenter.dotSelf() - radiusSquared;
+
+				float time = 0.0f;
+				if (lowestRoot(velocitySquared, b, c, bestTime, time))
+				{
+					bestTime = time;
+					hit.point = *v;
+					found = true;
+				}
+			}
+
+			for (size_t i = 0; i < 3; ++i)
+			{
+				const vec3& edgeStart = *vertices[i];
+				vec3 edge = *vertices[(i + 1) % 3] - edgeStart;
+				vec3 baseToVertex = edgeStart - center;
+
+				float edgeSquared = edge.dotSelf();
+				float edgeDotVelocity = dot(edge, velocity);
+				float edgeDotBaseToVertex = dot(edge, baseToVertex);
+
+				float a = -edgeSquared * velocitySquared + sqr(edgeDotVelocity);
+				float b = 2.0f * (edgeSquared * dot(velocity, baseToVertex) - edgeDotVelocity * edgeDotBaseToVertex);
+				float c = edgeSquared * (radiusSquared - baseToVertex.dotSelf()) + sqr(edgeDotBaseToVertex);
+
+				float time = 0.0f;
+				if (lowestRoot(a, b, c, bestTime, time))
+				{
+					float f = (edgeDotVelocity * time - edgeDotBaseToVertex) / edgeSquared;
+					if ((f >= 0.0f) && (f <= 1.0f))
+					{
+						bestTime = time;
+						hit.point = edgeStart + f * edge;
+						found = true;
+					}
+				}
+			}
+
+			if (found)
+			{
+				hit.time = bestTime;
+				hit.normal = normalize(center + bestTime * velocity - hit.point);
+			}
+
+			return found;
+		}
+	}
+}
+
+using namespace et;
+
+CollisionMesh::CollisionMesh(const triangle* triangles, size_t triangleCount)
+{
+	build(triangles, triangleCount);
+}
+
+void CollisionMesh::clear()
+{
+	_nodes.clear();
+	_triangles.clear();
+	_triangleIndices.clear();
+	_batches.clear();
+	_batchFirstTriangle.clear();
+}
+
+void CollisionMesh::build(const triangle* triangles, size_t triangleCount)
+{
+	clear();
+
+	if (triangleCount == 0)
+		return;
+
+	std::vector<BuildItem> items(triangleCount);
+	std::vector<uint32_t> order(triangleCount);
+	for (size_t i = 0; i < triangleCount; ++i)
+	{
+		const triangle& t = triangles[i];
+		BuildItem& item = items[i];
+		item.minVertex = minv(minv(t.v1(), t.v2()), t.v3());
+		item.maxVertex = maxv(maxv(t.v1(), t.v2()), t.v3());
+		item.centroid = 0.5f * (item.minVertex + item.maxVertex);
+		order[i] = static_cast<uint32_t>(i);
+	}
+
+	/*
+	 * Binary tree with at least one triangle per leaf never has more than 2n - 1 nodes,
+	 * references to nodes stay valid during build
+	 */
+	_nodes.reserve(2 * triangleCount);
+	_nodes.emplace_back();
+	buildNode(0, 0, static_cast<uint32_t>(triangleCount), 0, items, order);
+
+	_triangles.reserve(triangleCount);
+	_triangleIndices.swap(order);
+	for (uint32_t i : _triangleIndices)
+		_triangles.push_back(triangles[i]);
+
+	_batches.reserve(triangleCount / MaxTrianglesPerLeaf + 1);
+	_batchFirstTriangle.reserve(triangleCount / MaxTrianglesPerLeaf + 1);
+	for (Node& node : _nodes)
+	{
+		if (node.triangleCount == 0)
+			continue;
+
+		_batches.emplace_back();
+		_batches.back().pack(_triangles.data() + node.firstChild, node.triangleCount);
+		_batchFirstTriangle.push_back(node.firstChild);
+		node.firstChild = static_cast<uint32_t>(_batches.size() - 1);
+	}
+}
+
+void CollisionMesh::buildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth,
+	std::vector<BuildItem>& items, std::vector<uint32_t>& order)
+{
+	Node& node = _nodes[nodeIndex];
+
+	vec3 minCentroid(std::numeric_limits<float>::max());
+	vec3 maxCentroid(-std::numeric_limits<float>::max());
+	node.minVertex = vec3(std::numeric_limits<float>::max());
+	node.maxVertex = vec3(-std::numeric_limits<float>::max());
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		const BuildItem& item = items[order[i]];
+		node.minVertex = minv(node.minVertex, item.minVertex);
+		node.maxVertex = maxv(node.maxVertex, item.maxVertex);
+		minCentroid = minv(minCentroid, item.centroid);
+		maxCentroid = maxv(maxCentroid, item.centroid);
+	}
+
+	uint32_t count = end - begin;
+	if (count <= MaxTrianglesPerLeaf)
+	{
+		node.firstChild = begin;
+		node.triangleCount = count;
+		return;
+	}
+
+	vec3 extent = maxCentroid - minCentroid;
+	int axis = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2) : ((extent.y > extent.z) ? 1 : 2);
+
+	uint32_t middle = begin;
+	if ((depth < MaxSurfaceAreaHeuristicDepth) && (extent[axis] > 0.0f))
+	{
+		struct Bin
+		{
+			vec3 minVertex = vec3(std::numeric_limits<float>::max());
+			vec3 maxVertex = vec3(-std::numeric_limits<float>::max());
+			uint32_t count = 0;
+		};
+
+		Bin bins[BinsCount];
+		float binScale = static_cast<float>(BinsCount) / extent[axis];
+		auto binIndex = [&](uint32_t item) -> uint32_t
+		{
+			float position = (items[item].centroid[axis] - minCentroid[axis]) * binScale;
+			return etMin(static_cast<uint32_t>(position), static_cast<uint32_t>(BinsCount - 1));
+		};
+
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const BuildItem& item = items[order[i]];
+			Bin& bin = bins[binIndex(order[i])];
+			bin.minVertex = minv(bin.minVertex, item.minVertex);
+			bin.maxVertex = maxv(bin.maxVertex, item.maxVertex);
+			++bin.count;
+		}
+
+		/*
+		 * Cost of split after each bin: area of both sides multiplied by number of triangles
+		 */
+		float rightCost[BinsCount] = { };
+		Bin accumulated;
+		for (uint32_t i = BinsCount - 1; i > 0; --i)
+		{
+			accumulated.minVertex = minv(accumulated.minVertex, bins[i].minVertex);
+			accumulated.maxVertex = maxv(accumulated.maxVertex, bins[i].maxVertex);
+			accumulated.count += bins[i].count;
+			rightCost[i - 1] = surfaceArea(accumulated.minVertex, accumulated.maxVertex) *
+				static_cast<float>(accumulated.count);
+		}
+
+		float bestCost = std::numeric_limits<float>::max();
+		uint32_t bestSplit = BinsCount;
+		accumulated = Bin();
+		for (uint32_t i = 0; i + 1 < BinsCount; ++i)
+		{
+			accumulated.minVertex = minv(accumulated.minVertex, bins[i].minVertex);
+			accumulated.maxVertex = maxv(accumulated.maxVertex, bins[i].maxVertex);
+			accumulated.count += bins[i].count;
+			if ((accumulated.count == 0) || (accumulated.count == count))
+				continue;
+
+			float cost = surfaceArea(accumulated.minVertex, accumulated.maxVertex) *
+				static_cast<float>(accumulated.count) + rightCost[i];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = i;
+			}
+		}
+
+		if (bestSplit < BinsCount)
+		{
+			auto first = order.begin() + begin;
+			auto last = order.begin() + end;
+			middle = begin + static_cast<uint32_t>(std::partition(first, last,
+				[&](uint32_t item) { return binIndex(item) <= bestSplit; }) - first);
+		}
+	}
+
+	/*
+	 * Degenerate or too deep splits fall back to median of centroids
+	 */
+	if ((middle == begin) || (middle == end))
+	{
+		middle = begin + count / 2;
+		std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+			[&items, axis](uint32_t a, uint32_t b) { return items[a].centroid[axis] < items[b].centroid[axis]; });
+	}
+
+	uint32_t firstChild = static_cast<uint32_t>(_nodes.size());
+	node.firstChild = firstChild;
+	node.triangleCount = 0;
+
+	_nodes.emplace_back();
+	_nodes.emplace_back();
+	buildNode(firstChild, begin, middle, depth + 1, items, order);
+	buildNode(firstChild + 1, middle, end, depth + 1, items, order);
+}
+
+AABB CollisionMesh::bounds() const
+{
+	if (_nodes.empty())
+		return AABB();
+
+	const Node& root = _nodes.front();
+	return AABB(0.5f * (root.minVertex + root.maxVertex), 0.5f * (root.maxVertex - root.minVertex));
+}
+
+template <typename F>
+void CollisionMesh::queryBox(const vec3& minVertex, const vec3& maxVertex, F callback) const
+{
+	if (_nodes.empty())
+		return;
+
+	uint32_t stack[MaxStackSize];
+	size_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = _nodes[stack[--stackSize]];
+		if (!boxesOverlap(node.minVertex, node.maxVertex, minVertex, maxVertex))
+			continue;
+
+		if (node.triangleCount > 0)
+		{
+			callback(node.firstChild);
+		}
+		else
+		{
+			stack[stackSize++] = node.firstChild + 1;
+			stack[stackSize++] = node.firstChild;
+		}
+	}
+}
+
+bool CollisionMesh::rayClosestHit(const ray3d& r, float maxDistance, RayHit& hit, bool twoSided) const
+{
+	if (_nodes.empty())
+		return false;
+
+	vec3 invDirection(1.0f / r.direction.x, 1.0f / r.direction.y, 1.0f / r.direction.z);
+
+	uint32_t stack[MaxStackSize];
+	float stackEntry[MaxStackSize];
+	size_t stackSize = 0;
+
+	float entry = 0.0f;
+	if (!rayBox(r.origin, invDirection, _nodes.front().minVertex, _nodes.front().maxVertex, maxDistance, entry))
+		return false;
+
+	stack[stackSize] = 0;
+	stackEntry[stackSize++] = entry;
+
+	float closestDistance = maxDistance;
+	uint32_t closestTriangle = InvalidIndex;
+	bool closestBackFace = false;
+
+	while (stackSize > 0)
+	{
+		--stackSize;
+		if (stackEntry[stackSize] > closestDistance)
+			continue;
+
+		const Node& node = _nodes[stack[stackSize]];
+		if (node.triangleCount > 0)
+		{
+			TriangleBatch::RayResult result;
+			uint32_t lane = _batches[node.firstChild].intersectRay(r, closestDistance, twoSided, result);
+			if ((lane != TriangleBatch::InvalidLane) && (result.distance[lane] < closestDistance))
+			{
+				closestDistance = result.distance[lane];
+				closestTriangle = _batchFirstTriangle[node.firstChild] + lane;
+				closestBackFace = (result.backFaceMask & (1u << lane)) != 0;
+			}
+			continue;
+		}
+
+		/*
+		 * Nearest child is pushed last to be visited first
+		 */
+		uint32_t left = node.firstChild;
+		uint32_t right = left + 1;
+		float leftEntry = 0.0f;
+		float rightEntry = 0.0f;
+		bool hitLeft = rayBox(r.origin, invDirection, _nodes[left].minVertex, _nodes[left].maxVertex,
+			closestDistance, leftEntry);
+		bool hitRight = rayBox(r.origin, invDirection, _nodes[right].minVertex, _nodes[right].maxVertex,
+			closestDistance, rightEntry);
+
+		if (hitLeft && hitRight && (leftEntry < rightEntry))
+		{
+			std::swap(left, right);
+			std::swap(leftEntry, rightEntry);
+		}
+
+		if (hitLeft)
+		{
+			stack[stackSize] = left;
+			stackEntry[stackSize++] = leftEntry;
+		}
+
+		if (hitRight)
+		{
+			stack[stackSize] = right;
+			stackEntry[stackSize++] = rightEntry;
+		}
+	}
+
+	if (closestTriangle == InvalidIndex)
+		return false;
+
+	hit.distance = closestDistance;
+	hit.point = r.origin + closestDistance * r.direction;
+	hit.normal = closestBackFace ? -_triangles[closestTriangle].normalizedNormal() :
+		_triangles[closestTriangle].normalizedNormal();
+	hit.triangleIndex = _triangleIndices[closestTriangle];
+	return true;
+}
+
+bool CollisionMesh::rayAnyHit(const ray3d& r, float maxDistance, bool twoSided) const
+{
+	if (_nodes.empty())
+		return false;
+
+	vec3 invDirection(1.0f / r.direction.x, 1.0f / r.direction.y, 1.0f / r.direction.z);
+
+	uint32_t stack[MaxStackSize];
+	size_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = _nodes[stack[--stackSize]];
+
+		float entry = 0.0f;
+		if (!rayBox(r.origin, invDirection, node.minVertex, node.maxVertex, maxDistance, entry))
+			continue;
+
+		if (node.triangleCount > 0)
+		{
+			TriangleBatch::RayResult result;
+			if (_batches[node.firstChild].intersectRay(r, maxDistance, twoSided, result) != TriangleBatch::InvalidLane)
+				return true;
+		}
+		else
+		{
+			stack[stackSize++] = node.firstChild + 1;
+			stack[stackSize++] = node.firstChild;
+		}
+	}
+
+	return false;
+}
+
+bool CollisionMesh::sphereOverlap(const Sphere& s, Contact& contact) const
+{
+	bool found = false;
+	vec3 extent(s.radius());
+
+	queryBox(s.center() - extent, s.center() + extent, [&](uint32_t batch)
+	{
+		TriangleBatch::SphereResult result;
+		uint32_t lane = _batches[batch].intersectSphere(s.center(), s.radius(), result);
+		if ((lane != TriangleBatch::InvalidLane) && (!found || (result.penetration[lane] > contact.penetration)))
+		{
+			contact.point = result.point.at(lane);
+			contact.normal = result.normal.at(lane);
+			contact.penetration = result.penetration[lane];
+			contact.triangleIndex = _triangleIndices[_batchFirstTriangle[batch] + lane];
+			found = true;
+		}
+	});
+
+	return found;
+}
+
+size_t CollisionMesh::sphereContacts(const Sphere& s, std::vector<Contact>& contacts) const
+{
+	size_t initialSize = contacts.size();
+	vec3 extent(s.radius());
+
+	queryBox(s.center() - extent, s.center() + extent, [&](uint32_t batch)
+	{
+		TriangleBatch::SphereResult result;
+		if (_batches[batch].intersectSphere(s.center(), s.radius(), result) == TriangleBatch::InvalidLane)
+			return;
+
+		for (uint32_t lane = 0; lane < TriangleBatch::Width; ++lane)
+		{
+			if ((result.hitMask & (1u << lane)) == 0)
+				continue;
+
+			Contact c;
+			c.point = result.point.at(lane);
+			c.normal = result.normal.at(lane);
+			c.penetration = result.penetration[lane];
+			c.triangleIndex = _triangleIndices[_batchFirstTriangle[batch] + lane];
+			contacts.push_back(c);
+		}
+	});
+
+	return contacts.size() - initialSize;
+}
+
+bool CollisionMesh::sphereSweep(const Sphere& s, const vec3& velocity, SweepHit& hit) const
+{
+	if (_nodes.empty())
+		return false;
+
+	/*
+	 * Overlap at start is reported as contact at zero time
+	 */
+	Contact initialContact;
+	if (sphereOverlap(s, initialContact))
+	{
+		hit.point = initialContact.point;
+		hit.normal = initialContact.normal;
+		hit.time = 0.0f;
+		hit.triangleIndex = initialContact.triangleIndex;
+		return true;
+	}
+
+	/*
+	 * Center of sphere is traced against nodes expanded by radius
+	 */
+	vec3 extent(s.radius());
+	vec3 invVelocity(1.0f / velocity.x, 1.0f / velocity.y, 1.0f / velocity.z);
+
+	uint32_t stack[MaxStackSize];
+	size_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	float earliestTime = 1.0f;
+	bool found = false;
+
+	while (stackSize > 0)
+	{
+		const Node& node = _nodes[stack[--stackSize]];
+
+		float entry = 0.0f;
+		if (!rayBox(s.center(), invVelocity, node.minVertex - extent, node.maxVertex + extent, earliestTime, entry))
+			continue;
+
+		if (node.triangleCount > 0)
+		{
+			uint32_t firstTriangle = _batchFirstTriangle[node.firstChild];
+			for (uint32_t i = firstTriangle, e = firstTriangle + node.triangleCount; i < e; ++i)
+			{
+				SweepHit triangleHit;
+				if (sweepSphereTriangle(s.center(), s.radius(), velocity, _triangles[i], earliestTime, triangleHit))
+				{
+					hit = triangleHit;
+					hit.triangleIndex = _triangleIndices[i];
+					earliestTime = triangleHit.time;
+					found = true;
+				}
+			}
+		}
+		else
+		{
+			stack[stackSize++] = node.firstChild + 1;
+			stack[stackSize++] = node.firstChild;
+		}
+	}
+
+	return found;
+}
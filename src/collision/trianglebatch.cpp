@@ -0,0 +1,620 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/collision/trianglebatch.h>
+
+#if defined(__AVX__)
+#	include <immintrin.h>
+#	define ET_TRIANGLE_BATCH_AVX		1
+#elif (ET_PLATFORM_MAC || ET_PLATFORM_WIN)
+#	include <emmintrin.h>
+#	define ET_TRIANGLE_BATCH_SSE		1
+#elif (ET_PLATFORM_IOS) && defined(__aarch64__)
+#	include <arm_neon.h>
+#	define ET_TRIANGLE_BATCH_NEON	1
+#endif
+
+namespace et
+{
+	namespace
+	{
+		/*
+		 * Batch is processed by groups of lanes, one vector register each
+		 */
+		enum : uint32_t
+		{
+			Width = TriangleBatch::Width,
+#	if (ET_TRIANGLE_BATCH_AVX)
+			Lanes = 8
+#	elif (ET_TRIANGLE_BATCH_SSE || ET_TRIANGLE_BATCH_NEON)
+			Lanes = 4
+#	else
+			Lanes = Width
+#	endif
+		};
+		static_assert(Width % Lanes == 0, "Width of triangle batch should be multiple of vector lanes");
+
+		const float rayTriangleEpsilon = 1.0e-12f;
+
+#	if (ET_TRIANGLE_BATCH_AVX)
+
+		typedef __m256 floatN;
+		typedef __m256 maskN;
+
+		inline floatN fNload(const float* p)
+			{ return _mm256_loadu_ps(p); }
+
+		inline void fNstore(float* p, floatN v)
+			{ _mm256_storeu_ps(p, v); }
+
+		inline floatN fNset(float v)
+			{ return _mm256_set1_ps(v); }
+
+		inline floatN fNadd(floatN a, floatN b)
+			{ return _mm256_add_ps(a, b); }
+
+		inline floatN fNsub(floatN a, floatN b)
+			{ return _mm256_sub_ps(a, b); }
+
+		inline floatN fNmul(floatN a, floatN b)
+			{ return _mm256_mul_ps(a, b); }
+
+		inline floatN fNdiv(floatN a, floatN b)
+			{ return _mm256_div_ps(a, b); }
+
+		inline floatN fNmin(floatN a, floatN b)
+			{ return _mm256_min_ps(a, b); }
+
+		inline floatN fNmax(floatN a, floatN b)
+			{ return _mm256_max_ps(a, b); }
+
+		inline floatN fNsqrt(floatN a)
+			{ return _mm256_sqrt_ps(a); }
+
+		inline maskN fNless(floatN a, floatN b)
+			{ return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+
+		inline maskN fNlessEqual(floatN a, floatN b)
+			{ return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+
+		inline floatN fNselect(maskN m, floatN a, floatN b)
+			{ return _mm256_blendv_ps(b, a, m); }
+
+		inline maskN mNand(maskN a, maskN b)
+			{ return _mm256_and_ps(a, b); }
+
+		inline maskN mNor(maskN a, maskN b)
+			{ return _mm256_or_ps(a, b); }
+
+		inline uint32_t mNbits(maskN m)
+			{ return static_cast<uint32_t>(_mm256_movemask_ps(m)); }
+
+#	elif (ET_TRIANGLE_BATCH_SSE)
+
+		typedef __m128 floatN;
+		typedef __m128 maskN;
+
+		inline floatN fNload(const float* p)
+			{ return _mm_loadu_ps(p); }
+
+		inline void fNstore(float* p, floatN v)
+			{ _mm_storeu_ps(p, v); }
+
+		inline floatN fNset(float v)
+			{ return _mm_set1_ps(v); }
+
+		inline floatN fNadd(floatN a, floatN b)
+			{ return _mm_add_ps(a, b); }
+
+		inline floatN fNsub(floatN a, floatN b)
+			{ return _mm_sub_ps(a, b); }
+
+		inline floatN fNmul(floatN a, floatN b)
+			{ return _mm_mul_ps(a, b); }
+
+		inline floatN fNdiv(floatN a, floatN b)
+			{ return _mm_div_ps(a, b); }
+
+		inline floatN fNmin(floatN a, floatN b)
+			{ return _mm_min_ps(a, b); }
+
+		inline floatN fNmax(floatN a, floatN b)
+			{ return _mm_max_ps(a, b); }
+
+		inline floatN fNsqrt(floatN a)
+			{ return _mm_sqrt_ps(a); }
+
+		inline maskN fNless(floatN a, floatN b)
+			{ return _mm_cmplt_ps(a, b); }
+
+		inline maskN fNlessEqual(floatN a, floatN b)
+			{ return _mm_cmple_ps(a, b); }
+
+		inline floatN fNselect(maskN m, floatN a, floatN b)
+			{ return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+		inline maskN mNand(maskN a, maskN b)
+			{ return _mm_and_ps(a, b); }
+
+		inline maskN mNor(maskN a, maskN b)
+			{ return _mm_or_ps(a, b); }
+
+		inline uint32_t mNbits(maskN m)
+			{ return static_cast<uint32_t>(_mm_movemask_ps(m)); }
+
+#	elif (ET_TRIANGLE_BATCH_NEON)
+
+		typedef float32x4_t floatN;
+		typedef uint32x4_t maskN;
+
+		inline floatN fNload(const float* p)
+			{ return vld1q_f32(p); }
+
+		inline void fNstore(float* p, floatN v)
+			{ vst1q_f32(p, v); }
+
+		inline floatN fNset(float v)
+			{ return vdupq_n_f32(v); }
+
+		inline floatN fNadd(floatN a, floatN b)
+			{ return vaddq_f32(a, b); }
+
+		inline floatN fNsub(floatN a, floatN b)
+			{ return vsubq_f32(a, b); }
+
+		inline floatN fNmul(floatN a, floatN b)
+			{ return vmulq_f32(a, b); }
+
+		inline floatN fNdiv(floatN a, floatN b)
+			{ return vdivq_f32(a, b); }
+
+		inline floatN fNmin(floatN a, floatN b)
+			{ return vminq_f32(a, b); }
+
+		inline floatN fNmax(floatN a, floatN b)
+			{ return vmaxq_f32(a, b); }
+
+		inline floatN fNsqrt(floatN a)
+			{ return vsqrtq_f32(a); }
+
+		inline maskN fNless(floatN a, floatN b)
+			{ return vcltq_f32(a, b); }
+
+		inline maskN fNlessEqual(floatN a, floatN b)
+			{ return vcleq_f32(a, b); }
+
+		inline floatN fNselect(maskN m, floatN a, floatN b)
+			{ return vbslq_f32(m, a, b); }
+
+		inline maskN mNand(maskN a, maskN b)
+			{ return vandq_u32(a, b); }
+
+		inline maskN mNor(maskN a, maskN b)
+			{ return vorrq_u32(a, b); }
+
+		inline uint32_t mNbits(maskN m)
+		{
+			uint32x4_t b = vshrq_n_u32(m, 31);
+			return vgetq_lane_u32(b, 0) | (vgetq_lane_u32(b, 1) << 1) |
+				(vgetq_lane_u32(b, 2) << 2) | (vgetq_lane_u32(b, 3) << 3);
+		}
+
+#	else
+
+		struct floatN
+		{
+			float v[Lanes];
+		};
+
+		struct maskN
+		{
+			bool v[Lanes];
+		};
+
+		template <typename F>
+		inline floatN fNapply(const floatN& a, const floatN& b, F f)
+		{
+			floatN result;
+			for (uint32_t i = 0; i < Lanes; ++i)
+				result.v[i] = f(a.v[i], b.v[i]);
+			return result;
+		}
+
+		template <typename F>
+		inline maskN fNcompare(const floatN& a, const floatN& b, F f)
+		{
+			maskN result;
+			for (uint32_t i = 0; i < Lanes; ++i)
+				result.v[i] = f(a.v[i], b.v[i]);
+			return result;
+		}
+
+		inline floatN fNload(const float* p)
+		{
+			floatN result;
+			etCopyMemory(result.v, p, sizeof(result.v));
+			return result;
+		}
+
+		inline void fNstore(float* p, const floatN& a)
+			{ etCopyMemory(p, a.v, sizeof(a.v)); }
+
+		inline floatN fNset(float value)
+		{
+			floatN result;
+			for (float& v : result.v)
+				v = value;
+			return result;
+		}
+
+		inline floatN fNadd(const floatN& a, const floatN& b)
+			{ return fNapply(a, b, [](float x, float y) { return x + y; }); }
+
+		inline floatN fNsub(const floatN& a, const floatN& b)
+			{ return fNapply(a, b, [](float x, float y) { return x - y; }); }
+
+		inline floatN fNmul(const floatN& a, const floatN& b)
+			{ return fNapply(a, b, [](float x, float y) { return x * y; }); }
+
+		inline floatN fNdiv(const floatN& a, const floatN& b)
+			{ return fNapply(a, b, [](float x, float y) { return x / y; }); }
+
+		inline floatN fNmin(const floatN& a, const floatN& b)
+			{ return fNapply(a, b, [](float x, float y) { return (x < y) ? x : y; }); }
+
+		inline floatN fNmax(const floatN& a, const floatN& b)
+			{ return fNapply(a, b, [](float x, float y) { return (x > y) ? x : y; }); }
+
+		inline floatN fNsqrt(const floatN& a)
+			{ return fNapply(a, a, [](float x, float) { return std::sqrt(x); }); }
+
+		inline maskN fNless(const floatN& a, const floatN& b)
+			{ return fNcompare(a, b, [](float x, float y) { return x < y; }); }
+
+		inline maskN fNlessEqual(const floatN& a, const floatN& b)
+			{ return fNcompare(a, b, [](float x, float y) { return x <= y; }); }
+
+		inline floatN fNselect(const maskN& m, const floatN& a, const floatN& b)
+		{
+			floatN result;
+			for (uint32_t i = 0; i < Lanes; ++i)
+				result.v[i] = m.v[i] ? a.v[i] : b.v[i];
+			return result;
+		}
+
+		inline maskN mNand(const maskN& a, const maskN& b)
+		{
+			maskN result;
+			for (uint32_t i = 0; i < Lanes; ++i)
+				result.v[i] = a.v[i] && b.v[i];
+			return result;
+		}
+
+		inline maskN mNor(const maskN& a, const maskN& b)
+		{
+			maskN result;
+			for (uint32_t i = 0; i < Lanes; ++i)
+				result.v[i] = a.v[i] || b.v[i];
+			return result;
+		}
+
+		inline uint32_t mNbits(const maskN& m)
+		{
+			uint32_t result = 0;
+			for (uint32_t i = 0; i < Lanes; ++i)
+				result |= m.v[i] ? (1u << i) : 0u;
+			return result;
+		}
+
+#	endif
+
+		inline floatN fNneg(const floatN& a)
+			{ return fNsub(fNset(0.0f), a); }
+
+		inline floatN fNabs(const floatN& a)
+			{ return fNmax(a, fNneg(a)); }
+
+		inline floatN fNclamp01(const floatN& a)
+			{ return fNmax(fNmin(a, fNset(1.0f)), fNset(0.0f)); }
+
+		struct vec3N
+		{
+			floatN x;
+			floatN y;
+			floatN z;
+		};
+
+		inline vec3N v3Nload(const TriangleBatch::Vector& v, uint32_t base)
+			{ return { fNload(v.x + base), fNload(v.y + base), fNload(v.z + base) }; }
+
+		inline void v3Nstore(TriangleBatch::Vector& output, uint32_t base, const vec3N& v)
+			{ fNstore(output.x + base, v.x); fNstore(output.y + base, v.y); fNstore(output.z + base, v.z); }
+
+		inline vec3N v3Nset(const vec3& v)
+			{ return { fNset(v.x), fNset(v.y), fNset(v.z) }; }
+
+		inline vec3N v3Nadd(const vec3N& a, const vec3N& b)
+			{ return { fNadd(a.x, b.x), fNadd(a.y, b.y), fNadd(a.z, b.z) }; }
+
+		inline vec3N v3Nsub(const vec3N& a, const vec3N& b)
+			{ return { fNsub(a.x, b.x), fNsub(a.y, b.y), fNsub(a.z, b.z) }; }
+
+		inline vec3N v3Nscale(const vec3N& a, const floatN& s)
+			{ return { fNmul(a.x, s), fNmul(a.y, s), fNmul(a.z, s) }; }
+
+		inline vec3N v3Nneg(const vec3N& a)
+			{ return { fNneg(a.x), fNneg(a.y), fNneg(a.z) }; }
+
+		inline floatN v3Ndot(const vec3N& a, const vec3N& b)
+			{ return fNadd(fNadd(fNmul(a.x, b.x), fNmul(a.y, b.y)), fNmul(a.z, b.z)); }
+
+		inline vec3N v3Ncross(const vec3N& a, const vec3N& b)
+		{
+			return { fNsub(fNmul(a.y, b.z), fNmul(a.z, b.y)), fNsub(fNmul(a.z, b.x), fNmul(a.x, b.z)),
+				fNsub(fNmul(a.x, b.y), fNmul(a.y, b.x)) };
+		}
+
+		inline vec3N v3Nselect(const maskN& m, const vec3N& a, const vec3N& b)
+			{ return { fNselect(m, a.x, b.x), fNselect(m, a.y, b.y), fNselect(m, a.z, b.z) }; }
+
+		/*
+		 * Same as distanceSquareFromPointToLine
+		 */
+		inline floatN distanceSquareToSegment(const vec3N& p, const vec3N& l0, const vec3N& l1, vec3N& projection)
+		{
+			vec3N diff = v3Nsub(p, l0);
+			vec3N v = v3Nsub(l1, l0);
+
+			floatN t = v3Ndot(v, diff);
+			floatN dotVV = v3Ndot(v, v);
+			floatN f = fNselect(fNless(fNset(0.0f), t), fNselect(fNless(t, dotVV), fNdiv(t, dotVV),
+				fNset(1.0f)), fNset(0.0f));
+
+			diff = v3Nsub(diff, v3Nscale(v, f));
+			projection = v3Nadd(l0, v3Nscale(v, f));
+			return v3Ndot(diff, diff);
+		}
+	}
+}
+
+using namespace et;
+
+void TriangleBatch::clear()
+{
+	etFillMemory(this, 0, sizeof(TriangleBatch));
+}
+
+void TriangleBatch::set(uint32_t lane, const triangle& t)
+{
+	ET_ASSERT(lane < Width);
+
+	_v1.set(lane, t.v1());
+	_v2.set(lane, t.v2());
+	_v3.set(lane, t.v3());
+	_edge2to1.set(lane, t.edge2to1());
+	_edge3to1.set(lane, t.edge3to1());
+	_edge3to2.set(lane, t.edge3to2());
+	_normal.set(lane, t.normalizedNormal());
+
+	float a = dot(t.edge2to1(), t.edge2to1());
+	float b = dot(t.edge2to1(), t.edge3to1());
+	float c = dot(t.edge3to1(), t.edge3to1());
+	_edge2to1Square[lane] = a;
+	_edgesDot[lane] = b;
+	_edge3to1Square[lane] = c;
+	_determinant[lane] = a * c - b * b;
+
+	_count = etMax(_count, lane + 1);
+}
+
+uint32_t TriangleBatch::pack(const triangle* triangles, size_t count)
+{
+	clear();
+
+	uint32_t packed = static_cast<uint32_t>(etMin(count, static_cast<size_t>(Width)));
+	for (uint32_t i = 0; i < packed; ++i)
+		set(i, triangles[i]);
+
+	return packed;
+}
+
+uint32_t TriangleBatch::intersectRay(const ray3d& r, float maxDistance, bool twoSided, RayResult& result) const
+{
+	floatN zero = fNset(0.0f);
+	floatN one = fNset(1.0f);
+	vec3N origin = v3Nset(r.origin);
+	vec3N direction = v3Nset(r.direction);
+
+	result.hitMask = 0;
+	result.backFaceMask = 0;
+
+	for (uint32_t base = 0; base < _count; base += Lanes)
+	{
+		vec3N edge0 = v3Nload(_edge2to1, base);
+		vec3N edge1 = v3Nload(_edge3to1, base);
+
+		vec3N h = v3Ncross(direction, edge1);
+		floatN det = v3Ndot(edge0, h);
+		maskN valid = fNless(fNset(rayTriangleEpsilon), twoSided ? fNabs(det) : det);
+
+		floatN invDet = fNdiv(one, det);
+		vec3N s = v3Nsub(origin, v3Nload(_v1, base));
+		floatN u = fNmul(v3Ndot(s, h), invDet);
+		valid = mNand(valid, mNand(fNlessEqual(zero, u), fNlessEqual(u, one)));
+
+		vec3N q = v3Ncross(s, edge0);
+		floatN v = fNmul(v3Ndot(direction, q), invDet);
+		valid = mNand(valid, mNand(fNlessEqual(zero, v), fNlessEqual(fNadd(u, v), one)));
+
+		floatN t = fNmul(v3Ndot(edge1, q), invDet);
+		valid = mNand(valid, mNand(fNlessEqual(zero, t), fNlessEqual(t, fNset(maxDistance))));
+
+		fNstore(result.distance + base, t);
+		result.hitMask |= mNbits(valid) << base;
+		result.backFaceMask |= mNbits(fNless(det, zero)) << base;
+	}
+
+	result.hitMask &= (1u << _count) - 1;
+	result.backFaceMask &= result.hitMask;
+
+	uint32_t closestLane = InvalidLane;
+	for (uint32_t lane = 0; lane < Width; ++lane)
+	{
+		if ((result.hitMask & (1u << lane)) == 0)
+			result.distance[lane] = std::numeric_limits<float>::infinity();
+		else if ((closestLane == InvalidLane) || (result.distance[lane] < result.distance[closestLane]))
+			closestLane = lane;
+	}
+
+	return closestLane;
+}
+
+uint32_t TriangleBatch::intersectSphere(const vec3& aCenter, float aRadius, SphereResult& result) const
+{
+	floatN zero = fNset(0.0f);
+	floatN radius = fNset(aRadius);
+	floatN radiusSquared = fNset(sqr(aRadius));
+	vec3N center = v3Nset(aCenter);
+
+	result.hitMask = 0;
+
+	for (uint32_t base = 0; base < _count; base += Lanes)
+	{
+		vec3N v1 = v3Nload(_v1, base);
+		vec3N v2 = v3Nload(_v2, base);
+		vec3N v3 = v3Nload(_v3, base);
+		vec3N normal = v3Nload(_normal, base);
+
+		floatN distanceFromPlane = v3Ndot(v3Nsub(center, v1), normal);
+		maskN backSide = fNless(distanceFromPlane, zero);
+		distanceFromPlane = fNselect(backSide, fNneg(distanceFromPlane), distanceFromPlane);
+		normal = v3Nselect(backSide, v3Nneg(normal), normal);
+
+		maskN valid = fNless(distanceFromPlane, radius);
+
+		/*
+		 * Projection of center lies inside triangle, see pointInsideTriangle
+		 */
+		floatN r1 = v3Ndot(v3Ncross(v3Nload(_edge2to1, base), normal), v3Nsub(center, v1));
+		floatN r2 = v3Ndot(v3Ncross(v3Nload(_edge3to2, base), normal), v3Nsub(center, v2));
+		floatN r3 = v3Ndot(v3Ncross(v3Nload(_edge3to1, base), normal), v3Nsub(v3, center));
+		maskN inside = mNor(
+			mNand(mNand(fNless(zero, r1), fNless(zero, r2)), fNless(zero, r3)),
+			mNand(mNand(fNlessEqual(r1, zero), fNlessEqual(r2, zero)), fNlessEqual(r3, zero)));
+
+		/*
+		 * Otherwise the first edge within radius provides contact point
+		 */
+		vec3N p1;
+		vec3N p2;
+		vec3N p3;
+		maskN near1 = fNlessEqual(distanceSquareToSegment(center, v1, v2, p1), radiusSquared);
+		maskN near2 = fNlessEqual(distanceSquareToSegment(center, v2, v3, p2), radiusSquared);
+		maskN near3 = fNlessEqual(distanceSquareToSegment(center, v3, v1, p3), radiusSquared);
+
+		vec3N point = v3Nselect(inside, v3Nsub(center, v3Nscale(normal, distanceFromPlane)),
+			v3Nselect(near1, p1, v3Nselect(near2, p2, p3)));
+		valid = mNand(valid, mNor(inside, mNor(near1, mNor(near2, near3))));
+
+		vec3N contactToCenter = v3Nsub(center, point);
+		floatN distanceSquared = v3Ndot(contactToCenter, contactToCenter);
+		valid = mNand(valid, fNlessEqual(distanceSquared, radiusSquared));
+
+		maskN separated = fNless(fNset(std::numeric_limits<float>::epsilon()), distanceSquared);
+		floatN distance = fNsqrt(distanceSquared);
+		vec3N contactNormal = { fNdiv(contactToCenter.x, distance), fNdiv(contactToCenter.y, distance),
+			fNdiv(contactToCenter.z, distance) };
+
+		v3Nstore(result.point, base, point);
+		v3Nstore(result.normal, base, v3Nselect(separated, contactNormal, normal));
+		fNstore(result.penetration + base, fNselect(separated, fNsub(radius, distance), radius));
+		result.hitMask |= mNbits(valid) << base;
+	}
+
+	result.hitMask &= (1u << _count) - 1;
+
+	uint32_t deepestLane = InvalidLane;
+	for (uint32_t lane = 0; lane < Width; ++lane)
+	{
+		if ((result.hitMask & (1u << lane)) == 0)
+			continue;
+
+		if ((deepestLane == InvalidLane) || (result.penetration[lane] > result.penetration[deepestLane]))
+			deepestLane = lane;
+	}
+
+	return deepestLane;
+}
+
+/*
+ * Regions of closestPointOnTriangle are evaluated for all lanes and selected by masks
+ */
+uint32_t TriangleBatch::closestPoint(const vec3& aPoint, PointResult& result) const
+{
+	floatN zero = fNset(0.0f);
+	floatN one = fNset(1.0f);
+	vec3N p = v3Nset(aPoint);
+
+	for (uint32_t base = 0; base < _count; base += Lanes)
+	{
+		vec3N v1 = v3Nload(_v1, base);
+		vec3N edge0 = v3Nload(_edge2to1, base);
+		vec3N edge1 = v3Nload(_edge3to1, base);
+		vec3N v0 = v3Nsub(v1, p);
+
+		floatN a = fNload(_edge2to1Square + base);
+		floatN b = fNload(_edgesDot + base);
+		floatN c = fNload(_edge3to1Square + base);
+		floatN det = fNload(_determinant + base);
+		floatN d = v3Ndot(edge0, v0);
+		floatN e = v3Ndot(edge1, v0);
+		floatN s = fNsub(fNmul(b, e), fNmul(c, d));
+		floatN t = fNsub(fNmul(b, d), fNmul(a, e));
+
+		floatN invDet = fNdiv(one, det);
+		floatN denominator = fNadd(fNsub(a, fNmul(fNset(2.0f), b)), c);
+		floatN sEdge0 = fNclamp01(fNdiv(fNneg(d), a));
+		floatN tEdge1 = fNclamp01(fNdiv(fNneg(e), c));
+		floatN sEdgeS = fNclamp01(fNdiv(fNsub(fNadd(c, e), fNadd(b, d)), denominator));
+		floatN sEdgeT = fNclamp01(fNdiv(fNsub(fNsub(fNadd(c, e), b), d), denominator));
+
+		maskN sNegative = fNless(s, zero);
+		maskN tNegative = fNless(t, zero);
+		maskN dNegative = fNless(d, zero);
+		maskN firstBranch = fNless(fNadd(s, t), det);
+		maskN towardsEdgeS = fNless(fNadd(b, d), fNadd(c, e));
+		maskN towardsEdgeT = fNless(fNadd(b, e), fNadd(a, d));
+
+		floatN s1 = fNselect(sNegative, fNselect(mNand(tNegative, dNegative), sEdge0, zero),
+			fNselect(tNegative, sEdge0, fNmul(s, invDet)));
+		floatN t1 = fNselect(sNegative, fNselect(mNand(tNegative, dNegative), zero, tEdge1),
+			fNselect(tNegative, zero, fNmul(t, invDet)));
+
+		floatN s2 = fNselect(sNegative, fNselect(towardsEdgeS, sEdgeS, zero),
+			fNselect(tNegative, fNselect(towardsEdgeT, sEdgeT, tEdge1), sEdgeT));
+		floatN t2 = fNselect(sNegative, fNselect(towardsEdgeS, fNsub(one, sEdgeS), tEdge1),
+			fNselect(tNegative, fNselect(towardsEdgeT, fNsub(one, sEdgeT), zero), fNsub(one, sEdgeT)));
+
+		floatN finalS = fNselect(firstBranch, s1, s2);
+		floatN finalT = fNselect(firstBranch, t1, t2);
+
+		vec3N point = v3Nadd(v3Nadd(v1, v3Nscale(edge0, finalS)), v3Nscale(edge1, finalT));
+		vec3N delta = v3Nsub(point, p);
+
+		v3Nstore(result.point, base, point);
+		fNstore(result.distanceSquared + base, v3Ndot(delta, delta));
+	}
+
+	uint32_t closestLane = InvalidLane;
+	for (uint32_t lane = 0; lane < _count; ++lane)
+	{
+		if ((closestLane == InvalidLane) || (result.distanceSquared[lane] < result.distanceSquared[closestLane]))
+			closestLane = lane;
+	}
+
+	return closestLane;
+}
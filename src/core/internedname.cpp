@@ -0,0 +1,89 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <deque>
+#include <unordered_map>
+#include <et/threading/criticalsection.h>
+#include <et/core/internedname.h>
+
+using namespace et;
+
+namespace
+{
+	/*
+	 * Strings are kept in deque, so references returned by string() stay valid
+	 */
+	class NameTable
+	{
+	public:
+		NameTable()
+		{
+			_strings.emplace_back();
+			_identifiers.emplace(_strings.back(), InternedName::EmptyIdentifier);
+		}
+
+		uint32_t intern(const std::string& s)
+		{
+			CriticalSectionScope lock(_lock);
+
+			auto i = _identifiers.find(s);
+			if (i != _identifiers.end())
+				return i->second;
+
+			uint32_t identifier = static_cast<uint32_t>(_strings.size());
+			_strings.push_back(s);
+			_identifiers.emplace(s, identifier);
+			return identifier;
+		}
+
+		uint32_t find(const std::string& s)
+		{
+			CriticalSectionScope lock(_lock);
+
+			auto i = _identifiers.find(s);
+			return (i == _identifiers.end()) ? InternedName::MissingIdentifier : i->second;
+		}
+
+		const std::string& string(uint32_t identifier)
+		{
+			CriticalSectionScope lock(_lock);
+			return (identifier < _strings.size()) ? _strings[identifier] : _strings.front();
+		}
+
+	private:
+		CriticalSection _lock;
+		std::deque<std::string> _strings;
+		std::unordered_map<std::string, uint32_t> _identifiers;
+	};
+
+	NameTable& nameTable()
+	{
+		static NameTable table;
+		return table;
+	}
+}
+
+InternedName::InternedName(const std::string& s)
+{
+	if (!s.empty())
+		_identifier = nameTable().intern(s);
+}
+
+InternedName InternedName::find(const std::string& s)
+{
+	InternedName result;
+
+	if (!s.empty())
+		result._identifier = nameTable().find(s);
+
+	return result;
+}
+
+const std::string& InternedName::string() const
+{
+	return nameTable().string(_identifier);
+}
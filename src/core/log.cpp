@@ -0,0 +1,1281 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <mutex>
+#include <csignal>
+#include <cwchar>
+#include <condition_variable>
+#include <et/core/et.h>
+#include <et/core/profiler.h>
+
+#if (!ET_PLATFORM_WIN)
+#	include <signal.h>
+#endif
+
+namespace et
+{
+	namespace log
+	{
+		static_assert((bytesPerThread & (bytesPerThread - 1)) == 0, "bytesPerThread should be power of two");
+
+		enum class RecordType : uint32_t
+		{
+			Debug,
+			Info,
+			Warning,
+			Error,
+			Padding
+		};
+
+		/*
+		 * Record is header, format string and arguments packed by packArguments.
+		 * Records are 8-byte aligned and never wrap around end of the ring,
+		 * padding record fills the tail instead. Padding could be only 8 bytes long,
+		 * so size and type are the first fields.
+		 */
+		struct RecordHeader
+		{
+			uint32_t size = 0;
+			RecordType type = RecordType::Padding;
+			uint64_t timestamp = 0;
+			uint32_t threadIndex = 0;
+			uint32_t formatLength = 0;
+		};
+
+		enum : uint32_t
+		{
+			recordAlignment = 8,
+			maxRecordSize = bytesPerThread / 4,
+			maxStringLength = bytesPerThread / 8,
+			nullStringLength = 0xffffffff
+		};
+
+		/*
+		 * Single producer (owning thread), single consumer (thread holding drainLock)
+		 */
+		struct ThreadLog
+		{
+			char ring[bytesPerThread];
+			std::atomic<uint64_t> written;
+			std::atomic<uint64_t> read;
+			std::atomic<uint64_t> dropped;
+			std::vector<char> scratch;
+			uint32_t threadIndex = 0;
+			bool inUse = true;
+
+			ThreadLog(uint32_t index) :
+				written(0), read(0), dropped(0), threadIndex(index) { }
+		};
+
+		struct ThreadLogHolder
+		{
+			ThreadLog* log = nullptr;
+			~ThreadLogHolder();
+		};
+
+		inline uint32_t recordSize(size_t payload)
+		{
+			return static_cast<uint32_t>(sizeof(RecordHeader) + payload + recordAlignment - 1) & ~(recordAlignment - 1);
+		}
+
+		struct PendingRecord
+		{
+			const RecordHeader* header = nullptr;
+			uint32_t order = 0;
+		};
+
+		/*
+		 * Counts locks taken by current thread, so crash handler knows which ones it cannot wait for
+		 */
+		template <typename M>
+		class TrackedLock
+		{
+		public:
+			TrackedLock(M& m, uint32_t& depth) :
+				_mutex(m), _depth(depth) { ++_depth; _mutex.lock(); }
+
+			~TrackedLock()
+				{ _mutex.unlock(); --_depth; }
+
+		private:
+			TrackedLock(const TrackedLock&) = delete;
+			TrackedLock& operator = (const TrackedLock&) = delete;
+
+		private:
+			M& _mutex;
+			uint32_t& _depth;
+		};
+
+		struct LogState
+		{
+			std::recursive_mutex outputsLock;
+
+			std::mutex threadsLock;
+			std::vector<ThreadLog*> threads;
+
+			std::mutex drainLock;
+			std::vector<PendingRecord> pending;
+			std::string formatted;
+			std::string formatText;
+			std::string specText;
+			std::string stringValue;
+			std::wstring wideValue;
+
+			std::mutex consumerLock;
+			std::condition_variable consumerWake;
+			std::thread consumer;
+			bool wakeRequested = false;
+			bool consumerRunning = false;
+
+			std::atomic<bool> async;
+			std::atomic<uint64_t> droppedTotal;
+			std::atomic<OverflowPolicy> overflowPolicy;
+			bool crashHandlersInstalled = false;
+
+			LogState() :
+				async(false), droppedTotal(0), overflowPolicy(OverflowPolicy::DropMessage) { }
+
+			~LogState();
+		};
+
+		enum class ArgumentClass : uint32_t
+		{
+			None,
+			Signed,
+			Unsigned,
+			Char,
+			WideChar,
+			Double,
+			LongDouble,
+			Pointer,
+			String,
+			WideString,
+			WriteBack
+		};
+
+		enum class ArgumentLength : uint32_t
+		{
+			Default,
+			Char,
+			Short,
+			Long,
+			LongLong,
+			IntMax,
+			Size,
+			PtrDiff,
+			LongDouble,
+		};
+
+		struct FormatSpec
+		{
+			const char* begin = nullptr;
+			const char* lengthBegin = nullptr;
+			const char* lengthEnd = nullptr;
+			const char* end = nullptr;
+			uint32_t starCount = 0;
+			ArgumentLength length = ArgumentLength::Default;
+			ArgumentClass argument = ArgumentClass::None;
+		};
+
+		LogState& state();
+		ThreadLog& currentThreadLog();
+
+		void dispatch(RecordType, const char*, va_list);
+		void passToOutputs(RecordType, const char*, va_list);
+		void passTextToOutputs(RecordType, const char*, ...);
+
+		const char* parseSpec(const char*, FormatSpec&);
+		uint32_t packArguments(const char*, va_list, std::vector<char>&);
+		uint32_t packPreformatted(const char*, va_list, std::vector<char>&);
+		void pushRecord(RecordType, const char*, va_list);
+		bool reserveRecord(ThreadLog&, uint32_t, uint64_t&, uint32_t&);
+
+		void drain();
+		void drainLocked();
+		void formatRecord(LogState&, const RecordHeader*);
+		void consumerFunction();
+		void requestDrain();
+
+		void installCrashHandlers();
+		void removeCrashHandlers();
+		void drainOnCrash();
+
+		static thread_local bool insideConsumer = false;
+		static thread_local uint32_t outputsLockDepth = 0;
+		static thread_local uint32_t threadsLockDepth = 0;
+		static thread_local uint32_t drainLockDepth = 0;
+
+		static const int crashSignals[] =
+		{
+			SIGABRT, SIGSEGV, SIGFPE, SIGILL,
+#		if defined(SIGBUS)
+			SIGBUS,
+#		endif
+		};
+		static const size_t crashSignalsCount = sizeof(crashSignals) / sizeof(crashSignals[0]);
+
+#	if (ET_PLATFORM_WIN)
+		void crashHandler(int);
+		static void (*previousCrashHandlers[crashSignalsCount])(int) = { };
+#	else
+		void crashHandler(int, siginfo_t*, void*);
+		static struct sigaction previousCrashActions[crashSignalsCount] = { };
+#	endif
+	}
+}
+
+using namespace et;
+
+log::LogState& log::state()
+{
+	static LogState sharedState;
+	return sharedState;
+}
+
+log::LogState::~LogState()
+{
+	disableAsyncOutput();
+
+	for (auto t : threads)
+		delete t;
+}
+
+/*
+ * Outputs
+ */
+void log::addOutput(Output::Pointer ptr)
+{
+	TrackedLock<std::recursive_mutex> lock(state().outputsLock, outputsLockDepth);
+	sharedLogOutputs().push_back(ptr);
+}
+
+void log::removeOutput(Output::Pointer ptr)
+{
+	TrackedLock<std::recursive_mutex> lock(state().outputsLock, outputsLockDepth);
+	auto& outputs = sharedLogOutputs();
+	outputs.erase(std::remove_if(outputs.begin(), outputs.end(),
+		[ptr](Output::Pointer out) { return out == ptr; }), outputs.end());
+}
+
+void log::debug(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	dispatch(RecordType::Debug, format, args);
+	va_end(args);
+}
+
+void log::info(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	dispatch(RecordType::Info, format, args);
+	va_end(args);
+}
+
+void log::warning(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	dispatch(RecordType::Warning, format, args);
+	va_end(args);
+}
+
+void log::error(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	dispatch(RecordType::Error, format, args);
+	va_end(args);
+}
+
+void log::dispatch(RecordType type, const char* format, va_list args)
+{
+	/*
+	 * Messages from outputs called by consumer are passed through directly
+	 */
+	if (state().async.load(std::memory_order_acquire) && !insideConsumer)
+		pushRecord(type, format, args);
+	else
+		passToOutputs(type, format, args);
+}
+
+void log::passToOutputs(RecordType type, const char* format, va_list args)
+{
+	TrackedLock<std::recursive_mutex> lock(state().outputsLock, outputsLockDepth);
+	for (Output::Pointer output : sharedLogOutputs())
+	{
+		va_list outputArgs;
+		va_copy(outputArgs, args);
+		switch (type)
+		{
+			case RecordType::Debug:
+				output->debug(format, outputArgs);
+				break;
+
+			case RecordType::Info:
+				output->info(format, outputArgs);
+				break;
+
+			case RecordType::Warning:
+				output->warning(format, outputArgs);
+				break;
+
+			case RecordType::Error:
+				output->error(format, outputArgs);
+				break;
+
+			default:
+				break;
+		}
+		va_end(outputArgs);
+	}
+}
+
+void log::passTextToOutputs(RecordType type, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	passToOutputs(type, format, args);
+	va_end(args);
+}
+
+/*
+ * Asynchronous output
+ */
+void log::enableAsyncOutput(OverflowPolicy policy)
+{
+	auto& s = state();
+	std::unique_lock<std::mutex> lock(s.consumerLock);
+	s.overflowPolicy.store(policy, std::memory_order_relaxed);
+
+	if (s.consumerRunning) return;
+
+	s.consumerRunning = true;
+	s.wakeRequested = false;
+	s.consumer = std::thread(consumerFunction);
+	s.async.store(true, std::memory_order_release);
+	lock.unlock();
+
+	installCrashHandlers();
+}
+
+void log::disableAsyncOutput()
+{
+	auto& s = state();
+	{
+		std::lock_guard<std::mutex> lock(s.consumerLock);
+		if (!s.consumerRunning) return;
+
+		s.async.store(false, std::memory_order_release);
+		s.consumerRunning = false;
+	}
+	s.consumerWake.notify_one();
+	s.consumer.join();
+
+	removeCrashHandlers();
+	drain();
+}
+
+bool log::asyncOutputEnabled()
+{
+	return state().async.load(std::memory_order_acquire);
+}
+
+uint64_t log::droppedMessages()
+{
+	return state().droppedTotal.load(std::memory_order_relaxed);
+}
+
+void log::flush()
+{
+	if (!insideConsumer)
+		drain();
+}
+
+log::ThreadLog& log::currentThreadLog()
+{
+	/*
+	 * Rings are owned by shared state and reused by new threads,
+	 * so records of finished threads are still written to outputs.
+	 */
+	static thread_local ThreadLogHolder holder;
+
+	if (holder.log == nullptr)
+	{
+		auto& s = state();
+		TrackedLock<std::mutex> lock(s.threadsLock, threadsLockDepth);
+		for (auto t : s.threads)
+		{
+			if (!t->inUse)
+			{
+				t->inUse = true;
+				holder.log = t;
+				break;
+			}
+		}
+
+		if (holder.log == nullptr)
+		{
+			holder.log = new ThreadLog(static_cast<uint32_t>(s.threads.size() + 1));
+			s.threads.push_back(holder.log);
+		}
+	}
+
+	return *holder.log;
+}
+
+log::ThreadLogHolder::~ThreadLogHolder()
+{
+	if (log == nullptr) return;
+
+	auto& s = state();
+	TrackedLock<std::mutex> lock(s.threadsLock, threadsLockDepth);
+	log->inUse = false;
+}
+
+void log::pushRecord(RecordType type, const char* format, va_list args)
+{
+	auto& t = currentThreadLog();
+
+	uint32_t formatLength = packArguments(format, args, t.scratch);
+
+	uint32_t size = recordSize(t.scratch.size());
+	if (size > maxRecordSize)
+	{
+		formatLength = packPreformatted(format, args, t.scratch);
+		size = recordSize(t.scratch.size());
+	}
+
+	uint64_t position = 0;
+	uint32_t padding = 0;
+	bool drainRequested = false;
+	while (!reserveRecord(t, size, position, padding))
+	{
+		auto& s = state();
+		if (s.overflowPolicy.load(std::memory_order_relaxed) == OverflowPolicy::DropMessage)
+		{
+			t.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		if (!s.async.load(std::memory_order_acquire))
+		{
+			passToOutputs(type, format, args);
+			return;
+		}
+
+		if (!drainRequested)
+		{
+			requestDrain();
+			drainRequested = true;
+		}
+		std::this_thread::yield();
+	}
+
+	if (padding > 0)
+	{
+		RecordHeader paddingHeader;
+		paddingHeader.size = padding;
+		etCopyMemory(t.ring + (position & (bytesPerThread - 1)), &paddingHeader, 2 * sizeof(uint32_t));
+		position += padding;
+	}
+
+	RecordHeader header;
+	header.size = size;
+	header.type = type;
+	header.timestamp = profiler::timestamp();
+	header.threadIndex = t.threadIndex;
+	header.formatLength = formatLength;
+
+	char* record = t.ring + (position & (bytesPerThread - 1));
+	etCopyMemory(record, &header, sizeof(header));
+	etCopyMemory(record + sizeof(header), t.scratch.data(), t.scratch.size());
+	t.written.store(position + size, std::memory_order_release);
+
+	if (type == RecordType::Error)
+		requestDrain();
+}
+
+bool log::reserveRecord(ThreadLog& t, uint32_t size, uint64_t& position, uint32_t& padding)
+{
+	position = t.written.load(std::memory_order_relaxed);
+
+	uint32_t tail = bytesPerThread - static_cast<uint32_t>(position & (bytesPerThread - 1));
+	padding = (size > tail) ? tail : 0;
+
+	uint64_t read = t.read.load(std::memory_order_acquire);
+	return position + padding + size - read <= bytesPerThread;
+}
+
+void log::requestDrain()
+{
+	auto& s = state();
+	{
+		std::lock_guard<std::mutex> lock(s.consumerLock);
+		s.wakeRequested = true;
+	}
+	s.consumerWake.notify_one();
+}
+
+void log::consumerFunction()
+{
+	insideConsumer = true;
+
+	auto& s = state();
+	std::unique_lock<std::mutex> lock(s.consumerLock);
+	while (s.consumerRunning)
+	{
+		s.wakeRequested = false;
+		lock.unlock();
+		drain();
+		lock.lock();
+
+		s.consumerWake.wait_for(lock, std::chrono::milliseconds(5),
+			[&s]() { return s.wakeRequested || !s.consumerRunning; });
+	}
+
+	insideConsumer = false;
+}
+
+void log::drain()
+{
+	TrackedLock<std::mutex> lock(state().drainLock, drainLockDepth);
+	drainLocked();
+}
+
+void log::drainLocked()
+{
+	auto& s = state();
+
+	std::vector<ThreadLog*> threads;
+	{
+		TrackedLock<std::mutex> lock(s.threadsLock, threadsLockDepth);
+		threads = s.threads;
+	}
+
+	std::vector<uint64_t> drainedTo(threads.size(), 0);
+	s.pending.clear();
+
+	for (size_t i = 0, e = threads.size(); i < e; ++i)
+	{
+		ThreadLog* t = threads[i];
+		uint64_t read = t->read.load(std::memory_order_relaxed);
+		uint64_t written = t->written.load(std::memory_order_acquire);
+
+		while (read < written)
+		{
+			const RecordHeader* header = reinterpret_cast<const RecordHeader*>(t->ring + (read & (bytesPerThread - 1)));
+			if (header->type != RecordType::Padding)
+			{
+				PendingRecord record;
+				record.header = header;
+				record.order = static_cast<uint32_t>(s.pending.size());
+				s.pending.push_back(record);
+			}
+			read += header->size;
+		}
+		drainedTo[i] = written;
+	}
+
+	/*
+	 * Rings are ordered by themselves, records of different threads are merged by time
+	 */
+	std::sort(s.pending.begin(), s.pending.end(), [](const PendingRecord& l, const PendingRecord& r)
+	{
+		return (l.header->timestamp < r.header->timestamp) ||
+			((l.header->timestamp == r.header->timestamp) && (l.order < r.order));
+	});
+
+	for (const PendingRecord& record : s.pending)
+	{
+		formatRecord(s, record.header);
+		passTextToOutputs(record.header->type, "%s", s.formatted.c_str());
+	}
+
+	for (size_t i = 0, e = threads.size(); i < e; ++i)
+	{
+		threads[i]->read.store(drainedTo[i], std::memory_order_release);
+
+		uint64_t dropped = threads[i]->dropped.exchange(0, std::memory_order_relaxed);
+		if (dropped > 0)
+		{
+			s.droppedTotal.fetch_add(dropped, std::memory_order_relaxed);
+			passTextToOutputs(RecordType::Warning, "%llu log messages from thread %u were dropped",
+				static_cast<unsigned long long>(dropped), threads[i]->threadIndex);
+		}
+	}
+}
+
+/*
+ * Argument packing. Producer and consumer parse format string the same way,
+ * so arguments are stored without type tags. Integers are widened to 64 bits
+ * after truncation to their declared length.
+ */
+const char* log::parseSpec(const char* p, FormatSpec& spec)
+{
+	spec = FormatSpec();
+	spec.begin = p++;
+
+	if (*p == '%')
+	{
+		spec.lengthBegin = p;
+		spec.lengthEnd = p;
+		spec.end = p + 1;
+		return spec.end;
+	}
+
+	while ((*p != 0) && (strchr("-+ #0'", *p) != nullptr))
+		++p;
+
+	if (*p == '*')
+		{ ++spec.starCount; ++p; }
+	while ((*p >= '0') && (*p <= '9'))
+		++p;
+
+	if (*p == '.')
+	{
+		++p;
+		if (*p == '*')
+			{ ++spec.starCount; ++p; }
+		while ((*p >= '0') && (*p <= '9'))
+			++p;
+	}
+
+	spec.lengthBegin = p;
+	switch (*p)
+	{
+		case 'h':
+			spec.length = (p[1] == 'h') ? ArgumentLength::Char : ArgumentLength::Short;
+			p += (p[1] == 'h') ? 2 : 1;
+			break;
+
+		case 'l':
+			spec.length = (p[1] == 'l') ? ArgumentLength::LongLong : ArgumentLength::Long;
+			p += (p[1] == 'l') ? 2 : 1;
+			break;
+
+		case 'q':
+			spec.length = ArgumentLength::LongLong;
+			++p;
+			break;
+
+		case 'j':
+			spec.length = ArgumentLength::IntMax;
+			++p;
+			break;
+
+		case 'z':
+			spec.length = ArgumentLength::Size;
+			++p;
+			break;
+
+		case 't':
+			spec.length = ArgumentLength::PtrDiff;
+			++p;
+			break;
+
+		case 'L':
+			spec.length = ArgumentLength::LongDouble;
+			++p;
+			break;
+
+		case 'I':
+		{
+			if ((p[1] == '6') && (p[2] == '4'))
+				{ spec.length = ArgumentLength::LongLong; p += 3; }
+			else if ((p[1] == '3') && (p[2] == '2'))
+				{ p += 3; }
+			else
+				{ spec.length = ArgumentLength::Size; ++p; }
+			break;
+		}
+
+		default:
+			break;
+	}
+	spec.lengthEnd = p;
+
+	switch (*p)
+	{
+		case 'd':
+		case 'i':
+			spec.argument = ArgumentClass::Signed;
+			break;
+
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			spec.argument = ArgumentClass::Unsigned;
+			break;
+
+		case 'c':
+			spec.argument = (spec.length == ArgumentLength::Long) ? ArgumentClass::WideChar : ArgumentClass::Char;
+			break;
+
+		case 'C':
+			spec.argument = ArgumentClass::WideChar;
+			break;
+
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			spec.argument = (spec.length == ArgumentLength::LongDouble) ? ArgumentClass::LongDouble : ArgumentClass::Double;
+			break;
+
+		case 'p':
+			spec.argument = ArgumentClass::Pointer;
+			break;
+
+		case 's':
+			spec.argument = (spec.length == ArgumentLength::Long) ? ArgumentClass::WideString : ArgumentClass::String;
+			break;
+
+		case 'S':
+			spec.argument = ArgumentClass::WideString;
+			break;
+
+		case 'n':
+			spec.argument = ArgumentClass::WriteBack;
+			break;
+
+		default:
+			break;
+	}
+
+	spec.end = (*p == 0) ? p : p + 1;
+	return spec.end;
+}
+
+namespace et
+{
+	namespace log
+	{
+		template <typename T>
+		inline void writeValue(std::vector<char>& out, const T& value)
+		{
+			const char* begin = reinterpret_cast<const char*>(&value);
+			out.insert(out.end(), begin, begin + sizeof(T));
+		}
+
+		template <typename T>
+		inline T readValue(const char*& p, const char* end)
+		{
+			T result = T();
+			if (p + sizeof(T) <= end)
+				etCopyMemory(&result, p, sizeof(T));
+			p += sizeof(T);
+			return result;
+		}
+
+		int64_t readSigned(ArgumentLength length, va_list& args)
+		{
+			switch (length)
+			{
+				case ArgumentLength::Char:
+					return static_cast<signed char>(va_arg(args, int));
+				case ArgumentLength::Short:
+					return static_cast<short>(va_arg(args, int));
+				case ArgumentLength::Long:
+					return va_arg(args, long);
+				case ArgumentLength::LongLong:
+					return va_arg(args, long long);
+				case ArgumentLength::IntMax:
+					return va_arg(args, intmax_t);
+				case ArgumentLength::Size:
+				case ArgumentLength::PtrDiff:
+					return va_arg(args, ptrdiff_t);
+				default:
+					return va_arg(args, int);
+			}
+		}
+
+		uint64_t readUnsigned(ArgumentLength length, va_list& args)
+		{
+			switch (length)
+			{
+				case ArgumentLength::Char:
+					return static_cast<unsigned char>(va_arg(args, unsigned int));
+				case ArgumentLength::Short:
+					return static_cast<unsigned short>(va_arg(args, unsigned int));
+				case ArgumentLength::Long:
+					return va_arg(args, unsigned long);
+				case ArgumentLength::LongLong:
+					return va_arg(args, unsigned long long);
+				case ArgumentLength::IntMax:
+					return va_arg(args, uintmax_t);
+				case ArgumentLength::Size:
+				case ArgumentLength::PtrDiff:
+					return va_arg(args, size_t);
+				default:
+					return va_arg(args, unsigned int);
+			}
+		}
+
+		void appendDecimal(std::string& out, uint64_t value, bool negative)
+		{
+			char buffer[24];
+			char* p = buffer + sizeof(buffer);
+			do
+			{
+				*(--p) = static_cast<char>('0' + value % 10);
+				value /= 10;
+			}
+			while (value > 0);
+
+			if (negative)
+				*(--p) = '-';
+
+			out.append(p, buffer + sizeof(buffer));
+		}
+
+		template <typename T>
+		int formatValue(char* target, size_t targetSize, const char* spec, const int* stars, uint32_t starCount, T value)
+		{
+			if (starCount == 0)
+				return snprintf(target, targetSize, spec, value);
+			else if (starCount == 1)
+				return snprintf(target, targetSize, spec, stars[0], value);
+			else
+				return snprintf(target, targetSize, spec, stars[0], stars[1], value);
+		}
+
+		template <typename T>
+		void appendFormatted(std::string& out, const char* spec, const int* stars, uint32_t starCount, T value)
+		{
+			char buffer[256];
+			int length = formatValue(buffer, sizeof(buffer), spec, stars, starCount, value);
+			if (length < 0) return;
+
+			if (static_cast<size_t>(length) < sizeof(buffer))
+			{
+				out.append(buffer, static_cast<size_t>(length));
+			}
+			else
+			{
+				std::vector<char> largeBuffer(static_cast<size_t>(length) + 1);
+				formatValue(largeBuffer.data(), largeBuffer.size(), spec, stars, starCount, value);
+				out.append(largeBuffer.data(), static_cast<size_t>(length));
+			}
+		}
+	}
+}
+
+uint32_t log::packArguments(const char* format, va_list sourceArgs, std::vector<char>& out)
+{
+	va_list args;
+	va_copy(args, sourceArgs);
+
+	uint32_t formatLength = static_cast<uint32_t>(strlen(format));
+
+	out.clear();
+	out.insert(out.end(), format, format + formatLength);
+
+	FormatSpec spec;
+	const char* p = format;
+	while (*p != 0)
+	{
+		if (*p != '%')
+			{ ++p; continue; }
+
+		p = parseSpec(p, spec);
+
+		for (uint32_t i = 0; i < spec.starCount; ++i)
+			writeValue<int>(out, va_arg(args, int));
+
+		switch (spec.argument)
+		{
+			case ArgumentClass::Signed:
+				writeValue<int64_t>(out, readSigned(spec.length, args));
+				break;
+
+			case ArgumentClass::Unsigned:
+				writeValue<uint64_t>(out, readUnsigned(spec.length, args));
+				break;
+
+			case ArgumentClass::Char:
+				writeValue<int>(out, va_arg(args, int));
+				break;
+
+			case ArgumentClass::WideChar:
+				writeValue<wint_t>(out, va_arg(args, wint_t));
+				break;
+
+			case ArgumentClass::Double:
+				writeValue<double>(out, va_arg(args, double));
+				break;
+
+			case ArgumentClass::LongDouble:
+				writeValue<long double>(out, va_arg(args, long double));
+				break;
+
+			case ArgumentClass::Pointer:
+				writeValue<const void*>(out, va_arg(args, const void*));
+				break;
+
+			case ArgumentClass::WriteBack:
+				(void)va_arg(args, void*);
+				break;
+
+			case ArgumentClass::String:
+			{
+				const char* value = va_arg(args, const char*);
+				uint32_t length = (value == nullptr) ? nullStringLength :
+					static_cast<uint32_t>(etMin(strlen(value), static_cast<size_t>(maxStringLength)));
+
+				writeValue<uint32_t>(out, length);
+				if (value != nullptr)
+					out.insert(out.end(), value, value + length);
+				break;
+			}
+
+			case ArgumentClass::WideString:
+			{
+				const wchar_t* value = va_arg(args, const wchar_t*);
+				uint32_t length = (value == nullptr) ? nullStringLength :
+					static_cast<uint32_t>(etMin(wcslen(value), static_cast<size_t>(maxStringLength / sizeof(wchar_t))));
+
+				writeValue<uint32_t>(out, length);
+				if (value != nullptr)
+				{
+					const char* begin = reinterpret_cast<const char*>(value);
+					out.insert(out.end(), begin, begin + length * sizeof(wchar_t));
+				}
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+
+	va_end(args);
+	return formatLength;
+}
+
+uint32_t log::packPreformatted(const char* format, va_list sourceArgs, std::vector<char>& out)
+{
+	static const char preformattedFormat[] = "%s";
+	const uint32_t formatLength = sizeof(preformattedFormat) - 1;
+	const size_t textLength = maxRecordSize - sizeof(RecordHeader) - formatLength - sizeof(uint32_t) - recordAlignment;
+
+	out.assign(preformattedFormat, preformattedFormat + formatLength);
+	out.resize(formatLength + sizeof(uint32_t) + textLength + 1);
+
+	va_list args;
+	va_copy(args, sourceArgs);
+	int written = vsnprintf(out.data() + formatLength + sizeof(uint32_t), textLength + 1, format, args);
+	va_end(args);
+
+	uint32_t length = static_cast<uint32_t>(etMin(static_cast<size_t>(etMax(0, written)), textLength));
+	etCopyMemory(out.data() + formatLength, &length, sizeof(length));
+	out.resize(formatLength + sizeof(uint32_t) + length);
+
+	return formatLength;
+}
+
+void log::formatRecord(LogState& s, const RecordHeader* header)
+{
+	const char* data = reinterpret_cast<const char*>(header + 1) + header->formatLength;
+	const char* dataEnd = reinterpret_cast<const char*>(header) + header->size;
+
+	/*
+	 * Format is stored without terminating zero
+	 */
+	s.formatText.assign(reinterpret_cast<const char*>(header + 1), header->formatLength);
+	const char* format = s.formatText.c_str();
+	const char* formatEnd = format + s.formatText.size();
+
+	std::string& out = s.formatted;
+	std::string& specText = s.specText;
+	std::string& stringValue = s.stringValue;
+	std::wstring& wideValue = s.wideValue;
+
+	out.clear();
+
+	FormatSpec spec;
+	const char* p = format;
+	while (p < formatEnd)
+	{
+		const char* literal = p;
+		while ((p < formatEnd) && (*p != '%'))
+			++p;
+		out.append(literal, p);
+
+		if (p >= formatEnd) break;
+
+		p = parseSpec(p, spec);
+
+		int stars[2] = { };
+		for (uint32_t i = 0; i < spec.starCount; ++i)
+			stars[i] = readValue<int>(data, dataEnd);
+
+		/*
+		 * Integers are stored widened, so length modifier is replaced
+		 */
+		char conversion = spec.end[-1];
+		bool plainSpec = (spec.lengthBegin == spec.begin + 1) && (spec.starCount == 0);
+
+		/*
+		 * Fast path for the most common specifiers without flags, width or precision
+		 */
+		if (plainSpec && (spec.argument == ArgumentClass::Signed))
+		{
+			int64_t value = readValue<int64_t>(data, dataEnd);
+			appendDecimal(out, (value < 0) ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value), value < 0);
+			continue;
+		}
+
+		if (plainSpec && (spec.argument == ArgumentClass::Unsigned) && (conversion == 'u'))
+		{
+			appendDecimal(out, readValue<uint64_t>(data, dataEnd), false);
+			continue;
+		}
+
+		if (plainSpec && (spec.argument == ArgumentClass::String))
+		{
+			uint32_t length = readValue<uint32_t>(data, dataEnd);
+			if (length == nullStringLength)
+			{
+				out.append("(null)");
+			}
+			else
+			{
+				length = etMin(length, static_cast<uint32_t>(etMax(dataEnd - data, ptrdiff_t(0))));
+				out.append(data, length);
+				data += length;
+			}
+			continue;
+		}
+
+		specText.assign(spec.begin, spec.lengthBegin);
+		if ((spec.argument == ArgumentClass::Signed) || (spec.argument == ArgumentClass::Unsigned))
+			specText.append("ll");
+		else
+			specText.append(spec.lengthBegin, spec.lengthEnd);
+		specText.append(spec.lengthEnd, spec.end);
+
+		switch (spec.argument)
+		{
+			case ArgumentClass::None:
+			{
+				if ((spec.end - spec.begin == 2) && (spec.begin[1] == '%'))
+					out.push_back('%');
+				break;
+			}
+
+			case ArgumentClass::Signed:
+				appendFormatted(out, specText.c_str(), stars, spec.starCount,
+					static_cast<long long>(readValue<int64_t>(data, dataEnd)));
+				break;
+
+			case ArgumentClass::Unsigned:
+				appendFormatted(out, specText.c_str(), stars, spec.starCount,
+					static_cast<unsigned long long>(readValue<uint64_t>(data, dataEnd)));
+				break;
+
+			case ArgumentClass::Char:
+				appendFormatted(out, specText.c_str(), stars, spec.starCount, readValue<int>(data, dataEnd));
+				break;
+
+			case ArgumentClass::WideChar:
+				appendFormatted(out, specText.c_str(), stars, spec.starCount, readValue<wint_t>(data, dataEnd));
+				break;
+
+			case ArgumentClass::Double:
+				appendFormatted(out, specText.c_str(), stars, spec.starCount, readValue<double>(data, dataEnd));
+				break;
+
+			case ArgumentClass::LongDouble:
+				appendFormatted(out, specText.c_str(), stars, spec.starCount, readValue<long double>(data, dataEnd));
+				break;
+
+			case ArgumentClass::Pointer:
+				appendFormatted(out, specText.c_str(), stars, spec.starCount, readValue<const void*>(data, dataEnd));
+				break;
+
+			case ArgumentClass::String:
+			{
+				uint32_t length = readValue<uint32_t>(data, dataEnd);
+				if (length == nullStringLength)
+				{
+					appendFormatted(out, specText.c_str(), stars, spec.starCount, static_cast<const char*>(nullptr));
+				}
+				else
+				{
+					length = etMin(length, static_cast<uint32_t>(etMax(dataEnd - data, ptrdiff_t(0))));
+					stringValue.assign(data, length);
+					data += length;
+					appendFormatted(out, specText.c_str(), stars, spec.starCount, stringValue.c_str());
+				}
+				break;
+			}
+
+			case ArgumentClass::WideString:
+			{
+				uint32_t length = readValue<uint32_t>(data, dataEnd);
+				if (length == nullStringLength)
+				{
+					appendFormatted(out, specText.c_str(), stars, spec.starCount, static_cast<const wchar_t*>(nullptr));
+				}
+				else
+				{
+					length = etMin(length, static_cast<uint32_t>(etMax(dataEnd - data, ptrdiff_t(0)) / sizeof(wchar_t)));
+					wideValue.resize(length);
+					etCopyMemory(&wideValue[0], data, length * sizeof(wchar_t));
+					data += length * sizeof(wchar_t);
+					appendFormatted(out, specText.c_str(), stars, spec.starCount, wideValue.c_str());
+				}
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+}
+
+/*
+ * Crash handlers drain rings on the crashing thread and pass signal to previous handlers.
+ * Formatting allocates and outputs may use stdio, so this is not async-signal-safe,
+ * but better than losing the last messages. Drain is skipped when crashing thread
+ * holds one of the locks it needs.
+ */
+void log::drainOnCrash()
+{
+	auto& s = state();
+	if (insideConsumer || (outputsLockDepth > 0) || (threadsLockDepth > 0) || (drainLockDepth > 0)) return;
+
+	/*
+	 * Consumer could be in the middle of draining, give it some time to finish
+	 */
+	for (uint32_t attempt = 0; attempt < 100; ++attempt)
+	{
+		if (s.drainLock.try_lock())
+		{
+			drainLocked();
+			s.drainLock.unlock();
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+#if (ET_PLATFORM_WIN)
+
+void log::installCrashHandlers()
+{
+	auto& s = state();
+	if (s.crashHandlersInstalled) return;
+
+	for (size_t i = 0; i < crashSignalsCount; ++i)
+		previousCrashHandlers[i] = signal(crashSignals[i], crashHandler);
+
+	s.crashHandlersInstalled = true;
+}
+
+void log::removeCrashHandlers()
+{
+	auto& s = state();
+	if (!s.crashHandlersInstalled) return;
+
+	for (size_t i = 0; i < crashSignalsCount; ++i)
+		signal(crashSignals[i], (previousCrashHandlers[i] == SIG_ERR) ? SIG_DFL : previousCrashHandlers[i]);
+
+	s.crashHandlersInstalled = false;
+}
+
+void log::crashHandler(int sig)
+{
+	drainOnCrash();
+
+	for (size_t i = 0; i < crashSignalsCount; ++i)
+	{
+		if (crashSignals[i] == sig)
+		{
+			auto previous = previousCrashHandlers[i];
+			signal(sig, ((previous == SIG_ERR) || (previous == nullptr)) ? SIG_DFL : previous);
+			break;
+		}
+	}
+
+	raise(sig);
+}
+
+#else
+
+void log::installCrashHandlers()
+{
+	auto& s = state();
+	if (s.crashHandlersInstalled) return;
+
+	struct sigaction action = { };
+	action.sa_sigaction = crashHandler;
+	action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+	sigemptyset(&action.sa_mask);
+
+	for (size_t i = 0; i < crashSignalsCount; ++i)
+		sigaction(crashSignals[i], &action, &previousCrashActions[i]);
+
+	s.crashHandlersInstalled = true;
+}
+
+void log::removeCrashHandlers()
+{
+	auto& s = state();
+	if (!s.crashHandlersInstalled) return;
+
+	for (size_t i = 0; i < crashSignalsCount; ++i)
+		sigaction(crashSignals[i], &previousCrashActions[i], nullptr);
+
+	s.crashHandlersInstalled = false;
+}
+
+void log::crashHandler(int sig, siginfo_t* info, void* context)
+{
+	drainOnCrash();
+
+	/*
+	 * Previous action is restored as it was installed and called with the arguments
+	 * it expects, so crash reporters still receive siginfo and context of the fault
+	 */
+	for (size_t i = 0; i < crashSignalsCount; ++i)
+	{
+		if (crashSignals[i] == sig)
+		{
+			const struct sigaction& previous = previousCrashActions[i];
+			sigaction(sig, &previous, nullptr);
+
+			if (previous.sa_flags & SA_SIGINFO)
+			{
+				previous.sa_sigaction(sig, info, context);
+				return;
+			}
+
+			if (previous.sa_handler == SIG_IGN)
+				return;
+
+			if (previous.sa_handler != SIG_DFL)
+			{
+				previous.sa_handler(sig);
+				return;
+			}
+
+			break;
+		}
+	}
+
+	raise(sig);
+}
+
+#endif
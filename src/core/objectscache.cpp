@@ -10,39 +10,54 @@
 using namespace et;
 
 ObjectsCache::ObjectsCache() :
-	_updateTime(0.0f)
+	_polledObjects(0), _updateTime(0.0f)
 {
 }
 
 ObjectsCache::~ObjectsCache()
 {
 	clear();
+	
+	CriticalSectionScope lock(_lock);
+	_releasedObjects.clear();
 }
 
 void ObjectsCache::manage(const LoadableObject::Pointer& o, const ObjectLoader::Pointer& loader)
 {
 	if (o.valid() && o->canBeReloaded())
 	{
-		CriticalSectionScope lock(_lock);
-		
-		if (_objects.count(o->origin()) > 0)
 		{
-			ObjectPropertyList& list = _objects[o->origin()];
-			list.push_back(ObjectProperty(o, loader));
-			ObjectProperty& newObject = list.back();
-			newObject.identifiers[o->origin()] = getFileProperty(o->origin());
-			for (auto& s : o->distributedOrigins())
-				newObject.identifiers[s] = getFileProperty(s);
-		}
-		else
-		{
-			ObjectPropertyList newList(1, ObjectProperty(o, loader));
-			ObjectProperty& newObject = newList.back();
-			newObject.identifiers[o->origin()] = getFileProperty(o->origin());
-			for (auto& s : o->distributedOrigins())
-				newObject.identifiers[s] = getFileProperty(s);
-			_objects.insert(std::make_pair(o->origin(), newList));
+			CriticalSectionScope lock(_lock);
+			
+			auto existing = _entries.find(o.ptr());
+			if (existing != _entries.end())
+			{
+				existing->second->loader = loader;
+				touch(existing->second);
+				refreshMemoryUsage(*existing->second);
+				evict(typeEntry(existing->second->type));
+			}
+			else
+			{
+				ObjectProperty newObject(o, loader);
+				newObject.identifiers[o->origin()] = getFileProperty(o->origin());
+				for (auto& s : o->distributedOrigins())
+					newObject.identifiers[s] = getFileProperty(s);
+				newObject.memoryUsage = o->memoryUsage();
+				watchFiles(newObject);
+				
+				TypeEntry& type = typeEntry(newObject.type);
+				type.memoryUsage += newObject.memoryUsage;
+				type.objects.push_front(std::move(newObject));
+				
+				auto entry = type.objects.begin();
+				_entries[o.ptr()] = entry;
+				_objects[entry->key].push_back(entry);
+				
+				evict(type);
+			}
 		}
+		releaseObjects();
 	}
 	else
 	{
@@ -55,12 +70,22 @@ std::vector<LoadableObject::Pointer> ObjectsCache::findObjects(const std::string
 	CriticalSectionScope lock(_lock);
 	auto i = _objects.find(key);
 	if (i == _objects.end())
+	{
+		++_misses;
 		return std::vector<LoadableObject::Pointer>();
+	}
 		
+	++typeEntry(i->second.front()->type).hits;
+	
 	std::vector<LoadableObject::Pointer> result;
+	result.reserve(i->second.size());
 	
-	for (auto prop : i->second)
-		result.push_back(prop.object);
+	for (auto entry : i->second)
+	{
+		touch(entry);
+		refreshMemoryUsage(*entry);
+		result.push_back(entry->object);
+	}
 	
 	return result;
 }
@@ -72,6 +97,8 @@ LoadableObject::Pointer ObjectsCache::findAnyObject(const std::string& key, uint
 	auto i = _objects.find(key);
 	if (i == _objects.end())
 	{
+		++_misses;
+		
 		if (property)
 			*property = 0;
 		
@@ -79,80 +106,190 @@ LoadableObject::Pointer ObjectsCache::findAnyObject(const std::string& key, uint
 	}
 	else
 	{
+		auto entry = i->second.front();
+		++typeEntry(entry->type).hits;
+		touch(entry);
+		refreshMemoryUsage(*entry);
+		
 		if (property)
-			*property = i->second.front().identifiers[key];
+			*property = entry->identifiers[key];
 		
-		return i->second.front().object;
+		return entry->object;
 	}
 }
 
-
 void ObjectsCache::discard(const LoadableObject::Pointer& o)
 {
 	if (o.valid())
 	{
-		CriticalSectionScope lock(_lock);
-		if (_objects.count(o->origin()) == 0) return;
-		
-		ObjectPropertyList& list = _objects[o->origin()];
-		for (auto i = list.begin(), e = list.end(); i != e; ++i)
 		{
-			if (i->object == o)
-			{
-				list.erase(i);
-				break;
-			}
+			CriticalSectionScope lock(_lock);
+			
+			auto i = _entries.find(o.ptr());
+			if (i != _entries.end())
+				remove(i->second);
 		}
-		
-		if (list.empty())
-			_objects.erase(o->origin());
+		releaseObjects();
 	}
 }
 
 void ObjectsCache::clear()
 {
-	CriticalSectionScope lock(_lock);
-	_objects.clear();
+	{
+		CriticalSectionScope lock(_lock);
+		for (auto& type : _types)
+		{
+			for (auto& p : type.second.objects)
+				_releasedObjects.push_back(std::move(p.object));
+		}
+		_objects.clear();
+		_entries.clear();
+		_types.clear();
+		_watcher.unwatchAll();
+		_polledObjects = 0;
+	}
+	releaseObjects();
 }
 
 void ObjectsCache::flush()
 {
-	CriticalSectionScope lock(_lock);
-	
 	size_t objectsErased = 0;
-	
-	for (auto& lv : _objects)
 	{
-		auto obj = lv.second.begin();
-		while (obj != lv.second.end())
+		CriticalSectionScope lock(_lock);
+		
+		for (auto& type : _types)
 		{
-			if (obj->object->atomicCounterValue() == 1)
+			auto obj = type.second.objects.begin();
+			while (obj != type.second.objects.end())
 			{
-				obj = lv.second.erase(obj);
-				++objectsErased;
-			}
-			else
-			{
-				++obj;
+				auto current = obj++;
+				if ((current->pins == 0) && (current->object->atomicCounterValue() == 1))
+				{
+					remove(current);
+					++objectsErased;
+				}
 			}
 		}
 	}
+	releaseObjects();
 	
-	auto i = _objects.begin();
-	while (i != _objects.end())
+	if (objectsErased > 0)
+		log::info("[ObjectsCache] %llu objects flushed.", static_cast<uint64_t>(objectsErased));
+}
+
+void ObjectsCache::pin(const LoadableObject::Pointer& o)
+{
+	CriticalSectionScope lock(_lock);
+	
+	auto i = _entries.find(o.ptr());
+	if (i != _entries.end())
+		++i->second->pins;
+}
+
+void ObjectsCache::unpin(const LoadableObject::Pointer& o)
+{
 	{
-		if (i->second.empty())
+		CriticalSectionScope lock(_lock);
+		
+		auto i = _entries.find(o.ptr());
+		if ((i != _entries.end()) && (i->second->pins > 0))
 		{
-			i = _objects.erase(i);
+			if (--i->second->pins == 0)
+				evict(typeEntry(i->second->type));
 		}
-		else
+	}
+	releaseObjects();
+}
+
+void ObjectsCache::setMemoryBudget(const std::type_index& t, uint64_t budget)
+{
+	{
+		CriticalSectionScope lock(_lock);
+		
+		TypeEntry& type = typeEntry(t);
+		type.memoryBudget = budget;
+		evict(type);
+	}
+	releaseObjects();
+}
+
+uint64_t ObjectsCache::memoryBudget(const std::type_index& t)
+{
+	CriticalSectionScope lock(_lock);
+	
+	auto i = _types.find(t);
+	return (i == _types.end()) ? static_cast<uint64_t>(UnlimitedMemoryBudget) : i->second.memoryBudget;
+}
+
+uint64_t ObjectsCache::memoryUsage(const std::type_index& t)
+{
+	CriticalSectionScope lock(_lock);
+	
+	auto i = _types.find(t);
+	return (i == _types.end()) ? 0 : i->second.memoryUsage;
+}
+
+void ObjectsCache::updateMemoryUsage(const LoadableObject::Pointer& o)
+{
+	{
+		CriticalSectionScope lock(_lock);
+		
+		auto i = _entries.find(o.ptr());
+		if (i != _entries.end())
 		{
-			++i;
+			refreshMemoryUsage(*i->second);
+			evict(typeEntry(i->second->type));
 		}
 	}
+	releaseObjects();
+}
+
+ObjectsCache::Statistics ObjectsCache::statistics()
+{
+	CriticalSectionScope lock(_lock);
 	
-	if (objectsErased > 0)
-		log::info("[ObjectsCache] %llu objects flushed.", static_cast<uint64_t>(objectsErased));
+	Statistics result;
+	result.misses = _misses;
+	
+	for (const auto& type : _types)
+	{
+		result.hits += type.second.hits;
+		result.evictions += type.second.evictions;
+		result.residentObjects += type.second.objects.size();
+		result.residentMemory += type.second.memoryUsage;
+	}
+	
+	return result;
+}
+
+ObjectsCache::Statistics ObjectsCache::statistics(const std::type_index& t)
+{
+	CriticalSectionScope lock(_lock);
+	
+	Statistics result;
+	
+	auto i = _types.find(t);
+	if (i != _types.end())
+	{
+		result.hits = i->second.hits;
+		result.evictions = i->second.evictions;
+		result.residentObjects = i->second.objects.size();
+		result.residentMemory = i->second.memoryUsage;
+	}
+	
+	return result;
+}
+
+void ObjectsCache::resetStatistics()
+{
+	CriticalSectionScope lock(_lock);
+	
+	_misses = 0;
+	for (auto& type : _types)
+	{
+		type.second.hits = 0;
+		type.second.evictions = 0;
+	}
 }
 
 void ObjectsCache::startMonitoring()
@@ -169,6 +306,14 @@ void ObjectsCache::update(float t)
 {
 	static const float updateInterval = 0.5f;
 	
+	releaseObjects();
+	
+	if (_watcher.hasChanges())
+		reloadChangedFiles(_watcher.takeChanges());
+	
+	if (_polledObjects == 0)
+		return;
+	
 	if (_updateTime == 0.0f)
 		_updateTime = t;
 	
@@ -190,28 +335,23 @@ uint64_t ObjectsCache::getObjectProperty(LoadableObject::Pointer ptr)
 {
 	CriticalSectionScope lock(_lock);
 	
-	for (auto& entry : _objects)
-	{
-		for (auto& p : entry.second)
-		{
-			if (p.object == ptr)
-				return p.identifiers[ptr->origin()];
-		}
-	}
-	
-	return 0;
+	auto i = _entries.find(ptr.ptr());
+	return (i == _entries.end()) ? 0 : i->second->identifiers[ptr->origin()];
 }
 
 void ObjectsCache::performUpdate()
 {
-	ObjectsCache& cache = *this;
-	
-	for (auto& entry : _objects)
+	std::vector<std::pair<LoadableObject::Pointer, ObjectLoader::Pointer>> objectsToReload;
 	{
-		for (auto& p : entry.second)
+		CriticalSectionScope lock(_lock);
+		
+		for (auto& type : _types)
 		{
-			if (p.loader.valid() && p.object->canBeReloaded())
+			for (auto& p : type.second.objects)
 			{
+				if (p.watched || p.loader.invalid() || !p.object->canBeReloaded())
+					continue;
+				
 				bool shouldReload = false;
 				
 				const auto& origin = p.object->origin();
@@ -236,13 +376,195 @@ void ObjectsCache::performUpdate()
 				}
 				
 				if (shouldReload)
-					p.loader->reloadObject(p.object, cache);
+					objectsToReload.emplace_back(p.object, p.loader);
+			}
+		}
+	}
+	
+	for (auto& p : objectsToReload)
+	{
+		p.second->reloadObject(p.first, *this);
+		updateMemoryUsage(p.first);
+	}
+}
+
+void ObjectsCache::reloadChangedFiles(const StringList& files)
+{
+	if (files.empty())
+		return;
+	
+	/*
+	 * Notification is enough to reload object, file date could stay
+	 * the same when file is written several times within a second
+	 */
+	std::vector<std::pair<LoadableObject::Pointer, ObjectLoader::Pointer>> objectsToReload;
+	{
+		CriticalSectionScope lock(_lock);
+		
+		for (auto& type : _types)
+		{
+			for (auto& p : type.second.objects)
+			{
+				if (!p.watched)
+					continue;
+				
+				bool shouldReload = false;
+				for (const auto& file : files)
+				{
+					auto i = p.identifiers.find(file);
+					if (i != p.identifiers.end())
+					{
+						i->second = getFileProperty(file);
+						shouldReload = true;
+					}
+				}
+				
+				if (!shouldReload)
+					continue;
+				
+				/*
+				 * Folder of changed file could be removed or moved, then files are watched
+				 * again from their new folder or object falls back to polling
+				 */
+				for (const auto& file : p.identifiers)
+				{
+					if (!_watcher.watching(file.first))
+					{
+						releaseFiles(p);
+						watchFiles(p);
+						break;
+					}
+				}
+				
+				if (p.loader.valid())
+					objectsToReload.emplace_back(p.object, p.loader);
+			}
+		}
+	}
+	
+	for (auto& p : objectsToReload)
+	{
+		p.second->reloadObject(p.first, *this);
+		updateMemoryUsage(p.first);
+	}
+}
+
+ObjectsCache::TypeEntry& ObjectsCache::typeEntry(const std::type_index& t)
+{
+	return _types[t];
+}
+
+void ObjectsCache::touch(ObjectPropertyList::iterator entry)
+{
+	TypeEntry& type = typeEntry(entry->type);
+	type.objects.splice(type.objects.begin(), type.objects, entry);
+}
+
+void ObjectsCache::refreshMemoryUsage(ObjectProperty& p)
+{
+	uint64_t actualMemoryUsage = p.object->memoryUsage();
+	if (actualMemoryUsage != p.memoryUsage)
+	{
+		TypeEntry& type = typeEntry(p.type);
+		type.memoryUsage = type.memoryUsage - p.memoryUsage + actualMemoryUsage;
+		p.memoryUsage = actualMemoryUsage;
+	}
+}
+
+void ObjectsCache::evict(TypeEntry& type)
+{
+	if (type.memoryUsage <= type.memoryBudget)
+		return;
+	
+	auto i = type.objects.end();
+	while ((i != type.objects.begin()) && (type.memoryUsage > type.memoryBudget))
+	{
+		auto current = --i;
+		if ((current->pins == 0) && (current->object->atomicCounterValue() == 1))
+		{
+			i = std::next(current);
+			remove(current);
+			++type.evictions;
+		}
+	}
+}
+
+void ObjectsCache::remove(ObjectPropertyList::iterator entry)
+{
+	releaseFiles(*entry);
+	
+	auto key = _objects.find(entry->key);
+	if (key != _objects.end())
+	{
+		key->second.erase(std::find(key->second.begin(), key->second.end(), entry));
+		if (key->second.empty())
+			_objects.erase(key);
+	}
+	
+	TypeEntry& type = typeEntry(entry->type);
+	type.memoryUsage -= entry->memoryUsage;
+	
+	_entries.erase(entry->object.ptr());
+	_releasedObjects.push_back(std::move(entry->object));
+	type.objects.erase(entry);
+}
+
+void ObjectsCache::releaseObjects()
+{
+	if (!threading::inMainThread())
+		return;
+	
+	std::vector<LoadableObject::Pointer> objects;
+	{
+		CriticalSectionScope lock(_lock);
+		objects.swap(_releasedObjects);
+	}
+}
+
+void ObjectsCache::watchFiles(ObjectProperty& p)
+{
+	p.watched = _watcher.available();
+	
+	if (p.watched)
+	{
+		for (auto i = p.identifiers.begin(), e = p.identifiers.end(); i != e; ++i)
+		{
+			if (!_watcher.watch(i->first))
+			{
+				for (auto w = p.identifiers.begin(); w != i; ++w)
+					_watcher.unwatch(w->first);
+				
+				p.watched = false;
+				break;
 			}
 		}
 	}
+	
+	if (!p.watched)
+		++_polledObjects;
+}
+
+void ObjectsCache::releaseFiles(const ObjectProperty& p)
+{
+	if (p.watched)
+	{
+		for (const auto& file : p.identifiers)
+			_watcher.unwatch(file.first);
+	}
+	else
+	{
+		--_polledObjects;
+	}
 }
 
 void ObjectsCache::report()
 {
-	log::info("[ObjectsCache] Contains %llu objects", static_cast<uint64_t>(_objects.size()));
+	Statistics stats = statistics();
+	
+	log::info("[ObjectsCache] Contains %llu objects (%llu bytes), %llu files watched, %llu objects polled",
+		stats.residentObjects, stats.residentMemory, static_cast<uint64_t>(_watcher.watchedFilesCount()),
+		static_cast<uint64_t>(_polledObjects.load()));
+	
+	log::info("[ObjectsCache] Hit rate %.1f%% (%llu hits, %llu misses), %llu objects evicted",
+		100.0f * stats.hitRate(), stats.hits, stats.misses, stats.evictions);
 }
@@ -0,0 +1,275 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <chrono>
+#include <mutex>
+#include <et/core/profiler.h>
+
+namespace et
+{
+	namespace profiler
+	{
+		static_assert((eventsPerThread & (eventsPerThread - 1)) == 0, "eventsPerThread should be power of two");
+
+		/*
+		 * Slots are read by trace writer while owning thread overwrites them,
+		 * so fields are atomic and consistency is checked with written counter.
+		 */
+		struct EventSlot
+		{
+			std::atomic<const char*> name;
+			std::atomic<uint64_t> begin;
+			std::atomic<uint64_t> end;
+		};
+
+		struct ThreadEvents
+		{
+			EventSlot events[eventsPerThread];
+			std::atomic<uint64_t> written;
+			const char* name = nullptr;
+			uint64_t threadIndex = 0;
+			bool inUse = true;
+
+			ThreadEvents(uint64_t index) :
+				written(0), threadIndex(index) { }
+		};
+
+		struct ThreadEventsHolder
+		{
+			ThreadEvents* events = nullptr;
+			~ThreadEventsHolder();
+		};
+
+		struct ProfilerState
+		{
+			std::mutex threadsLock;
+			std::vector<ThreadEvents*> threads;
+			uint64_t lastThreadIndex = 0;
+			std::atomic<uint64_t> captureBegin;
+			std::atomic<uint64_t> captureEnd;
+
+			ProfilerState() :
+				captureBegin(0), captureEnd(0) { }
+
+			~ProfilerState()
+			{
+				for (auto t : threads)
+					delete t;
+			}
+		};
+
+		ProfilerState& state();
+		ThreadEvents& currentThreadEvents();
+		void writeEscapedString(std::ostream&, const char*);
+
+		std::atomic<bool> enabledFlag(false);
+	}
+}
+
+using namespace et;
+
+profiler::ProfilerState& profiler::state()
+{
+	static ProfilerState sharedState;
+	return sharedState;
+}
+
+profiler::ThreadEvents& profiler::currentThreadEvents()
+{
+	/*
+	 * Buffers are owned by shared state and outlive their threads,
+	 * so events of finished workers could still be written to trace.
+	 * Buffers of finished threads are reused by new ones, reused buffer
+	 * is cleared and gets new index, so threads are not merged in trace.
+	 */
+	static thread_local ThreadEventsHolder holder;
+
+	if (holder.events == nullptr)
+	{
+		auto& s = state();
+		std::lock_guard<std::mutex> lock(s.threadsLock);
+		for (auto t : s.threads)
+		{
+			if (!t->inUse)
+			{
+				t->inUse = true;
+				t->name = nullptr;
+				t->threadIndex = ++s.lastThreadIndex;
+				t->written.store(0, std::memory_order_relaxed);
+				holder.events = t;
+				break;
+			}
+		}
+
+		if (holder.events == nullptr)
+		{
+			holder.events = new ThreadEvents(++s.lastThreadIndex);
+			s.threads.push_back(holder.events);
+		}
+	}
+
+	return *holder.events;
+}
+
+profiler::ThreadEventsHolder::~ThreadEventsHolder()
+{
+	if (events == nullptr) return;
+
+	auto& s = state();
+	std::lock_guard<std::mutex> lock(s.threadsLock);
+	events->inUse = false;
+}
+
+void profiler::setEnabled(bool e)
+{
+	enabledFlag.store(e, std::memory_order_relaxed);
+}
+
+uint64_t profiler::timestamp()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void profiler::setThreadName(const char* name)
+{
+	if (enabled())
+		currentThreadEvents().name = name;
+}
+
+void profiler::submit(const char* name, uint64_t begin, uint64_t end)
+{
+	auto& t = currentThreadEvents();
+
+	uint64_t index = t.written.load(std::memory_order_relaxed);
+	EventSlot& e = t.events[index & (eventsPerThread - 1)];
+
+	/*
+	 * Pairs with acquire fence in writeChromeTrace: reader which sees new contents
+	 * of slot also sees counter value at which slot started to be overwritten
+	 */
+	std::atomic_thread_fence(std::memory_order_release);
+	e.name.store(name, std::memory_order_relaxed);
+	e.begin.store(begin, std::memory_order_relaxed);
+	e.end.store(end, std::memory_order_relaxed);
+
+	t.written.store(index + 1, std::memory_order_release);
+}
+
+void profiler::beginCapture()
+{
+	auto& s = state();
+	s.captureBegin.store(timestamp());
+	s.captureEnd.store(0);
+}
+
+void profiler::endCapture()
+{
+	state().captureEnd.store(timestamp());
+}
+
+void profiler::writeChromeTrace(std::ostream& stream)
+{
+	auto& s = state();
+	uint64_t to = s.captureEnd.load();
+	writeChromeTrace(stream, s.captureBegin.load(), (to == 0) ? timestamp() : to);
+}
+
+void profiler::writeChromeTrace(std::ostream& stream, uint64_t from, uint64_t to)
+{
+	auto& s = state();
+	std::lock_guard<std::mutex> lock(s.threadsLock);
+
+	std::vector<Event> events;
+	events.reserve(eventsPerThread);
+
+	auto flags = stream.flags();
+	stream.setf(std::ios::fixed);
+	stream.precision(3);
+
+	bool firstEntry = true;
+	stream << "{\"traceEvents\":[";
+	for (ThreadEvents* t : s.threads)
+	{
+		uint64_t writtenBefore = t->written.load(std::memory_order_acquire);
+		uint64_t firstIndex = (writtenBefore > eventsPerThread) ? writtenBefore - eventsPerThread : 0;
+
+		events.clear();
+		for (uint64_t i = firstIndex; i < writtenBefore; ++i)
+		{
+			const EventSlot& slot = t->events[i & (eventsPerThread - 1)];
+			events.emplace_back();
+			events.back().name = slot.name.load(std::memory_order_relaxed);
+			events.back().begin = slot.begin.load(std::memory_order_relaxed);
+			events.back().end = slot.end.load(std::memory_order_relaxed);
+		}
+
+		/*
+		 * Producer is not stopped while reading. Events with indices up to
+		 * (writtenAfter - eventsPerThread) could be overwritten or be in progress
+		 * of overwriting during copying, so they are dropped.
+		 */
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t writtenAfter = t->written.load(std::memory_order_relaxed);
+		if (writtenAfter >= eventsPerThread)
+		{
+			uint64_t firstValidIndex = writtenAfter - eventsPerThread + 1;
+			if (firstValidIndex > firstIndex)
+			{
+				uint64_t overwritten = etMin(static_cast<uint64_t>(events.size()), firstValidIndex - firstIndex);
+				events.erase(events.begin(), events.begin() + static_cast<ptrdiff_t>(overwritten));
+			}
+		}
+
+		if (t->name != nullptr)
+		{
+			stream << (firstEntry ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" <<
+				t->threadIndex << ",\"args\":{\"name\":\"";
+			writeEscapedString(stream, t->name);
+			stream << "\"}}";
+			firstEntry = false;
+		}
+
+		for (const Event& e : events)
+		{
+			if ((e.begin < from) || (e.end > to)) continue;
+
+			stream << (firstEntry ? "" : ",") << "\n{\"name\":\"";
+			writeEscapedString(stream, e.name);
+			stream << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t->threadIndex <<
+				",\"ts\":" << static_cast<double>(e.begin - from) / 1000.0 <<
+				",\"dur\":" << static_cast<double>(e.end - e.begin) / 1000.0 << "}";
+			firstEntry = false;
+		}
+	}
+	stream << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+	stream.flags(flags);
+}
+
+bool profiler::writeChromeTrace(const std::string& fileName)
+{
+	std::ofstream file(fileName.c_str(), std::ios::out | std::ios::trunc);
+	if (file.fail())
+	{
+		log::error("Unable to write profiler trace to %s", fileName.c_str());
+		return false;
+	}
+
+	writeChromeTrace(file);
+	return true;
+}
+
+void profiler::writeEscapedString(std::ostream& stream, const char* str)
+{
+	for (const char* c = str; (c != nullptr) && (*c != 0); ++c)
+	{
+		if ((*c == '"') || (*c == '\\'))
+			stream << '\\';
+		stream << *c;
+	}
+}
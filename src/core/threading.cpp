@@ -5,8 +5,48 @@
  *
  */
 
+#include <mutex>
+#include <condition_variable>
 #include <et/core/et.h>
 
+namespace et
+{
+	namespace threading
+	{
+		class WorkerPool
+		{
+		public:
+			WorkerPool();
+			~WorkerPool();
+			
+			bool tryRun(size_t count, size_t rangeSize, const RangeFunction&);
+			
+		private:
+			void workerFunction();
+			void processRanges();
+			
+		private:
+			std::vector<std::thread> _workers;
+			std::mutex _submitLock;
+			std::mutex _lock;
+			std::condition_variable _jobAvailable;
+			std::condition_variable _jobFinished;
+			
+			const RangeFunction* _function = nullptr;
+			std::atomic<size_t> _nextRange;
+			size_t _count = 0;
+			size_t _rangeSize = 0;
+			size_t _rangesCount = 0;
+			size_t _rangesCompleted = 0;
+			size_t _activeWorkers = 0;
+			uint64_t _jobIndex = 0;
+			bool _running = true;
+		};
+		
+		static thread_local bool insideParallelFor = false;
+	}
+}
+
 static et::threading::ThreadIdentifier mainThreadId = 0;
 
 et::threading::ThreadIdentifier et::threading::currentThread()
@@ -46,3 +86,117 @@ void et::threading::sleepMSec(uint64_t msec)
 {
 	std::this_thread::sleep_for(std::chrono::milliseconds(msec));
 }
+
+void et::threading::parallelFor(size_t count, size_t minimalRange, const RangeFunction& function)
+{
+	if (count == 0) return;
+	
+	size_t threads = etMax(size_t(1), maxConcurrentThreads());
+	size_t rangeSize = etMax(etMax(size_t(1), minimalRange), (count + 4 * threads - 1) / (4 * threads));
+	
+	if (!insideParallelFor && (threads > 1) && (count > rangeSize))
+	{
+		static WorkerPool pool;
+		if (pool.tryRun(count, rangeSize, function))
+			return;
+	}
+	
+	function(0, count);
+}
+
+et::threading::WorkerPool::WorkerPool() :
+	_nextRange(0)
+{
+	size_t workersCount = etMax(size_t(1), maxConcurrentThreads()) - 1;
+	for (size_t i = 0; i < workersCount; ++i)
+		_workers.emplace_back(&WorkerPool::workerFunction, this);
+}
+
+et::threading::WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_running = false;
+	}
+	_jobAvailable.notify_all();
+	
+	for (auto& worker : _workers)
+		worker.join();
+}
+
+bool et::threading::WorkerPool::tryRun(size_t count, size_t rangeSize, const RangeFunction& function)
+{
+	std::unique_lock<std::mutex> submitLock(_submitLock, std::try_to_lock);
+	if (!submitLock.owns_lock())
+		return false;
+	
+	{
+		/*
+		 * Workers which woke up too late for the previous job could still be
+		 * inside processRanges, job parameters are not changed until they leave
+		 */
+		std::unique_lock<std::mutex> lock(_lock);
+		_jobFinished.wait(lock, [this]() { return _activeWorkers == 0; });
+		_function = &function;
+		_count = count;
+		_rangeSize = rangeSize;
+		_rangesCount = (count + rangeSize - 1) / rangeSize;
+		_rangesCompleted = 0;
+		_nextRange.store(0);
+		++_jobIndex;
+	}
+	_jobAvailable.notify_all();
+	
+	processRanges();
+	
+	std::unique_lock<std::mutex> lock(_lock);
+	_jobFinished.wait(lock, [this]() { return _rangesCompleted == _rangesCount; });
+	
+	return true;
+}
+
+void et::threading::WorkerPool::workerFunction()
+{
+	uint64_t lastJob = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_jobAvailable.wait(lock, [this, lastJob]() { return !_running || (_jobIndex != lastJob); });
+			if (!_running) break;
+			lastJob = _jobIndex;
+			++_activeWorkers;
+		}
+		
+		processRanges();
+		
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			--_activeWorkers;
+		}
+		_jobFinished.notify_all();
+	}
+}
+
+void et::threading::WorkerPool::processRanges()
+{
+	insideParallelFor = true;
+	
+	size_t completed = 0;
+	for (size_t range = _nextRange.fetch_add(1); range < _rangesCount; range = _nextRange.fetch_add(1))
+	{
+		size_t begin = range * _rangeSize;
+		(*_function)(begin, etMin(_count, begin + _rangeSize));
+		++completed;
+	}
+	
+	insideParallelFor = false;
+	
+	if (completed > 0)
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_rangesCompleted += completed;
+		if (_rangesCompleted == _rangesCount)
+			_jobFinished.notify_all();
+	}
+}
@@ -39,6 +39,16 @@ Program::Program(RenderContext* rc, const std::string& vertexShader, const std::
 #endif
 }
 
+Program::Program(RenderContext* rc, const std::string& objName, const std::string& origin,
+	const StringList& defines) : APIObject(objName, origin), _rc(rc), _mModelViewLocation(-1),
+	_mModelViewProjectionLocation(-1), _vCameraLocation(-1), _vPrimaryLightLocation(-1),
+	_mLightProjectionMatrixLocation(-1), _mTransformLocation(-1), _defines(defines)
+{
+#if defined(ET_CONSOLE_APPLICATION)
+	ET_FAIL("Attempt to create Program in console application");
+#endif
+}
+
 Program::~Program()
 {
 #if !defined(ET_CONSOLE_APPLICATION)
@@ -104,12 +114,10 @@ void Program::setCameraProperties(const Camera& cam)
 void Program::buildProgram(const std::string& vertex_source, const std::string& geom_source,
 	const std::string& frag_source)
 {
-	_floatCache.clear();
-	_vec2Cache.clear();
-	_vec3Cache.clear();
-	_vec4Cache.clear();
-	_mat3Cache.clear();
-	_mat4Cache.clear();
+	_uniformShadows.clear();
+	_uniformShadowData.resize(0);
+	_uniformsByName.clear();
+	_uniformBlocks.clear();
 	_uniforms.clear();
 	
 #if !defined(ET_CONSOLE_APPLICATION)
@@ -132,6 +140,16 @@ void Program::validate() const
 {
 }
 
+bool Program::loadBinary(uint32_t, const BinaryDataStorage&)
+{
+	return false;
+}
+
+bool Program::retrieveBinary(uint32_t&, BinaryDataStorage&) const
+{
+	return false;
+}
+
 /*
  * Uniform setters
  */
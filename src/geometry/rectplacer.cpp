@@ -7,20 +7,55 @@
 
 #include <et/geometry/rectplacer.h>
 
+namespace et
+{
+	namespace
+	{
+		inline bool rectsOverlap(const recti& a, const recti& b)
+		{
+			return (a.left < b.right()) && (a.right() > b.left) &&
+				(a.top < b.bottom()) && (a.bottom() > b.top);
+		}
+
+		inline bool rectContains(const recti& outer, const recti& inner)
+		{
+			return (inner.left >= outer.left) && (inner.top >= outer.top) &&
+				(inner.right() <= outer.right()) && (inner.bottom() <= outer.bottom());
+		}
+	}
+}
+
 using namespace et;
 
-RectPlacer::RectPlacer(const vec2i& contextSize, bool addSpace) :
-	_contextSize(contextSize), _addSpace(addSpace)
+RectPlacer::RectPlacer(const vec2i& contextSize, bool addSpace, Method method, bool allowRotation) :
+	_contextSize(contextSize), _method(method), _addSpace(addSpace), _allowRotation(allowRotation)
 {
+	reset();
+}
+
+void RectPlacer::reset()
+{
+	_placedItems.clear();
+	_freeRects.clear();
+	_skyline.clear();
+	_usedArea = 0;
+
+	if ((_contextSize.x <= 0) || (_contextSize.y <= 0))
+		return;
 
+	if (_method == Method::Skyline)
+		_skyline.emplace_back(0, 0, _contextSize.x);
+	else
+		_freeRects.emplace_back(0, 0, _contextSize.x, _contextSize.y);
 }
 
 void RectPlacer::addPlacedRect(const recti& r)
 {
 	_placedItems.push_back(r);
+	occupy(r);
 }
 
-bool RectPlacer::place(const vec2i& size, recti& placedPosition)
+bool RectPlacer::place(const vec2i& size, recti& placedPosition, bool* rotated)
 {
 	int w = size.x;
 	int h = size.y;
@@ -34,61 +69,282 @@ bool RectPlacer::place(const vec2i& size, recti& placedPosition)
 			h++;
 	}
 
-	placedPosition = recti(vec2i(0), vec2i(w, h));
+	if ((w <= 0) || (h <= 0))
+		return false;
+
+	bool placedRotated = false;
+	bool found = (_method == Method::Skyline) ? findSkylinePosition(w, h, placedPosition, placedRotated) :
+		findMaxRectsPosition(w, h, placedPosition, placedRotated);
+
+	if (!found)
+		return false;
+
+	if (rotated != nullptr)
+		*rotated = placedRotated;
+
+	addPlacedRect(placedPosition);
+	return true;
+}
+
+float RectPlacer::occupancy() const
+{
+	int64_t contextArea = static_cast<int64_t>(_contextSize.x) * static_cast<int64_t>(_contextSize.y);
+	return (contextArea > 0) ? static_cast<float>(static_cast<double>(_usedArea) / static_cast<double>(contextArea)) : 0.0f;
+}
+
+void RectPlacer::occupy(const recti& r)
+{
+	_usedArea += static_cast<int64_t>(r.width) * static_cast<int64_t>(r.height);
+
+	if (_method == Method::Skyline)
+		raiseSkyline(r);
+	else
+		splitFreeRects(r);
+}
+
+/*
+ * MaxRects
+ */
+bool RectPlacer::findMaxRectsPosition(int w, int h, recti& result, bool& rotated) const
+{
+	int bestShortSide = std::numeric_limits<int>::max();
+	int bestLongSide = std::numeric_limits<int>::max();
+	bool found = false;
+
+	auto tryPlace = [&](const recti& freeRect, int width, int height, bool isRotated)
+	{
+		if ((freeRect.width < width) || (freeRect.height < height))
+			return;
+
+		int leftoverX = freeRect.width - width;
+		int leftoverY = freeRect.height - height;
+		int shortSide = etMin(leftoverX, leftoverY);
+		int longSide = etMax(leftoverX, leftoverY);
+		if ((shortSide < bestShortSide) || ((shortSide == bestShortSide) && (longSide < bestLongSide)))
+		{
+			result = recti(freeRect.left, freeRect.top, width, height);
+			bestShortSide = shortSide;
+			bestLongSide = longSide;
+			rotated = isRotated;
+			found = true;
+		}
+	};
 
-	if (_placedItems.size() == 0)
+	bool tryRotated = _allowRotation && (w != h);
+	for (const recti& freeRect : _freeRects)
 	{
-		_placedItems.push_back(placedPosition);
-		return true;
+		tryPlace(freeRect, w, h, false);
+
+		if (tryRotated)
+			tryPlace(freeRect, h, w, true);
 	}
-	
-	for (const recti& i : _placedItems)
+
+	return found;
+}
+
+void RectPlacer::splitFreeRects(const recti& used)
+{
+	size_t freeRectsCount = _freeRects.size();
+	size_t keptRects = 0;
+	RectList splitRects;
+
+	for (size_t i = 0; i < freeRectsCount; ++i)
 	{
-		placedPosition.setOrigin(i.origin() + vec2i(i.size().x, 0));
+		recti freeRect = _freeRects[i];
+		if (!rectsOverlap(freeRect, used))
+		{
+			_freeRects[keptRects++] = freeRect;
+			continue;
+		}
+
+		if (used.left > freeRect.left)
+			splitRects.emplace_back(freeRect.left, freeRect.top, used.left - freeRect.left, freeRect.height);
+
+		if (used.right() < freeRect.right())
+			splitRects.emplace_back(used.right(), freeRect.top, freeRect.right() - used.right(), freeRect.height);
+
+		if (used.top > freeRect.top)
+			splitRects.emplace_back(freeRect.left, freeRect.top, freeRect.width, used.top - freeRect.top);
+
+		if (used.bottom() < freeRect.bottom())
+			splitRects.emplace_back(freeRect.left, used.bottom(), freeRect.width, freeRect.bottom() - used.bottom());
+	}
 
-		bool placed = (placedPosition.origin().x + w <= _contextSize.x) &&
-			(placedPosition.origin().y + h <= _contextSize.y);
-		
-		if (placed)
+	_freeRects.resize(keptRects);
+	_freeRects.insert(_freeRects.end(), splitRects.begin(), splitRects.end());
+	pruneFreeRects(keptRects);
+}
+
+/*
+ * Rects which were not split are not contained in each other already,
+ * and could not be contained in parts of split rects,
+ * so only new rects are tested against the others
+ */
+void RectPlacer::pruneFreeRects(size_t firstNewRect)
+{
+	for (size_t i = firstNewRect, e = _freeRects.size(); i < e; ++i)
+	{
+		for (size_t j = 0; j < e; ++j)
 		{
-			for (const recti& ii : _placedItems)
+			if ((i != j) && (_freeRects[j].width > 0) && rectContains(_freeRects[j], _freeRects[i]))
 			{
-				if (ii.intersects(placedPosition) && (ii != i))
-				{
-					placed = false;
-					break;
-				}
+				_freeRects[i].width = 0;
+				break;
 			}
 		}
+	}
+
+	_freeRects.erase(std::remove_if(_freeRects.begin() + firstNewRect, _freeRects.end(),
+		[](const recti& r) { return r.width == 0; }), _freeRects.end());
+}
+
+/*
+ * Skyline
+ */
+bool RectPlacer::findSkylinePosition(int w, int h, recti& result, bool& rotated) const
+{
+	int bestBottom = std::numeric_limits<int>::max();
+	int bestWidth = std::numeric_limits<int>::max();
+	bool found = false;
 
-		if (placed)
+	auto tryPlace = [&](size_t nodeIndex, int width, int height, bool isRotated)
+	{
+		int y = 0;
+		if (!skylineFits(nodeIndex, width, height, y))
+			return;
+
+		const SkylineNode& node = _skyline[nodeIndex];
+		if ((y + height < bestBottom) || ((y + height == bestBottom) && (node.width < bestWidth)))
 		{
-			_placedItems.push_back(placedPosition);
-			return true;
+			result = recti(node.x, y, width, height);
+			bestBottom = y + height;
+			bestWidth = node.width;
+			rotated = isRotated;
+			found = true;
 		}
+	};
+
+	bool tryRotated = _allowRotation && (w != h);
+	for (size_t i = 0, e = _skyline.size(); i < e; ++i)
+	{
+		tryPlace(i, w, h, false);
 
-		placedPosition.setOrigin(i.origin() + vec2i(0, i.size().y));
-		placed = (placedPosition.origin().x + w <= _contextSize.x) &&
-			(placedPosition.origin().y + h <= _contextSize.y);
-		
-		if (placed)
+		if (tryRotated)
+			tryPlace(i, h, w, true);
+	}
+
+	return found;
+}
+
+bool RectPlacer::skylineFits(size_t nodeIndex, int w, int h, int& y) const
+{
+	const SkylineNode& firstNode = _skyline[nodeIndex];
+	if (firstNode.x + w > _contextSize.x)
+		return false;
+
+	y = firstNode.y;
+	int widthLeft = w;
+	while (widthLeft > 0)
+	{
+		const SkylineNode& node = _skyline[nodeIndex++];
+		y = etMax(y, node.y);
+		if (y + h > _contextSize.y)
+			return false;
+
+		widthLeft -= node.width;
+	}
+
+	return true;
+}
+
+void RectPlacer::splitSkyline(int x)
+{
+	for (size_t i = 0, e = _skyline.size(); i < e; ++i)
+	{
+		SkylineNode& node = _skyline[i];
+		if ((node.x < x) && (x < node.x + node.width))
 		{
-			for (const recti& ii : _placedItems)
-			{
-				if (ii.intersects(placedPosition) && (ii != i))
-				{
-					placed = false;
-					break;
-				}
-			}
+			SkylineNode rightPart(x, node.y, node.x + node.width - x);
+			node.width = x - node.x;
+			_skyline.insert(_skyline.begin() + i + 1, rightPart);
+			return;
 		}
+	}
+}
+
+/*
+ * Skyline is raised to the bottom of rect along its width,
+ * neighbour nodes of the same height are merged
+ */
+void RectPlacer::raiseSkyline(const recti& r)
+{
+	int left = clamp(r.left, 0, _contextSize.x);
+	int right = clamp(r.right(), 0, _contextSize.x);
+	if (left >= right)
+		return;
+
+	splitSkyline(left);
+	splitSkyline(right);
+
+	for (SkylineNode& node : _skyline)
+	{
+		if ((node.x >= left) && (node.x + node.width <= right))
+			node.y = etMax(node.y, r.bottom());
+	}
+
+	size_t mergedNodes = 0;
+	for (size_t i = 1, e = _skyline.size(); i < e; ++i)
+	{
+		SkylineNode& last = _skyline[mergedNodes];
+		if (_skyline[i].y == last.y)
+			last.width += _skyline[i].width;
+		else
+			_skyline[++mergedNodes] = _skyline[i];
+	}
+	_skyline.resize(mergedNodes + 1);
+}
+
+/*
+ * Batch placement
+ */
+RectPlacer::List RectPlacer::placeBatch(std::vector<BatchItem>& items, const vec2i& pageSize, bool addSpace,
+	Method method, bool allowRotation, uint32_t maxPages)
+{
+	std::vector<size_t> order(items.size());
+	for (size_t i = 0, e = items.size(); i < e; ++i)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [&items](size_t a, size_t b)
+	{
+		const vec2i& sa = items[a].size;
+		const vec2i& sb = items[b].size;
+		int64_t areaA = static_cast<int64_t>(sa.x) * static_cast<int64_t>(sa.y);
+		int64_t areaB = static_cast<int64_t>(sb.x) * static_cast<int64_t>(sb.y);
+		return (areaA > areaB) || ((areaA == areaB) && (etMax(sa.x, sa.y) > etMax(sb.x, sb.y)));
+	});
 
-		if (placed) 
+	List pages;
+	for (size_t i : order)
+	{
+		BatchItem& item = items[i];
+		item.page = InvalidPage;
+		item.rotated = false;
+
+		for (size_t p = 0, e = pages.size(); (item.page == InvalidPage) && (p < e); ++p)
+		{
+			if (pages[p].place(item.size, item.place, &item.rotated))
+				item.page = static_cast<uint32_t>(p);
+		}
+
+		if ((item.page == InvalidPage) && (pages.size() < maxPages))
 		{
-			_placedItems.push_back(placedPosition);
-			return true;
+			pages.emplace_back(pageSize, addSpace, method, allowRotation);
+			if (pages.back().place(item.size, item.place, &item.rotated))
+				item.page = static_cast<uint32_t>(pages.size() - 1);
+			else
+				pages.pop_back();
 		}
 	}
-	
-	return false;
+
+	return pages;
 }
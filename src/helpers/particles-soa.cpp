@@ -0,0 +1,528 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/helpers/particles-soa.h>
+
+#if (ET_PLATFORM_IOS)
+#	include <arm_neon.h>
+#	define ET_PARTICLES_NEON	1
+#elif (ET_PLATFORM_MAC || ET_PLATFORM_WIN)
+#	include <emmintrin.h>
+#	define ET_PARTICLES_SSE		1
+#endif
+
+namespace et
+{
+	namespace particles
+	{
+		enum : size_t
+		{
+			StreamAlignment = 4
+		};
+
+#	if (ET_PARTICLES_SSE)
+
+		typedef __m128 float4;
+
+		inline float4 f4load(const float* p)
+			{ return _mm_load_ps(p); }
+
+		inline void f4store(float* p, float4 v)
+			{ _mm_store_ps(p, v); }
+
+		inline float4 f4set(float v)
+			{ return _mm_set1_ps(v); }
+
+		inline float4 f4add(float4 a, float4 b)
+			{ return _mm_add_ps(a, b); }
+
+		inline float4 f4sub(float4 a, float4 b)
+			{ return _mm_sub_ps(a, b); }
+
+		inline float4 f4mul(float4 a, float4 b)
+			{ return _mm_mul_ps(a, b); }
+
+		inline float4 f4div(float4 a, float4 b)
+			{ return _mm_div_ps(a, b); }
+
+		inline float4 f4clamp(float4 v, float4 low, float4 up)
+			{ return _mm_min_ps(_mm_max_ps(v, low), up); }
+
+		inline int f4greaterMask(float4 a, float4 b)
+			{ return _mm_movemask_ps(_mm_cmpgt_ps(a, b)); }
+
+#	elif (ET_PARTICLES_NEON)
+
+		typedef float32x4_t float4;
+
+		inline float4 f4load(const float* p)
+			{ return vld1q_f32(p); }
+
+		inline void f4store(float* p, float4 v)
+			{ vst1q_f32(p, v); }
+
+		inline float4 f4set(float v)
+			{ return vdupq_n_f32(v); }
+
+		inline float4 f4add(float4 a, float4 b)
+			{ return vaddq_f32(a, b); }
+
+		inline float4 f4sub(float4 a, float4 b)
+			{ return vsubq_f32(a, b); }
+
+		inline float4 f4mul(float4 a, float4 b)
+			{ return vmulq_f32(a, b); }
+
+		inline float4 f4div(float4 a, float4 b)
+		{
+			float32x4_t r = vrecpeq_f32(b);
+			r = vmulq_f32(r, vrecpsq_f32(b, r));
+			r = vmulq_f32(r, vrecpsq_f32(b, r));
+			return vmulq_f32(a, r);
+		}
+
+		inline float4 f4clamp(float4 v, float4 low, float4 up)
+			{ return vminq_f32(vmaxq_f32(v, low), up); }
+
+		inline int f4greaterMask(float4 a, float4 b)
+		{
+			uint32x4_t m = vshrq_n_u32(vcgtq_f32(a, b), 31);
+			return static_cast<int>(vgetq_lane_u32(m, 0) | (vgetq_lane_u32(m, 1) << 1) |
+				(vgetq_lane_u32(m, 2) << 2) | (vgetq_lane_u32(m, 3) << 3));
+		}
+
+#	else
+
+		struct float4
+		{
+			float v[4];
+		};
+
+		inline float4 f4load(const float* p)
+			{ return { { p[0], p[1], p[2], p[3] } }; }
+
+		inline void f4store(float* p, const float4& a)
+			{ p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+
+		inline float4 f4set(float v)
+			{ return { { v, v, v, v } }; }
+
+		inline float4 f4add(const float4& a, const float4& b)
+			{ return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+
+		inline float4 f4sub(const float4& a, const float4& b)
+			{ return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+
+		inline float4 f4mul(const float4& a, const float4& b)
+			{ return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+
+		inline float4 f4div(const float4& a, const float4& b)
+			{ return { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+
+		inline float4 f4clamp(const float4& a, const float4& low, const float4& up)
+		{
+			return { { clamp(a.v[0], low.v[0], up.v[0]), clamp(a.v[1], low.v[1], up.v[1]),
+				clamp(a.v[2], low.v[2], up.v[2]), clamp(a.v[3], low.v[3], up.v[3]) } };
+		}
+
+		inline int f4greaterMask(const float4& a, const float4& b)
+		{
+			return (a.v[0] > b.v[0] ? 1 : 0) | (a.v[1] > b.v[1] ? 2 : 0) |
+				(a.v[2] > b.v[2] ? 4 : 0) | (a.v[3] > b.v[3] ? 8 : 0);
+		}
+
+#	endif
+
+		inline size_t alignedCount(size_t count)
+			{ return (count + StreamAlignment - 1) & ~(StreamAlignment - 1); }
+
+		inline float uniformFromBits(uint32_t bits)
+		{
+			union { uint32_t i; float f; } u;
+			u.i = (bits >> 9) | 0x3f800000;
+			return u.f - 1.0f;
+		}
+	}
+}
+
+using namespace et;
+using namespace et::particles;
+
+/*
+ * RandomGenerator
+ */
+RandomGenerator::RandomGenerator(uint32_t seed)
+{
+	if (seed == 0)
+		seed = static_cast<uint32_t>(rand()) | 1;
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		_state[i] = (seed == 0) ? 0x9e3779b9 : seed;
+	}
+}
+
+void RandomGenerator::generate(float* output, size_t count, float low, float up)
+{
+	float range = up - low;
+
+#if (ET_PARTICLES_SSE || ET_PARTICLES_NEON)
+	size_t fullGroups = count / 4;
+#endif
+
+#if (ET_PARTICLES_SSE)
+	__m128i state = _mm_load_si128(reinterpret_cast<const __m128i*>(_state));
+	const __m128i exponent = _mm_set1_epi32(0x3f800000);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 low4 = _mm_set1_ps(low);
+	const __m128 range4 = _mm_set1_ps(range);
+
+	auto next = [&]() -> __m128
+	{
+		state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+		state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+		state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+		__m128 f = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(state, 9), exponent)), one);
+		return _mm_add_ps(low4, _mm_mul_ps(range4, f));
+	};
+
+	for (size_t i = 0; i < fullGroups; ++i)
+		_mm_storeu_ps(output + 4 * i, next());
+
+	if (count % 4 != 0)
+	{
+		ET_ALIGNED(16) float tail[4];
+		_mm_store_ps(tail, next());
+		for (size_t i = 4 * fullGroups; i < count; ++i)
+			output[i] = tail[i % 4];
+	}
+
+	_mm_store_si128(reinterpret_cast<__m128i*>(_state), state);
+
+#elif (ET_PARTICLES_NEON)
+	uint32x4_t state = vld1q_u32(_state);
+	const uint32x4_t exponent = vdupq_n_u32(0x3f800000);
+	const float32x4_t one = vdupq_n_f32(1.0f);
+	const float32x4_t low4 = vdupq_n_f32(low);
+	const float32x4_t range4 = vdupq_n_f32(range);
+
+	auto next = [&]() -> float32x4_t
+	{
+		state = veorq_u32(state, vshlq_n_u32(state, 13));
+		state = veorq_u32(state, vshrq_n_u32(state, 17));
+		state = veorq_u32(state, vshlq_n_u32(state, 5));
+		float32x4_t f = vsubq_f32(vreinterpretq_f32_u32(vorrq_u32(vshrq_n_u32(state, 9), exponent)), one);
+		return vmlaq_f32(low4, range4, f);
+	};
+
+	for (size_t i = 0; i < fullGroups; ++i)
+		vst1q_f32(output + 4 * i, next());
+
+	if (count % 4 != 0)
+	{
+		float tail[4];
+		vst1q_f32(tail, next());
+		for (size_t i = 4 * fullGroups; i < count; ++i)
+			output[i] = tail[i % 4];
+	}
+
+	vst1q_u32(_state, state);
+
+#else
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint32_t& s = _state[i % 4];
+		s ^= s << 13;
+		s ^= s >> 17;
+		s ^= s << 5;
+		output[i] = low + range * uniformFromBits(s);
+	}
+#endif
+}
+
+/*
+ * SoAEmitter
+ */
+SoAEmitter::SoAEmitter(size_t capacity) :
+	_capacity(capacity)
+{
+	size_t streamSize = alignedCount(capacity);
+
+	_storage.resize(Stream_max * streamSize + StreamAlignment);
+	_storage.fill(0);
+
+	size_t misalignment = reinterpret_cast<uintptr_t>(_storage.data()) % (StreamAlignment * sizeof(float));
+	float* base = _storage.data() + (misalignment ? (StreamAlignment * sizeof(float) - misalignment) / sizeof(float) : 0);
+
+	for (size_t s = 0; s < Stream_max; ++s)
+		_streams[s] = base + s * streamSize;
+
+	_random.resize(streamSize);
+	_deadParticles.reserve(capacity);
+}
+
+PointSprite SoAEmitter::particle(size_t i) const
+{
+	ET_ASSERT(i < _capacity);
+
+	PointSprite result;
+	result.position = vec3(_streams[Stream_PositionX][i], _streams[Stream_PositionY][i], _streams[Stream_PositionZ][i]);
+	result.velocity = vec3(_streams[Stream_VelocityX][i], _streams[Stream_VelocityY][i], _streams[Stream_VelocityZ][i]);
+	result.acceleration = vec3(_streams[Stream_AccelerationX][i], _streams[Stream_AccelerationY][i],
+		_streams[Stream_AccelerationZ][i]);
+	result.color = vec4(_streams[Stream_ColorR][i], _streams[Stream_ColorG][i], _streams[Stream_ColorB][i],
+		_streams[Stream_ColorA][i]);
+	result.size = _streams[Stream_Size][i];
+	result.emitTime = _streams[Stream_EmitTime][i];
+	result.lifeTime = _streams[Stream_LifeTime][i];
+	return result;
+}
+
+bool SoAEmitter::emit(const PointSprite& p)
+{
+	if (_activeParticles >= _capacity) return false;
+
+	size_t i = _activeParticles++;
+	_streams[Stream_PositionX][i] = p.position.x;
+	_streams[Stream_PositionY][i] = p.position.y;
+	_streams[Stream_PositionZ][i] = p.position.z;
+	_streams[Stream_VelocityX][i] = p.velocity.x;
+	_streams[Stream_VelocityY][i] = p.velocity.y;
+	_streams[Stream_VelocityZ][i] = p.velocity.z;
+	_streams[Stream_AccelerationX][i] = p.acceleration.x;
+	_streams[Stream_AccelerationY][i] = p.acceleration.y;
+	_streams[Stream_AccelerationZ][i] = p.acceleration.z;
+	_streams[Stream_ColorR][i] = p.color.x;
+	_streams[Stream_ColorG][i] = p.color.y;
+	_streams[Stream_ColorB][i] = p.color.z;
+	_streams[Stream_ColorA][i] = p.color.w;
+	_streams[Stream_Size][i] = p.size;
+	_streams[Stream_EmitTime][i] = p.emitTime;
+	_streams[Stream_LifeTime][i] = p.lifeTime;
+	return true;
+}
+
+size_t SoAEmitter::emit(size_t count, float t)
+{
+	count = etMin(count, _capacity - _activeParticles);
+	if (count == 0) return 0;
+
+	_deadParticles.clear();
+	for (size_t i = 0; i < count; ++i)
+		_deadParticles.push_back(static_cast<uint32_t>(_activeParticles + i));
+
+	_activeParticles += count;
+	respawnDeadParticles(t);
+	_deadParticles.clear();
+
+	return count;
+}
+
+size_t SoAEmitter::emit(size_t count, float t, const PointSprite& base, const PointSprite& var)
+{
+	setBase(base);
+	setVariation(var);
+	return emit(count, t);
+}
+
+size_t SoAEmitter::emitMissingParticles(float t)
+{
+	return emit(_capacity - _activeParticles, t);
+}
+
+void SoAEmitter::update(float t)
+{
+	if (_updateTime == 0.0f)
+		_updateTime = t;
+
+	float dt = t - _updateTime;
+	_updateTime = t;
+
+	_deadParticles.clear();
+	integrate(t, dt);
+
+	if (_deadParticles.empty()) return;
+
+	if (_autoRenewParticles)
+		respawnDeadParticles(t);
+	else
+		removeDeadParticles();
+}
+
+void SoAEmitter::integrate(float t, float dt)
+{
+	float* px = _streams[Stream_PositionX];
+	float* py = _streams[Stream_PositionY];
+	float* pz = _streams[Stream_PositionZ];
+	float* vx = _streams[Stream_VelocityX];
+	float* vy = _streams[Stream_VelocityY];
+	float* vz = _streams[Stream_VelocityZ];
+	const float* ax = _streams[Stream_AccelerationX];
+	const float* ay = _streams[Stream_AccelerationY];
+	const float* az = _streams[Stream_AccelerationZ];
+	float* alpha = _streams[Stream_ColorA];
+	const float* emitTime = _streams[Stream_EmitTime];
+	const float* lifeTime = _streams[Stream_LifeTime];
+
+	const float4 dt4 = f4set(dt);
+	const float4 t4 = f4set(t);
+	const float4 zero = f4set(0.0f);
+	const float4 one = f4set(1.0f);
+
+	for (size_t i = 0, e = alignedCount(_activeParticles); i < e; i += StreamAlignment)
+	{
+		float4 velocityX = f4add(f4load(vx + i), f4mul(dt4, f4load(ax + i)));
+		float4 velocityY = f4add(f4load(vy + i), f4mul(dt4, f4load(ay + i)));
+		float4 velocityZ = f4add(f4load(vz + i), f4mul(dt4, f4load(az + i)));
+		f4store(vx + i, velocityX);
+		f4store(vy + i, velocityY);
+		f4store(vz + i, velocityZ);
+		f4store(px + i, f4add(f4load(px + i), f4mul(dt4, velocityX)));
+		f4store(py + i, f4add(f4load(py + i), f4mul(dt4, velocityY)));
+		f4store(pz + i, f4add(f4load(pz + i), f4mul(dt4, velocityZ)));
+
+		float4 age = f4sub(t4, f4load(emitTime + i));
+		float4 life = f4load(lifeTime + i);
+		f4store(alpha + i, f4clamp(f4sub(one, f4div(age, life)), zero, one));
+
+		int deadMask = f4greaterMask(age, life);
+		while (deadMask != 0)
+		{
+			size_t lane = (deadMask & 1) ? 0 : ((deadMask & 2) ? 1 : ((deadMask & 4) ? 2 : 3));
+			deadMask &= deadMask - 1;
+
+			if (i + lane < _activeParticles)
+				_deadParticles.push_back(static_cast<uint32_t>(i + lane));
+		}
+	}
+}
+
+void SoAEmitter::respawnDeadParticles(float t)
+{
+	size_t count = _deadParticles.size();
+	float* random = _random.data();
+	const uint32_t* indices = _deadParticles.data();
+
+	auto vary = [&](Stream s, float low, float up)
+	{
+		_rng.generate(random, count, low, up);
+
+		float* output = _streams[s];
+		for (size_t i = 0; i < count; ++i)
+			output[indices[i]] = random[i];
+	};
+
+	vary(Stream_PositionX, _base.position.x - _variation.position.x, _base.position.x + _variation.position.x);
+	vary(Stream_PositionY, _base.position.y - _variation.position.y, _base.position.y + _variation.position.y);
+	vary(Stream_PositionZ, _base.position.z - _variation.position.z, _base.position.z + _variation.position.z);
+	vary(Stream_VelocityX, _base.velocity.x - _variation.velocity.x, _base.velocity.x + _variation.velocity.x);
+	vary(Stream_VelocityY, _base.velocity.y - _variation.velocity.y, _base.velocity.y + _variation.velocity.y);
+	vary(Stream_VelocityZ, _base.velocity.z - _variation.velocity.z, _base.velocity.z + _variation.velocity.z);
+	vary(Stream_AccelerationX, _base.acceleration.x - _variation.acceleration.x,
+		_base.acceleration.x + _variation.acceleration.x);
+	vary(Stream_AccelerationY, _base.acceleration.y - _variation.acceleration.y,
+		_base.acceleration.y + _variation.acceleration.y);
+	vary(Stream_AccelerationZ, _base.acceleration.z - _variation.acceleration.z,
+		_base.acceleration.z + _variation.acceleration.z);
+	vary(Stream_ColorR, _base.color.x - _variation.color.x, _base.color.x + _variation.color.x);
+	vary(Stream_ColorG, _base.color.y - _variation.color.y, _base.color.y + _variation.color.y);
+	vary(Stream_ColorB, _base.color.z - _variation.color.z, _base.color.z + _variation.color.z);
+	vary(Stream_Size, _base.size - _variation.size, _base.size + _variation.size);
+	vary(Stream_EmitTime, t, t + _variation.emitTime);
+	vary(Stream_LifeTime, _base.lifeTime - _variation.lifeTime, _base.lifeTime + _variation.lifeTime);
+
+	/*
+	 * Same as defaultMovementFunction with zero time step
+	 */
+	float* alpha = _streams[Stream_ColorA];
+	const float* emitTime = _streams[Stream_EmitTime];
+	const float* lifeTime = _streams[Stream_LifeTime];
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint32_t p = indices[i];
+		alpha[p] = clamp(1.0f - (t - emitTime[p]) / lifeTime[p], 0.0f, 1.0f);
+	}
+}
+
+void SoAEmitter::removeDeadParticles()
+{
+	/*
+	 * Indices are sorted, so going from the end guarantees
+	 * that particle moved into the freed slot is alive
+	 */
+	for (auto i = _deadParticles.rbegin(), e = _deadParticles.rend(); i != e; ++i)
+	{
+		size_t last = --_activeParticles;
+		if (*i == last) continue;
+
+		for (size_t s = 0; s < Stream_max; ++s)
+			_streams[s][*i] = _streams[s][last];
+	}
+}
+
+void SoAEmitter::writeVertices(void* output) const
+{
+	const float* px = _streams[Stream_PositionX];
+	const float* py = _streams[Stream_PositionY];
+	const float* pz = _streams[Stream_PositionZ];
+	const float* cr = _streams[Stream_ColorR];
+	const float* cg = _streams[Stream_ColorG];
+	const float* cb = _streams[Stream_ColorB];
+	const float* ca = _streams[Stream_ColorA];
+
+	float* out = reinterpret_cast<float*>(output);
+	size_t i = 0;
+
+#if (ET_PARTICLES_SSE)
+	/*
+	 * Four particles occupy exactly seven 16-byte vectors
+	 */
+	if (reinterpret_cast<uintptr_t>(output) % 16 == 0)
+	{
+		ET_ALIGNED(16) float block[32];
+		for (size_t e = _activeParticles & ~size_t(3); i < e; i += 4, out += 28)
+		{
+			__m128 r0 = _mm_load_ps(px + i);
+			__m128 r1 = _mm_load_ps(py + i);
+			__m128 r2 = _mm_load_ps(pz + i);
+			__m128 r3 = _mm_load_ps(cr + i);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+			__m128 c0 = _mm_load_ps(cg + i);
+			__m128 c1 = _mm_load_ps(cb + i);
+			__m128 c2 = _mm_load_ps(ca + i);
+			__m128 c3 = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+			_mm_storeu_ps(block + 0, r0);
+			_mm_storeu_ps(block + 4, c0);
+			_mm_storeu_ps(block + 7, r1);
+			_mm_storeu_ps(block + 11, c1);
+			_mm_storeu_ps(block + 14, r2);
+			_mm_storeu_ps(block + 18, c2);
+			_mm_storeu_ps(block + 21, r3);
+			_mm_storeu_ps(block + 25, c3);
+
+			for (size_t v = 0; v < 7; ++v)
+				_mm_stream_ps(out + 4 * v, _mm_load_ps(block + 4 * v));
+		}
+		_mm_sfence();
+	}
+#endif
+
+	for (; i < _activeParticles; ++i, out += 7)
+	{
+		out[0] = px[i];
+		out[1] = py[i];
+		out[2] = pz[i];
+		out[3] = cr[i];
+		out[4] = cg[i];
+		out[5] = cb[i];
+		out[6] = ca[i];
+	}
+}
@@ -0,0 +1,934 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <et/core/tools.h>
+#include <et/core/mappedfile.h>
+#include <et/app/application.h>
+#include <et/rendering/rendering.h>
+#include <et/helpers/streamedterrain.h>
+
+namespace et
+{
+	namespace
+	{
+		const size_t maximumLoadingThreads = 2;
+		const uint32_t maximumTileSize = 128;
+
+		inline uint64_t tileKey(uint32_t level, uint32_t x, uint32_t z)
+		{
+			return (static_cast<uint64_t>(level) << 48) | (static_cast<uint64_t>(z) << 24) |
+				static_cast<uint64_t>(x);
+		}
+	}
+
+	class StreamedTerrainPrivate
+	{
+	public:
+		struct Tile
+		{
+			uint32_t level = 0;
+			uint32_t x = 0;
+			uint32_t z = 0;
+
+			/*
+			 * Heightmap coordinates of the first and the last vertex
+			 */
+			vec2i gridMin;
+			vec2i gridMax;
+
+			float minHeight = 0.0f;
+			float maxHeight = 0.0f;
+			std::vector<float> heights;
+
+			VertexStorage::Pointer vertexData;
+			VertexArrayObject vao;
+
+			size_t memoryUsage = 0;
+			uint64_t lastUsedFrame = 0;
+		};
+
+		struct Request
+		{
+			float priority = 0.0f;
+			uint64_t key = 0;
+
+			Request(float p, uint64_t k) :
+				priority(p), key(k) { }
+		};
+
+	public:
+		StreamedTerrainPrivate(RenderContext* rc) :
+			renderContext(rc) { }
+
+		~StreamedTerrainPrivate()
+			{ close(); }
+
+		bool open(const std::string& fileName, const StreamedTerrain::Parameters&);
+		void close();
+
+		void update(const vec3& cameraPosition);
+		void integrateLoadedTiles();
+		void selectTile(Tile*, const vec3& cameraPosition);
+		void scheduleRequests();
+		void evictTiles();
+
+		void loadingThreadFunction();
+		Tile* buildTile(uint32_t level, uint32_t x, uint32_t z) const;
+		void buildIndexBuffer();
+		void releaseTile(Tile*);
+
+		float sampleHeight(int x, int z) const;
+		int gridCoordinate(int tile, int vertex, uint32_t level, int dimension) const;
+		vec2i cellCount(const Tile*) const;
+		vec3 vertexPosition(const Tile*, int i, int j) const;
+		vec2 gridPosition(const vec3&) const;
+
+		float tileExtent(uint32_t level) const;
+		float distanceToTile(const Tile*, const vec3&) const;
+
+		vec2i tilesAtLevel(uint32_t level) const;
+		Tile* residentTile(uint32_t level, uint32_t x, uint32_t z) const;
+		const Tile* finestTileAt(const vec2& gridPosition) const;
+
+		bool cellAt(const vec2& gridPosition, const Tile*& tile, int& i, int& j, vec2& fraction) const;
+		void cellTriangles(const Tile*, int i, int j, triangle& t1, triangle& t2) const;
+
+		template <typename F>
+		void forEachChild(const Tile*, F callback) const;
+
+		template <typename F>
+		void forEachTriangle(const Tile*, const vec2& gridMin, const vec2& gridMax, F callback) const;
+
+	public:
+		RenderContext* renderContext = nullptr;
+		StreamedTerrain::Parameters parameters;
+		MappedFile heightmap;
+
+		Tile* rootTile = nullptr;
+		uint32_t rootLevel = 0;
+		vec3 cellSize;
+
+		IndexBuffer::Pointer indexBuffer;
+
+		std::unordered_map<uint64_t, Tile*> tiles;
+		std::vector<const Tile*> visibleTiles;
+		std::vector<Request> pendingRequests;
+		std::unordered_set<uint64_t> requestedTiles;
+		size_t residentMemory = 0;
+		uint64_t frame = 0;
+
+		std::mutex loadingMutex;
+		std::condition_variable loadingCondition;
+		std::deque<uint64_t> loadingQueue;
+		std::vector<Tile*> loadedTiles;
+		std::vector<std::thread> loadingThreads;
+		bool loadingThreadsRunning = false;
+	};
+}
+
+using namespace et;
+
+StreamedTerrain::StreamedTerrain(RenderContext* rc)
+{
+	ET_PIMPL_INIT(StreamedTerrain, rc)
+}
+
+StreamedTerrain::~StreamedTerrain()
+{
+	ET_PIMPL_FINALIZE(StreamedTerrain)
+}
+
+bool StreamedTerrain::open(const std::string& fileName, const Parameters& params)
+{
+	return _private->open(application().resolveFileName(fileName), params);
+}
+
+void StreamedTerrain::close()
+{
+	_private->close();
+}
+
+bool StreamedTerrain::isOpen() const
+{
+	return _private->rootTile != nullptr;
+}
+
+void StreamedTerrain::update(const vec3& cameraPosition)
+{
+	if (isOpen())
+		_private->update(cameraPosition);
+}
+
+void StreamedTerrain::render(RenderContext* rc)
+{
+	if (_private->indexBuffer.invalid())
+		return;
+
+	for (const StreamedTerrainPrivate::Tile* tile : _private->visibleTiles)
+	{
+		rc->renderState().bindVertexArray(tile->vao);
+		rc->renderer()->drawElements(_private->indexBuffer, 0, _private->indexBuffer->size());
+	}
+}
+
+bool StreamedTerrain::heightAtPoint(const vec3& pt, float& height) const
+{
+	const StreamedTerrainPrivate::Tile* tile = nullptr;
+	int i = 0;
+	int j = 0;
+	vec2 f;
+
+	if (!_private->cellAt(_private->gridPosition(pt), tile, i, j, f))
+		return false;
+
+	int stride = static_cast<int>(_private->parameters.tileSize) + 1;
+	float h00 = tile->heights[i + j * stride];
+	float h10 = tile->heights[i + 1 + j * stride];
+	float h01 = tile->heights[i + (j + 1) * stride];
+	float h11 = tile->heights[i + 1 + (j + 1) * stride];
+
+	if (f.x + f.y <= 1.0f)
+		height = h00 + f.x * (h10 - h00) + f.y * (h01 - h00);
+	else
+		height = h11 + (1.0f - f.x) * (h01 - h11) + (1.0f - f.y) * (h10 - h11);
+
+	return true;
+}
+
+bool StreamedTerrain::normalAtPoint(const vec3& pt, vec3& normal) const
+{
+	const StreamedTerrainPrivate::Tile* tile = nullptr;
+	int i = 0;
+	int j = 0;
+	vec2 f;
+
+	if (!_private->cellAt(_private->gridPosition(pt), tile, i, j, f))
+		return false;
+
+	triangle t1;
+	triangle t2;
+	_private->cellTriangles(tile, i, j, t1, t2);
+	normal = (f.x + f.y <= 1.0f) ? t1.normalizedNormal() : t2.normalizedNormal();
+	return true;
+}
+
+TerrainContact StreamedTerrain::contactForSphere(const Sphere& s) const
+{
+	TerrainContact result;
+	if (!isOpen())
+		return result;
+
+	vec3 radiusVector(s.radius(), 0.0f, s.radius());
+	vec2 gridMin = _private->gridPosition(s.center() - radiusVector);
+	vec2 gridMax = _private->gridPosition(s.center() + radiusVector);
+
+	int numPoints = 0;
+	_private->forEachTriangle(_private->rootTile, gridMin, gridMax, [&](const triangle& t)
+	{
+		vec3 point;
+		vec3 normal;
+		float penetration = 0.0f;
+		if (intersect::sphereTriangle(s, t, point, normal, penetration))
+		{
+			result.point += point;
+			result.normal += normal;
+			++numPoints;
+		}
+	});
+
+	result.contacted = numPoints > 0;
+	if (result.contacted)
+	{
+		result.point /= static_cast<float>(numPoints);
+		result.normal = normalize(result.normal);
+	}
+
+	return result;
+}
+
+void StreamedTerrain::gatherContactsForSphere(const Sphere& s, TerrainDataDelegate* contactDelegate) const
+{
+	if (!isOpen() || (contactDelegate == nullptr))
+		return;
+
+	vec3 radiusVector(s.radius(), 0.0f, s.radius());
+	vec2 gridMin = _private->gridPosition(s.center() - radiusVector);
+	vec2 gridMax = _private->gridPosition(s.center() + radiusVector);
+
+	_private->forEachTriangle(_private->rootTile, gridMin, gridMax, [&](const triangle& t)
+	{
+		vec3 point;
+		vec3 normal;
+		float penetration = 0.0f;
+		if (intersect::sphereTriangle(s, t, point, normal, penetration))
+			contactDelegate->terrainDataDidFindContact(TerrainContact(point, normal, true));
+	});
+}
+
+const StreamedTerrain::Parameters& StreamedTerrain::parameters() const
+{
+	return _private->parameters;
+}
+
+AABB StreamedTerrain::bounds() const
+{
+	const Parameters& p = _private->parameters;
+	return AABB(p.origin + 0.5f * p.size, 0.5f * p.size);
+}
+
+size_t StreamedTerrain::visibleTileCount() const
+{
+	return _private->visibleTiles.size();
+}
+
+size_t StreamedTerrain::residentTileCount() const
+{
+	return _private->tiles.size();
+}
+
+size_t StreamedTerrain::pendingTileCount() const
+{
+	return _private->requestedTiles.size();
+}
+
+size_t StreamedTerrain::residentMemory() const
+{
+	return _private->residentMemory;
+}
+
+/*
+ * Private implementation
+ */
+bool StreamedTerrainPrivate::open(const std::string& fileName, const StreamedTerrain::Parameters& params)
+{
+	close();
+
+	if ((params.dimension.x < 2) || (params.dimension.y < 2) || (params.tileSize < 2) ||
+		(params.tileSize > maximumTileSize) || !isPowerOfTwo(static_cast<int>(params.tileSize)))
+	{
+		log::error("Invalid streamed terrain parameters for %s", fileName.c_str());
+		return false;
+	}
+
+	if (!heightmap.open(fileName))
+		return false;
+
+	uint64_t bytesPerSample = (params.format == TerrainData::Format_8bit) ? 1 : 2;
+	uint64_t expectedSize = static_cast<uint64_t>(params.dimension.x) *
+		static_cast<uint64_t>(params.dimension.y) * bytesPerSample;
+
+	if (heightmap.size() < expectedSize)
+	{
+		log::error("Heightmap %s is smaller than expected (%llu of %llu bytes)", fileName.c_str(),
+			static_cast<unsigned long long>(heightmap.size()), static_cast<unsigned long long>(expectedSize));
+		heightmap.close();
+		return false;
+	}
+
+	parameters = params;
+	cellSize = vec3(params.size.x / static_cast<float>(params.dimension.x - 1), params.size.y,
+		params.size.z / static_cast<float>(params.dimension.y - 1));
+
+	int largestSide = etMax(params.dimension.x, params.dimension.y) - 1;
+	for (rootLevel = 0; static_cast<int>(params.tileSize << rootLevel) < largestSide; ++rootLevel);
+
+	if (renderContext != nullptr)
+		buildIndexBuffer();
+
+	/*
+	 * Root tile is built synchronously, so queries and rendering always have data
+	 */
+	rootTile = buildTile(rootLevel, 0, 0);
+	if (renderContext != nullptr)
+	{
+		rootTile->vao = renderContext->vertexBufferFactory().createVertexArrayObject("streamed-terrain-vao",
+			rootTile->vertexData, BufferDrawType::Static, indexBuffer);
+		rootTile->vertexData = VertexStorage::Pointer();
+	}
+	tiles.emplace(tileKey(rootLevel, 0, 0), rootTile);
+	residentMemory = rootTile->memoryUsage;
+	visibleTiles.push_back(rootTile);
+
+	loadingThreadsRunning = true;
+	size_t threadsCount = etMax(size_t(1), etMin(maximumLoadingThreads, threading::maxConcurrentThreads() / 2));
+	for (size_t i = 0; i < threadsCount; ++i)
+		loadingThreads.emplace_back(&StreamedTerrainPrivate::loadingThreadFunction, this);
+
+	return true;
+}
+
+void StreamedTerrainPrivate::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(loadingMutex);
+		loadingThreadsRunning = false;
+		loadingQueue.clear();
+	}
+	loadingCondition.notify_all();
+
+	for (auto& t : loadingThreads)
+		t.join();
+	loadingThreads.clear();
+
+	for (Tile* tile : loadedTiles)
+		releaseTile(tile);
+	loadedTiles.clear();
+
+	for (auto& kv : tiles)
+		releaseTile(kv.second);
+	tiles.clear();
+
+	visibleTiles.clear();
+	pendingRequests.clear();
+	requestedTiles.clear();
+	indexBuffer = IndexBuffer::Pointer();
+	heightmap.close();
+
+	rootTile = nullptr;
+	residentMemory = 0;
+	frame = 0;
+}
+
+void StreamedTerrainPrivate::update(const vec3& cameraPosition)
+{
+	++frame;
+
+	integrateLoadedTiles();
+
+	visibleTiles.clear();
+	pendingRequests.clear();
+	selectTile(rootTile, cameraPosition);
+
+	scheduleRequests();
+	evictTiles();
+}
+
+void StreamedTerrainPrivate::integrateLoadedTiles()
+{
+	std::vector<Tile*> readyTiles;
+	{
+		std::lock_guard<std::mutex> lock(loadingMutex);
+
+		size_t count = loadedTiles.size();
+		if (renderContext != nullptr)
+			count = etMin(count, static_cast<size_t>(etMax(1u, parameters.maxUploadsPerUpdate)));
+
+		readyTiles.assign(loadedTiles.begin(), loadedTiles.begin() + count);
+		loadedTiles.erase(loadedTiles.begin(), loadedTiles.begin() + count);
+	}
+
+	for (Tile* tile : readyTiles)
+	{
+		uint64_t key = tileKey(tile->level, tile->x, tile->z);
+		requestedTiles.erase(key);
+
+		if (tiles.count(key) > 0)
+		{
+			releaseTile(tile);
+			continue;
+		}
+
+		if (renderContext != nullptr)
+		{
+			tile->vao = renderContext->vertexBufferFactory().createVertexArrayObject("streamed-terrain-vao",
+				tile->vertexData, BufferDrawType::Static, indexBuffer);
+			tile->vertexData = VertexStorage::Pointer();
+		}
+
+		tile->lastUsedFrame = frame;
+		tiles.emplace(key, tile);
+		residentMemory += tile->memoryUsage;
+	}
+}
+
+/*
+ * Tile is replaced with its children only when all of them are resident,
+ * missing children are requested and the tile is rendered meanwhile
+ */
+void StreamedTerrainPrivate::selectTile(Tile* tile, const vec3& cameraPosition)
+{
+	tile->lastUsedFrame = frame;
+
+	if (tile->level > 0)
+	{
+		float distance = distanceToTile(tile, cameraPosition);
+		float extent = tileExtent(tile->level);
+		if (distance < parameters.detailFactor * extent)
+		{
+			bool childrenResident = true;
+			forEachChild(tile, [&](uint32_t x, uint32_t z)
+			{
+				Tile* child = residentTile(tile->level - 1, x, z);
+				if (child == nullptr)
+				{
+					pendingRequests.emplace_back(2.0f * distance / extent, tileKey(tile->level - 1, x, z));
+					childrenResident = false;
+				}
+				else
+				{
+					child->lastUsedFrame = frame;
+				}
+			});
+
+			if (childrenResident)
+			{
+				forEachChild(tile, [&](uint32_t x, uint32_t z)
+					{ selectTile(residentTile(tile->level - 1, x, z), cameraPosition); });
+				return;
+			}
+		}
+	}
+
+	visibleTiles.push_back(tile);
+}
+
+/*
+ * Queue is rebuilt on each update, so tiles which are no longer needed are not loaded.
+ * Tiles being loaded stay in requested set until they are integrated.
+ */
+void StreamedTerrainPrivate::scheduleRequests()
+{
+	std::sort(pendingRequests.begin(), pendingRequests.end(), [](const Request& a, const Request& b)
+		{ return a.priority < b.priority; });
+
+	bool hasRequests = false;
+	{
+		std::lock_guard<std::mutex> lock(loadingMutex);
+
+		for (uint64_t key : loadingQueue)
+			requestedTiles.erase(key);
+		loadingQueue.clear();
+
+		for (const Request& r : pendingRequests)
+		{
+			if (requestedTiles.insert(r.key).second)
+				loadingQueue.push_back(r.key);
+		}
+
+		hasRequests = !loadingQueue.empty();
+	}
+
+	if (hasRequests)
+		loadingCondition.notify_all();
+}
+
+/*
+ * Tiles used in current frame and root tile are never evicted, so visible set
+ * could exceed budget. Finer tiles go first, so parents outlive their children.
+ */
+void StreamedTerrainPrivate::evictTiles()
+{
+	if (residentMemory <= parameters.memoryBudget)
+		return;
+
+	std::vector<Tile*> candidates;
+	for (const auto& kv : tiles)
+	{
+		if ((kv.second != rootTile) && (kv.second->lastUsedFrame < frame))
+			candidates.push_back(kv.second);
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const Tile* a, const Tile* b)
+	{
+		return (a->lastUsedFrame < b->lastUsedFrame) ||
+			((a->lastUsedFrame == b->lastUsedFrame) && (a->level < b->level));
+	});
+
+	for (Tile* tile : candidates)
+	{
+		if (residentMemory <= parameters.memoryBudget)
+			break;
+
+		tiles.erase(tileKey(tile->level, tile->x, tile->z));
+		residentMemory -= tile->memoryUsage;
+		releaseTile(tile);
+	}
+}
+
+void StreamedTerrainPrivate::loadingThreadFunction()
+{
+	for (;;)
+	{
+		uint64_t key = 0;
+		{
+			std::unique_lock<std::mutex> lock(loadingMutex);
+			loadingCondition.wait(lock, [this]() { return !loadingThreadsRunning || !loadingQueue.empty(); });
+
+			if (!loadingThreadsRunning)
+				return;
+
+			key = loadingQueue.front();
+			loadingQueue.pop_front();
+		}
+
+		Tile* tile = buildTile(static_cast<uint32_t>(key >> 48), static_cast<uint32_t>(key & 0xffffff),
+			static_cast<uint32_t>((key >> 24) & 0xffffff));
+
+		std::lock_guard<std::mutex> lock(loadingMutex);
+		loadedTiles.push_back(tile);
+	}
+}
+
+/*
+ * Normals and tangents are computed from heightmap directly, so they match on tile borders.
+ * Each border gets a skirt of vertices moved down to hide cracks between tiles of different levels.
+ */
+StreamedTerrainPrivate::Tile* StreamedTerrainPrivate::buildTile(uint32_t level, uint32_t x, uint32_t z) const
+{
+	int tileSize = static_cast<int>(parameters.tileSize);
+	int stride = tileSize + 1;
+	int spacing = 1 << level;
+
+	Tile* tile = sharedObjectFactory().createObject<Tile>();
+	tile->level = level;
+	tile->x = x;
+	tile->z = z;
+	tile->gridMin = vec2i(gridCoordinate(x, 0, level, parameters.dimension.x),
+		gridCoordinate(z, 0, level, parameters.dimension.y));
+	tile->gridMax = vec2i(gridCoordinate(x, tileSize, level, parameters.dimension.x),
+		gridCoordinate(z, tileSize, level, parameters.dimension.y));
+
+	tile->heights.resize(stride * stride);
+	tile->minHeight = std::numeric_limits<float>::max();
+	tile->maxHeight = -std::numeric_limits<float>::max();
+	for (int j = 0; j < stride; ++j)
+	{
+		int gz = gridCoordinate(z, j, level, parameters.dimension.y);
+		for (int i = 0; i < stride; ++i)
+		{
+			float h = sampleHeight(gridCoordinate(x, i, level, parameters.dimension.x), gz);
+			tile->minHeight = etMin(tile->minHeight, h);
+			tile->maxHeight = etMax(tile->maxHeight, h);
+			tile->heights[i + j * stride] = h;
+		}
+	}
+	tile->memoryUsage = tile->heights.size() * sizeof(float);
+
+	if (renderContext == nullptr)
+		return tile;
+
+	VertexDeclaration decl(true, VertexAttributeUsage::Position, VertexAttributeType::Vec3);
+	decl.push_back(VertexAttributeUsage::Normal, VertexAttributeType::Vec3);
+	decl.push_back(VertexAttributeUsage::TexCoord0, VertexAttributeType::Vec2);
+	decl.push_back(VertexAttributeUsage::Tangent, VertexAttributeType::Vec3);
+
+	size_t gridVertices = static_cast<size_t>(stride * stride);
+	tile->vertexData = VertexStorage::Pointer::create(decl, gridVertices + 4 * stride);
+
+	auto pos = tile->vertexData->accessData<VertexAttributeType::Vec3>(VertexAttributeUsage::Position, 0);
+	auto nrm = tile->vertexData->accessData<VertexAttributeType::Vec3>(VertexAttributeUsage::Normal, 0);
+	auto tan = tile->vertexData->accessData<VertexAttributeType::Vec3>(VertexAttributeUsage::Tangent, 0);
+	auto tc = tile->vertexData->accessData<VertexAttributeType::Vec2>(VertexAttributeUsage::TexCoord0, 0);
+
+	vec2 texCoordScale(1.0f / static_cast<float>(parameters.dimension.x - 1),
+		1.0f / static_cast<float>(parameters.dimension.y - 1));
+
+	for (int j = 0; j < stride; ++j)
+	{
+		int gz = gridCoordinate(z, j, level, parameters.dimension.y);
+		int gzPrev = etMax(0, gz - spacing);
+		int gzNext = etMin(parameters.dimension.y - 1, gz + spacing);
+
+		for (int i = 0; i < stride; ++i)
+		{
+			int gx = gridCoordinate(x, i, level, parameters.dimension.x);
+			int gxPrev = etMax(0, gx - spacing);
+			int gxNext = etMin(parameters.dimension.x - 1, gx + spacing);
+
+			float slopeX = (sampleHeight(gxNext, gz) - sampleHeight(gxPrev, gz)) /
+				(static_cast<float>(gxNext - gxPrev) * cellSize.x);
+			float slopeZ = (sampleHeight(gx, gzNext) - sampleHeight(gx, gzPrev)) /
+				(static_cast<float>(gzNext - gzPrev) * cellSize.z);
+
+			size_t index = static_cast<size_t>(i + j * stride);
+			pos[index] = vertexPosition(tile, i, j);
+			nrm[index] = normalize(vec3(-slopeX, 1.0f, -slopeZ));
+			tan[index] = normalize(vec3(1.0f, slopeX, 0.0f));
+			tc[index] = vec2(static_cast<float>(gx) * texCoordScale.x, static_cast<float>(gz) * texCoordScale.y);
+		}
+	}
+
+	float skirtDepth = etMax(tile->maxHeight - tile->minHeight,
+		static_cast<float>(spacing) * etMax(cellSize.x, cellSize.z));
+
+	size_t index = gridVertices;
+	for (int side = 0; side < 4; ++side)
+	{
+		for (int k = 0; k < stride; ++k, ++index)
+		{
+			int i = (side < 2) ? k : ((side == 2) ? 0 : tileSize);
+			int j = (side < 2) ? ((side == 0) ? 0 : tileSize) : k;
+			size_t source = static_cast<size_t>(i + j * stride);
+			pos[index] = pos[source] - vec3(0.0f, skirtDepth, 0.0f);
+			nrm[index] = nrm[source];
+			tan[index] = tan[source];
+			tc[index] = tc[source];
+		}
+	}
+
+	tile->memoryUsage += tile->vertexData->data().dataSize();
+	return tile;
+}
+
+/*
+ * All tiles share one index buffer: grid triangulated the same way as Terrain chunks,
+ * followed by skirts along top, bottom, left and right borders facing outside
+ */
+void StreamedTerrainPrivate::buildIndexBuffer()
+{
+	uint32_t tileSize = parameters.tileSize;
+	uint32_t stride = tileSize + 1;
+	uint32_t gridVertices = stride * stride;
+	size_t indexCount = 6 * tileSize * tileSize + 4 * 6 * tileSize;
+
+	IndexArray::Pointer indices = IndexArray::Pointer::create((gridVertices + 4 * stride > 65535) ?
+		IndexArrayFormat::Format_32bit : IndexArrayFormat::Format_16bit, indexCount, PrimitiveType::Triangles);
+
+	size_t position = 0;
+	auto pushTriangle = [&indices, &position](uint32_t a, uint32_t b, uint32_t c)
+	{
+		indices->setIndex(a, position++);
+		indices->setIndex(b, position++);
+		indices->setIndex(c, position++);
+	};
+
+	for (uint32_t v = 0; v < tileSize; ++v)
+	{
+		uint32_t c_v = v * stride;
+		uint32_t n_v = (v + 1) * stride;
+		for (uint32_t u = 0; u < tileSize; ++u)
+		{
+			pushTriangle(u + c_v, u + n_v, u + 1 + c_v);
+			pushTriangle(u + n_v, u + 1 + n_v, u + 1 + c_v);
+		}
+	}
+
+	auto pushSkirt = [&](uint32_t a, uint32_t b, uint32_t skirtA, uint32_t skirtB)
+	{
+		pushTriangle(a, b, skirtA);
+		pushTriangle(b, skirtB, skirtA);
+	};
+
+	uint32_t top = gridVertices;
+	uint32_t bottom = top + stride;
+	uint32_t left = bottom + stride;
+	uint32_t right = left + stride;
+	for (uint32_t k = 0; k < tileSize; ++k)
+	{
+		pushSkirt(k, k + 1, top + k, top + k + 1);
+		pushSkirt(k + 1 + tileSize * stride, k + tileSize * stride, bottom + k + 1, bottom + k);
+		pushSkirt((k + 1) * stride, k * stride, left + k + 1, left + k);
+		pushSkirt(tileSize + k * stride, tileSize + (k + 1) * stride, right + k, right + k + 1);
+	}
+
+	indexBuffer = renderContext->vertexBufferFactory().createIndexBuffer("streamed-terrain-ib",
+		indices, BufferDrawType::Static);
+}
+
+void StreamedTerrainPrivate::releaseTile(Tile* tile)
+{
+	sharedObjectFactory().deleteObject(tile);
+}
+
+float StreamedTerrainPrivate::sampleHeight(int x, int z) const
+{
+	size_t index = static_cast<size_t>(clamp(x, 0, parameters.dimension.x - 1)) +
+		static_cast<size_t>(clamp(z, 0, parameters.dimension.y - 1)) * static_cast<size_t>(parameters.dimension.x);
+
+	float value = 0.0f;
+	if (parameters.format == TerrainData::Format_8bit)
+	{
+		value = static_cast<float>(static_cast<uint8_t>(heightmap.data()[index])) / 255.0f;
+	}
+	else
+	{
+		uint16_t sample = 0;
+		etCopyMemory(&sample, heightmap.data() + 2 * index, sizeof(sample));
+		value = static_cast<float>(sample) / 65535.0f;
+	}
+
+	return parameters.origin.y + value * cellSize.y;
+}
+
+int StreamedTerrainPrivate::gridCoordinate(int tile, int vertex, uint32_t level, int dimension) const
+{
+	int tileSize = static_cast<int>(parameters.tileSize);
+	return etMin((tile * tileSize + vertex) << level, dimension - 1);
+}
+
+/*
+ * Tiles on the far border of heightmap have fewer cells, the last one could be narrower
+ */
+vec2i StreamedTerrainPrivate::cellCount(const Tile* tile) const
+{
+	int spacing = 1 << tile->level;
+	return vec2i((tile->gridMax.x - tile->gridMin.x + spacing - 1) / spacing,
+		(tile->gridMax.y - tile->gridMin.y + spacing - 1) / spacing);
+}
+
+vec3 StreamedTerrainPrivate::vertexPosition(const Tile* tile, int i, int j) const
+{
+	int gx = gridCoordinate(tile->x, i, tile->level, parameters.dimension.x);
+	int gz = gridCoordinate(tile->z, j, tile->level, parameters.dimension.y);
+	return vec3(parameters.origin.x + static_cast<float>(gx) * cellSize.x,
+		tile->heights[i + j * (parameters.tileSize + 1)], parameters.origin.z + static_cast<float>(gz) * cellSize.z);
+}
+
+vec2 StreamedTerrainPrivate::gridPosition(const vec3& pt) const
+{
+	return vec2((pt.x - parameters.origin.x) / cellSize.x, (pt.z - parameters.origin.z) / cellSize.z);
+}
+
+float StreamedTerrainPrivate::tileExtent(uint32_t level) const
+{
+	return static_cast<float>(parameters.tileSize << level) * etMax(cellSize.x, cellSize.z);
+}
+
+float StreamedTerrainPrivate::distanceToTile(const Tile* tile, const vec3& p) const
+{
+	vec3 minVertex(parameters.origin.x + static_cast<float>(tile->gridMin.x) * cellSize.x, tile->minHeight,
+		parameters.origin.z + static_cast<float>(tile->gridMin.y) * cellSize.z);
+	vec3 maxVertex(parameters.origin.x + static_cast<float>(tile->gridMax.x) * cellSize.x, tile->maxHeight,
+		parameters.origin.z + static_cast<float>(tile->gridMax.y) * cellSize.z);
+	return length(p - minv(maxv(p, minVertex), maxVertex));
+}
+
+vec2i StreamedTerrainPrivate::tilesAtLevel(uint32_t level) const
+{
+	int span = static_cast<int>(parameters.tileSize << level);
+	return vec2i((parameters.dimension.x - 2) / span + 1, (parameters.dimension.y - 2) / span + 1);
+}
+
+StreamedTerrainPrivate::Tile* StreamedTerrainPrivate::residentTile(uint32_t level, uint32_t x, uint32_t z) const
+{
+	auto i = tiles.find(tileKey(level, x, z));
+	return (i == tiles.end()) ? nullptr : i->second;
+}
+
+const StreamedTerrainPrivate::Tile* StreamedTerrainPrivate::finestTileAt(const vec2& gridPosition) const
+{
+	const Tile* tile = rootTile;
+	while (tile->level > 0)
+	{
+		uint32_t childLevel = tile->level - 1;
+		vec2i childTiles = tilesAtLevel(childLevel);
+		float childSpan = static_cast<float>(parameters.tileSize << childLevel);
+
+		uint32_t x = static_cast<uint32_t>(clamp(static_cast<int>(gridPosition.x / childSpan), 0, childTiles.x - 1));
+		uint32_t z = static_cast<uint32_t>(clamp(static_cast<int>(gridPosition.y / childSpan), 0, childTiles.y - 1));
+
+		const Tile* child = residentTile(childLevel, x, z);
+		if (child == nullptr)
+			break;
+
+		tile = child;
+	}
+	return tile;
+}
+
+bool StreamedTerrainPrivate::cellAt(const vec2& g, const Tile*& tile, int& i, int& j, vec2& fraction) const
+{
+	if ((rootTile == nullptr) || (g.x < 0.0f) || (g.y < 0.0f) ||
+		(g.x > static_cast<float>(parameters.dimension.x - 1)) || (g.y > static_cast<float>(parameters.dimension.y - 1)))
+	{
+		return false;
+	}
+
+	tile = finestTileAt(g);
+
+	vec2i cells = cellCount(tile);
+	float spacing = static_cast<float>(1 << tile->level);
+
+	i = clamp(static_cast<int>((g.x - static_cast<float>(tile->gridMin.x)) / spacing), 0, cells.x - 1);
+	j = clamp(static_cast<int>((g.y - static_cast<float>(tile->gridMin.y)) / spacing), 0, cells.y - 1);
+
+	/*
+	 * Cells on the far border of heightmap could be clamped
+	 */
+	float x0 = static_cast<float>(gridCoordinate(tile->x, i, tile->level, parameters.dimension.x));
+	float x1 = static_cast<float>(gridCoordinate(tile->x, i + 1, tile->level, parameters.dimension.x));
+	float z0 = static_cast<float>(gridCoordinate(tile->z, j, tile->level, parameters.dimension.y));
+	float z1 = static_cast<float>(gridCoordinate(tile->z, j + 1, tile->level, parameters.dimension.y));
+
+	fraction.x = (x1 > x0) ? clamp((g.x - x0) / (x1 - x0), 0.0f, 1.0f) : 0.0f;
+	fraction.y = (z1 > z0) ? clamp((g.y - z0) / (z1 - z0), 0.0f, 1.0f) : 0.0f;
+	return true;
+}
+
+void StreamedTerrainPrivate::cellTriangles(const Tile* tile, int i, int j, triangle& t1, triangle& t2) const
+{
+	vec3 p00 = vertexPosition(tile, i, j);
+	vec3 p10 = vertexPosition(tile, i + 1, j);
+	vec3 p01 = vertexPosition(tile, i, j + 1);
+	vec3 p11 = vertexPosition(tile, i + 1, j + 1);
+	t1 = triangle(p00, p01, p10);
+	t2 = triangle(p01, p11, p10);
+}
+
+template <typename F>
+void StreamedTerrainPrivate::forEachChild(const Tile* tile, F callback) const
+{
+	vec2i childTiles = tilesAtLevel(tile->level - 1);
+	for (uint32_t z = 2 * tile->z, ze = etMin(z + 2, static_cast<uint32_t>(childTiles.y)); z < ze; ++z)
+	{
+		for (uint32_t x = 2 * tile->x, xe = etMin(x + 2, static_cast<uint32_t>(childTiles.x)); x < xe; ++x)
+			callback(x, z);
+	}
+}
+
+/*
+ * Triangles are taken from the finest tiles which have all their siblings resident
+ */
+template <typename F>
+void StreamedTerrainPrivate::forEachTriangle(const Tile* tile, const vec2& gridMin, const vec2& gridMax, F callback) const
+{
+	if ((gridMax.x < static_cast<float>(tile->gridMin.x)) || (gridMin.x > static_cast<float>(tile->gridMax.x)) ||
+		(gridMax.y < static_cast<float>(tile->gridMin.y)) || (gridMin.y > static_cast<float>(tile->gridMax.y)))
+	{
+		return;
+	}
+
+	if (tile->level > 0)
+	{
+		bool childrenResident = true;
+		forEachChild(tile, [&](uint32_t x, uint32_t z)
+			{ childrenResident = childrenResident && (residentTile(tile->level - 1, x, z) != nullptr); });
+
+		if (childrenResident)
+		{
+			forEachChild(tile, [&](uint32_t x, uint32_t z)
+				{ forEachTriangle(residentTile(tile->level - 1, x, z), gridMin, gridMax, callback); });
+			return;
+		}
+	}
+
+	vec2i cells = cellCount(tile);
+	vec2 origin(static_cast<float>(tile->gridMin.x), static_cast<float>(tile->gridMin.y));
+	float spacing = static_cast<float>(1 << tile->level);
+
+	int i0 = clamp(static_cast<int>(std::floor((gridMin.x - origin.x) / spacing)), 0, cells.x - 1);
+	int i1 = clamp(static_cast<int>(std::floor((gridMax.x - origin.x) / spacing)), 0, cells.x - 1);
+	int j0 = clamp(static_cast<int>(std::floor((gridMin.y - origin.y) / spacing)), 0, cells.y - 1);
+	int j1 = clamp(static_cast<int>(std::floor((gridMax.y - origin.y) / spacing)), 0, cells.y - 1);
+
+	triangle t1;
+	triangle t2;
+	for (int j = j0; j <= j1; ++j)
+	{
+		for (int i = i0; i <= i1; ++i)
+		{
+			cellTriangles(tile, i, j, t1, t2);
+			callback(t1);
+			callback(t2);
+		}
+	}
+}
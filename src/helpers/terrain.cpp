@@ -5,6 +5,7 @@
  *
  */
 
+#include <unordered_map>
 #include <et/core/tools.h>
 #include <et/app/application.h>
 #include <et/helpers/terrain.h>
@@ -16,361 +17,177 @@ using namespace et;
 
 #define ET_TERRAIN_CHUNK_SIZE			32
 
+/*
+ * Chunk starts morphing to the next level when projected error of that level
+ * becomes less than this number of allowed screen space errors
+ */
+#define ET_TERRAIN_MORPH_START			2.0f
+
 class et::TerrainLODLevels
 {
 public:
-	struct LOD
-	{
-		static const size_t VARIATIONS = 16;
-		size_t first[VARIATIONS];
-		size_t size[VARIATIONS];
-	};
-
-	LOD lods[Terrain::LodLevel_max];
-
-	enum TriangleType
-	{
-		TT_LeftTop,
-		TT_LeftBottom,
-		TT_RightTop,
-		TT_RightBottom
-	};
-
 	enum LODSide
 	{
 		Side_Left,
 		Side_Right,
 		Side_Bottom,
-		Side_Top
+		Side_Top,
+		Side_max
 	};
 
-	enum LODCorner
+	enum MorphCategory
 	{
-		Corner_LeftTop,
-		Corner_LeftBottom,
-		Corner_RightTop,
-		Corner_RightBottom
+		Morph_Interior,
+		Morph_VerticalEven,
+		Morph_VerticalOdd,
+		Morph_HorizontalEven,
+		Morph_HorizontalOdd,
+		Morph_max
 	};
 
-	union LODVariation
-	{ 
-		struct 
-		{
-			bool conjugateLeft : 1;
-			bool conjugateRight : 1;
-			bool conjugateTop : 1;
-			bool conjugateBottom : 1;
-		};
+	static const uint32_t MorphCategoryStride = 8;
 
-		struct 
-		{
-			int _definition;
-		};
-
-		inline int definition() 
-		{ 
-			return static_cast<int>(conjugateLeft) | static_cast<int>(conjugateRight) << 1 | 
-				static_cast<int>(conjugateTop) << 2 | static_cast<int>(conjugateBottom) << 3;
-		}
-		
-		LODVariation() : 
-			_definition(0) { }
+	struct Range
+	{
+		uint32_t first = 0;
+		uint32_t size = 0;
 	};
 
-#define pushIndex(value) _buf->push_back(value)
+	/*
+	 * Solid range of the level contains interior followed by all borders
+	 * stitched to the same level, border[level][side][borderLevel] connects interior
+	 * with chunk side which has vertices of the border level
+	 */
+	Range solid[Terrain::LodLevel_max];
+	Range interior[Terrain::LodLevel_max];
+	Range border[Terrain::LodLevel_max][Side_max][Terrain::LodLevel_max];
 
-	void putTriangle(TriangleType t, uint32_t c_u, uint32_t n_u, uint32_t c_v, uint32_t n_v)
-	{
-		switch (t) 
-		{
-		case TT_LeftTop:
-			{
-				pushIndex(c_u + c_v);
-				pushIndex(c_u + n_v);
-				pushIndex(n_u + c_v);
-				break;
-			}
-		case TT_RightTop:
-			{
-				pushIndex(c_u + c_v);
-				pushIndex(n_u + n_v);
-				pushIndex(n_u + c_v);
-				break;
-			}
-		case TT_LeftBottom:
-			{
-				pushIndex(c_u + c_v);
-				pushIndex(c_u + n_v);
-				pushIndex(n_u + n_v);
-				break;
-			}
-		case TT_RightBottom:
-			{
-				pushIndex(n_u + c_v);
-				pushIndex(c_u + n_v);
-				pushIndex(n_u + n_v);
-				break;
-			}
-		};
-	}
+	std::vector<uint32_t> indices;
 
-	void generateSolidLOD(int level, size_t var)
+public:
+	TerrainLODLevels(uint32_t rowStride) : 
+		_rowStride(rowStride)
 	{
-		uint32_t scale = static_cast<uint32_t>(intPower(2, level));
-		vector2<uint32_t> terrainDim(static_cast<uint32_t>(_t->terrainData()->dimension().x - 1), 
-									  static_cast<uint32_t>(_t->terrainData()->dimension().y - 1));
-		vector2<uint32_t> dim(ET_TERRAIN_CHUNK_SIZE / scale, ET_TERRAIN_CHUNK_SIZE / scale);
-		vec2i s(_x0, _z0);
+		for (uint32_t level = 0; level < Terrain::LodLevel_max; ++level)
+		{
+			solid[level].first = currentIndex();
+			generateInterior(level);
 
-		lods[level].first[var] = _buf->actualSize();
-		lods[level].size[var] = dim.square() * 6;
+			for (uint32_t side = 0; side < Side_max; ++side)
+				generateBorder(level, static_cast<LODSide>(side), level);
 
-		for (uint32_t v = 0; v < dim.y; ++v)
-		{
-			uint32_t c_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + v * scale)) * (terrainDim.x + 1);
-			uint32_t n_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + (v + 1) * scale)) * (terrainDim.x + 1);
+			solid[level].size = currentIndex() - solid[level].first;
 
-			for (uint32_t u = 0; u < dim.x; ++u)
+			for (uint32_t side = 0; side < Side_max; ++side)
 			{
-				uint32_t c_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + u * scale));
-				uint32_t n_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + (u + 1) * scale));
-
-				pushIndex(c_u + c_v);
-				pushIndex(c_u + n_v);
-				pushIndex(n_u + c_v);
-				pushIndex(c_u + n_v);
-				pushIndex(n_u + n_v);
-				pushIndex(n_u + c_v);
+				for (uint32_t borderLevel = level + 1; borderLevel < Terrain::LodLevel_max; ++borderLevel)
+					generateBorder(level, static_cast<LODSide>(side), borderLevel);
 			}
 		}
 	}
 
-	void generateLODInterior(const vec2i& lod_dim, int lod_scale_hi, int lod_scale, int& TRI_COUNTER)
+private:
+	uint32_t currentIndex() const
+		{ return static_cast<uint32_t>(indices.size()); }
+
+	uint32_t vertexIndex(const vec2i& p) const
+		{ return static_cast<uint32_t>(p.x) + static_cast<uint32_t>(p.y) * _rowStride; }
+
+	/*
+	 * Point on chunk side at offset along the side and inset into chunk
+	 */
+	vec2i sidePoint(LODSide side, uint32_t offset, uint32_t inset) const
 	{
-		vector2<uint32_t> terrainDim(static_cast<uint32_t>(_t->terrainData()->dimension().x - 1), 
-									    static_cast<uint32_t>(_t->terrainData()->dimension().y - 1));
+		int t = static_cast<int>(offset);
+		int i = static_cast<int>(inset);
 
-		for (uint32_t v = 0; v < static_cast<uint32_t>(lod_dim.y - 1); ++v)
+		switch (side)
 		{
-			uint32_t c_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + lod_scale_hi + v * lod_scale)) * (terrainDim.x + 1);
-			uint32_t n_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + lod_scale_hi + (v + 1) * lod_scale)) * (terrainDim.x + 1);
-			for (uint32_t u = 0; u < static_cast<uint32_t>(lod_dim.x - 1); ++u)
-			{
-				uint32_t c_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + lod_scale_hi + u * lod_scale));
-				uint32_t n_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + lod_scale_hi + (u + 1) * lod_scale ));
-				pushIndex(c_u + c_v);
-				pushIndex(c_u + n_v);
-				pushIndex(n_u + c_v);
-				pushIndex(c_u + n_v);
-				pushIndex(n_u + n_v);
-				pushIndex(n_u + c_v);
-				TRI_COUNTER += 2;
-			}
+			case Side_Left:
+				return vec2i(i, t);
+			case Side_Right:
+				return vec2i(ET_TERRAIN_CHUNK_SIZE - i, t);
+			case Side_Bottom:
+				return vec2i(t, ET_TERRAIN_CHUNK_SIZE - i);
+			default:
+				return vec2i(t, i);
 		}
 	}
 
-	void putTransitionTriangles(LODSide side, const vec2i& lod_dim_hi, const vec2i& lod_dim, 
-			uint32_t lod_scale_hi, uint32_t lod_scale, int& TRI_COUNTER)
+	/*
+	 * Keeps winding of interior triangles, (x, z), (x, z + 1), (x + 1, z)
+	 */
+	void putTriangle(const vec2i& a, const vec2i& b, const vec2i& c)
 	{
-		vector2<uint32_t> terrainDim(static_cast<uint32_t>(_t->terrainData()->dimension().x - 1), 
-									  static_cast<uint32_t>(_t->terrainData()->dimension().y - 1));
-		if ( (side == Side_Top) || (side == Side_Bottom) )
-		{
-			for (uint32_t u = 0; u < static_cast<uint32_t>(lod_dim.x - 1); ++u)
-			{
-				uint32_t v = (side == Side_Top) ? 0 : static_cast<uint32_t>(lod_dim_hi.y - 1);
-				uint32_t c_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + v * lod_scale_hi)) * (terrainDim.x + 1);
-				uint32_t n_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + (v + 1) * lod_scale_hi)) * (terrainDim.x + 1);
-				uint32_t c_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + lod_scale_hi + u * lod_scale));
-				uint32_t m_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + lod_scale_hi + u * lod_scale + lod_scale_hi));
-				uint32_t n_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + lod_scale_hi + (u + 1) * lod_scale));
-				if (side == Side_Top)
-				{
-					pushIndex( m_u + c_v );
-					pushIndex( c_u + n_v );
-					pushIndex( n_u + n_v );
-				}
-				else
-				{
-					pushIndex( c_u + c_v );
-					pushIndex( m_u + n_v );
-					pushIndex( n_u + c_v );
-				}
-				++TRI_COUNTER;
-			}
-		}
-		else
-		{
-			for (int v = 0; v < lod_dim.y - 1; ++v)
-			{
-				uint32_t u = (side == Side_Left) ? 0 : static_cast<uint32_t>((lod_dim.x - 1) * lod_scale + lod_scale_hi);
-				uint32_t c_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + lod_scale_hi + v * lod_scale)) * (terrainDim.x + 1);
-				uint32_t m_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + lod_scale_hi + v * lod_scale + lod_scale_hi)) * (terrainDim.x + 1);
-				uint32_t n_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + lod_scale_hi + (v + 1) * lod_scale)) * (terrainDim.x + 1);
-				uint32_t c_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + u));
-				uint32_t n_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + u + lod_scale_hi));
-				if (side == Side_Left)
-				{
-					pushIndex( n_u + c_v );
-					pushIndex( c_u + m_v );
-					pushIndex( n_u + n_v );
-				}
-				else
-				{
-					pushIndex( c_u + c_v );
-					pushIndex( c_u + n_v );
-					pushIndex( n_u + m_v );
-				}
-				++TRI_COUNTER;
-			}
-		}
+		vec2i ab = b - a;
+		vec2i ac = c - a;
+		bool flip = ab.x * ac.y - ab.y * ac.x > 0;
+
+		indices.push_back(vertexIndex(a));
+		indices.push_back(vertexIndex(flip ? c : b));
+		indices.push_back(vertexIndex(flip ? b : c));
 	}
 
-	void putConjugateTriangles(LODSide side, bool large, const vec2i& lod_dim_hi, const vec2i& lod_dim, int lod_scale_hi, int lod_scale, int& TRI_COUNTER)
+	void generateInterior(uint32_t level)
 	{
-		int currentScale = large ? lod_scale : lod_scale_hi;
-		const vec2i& currentDim = large ? lod_dim : lod_dim_hi;
-		vector2<uint32_t> terrainDim(static_cast<uint32_t>(_t->terrainData()->dimension().x - 1), 
-									  static_cast<uint32_t>(_t->terrainData()->dimension().y - 1));
-
-		if ((side == Side_Top) || (side == Side_Bottom))
-		{
-			int v = (side == Side_Top) ? 0 : lod_dim_hi.y - 1;
-			uint32_t c_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + v * lod_scale_hi)) * (terrainDim.x + 1);
-			uint32_t n_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + (v + 1) * lod_scale_hi)) * (terrainDim.x + 1);
+		int scale = 1 << level;
+		int cells = ET_TERRAIN_CHUNK_SIZE / scale;
 
-			for (uint32_t u = 0; u < static_cast<uint32_t>(currentDim.x); ++u)
-			{
-				bool odd = u % 2 == 1;
-				uint32_t c_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + u * currentScale));
-				uint32_t n_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + (u + 1) * currentScale));
+		interior[level].first = currentIndex();
 
-				if (side == Side_Top)
-				{
-					if (large)
-					{
-						uint32_t m_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + u * currentScale + lod_scale_hi));
-						pushIndex( c_u + c_v );
-						pushIndex( m_u + n_v );
-						pushIndex( n_u + c_v );
-					}
-					else
-						putTriangle( odd ? TT_LeftTop : TT_RightTop, c_u, n_u, c_v, n_v);
-				}
-				else
-				{
-					if (large)
-					{
-						uint32_t m_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + u * currentScale + lod_scale_hi));
-						pushIndex( m_u + c_v );
-						pushIndex( c_u + n_v );
-						pushIndex( n_u + n_v );
-					}
-					else
-						putTriangle( odd ? TT_LeftBottom : TT_RightBottom, c_u, n_u, c_v, n_v);
-				}
-				++TRI_COUNTER;
-			}
-		} 
-		else
+		for (int v = 1; v + 1 < cells; ++v)
 		{
-			uint32_t u = (side == Side_Left) ? 0 : static_cast<uint32_t>(lod_dim_hi.x - 1);
-			uint32_t c_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + u * lod_scale_hi));
-			uint32_t n_u = etMin(terrainDim.x, static_cast<uint32_t>(_x0 + (u + 1) * lod_scale_hi));
-
-			for (int h = 0; h < currentDim.y; ++h)
+			int c_v = v * scale;
+			int n_v = c_v + scale;
+			for (int u = 1; u + 1 < cells; ++u)
 			{
-				bool odd = h % 2 == 1;
-				uint32_t c_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + h * currentScale)) * (terrainDim.x + 1);
-				uint32_t n_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + (h + 1) * currentScale)) * (terrainDim.x + 1);
-
-				if (side == Side_Left)
-				{
-					if (large)
-					{
-						uint32_t m_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + h * currentScale + lod_scale_hi)) * (terrainDim.x + 1);
-						pushIndex(c_u + c_v);
-						pushIndex(c_u + n_v);
-						pushIndex(n_u + m_v);
-					}
-					else
-						putTriangle( odd ? TT_LeftTop : TT_LeftBottom, c_u, n_u, c_v, n_v );
-				}
-				else
-				{
-					if (large)
-					{
-						uint32_t m_v = etMin(terrainDim.y, static_cast<uint32_t>(_z0 + h * currentScale + lod_scale_hi)) * (terrainDim.x + 1);
-						pushIndex(n_u + c_v);
-						pushIndex(c_u + m_v);
-						pushIndex(n_u + n_v);
-					}
-					else
-					{
-						putTriangle( odd ? TT_RightTop : TT_RightBottom, c_u, n_u, c_v, n_v );
-					}
-				}
+				int c_u = u * scale;
+				int n_u = c_u + scale;
+				putTriangle(vec2i(c_u, c_v), vec2i(c_u, n_v), vec2i(n_u, c_v));
+				putTriangle(vec2i(c_u, n_v), vec2i(n_u, n_v), vec2i(n_u, c_v));
 			}
-			++TRI_COUNTER;
 		}
-	}
 
-	void generateLODLevel(int level, LODVariation var)
-	{
-		if (var.definition() == 0)
-		{
-			generateSolidLOD(level, 0);
-			return;
-		}
-
-		int variation = var.definition();
-		uint32_t lod_scale = static_cast<uint32_t>(intPower(2, level));
-		uint32_t lod_scale_hi = lod_scale / 2;
-		vec2i lod_dim = vec2i( ET_TERRAIN_CHUNK_SIZE / lod_scale, ET_TERRAIN_CHUNK_SIZE / lod_scale );
-		vec2i lod_dim_hi = 2 * lod_dim;
-
-		lods[level].first[variation] = _buf->actualSize();
-
-		int TRI_COUNTER = 0;
-
-		putConjugateTriangles(Side_Left, !var.conjugateLeft, lod_dim_hi, lod_dim, lod_scale_hi, lod_scale, TRI_COUNTER);
-		putConjugateTriangles(Side_Top, !var.conjugateTop, lod_dim_hi, lod_dim, lod_scale_hi, lod_scale, TRI_COUNTER);
-		putConjugateTriangles(Side_Right, !var.conjugateRight, lod_dim_hi, lod_dim, lod_scale_hi, lod_scale, TRI_COUNTER);
-		putConjugateTriangles(Side_Bottom, !var.conjugateBottom, lod_dim_hi, lod_dim, lod_scale_hi, lod_scale, TRI_COUNTER);
-
-		putTransitionTriangles(Side_Left, lod_dim_hi, lod_dim, lod_scale_hi, lod_scale, TRI_COUNTER);
-		putTransitionTriangles(Side_Top, lod_dim_hi, lod_dim, lod_scale_hi, lod_scale, TRI_COUNTER);
-		putTransitionTriangles(Side_Bottom, lod_dim_hi, lod_dim, lod_scale_hi, lod_scale, TRI_COUNTER);
-		putTransitionTriangles(Side_Right, lod_dim_hi, lod_dim, lod_scale_hi, lod_scale, TRI_COUNTER);
-
-		generateLODInterior(lod_dim, lod_scale_hi, lod_scale, TRI_COUNTER);
-
-		lods[level].size[variation] = _buf->actualSize() - lods[level].first[variation];
+		interior[level].size = currentIndex() - interior[level].first;
 	}
 
-	TerrainLODLevels(IndexArray::Pointer buf, Terrain* t) : _buf(buf), _t(t), _x0(0), _z0(0)
+	/*
+	 * Zips inner row of the interior with vertices of the border level on the chunk side,
+	 * inner row ends at the diagonals going from chunk corners
+	 */
+	void generateBorder(uint32_t level, LODSide side, uint32_t borderLevel)
 	{
-		int maxLodIndices = ET_TERRAIN_CHUNK_SIZE * ET_TERRAIN_CHUNK_SIZE * 6;
-		int approxIndices = maxLodIndices;
+		uint32_t innerStep = 1u << level;
+		uint32_t outerStep = 1u << borderLevel;
+		uint32_t innerPoints = ET_TERRAIN_CHUNK_SIZE / innerStep - 1;
+		uint32_t outerPoints = ET_TERRAIN_CHUNK_SIZE / outerStep + 1;
 
-		for (int i = 1; i < Terrain::LodLevel_max; ++i)
-			approxIndices += 16 * maxLodIndices / intPower(2, i);
+		Range& range = border[level][side][borderLevel];
+		range.first = currentIndex();
 
-		_buf->resizeToFit(approxIndices);
+		uint32_t inner = 0;
+		uint32_t outer = 0;
+		while ((inner + 1 < innerPoints) || (outer + 1 < outerPoints))
+		{
+			vec2i innerPoint = sidePoint(side, (inner + 1) * innerStep, innerStep);
+			vec2i outerPoint = sidePoint(side, outer * outerStep, 0);
 
-		generateSolidLOD(0, 0);
+			bool advanceOuter = (inner + 1 == innerPoints) ||
+				((outer + 1 < outerPoints) && ((outer + 1) * outerStep <= (inner + 2) * innerStep));
 
-		for (int level = 1; level < Terrain::LodLevel_max; ++level)
-		{
-			for (int var = 0; var < TerrainLODLevels::LOD::VARIATIONS; ++var)
+			if (advanceOuter)
+			{
+				putTriangle(outerPoint, sidePoint(side, (outer + 1) * outerStep, 0), innerPoint);
+				++outer;
+			}
+			else
 			{
-				TerrainLODLevels::LODVariation variation;
-				variation._definition = var;
-				generateLODLevel(level, variation);
+				putTriangle(outerPoint, sidePoint(side, (inner + 2) * innerStep, innerStep), innerPoint);
+				++inner;
 			}
 		}
 
-		_buf->compact();
+		range.size = currentIndex() - range.first;
 	}
 
 private:
@@ -378,32 +195,28 @@ private:
 		{ return *this; }
 
 private:
-	IndexArray::Pointer _buf;
-	Terrain* _t;
-
-	uint32_t _x0;
-	uint32_t _z0;
-	uint32_t _lod0EndIndex;
+	uint32_t _rowStride;
 };
 
 class et::TerrainChunk
 {
 public:
-	TerrainChunk(int index, Terrain* t, int x0, int z0) : selectedLod(0), selectedVariation(0), 
+	TerrainChunk(int index, Terrain* t, int x0, int z0) : selectedLod(0), morphFactor(0.0f),
 		visible(true), _x0(x0), _z0(z0), _index(index), _t(t)
 	{
 		VertexDataChunk pos = t->_tdata->vertexData()->chunk(VertexAttributeUsage::Position);
 		RawDataAcessor<vec3> posData = pos.accessData<vec3>(0);
+		int rowStride = _t->terrainData()->dimension().x;
 
-		initialOffset = x0 + z0 * _t->terrainData()->dimension().x;
+		initialOffset = x0 + z0 * rowStride;
 		vec3 _minVect = posData[initialOffset];
 		vec3 _maxVect = _minVect;
 
-		for (int z = z0, ze = z0 + ET_TERRAIN_CHUNK_SIZE; z < ze; ++z)
+		for (int z = z0, ze = z0 + ET_TERRAIN_CHUNK_SIZE; z <= ze; ++z)
 		{
-			for (int x = x0, xe = x0 + ET_TERRAIN_CHUNK_SIZE; x < xe; ++x)
+			for (int x = x0, xe = x0 + ET_TERRAIN_CHUNK_SIZE; x <= xe; ++x)
 			{
-				int e = x + z * _t->terrainData()->dimension().x;
+				int e = x + z * rowStride;
 				_minVect = minv(posData[e], _minVect);
 				_maxVect = maxv(posData[e], _maxVect);
 			}
@@ -411,12 +224,54 @@ public:
 
 		vec3 center = (_minVect + _maxVect) / 2.0f;
 		vec3 dimension = _maxVect - _minVect;
-		_aabb = AABB(center, dimension);
+		_aabb = AABB(center, 0.5f * dimension);
+
+		/*
+		 * Geometric error of the level is the largest distance from vertices
+		 * of the full resolution grid to the surface of the level
+		 */
+		error[Terrain::LodLevel0] = 0.0f;
+		for (int level = Terrain::LodLevel1; level < Terrain::LodLevel_max; ++level)
+		{
+			int scale = 1 << level;
+			float invScale = 1.0f / static_cast<float>(scale);
+			float maxError = error[level - 1];
+
+			for (int z = 0; z <= ET_TERRAIN_CHUNK_SIZE; ++z)
+			{
+				int cz = etMin(z / scale * scale, ET_TERRAIN_CHUNK_SIZE - scale);
+				float v = static_cast<float>(z - cz) * invScale;
+				for (int x = 0; x <= ET_TERRAIN_CHUNK_SIZE; ++x)
+				{
+					int cx = etMin(x / scale * scale, ET_TERRAIN_CHUNK_SIZE - scale);
+					float u = static_cast<float>(x - cx) * invScale;
+
+					int i00 = initialOffset + cx + cz * rowStride;
+					int i10 = i00 + scale;
+					int i01 = i00 + scale * rowStride;
+					int i11 = i01 + scale;
+
+					vec3 approx = (u + v <= 1.0f) ?
+						posData[i00] + u * (posData[i10] - posData[i00]) + v * (posData[i01] - posData[i00]) :
+						posData[i11] + (1.0f - u) * (posData[i01] - posData[i11]) + (1.0f - v) * (posData[i10] - posData[i11]);
+
+					maxError = etMax(maxError, (posData[initialOffset + x + z * rowStride] - approx).length());
+				}
+			}
+
+			error[level] = maxError;
+		}
 	}
 
 public:
+	float error[Terrain::LodLevel_max];
+
 	int selectedLod;
-	int selectedVariation;
+	float morphFactor;
+
+	int borderLod[TerrainLODLevels::Side_max];
+	float borderMorph[TerrainLODLevels::Side_max];
+
 	int initialOffset;
 	bool visible;
 
@@ -457,16 +312,186 @@ void Terrain::releaseData()
 
 void Terrain::render(RenderContext* rc)
 {
+	rc->renderState().bindVertexArray(_vao);
+	for (ChunkIterator i = _chunks.begin(), e = _chunks.end(); i != e; ++i)
+	{
+		if ((*i)->visible)
+			renderChunk(rc, *i);
+	}
+}
+
+void Terrain::render(RenderContext* rc, Program::Pointer program)
+{
+	Program::Uniform morphUniform;
+	if (program.valid())
+		morphUniform = program->getUniform("morphParameters");
+
+	if (morphUniform.location == -1)
+	{
+		render(rc);
+		return;
+	}
+
 	rc->renderState().bindVertexArray(_vao);
 	for (ChunkIterator i = _chunks.begin(), e = _chunks.end(); i != e; ++i)
 	{
 		TerrainChunk* chunk = *i;
-		TerrainLODLevels::LOD& l = _lods->lods[chunk->selectedLod];
-		rc->renderer()->drawElementsBaseIndex(_vao, chunk->initialOffset, 
-			l.first[chunk->selectedVariation], l.size[chunk->selectedVariation]);
+		if (!chunk->visible) continue;
+
+		vec2 parameters[TerrainLODLevels::Morph_max];
+		morphParameters(chunk, parameters);
+		program->setUniform(morphUniform.location, morphUniform.type, parameters, static_cast<size_t>(TerrainLODLevels::Morph_max));
+
+		renderChunk(rc, chunk);
 	}
 }
 
+/*
+ * Chunk sides lie on chunk borders with the same index as row and column of chunk
+ * and the next one, categories of vertices are selected by parity of this index
+ */
+void Terrain::morphParameters(const TerrainChunk* chunk, vec2* parameters) const
+{
+	int column = chunk->index() % _chunkSizes.x;
+	int row = chunk->index() / _chunkSizes.x;
+
+	parameters[TerrainLODLevels::Morph_Interior] = vec2(static_cast<float>(chunk->selectedLod), chunk->morphFactor);
+	parameters[TerrainLODLevels::Morph_VerticalEven + column % 2] = 
+		vec2(static_cast<float>(chunk->borderLod[TerrainLODLevels::Side_Left]), chunk->borderMorph[TerrainLODLevels::Side_Left]);
+	parameters[TerrainLODLevels::Morph_VerticalEven + (column + 1) % 2] = 
+		vec2(static_cast<float>(chunk->borderLod[TerrainLODLevels::Side_Right]), chunk->borderMorph[TerrainLODLevels::Side_Right]);
+	parameters[TerrainLODLevels::Morph_HorizontalEven + row % 2] = 
+		vec2(static_cast<float>(chunk->borderLod[TerrainLODLevels::Side_Top]), chunk->borderMorph[TerrainLODLevels::Side_Top]);
+	parameters[TerrainLODLevels::Morph_HorizontalEven + (row + 1) % 2] = 
+		vec2(static_cast<float>(chunk->borderLod[TerrainLODLevels::Side_Bottom]), chunk->borderMorph[TerrainLODLevels::Side_Bottom]);
+}
+
+void Terrain::renderChunk(RenderContext* rc, TerrainChunk* chunk)
+{
+	int level = chunk->selectedLod;
+
+	bool solid = true;
+	for (uint32_t side = 0; side < TerrainLODLevels::Side_max; ++side)
+		solid = solid && (chunk->borderLod[side] == level);
+
+	if (solid)
+	{
+		const TerrainLODLevels::Range& r = _lods->solid[level];
+		rc->renderer()->drawElementsBaseIndex(_vao, chunk->initialOffset, r.first, r.size);
+		return;
+	}
+
+	const TerrainLODLevels::Range& interior = _lods->interior[level];
+	if (interior.size > 0)
+		rc->renderer()->drawElementsBaseIndex(_vao, chunk->initialOffset, interior.first, interior.size);
+
+	for (uint32_t side = 0; side < TerrainLODLevels::Side_max; ++side)
+	{
+		const TerrainLODLevels::Range& r = _lods->border[level][side][chunk->borderLod[side]];
+		rc->renderer()->drawElementsBaseIndex(_vao, chunk->initialOffset, r.first, r.size);
+	}
+}
+
+size_t Terrain::triangleCount() const
+{
+	size_t result = 0;
+	for (const TerrainChunk* chunk : _chunks)
+	{
+		if (!chunk->visible) continue;
+
+		int level = chunk->selectedLod;
+		result += _lods->interior[level].size;
+		for (uint32_t side = 0; side < TerrainLODLevels::Side_max; ++side)
+			result += _lods->border[level][side][chunk->borderLod[side]].size;
+	}
+	return result / 3;
+}
+
+#if (ET_DEBUG)
+/*
+ * Indices are released after upload, so they are generated again. Morphed positions
+ * are computed the same way as in vertex program described in terrain.h
+ */
+bool Terrain::validateStitching() const
+{
+	if (_tdata.invalid() || _chunks.empty())
+		return true;
+
+	const vec2i& dim = _tdata->dimension();
+	TerrainLODLevels lods(static_cast<uint32_t>(dim.x));
+
+	VertexArray::Pointer vertexData = _tdata->vertexData();
+	RawDataAcessor<vec3> pos = vertexData->chunk(VertexAttributeUsage::Position).accessData<vec3>(0);
+	RawDataAcessor<vec4> morph = vertexData->chunk(VertexAttributeUsage::TexCoord1).accessData<vec4>(0);
+
+	const float stride = static_cast<float>(TerrainLODLevels::MorphCategoryStride);
+	const int lastColumn = _chunkSizes.x * ET_TERRAIN_CHUNK_SIZE;
+	const int lastRow = _chunkSizes.y * ET_TERRAIN_CHUNK_SIZE;
+
+	std::unordered_map<int, vec3> morphedPositions;
+	std::map<std::pair<int, int>, int> edges;
+	bool valid = true;
+
+	for (const TerrainChunk* chunk : _chunks)
+	{
+		vec2 parameters[TerrainLODLevels::Morph_max];
+		morphParameters(chunk, parameters);
+
+		int level = chunk->selectedLod;
+		const TerrainLODLevels::Range* ranges[1 + TerrainLODLevels::Side_max] = { &lods.interior[level] };
+		for (uint32_t side = 0; side < TerrainLODLevels::Side_max; ++side)
+			ranges[1 + side] = &lods.border[level][side][chunk->borderLod[side]];
+
+		for (const TerrainLODLevels::Range* range : ranges)
+		{
+			for (uint32_t i = range->first, e = range->first + range->size; i < e; i += 3)
+			{
+				int face[3];
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					int index = static_cast<int>(lods.indices[i + k]) + chunk->initialOffset;
+					face[k] = index;
+
+					const vec4& m = morph[index];
+					float category = std::floor(m.w / stride);
+					const vec2& p = parameters[static_cast<int>(category)];
+					float factor = (m.w - stride * category == p.x + 1.0f) ? p.y : 0.0f;
+					vec3 morphed = pos[index] + factor * m.xyz();
+
+					auto inserted = morphedPositions.insert(std::make_pair(index, morphed));
+					if (!inserted.second && ((inserted.first->second - morphed).length() > 1.0e-4f))
+						valid = false;
+				}
+
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					int a = face[k];
+					int b = face[(k + 1) % 3];
+					++edges[std::make_pair(etMin(a, b), etMax(a, b))];
+				}
+			}
+		}
+	}
+
+	auto onTerrainBorder = [&dim, lastColumn, lastRow](int a, int b)
+	{
+		int ax = a % dim.x;
+		int az = a / dim.x;
+		int bx = b % dim.x;
+		int bz = b / dim.x;
+		return ((ax == bx) && ((ax == 0) || (ax == lastColumn))) || ((az == bz) && ((az == 0) || (az == lastRow)));
+	};
+
+	for (const auto& edge : edges)
+	{
+		int expected = onTerrainBorder(edge.first.first, edge.first.second) ? 1 : 2;
+		valid = valid && (edge.second == expected);
+	}
+
+	return valid;
+}
+#endif
+
 void Terrain::loadFromData(const TerrainDataRef& data)
 {
 	_tdata = data;
@@ -489,11 +514,23 @@ void Terrain::loadFromRAWFile(const std::string& fileName, const vec2i& dimensio
 void Terrain::generateBuffer()
 {
 	releaseData();
-	
-	IndexArray::Pointer indices = IndexArray::Pointer::create(IndexArrayFormat::Format_16bit, 0, PrimitiveType::Triangles);
-	_lods = sharedObjectFactory().createObject<TerrainLODLevels>(indices, this);
+
+	uint32_t rowStride = static_cast<uint32_t>(_tdata->dimension().x);
+	uint32_t maxIndex = ET_TERRAIN_CHUNK_SIZE * (rowStride + 1);
+
+	generateMorphData();
+	_lods = sharedObjectFactory().createObject<TerrainLODLevels>(rowStride);
 	generateChunks();
-	indices->compact();
+
+	IndexArrayFormat format = (maxIndex <= std::numeric_limits<uint16_t>::max()) ?
+		IndexArrayFormat::Format_16bit : IndexArrayFormat::Format_32bit;
+
+	IndexArray::Pointer indices = IndexArray::Pointer::create(format, _lods->indices.size(), PrimitiveType::Triangles);
+	for (uint32_t index : _lods->indices)
+		indices->push_back(index);
+
+	_lods->indices.clear();
+	_lods->indices.shrink_to_fit();
 
 	_vao = _rc->vertexBufferFactory().createVertexArrayObject("terrain-vao");
 	_vertexBuffer = _rc->vertexBufferFactory().createVertexBuffer("terrain-vb", _tdata->vertexData(), BufferDrawType::Static);
@@ -507,7 +544,7 @@ void Terrain::generateChunks()
 	IntervalTimer timer(true);
 
 	int totalChunks = 0;
-	_chunkSizes = _tdata->dimension() / ET_TERRAIN_CHUNK_SIZE;
+	_chunkSizes = (_tdata->dimension() - vec2i(1)) / ET_TERRAIN_CHUNK_SIZE;
 	for (int z = 0; z < _chunkSizes.y; ++z)
 	{
 		for (int x = 0; x < _chunkSizes.x; ++x, ++totalChunks)
@@ -518,9 +555,61 @@ void Terrain::generateChunks()
 		}
 	}
 
+	validateLODLevels();
+
 	std::cout << "done (" << timer.lap() << " sec) " << std::endl;
 }
 
+/*
+ * Vertex disappears on the level after the number of trailing zero bits in its coordinates,
+ * on that level it lies in the middle of an edge or of a diagonal of the coarser grid
+ */
+void Terrain::generateMorphData()
+{
+	const vec2i& dim = _tdata->dimension();
+	VertexArray::Pointer vertexData = _tdata->vertexData();
+	RawDataAcessor<vec3> pos = vertexData->chunk(VertexAttributeUsage::Position).accessData<vec3>(0);
+	RawDataAcessor<vec4> morph = vertexData->chunk(VertexAttributeUsage::TexCoord1).accessData<vec4>(0);
+
+	auto insideGrid = [&dim](const vec2i& p)
+		{ return (p.x >= 0) && (p.y >= 0) && (p.x < dim.x) && (p.y < dim.y); };
+
+	const int maxTrailingZeros = 6;
+	for (int z = 0; z < dim.y; ++z)
+	{
+		for (int x = 0; x < dim.x; ++x)
+		{
+			int index = x + z * dim.x;
+
+			int zeros = 0;
+			while ((zeros < maxTrailingZeros) && (((x | z) & (1 << zeros)) == 0))
+				++zeros;
+
+			vec3 offset(0.0f);
+			if (zeros + 1 < LodLevel_max)
+			{
+				int h = 1 << zeros;
+				bool oddX = ((x >> zeros) & 1) == 1;
+				bool oddZ = ((z >> zeros) & 1) == 1;
+
+				vec2i a = oddX ? (oddZ ? vec2i(x + h, z - h) : vec2i(x - h, z)) : vec2i(x, z - h);
+				vec2i b = oddX ? (oddZ ? vec2i(x - h, z + h) : vec2i(x + h, z)) : vec2i(x, z + h);
+
+				if (insideGrid(a) && insideGrid(b))
+					offset = 0.5f * (pos[a.x + a.y * dim.x] + pos[b.x + b.y * dim.x]) - pos[index];
+			}
+
+			uint32_t category = TerrainLODLevels::Morph_Interior;
+			if (x % ET_TERRAIN_CHUNK_SIZE == 0)
+				category = TerrainLODLevels::Morph_VerticalEven + (x / ET_TERRAIN_CHUNK_SIZE) % 2;
+			else if (z % ET_TERRAIN_CHUNK_SIZE == 0)
+				category = TerrainLODLevels::Morph_HorizontalEven + (z / ET_TERRAIN_CHUNK_SIZE) % 2;
+
+			morph[index] = vec4(offset, static_cast<float>(zeros + 1 + category * TerrainLODLevels::MorphCategoryStride));
+		}
+	}
+}
+
 void Terrain::recomputeLodLevels()
 {
 	if (!_delegate) return;
@@ -529,45 +618,100 @@ void Terrain::recomputeLodLevels()
 	{
 		bool visible = true;
 		(*i)->selectedLod = clamp<int>(_delegate->computeTerrainLod(this, (*i)->aabb(), (*i)->selectedLod, visible), 0, LodLevel4);
+		(*i)->morphFactor = 0.0f;
 		(*i)->visible = visible;
 	}
 	validateLODLevels();
 }
 
-void Terrain::validateLODLevels()
+void Terrain::recomputeLodLevels(const Camera& camera, float viewportHeight)
 {
+	float projectionScale = 0.5f * viewportHeight * camera.projectionMatrix()[1][1];
+	const vec3& eye = camera.position();
+
 	for (ChunkIterator i = _chunks.begin(), e = _chunks.end(); i != e; ++i)
 	{
 		TerrainChunk* chunk = *i;
-
-		if (chunk->selectedLod == 0)
+		const AABB& box = chunk->aabb();
+
+		vec3 outside = maxv(absv(eye - box.center) - box.halfDimension, vec3(0.0f));
+		float distance = etMax(outside.length(), std::numeric_limits<float>::epsilon());
+
+		/*
+		 * Projected error of the level relative to allowed error is error * errorScale
+		 */
+		float errorScale = projectionScale / (distance * _screenSpaceError);
+
+		int level = LodLevel0;
+		while ((level + 1 < LodLevel_max) && (chunk->error[level + 1] * errorScale <= 1.0f))
+			++level;
+
+		/*
+		 * Morphing ends where the next level is selected and starts not earlier
+		 * than this level is selected, so there are no jumps on switching levels
+		 */
+		float morph = 0.0f;
+		if (level + 1 < LodLevel_max)
 		{
-			chunk->selectedVariation = 0;
+			float morphEnd = 1.0f / chunk->error[level + 1];
+			float morphStart = ET_TERRAIN_MORPH_START * morphEnd;
+			if (chunk->error[level] > 0.0f)
+				morphStart = etMin(morphStart, 1.0f / chunk->error[level]);
+			morph = clamp((morphStart - errorScale) / (morphStart - morphEnd), 0.0f, 1.0f);
 		}
-		else
-		{
-			int chunkRow = chunk->index() / _chunkSizes.x;
-			int chunkCol = chunk->index() % _chunkSizes.x;
 
-			int leftCol = etMax(0, chunkCol - 1);
-			int rightCol = etMin(_chunkSizes.x - 1, chunkCol + 1);
-			int topRow = etMax(0, chunkRow - 1);
-			int bottomRow = etMin(_chunkSizes.y - 1, chunkRow + 1);
-
-			int leftChunk = leftCol + chunkRow * _chunkSizes.x;
-			int rightChunk = rightCol + chunkRow * _chunkSizes.x;
-			int topChunk = chunkCol + topRow * _chunkSizes.x;
-			int bottomChunk = chunkCol + bottomRow * _chunkSizes.x;
+		chunk->selectedLod = level;
+		chunk->morphFactor = morph;
+		chunk->visible = camera.frustum().containsAABB(box);
+	}
 
-			int ownLOD = chunk->selectedLod;
+	validateLODLevels();
+}
 
-			TerrainLODLevels::LODVariation variation;
-			variation.conjugateLeft = ownLOD > _chunks.at(leftChunk)->selectedLod;
-			variation.conjugateRight = ownLOD > _chunks.at(rightChunk)->selectedLod;
-			variation.conjugateTop = ownLOD > _chunks.at(topChunk)->selectedLod;
-			variation.conjugateBottom = ownLOD > _chunks.at(bottomChunk)->selectedLod;
+/*
+ * Border between chunks is built with vertices of the coarser chunk and morphed with its
+ * factor, borders between chunks of the same level use the larger factor of two
+ */
+void Terrain::validateLODLevels()
+{
+	for (ChunkIterator i = _chunks.begin(), e = _chunks.end(); i != e; ++i)
+	{
+		TerrainChunk* chunk = *i;
 
-			chunk->selectedVariation = variation.definition();
+		int chunkRow = chunk->index() / _chunkSizes.x;
+		int chunkCol = chunk->index() % _chunkSizes.x;
+
+		TerrainChunk* neighbours[TerrainLODLevels::Side_max] = { };
+		if (chunkCol > 0)
+			neighbours[TerrainLODLevels::Side_Left] = _chunks.at(chunk->index() - 1);
+		if (chunkCol + 1 < _chunkSizes.x)
+			neighbours[TerrainLODLevels::Side_Right] = _chunks.at(chunk->index() + 1);
+		if (chunkRow > 0)
+			neighbours[TerrainLODLevels::Side_Top] = _chunks.at(chunk->index() - _chunkSizes.x);
+		if (chunkRow + 1 < _chunkSizes.y)
+			neighbours[TerrainLODLevels::Side_Bottom] = _chunks.at(chunk->index() + _chunkSizes.x);
+
+		int ownLOD = chunk->selectedLod;
+		for (uint32_t side = 0; side < TerrainLODLevels::Side_max; ++side)
+		{
+			const TerrainChunk* n = neighbours[side];
+			if ((n == nullptr) || (n->selectedLod < ownLOD))
+			{
+				chunk->borderLod[side] = ownLOD;
+				chunk->borderMorph[side] = chunk->morphFactor;
+			}
+			else if (n->selectedLod == ownLOD)
+			{
+				chunk->borderLod[side] = ownLOD;
+				chunk->borderMorph[side] = etMax(chunk->morphFactor, n->morphFactor);
+			}
+			else
+			{
+				chunk->borderLod[side] = n->selectedLod;
+				chunk->borderMorph[side] = n->morphFactor;
+			}
 		}
 	}
+
+	ET_ASSERT(validateStitching());
 }
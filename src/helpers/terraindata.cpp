@@ -62,6 +62,11 @@ void TerrainData::generateVertexData(const FloatDataStorage& hm)
 	decl.push_back(VertexAttributeUsage::TexCoord0, VertexAttributeType::Vec2);
 	decl.push_back(VertexAttributeUsage::Tangent, VertexAttributeType::Vec3);
 
+	/*
+	 * Geomorphing data, filled by Terrain
+	 */
+	decl.push_back(VertexAttributeUsage::TexCoord1, VertexAttributeType::Vec4);
+
 	_vertexData = VertexArray::Pointer::create(decl, _dimension.square());
 
 	RawDataAcessor<vec3> pos = _vertexData->chunk(VertexAttributeUsage::Position).accessData<vec3>(0);
@@ -114,8 +119,8 @@ void TerrainData::generateVertexData(const FloatDataStorage& hm)
 	IndexArray::Pointer tempIB = IndexArray::Pointer::create(IndexArrayFormat::Format_32bit, numTriangles, PrimitiveType::Triangles);
 	
 	primitives::buildTrianglesIndexes(tempIB, _dimension, 0, 0);
-	primitives::calculateNormals(_vertexData, tempIB, 0, numTriangles);
-	primitives::calculateTangents(_vertexData, tempIB, 0, numTriangles);
+	primitives::calculateNormalsParallel(_vertexData, tempIB, 0, numTriangles);
+	primitives::calculateTangentsParallel(_vertexData, tempIB, 0, numTriangles);
 
 	_normals.resize(hm.size());
 	_normals.setOffset(0);
@@ -5,6 +5,7 @@
  *
  */
 
+#include <et/core/profiler.h>
 #include <et/imaging/textureloader.h>
 #include <et/imaging/pngloader.h>
 #include <et/imaging/ddsloader.h>
@@ -18,6 +19,8 @@ using namespace et;
 
 TextureDescription::Pointer et::loadTextureDescription(const std::string& fileName, bool initWithZero)
 {
+	ET_PROFILE_SCOPE("loadTextureDescription");
+
 	if (!fileExists(fileName))
 		return TextureDescription::Pointer();
 
@@ -84,6 +87,8 @@ TextureDescription::Pointer et::loadTextureDescription(const std::string& fileNa
 
 TextureDescription::Pointer et::loadTexture(const std::string& fileName)
 {
+	ET_PROFILE_SCOPE("loadTexture");
+
 	if (!fileExists(fileName))
 		return TextureDescription::Pointer();
 	
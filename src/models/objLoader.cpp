@@ -7,6 +7,7 @@
 
 #include <et/app/application.h>
 #include <et/core/conversion.h>
+#include <et/core/profiler.h>
 #include <et/core/filesystem.h>
 #include <et/primitives/primitives.h>
 #include <et/models/objloader.h>
@@ -180,6 +181,8 @@ OBJLoader::~OBJLoader()
 
 void OBJLoader::loadData(bool async,  s3d::Storage& storage, ObjectsCache& cache)
 {
+	ET_PROFILE_SCOPE("OBJLoader::loadData");
+
 	ET_ASSERT(!async && "Async loading is currently disabled");
 	
 	std::string line;
@@ -396,6 +399,8 @@ void OBJLoader::loadAsync(et::RenderContext* rc, s3d::Storage& storage, ObjectsC
 
 void OBJLoader::loadMaterials(const std::string& fileName, bool async, ObjectsCache& cache)
 {
+	ET_PROFILE_SCOPE("OBJLoader::loadMaterials");
+
 	application().pushSearchPath(inputFilePath);
 	std::string filePath = application().resolveFileName(fileName);
 	
@@ -730,6 +735,8 @@ void OBJLoader::loadMaterials(const std::string& fileName, bool async, ObjectsCa
 
 void OBJLoader::processLoadedData()
 {
+	ET_PROFILE_SCOPE("OBJLoader::processLoadedData");
+
 	size_t totalTriangles = 0;
 
 	for (const auto& group : _groups)
@@ -849,14 +856,16 @@ void OBJLoader::processLoadedData()
 	}
 	
 	if (!hasNormals)
-		primitives::calculateNormals(_vertexData, _indices, 0, _indices->primitivesCount());
+		primitives::calculateNormalsParallel(_vertexData, _indices, 0, _indices->primitivesCount());
 
 	if (hasTexCoords && ((_loadOptions & Option_CalculateTangents) == Option_CalculateTangents))
-		primitives::calculateTangents(_vertexData, _indices, 0, _indices->primitivesCount() & 0xffffffff);
+		primitives::calculateTangentsParallel(_vertexData, _indices, 0, _indices->primitivesCount() & 0xffffffff);
 }
 
 s3d::ElementContainer::Pointer OBJLoader::generateVertexBuffers(s3d::Storage& storage)
 {
+	ET_PROFILE_SCOPE("OBJLoader::generateVertexBuffers");
+
 	s3d::ElementContainer::Pointer result = s3d::ElementContainer::Pointer::create(inputFileName, nullptr);
 
 	storage.flush();
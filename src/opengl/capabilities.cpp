@@ -148,6 +148,20 @@ void OpenGLCapabilities::checkCaps()
 		}
 	}
 #endif
+
+#if defined(GL_NUM_PROGRAM_BINARY_FORMATS)
+	bool supportProgramBinary = _isOpenGLES ? (_version == OpenGLVersion::Version_3x) :
+		((strToInt(_versionShortString) >= 410) || hasExtension("GL_ARB_get_program_binary"));
+	
+	if (supportProgramBinary)
+	{
+		int binaryFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+		checkOpenGLError("glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, ...");
+		if (binaryFormats > 0)
+			setFlag(OpenGLFeature_ProgramBinary);
+	}
+#endif
 	
 	log::info("[OpenGLCapabilities] Version: %s (%s), GLSL version: %s (%s)", _versionString.c_str(),
 		_versionShortString.c_str(), _glslVersionString.c_str(), _glslVersionShortString.c_str());
@@ -694,6 +694,25 @@ void et::etDrawElements(uint32_t mode, GLsizei count, uint32_t type, const GLvoi
 #endif
 }
 
+void et::etMultiDrawElements(uint32_t mode, const GLsizei* count, uint32_t type, const GLvoid* const* indices,
+	GLsizei drawCount)
+{
+#if (ET_OPENGLES)
+	for (GLsizei i = 0; i < drawCount; ++i)
+		etDrawElements(mode, count[i], type, indices[i]);
+#else
+	glMultiDrawElements(mode, count, type, indices, drawCount);
+	checkOpenGLError("glMultiDrawElements(%s, ..., %s, ..., %d)", glPrimitiveTypeToString(mode).c_str(),
+		glTypeToString(type).c_str(), drawCount);
+	
+#	if ET_ENABLE_OPENGL_COUNTERS
+	for (GLsizei i = 0; i < drawCount; ++i)
+		OpenGLCounters::primitiveCounter += primitiveCount(mode, static_cast<size_t>(count[i]));
+	++OpenGLCounters::DIPCounter;
+#	endif
+#endif
+}
+
 void et::etBindTexture(uint32_t target, uint32_t texture)
 {
 	glBindTexture(target, texture);
@@ -6,6 +6,7 @@
  */
 
 #include <et/opengl/opengl.h>
+#include <et/opengl/openglcaps.h>
 #include <et/app/application.h>
 #include <et/camera/camera.h>
 #include <et/rendering/rendercontext.h>
@@ -37,6 +38,16 @@ Program::Program(RenderContext* rc, const std::string& vertexShader, const std::
 #endif
 }
 
+Program::Program(RenderContext* rc, const std::string& objName, const std::string& origin,
+	const StringList& defines) : APIObject(objName, origin), _rc(rc), _mModelViewLocation(-1),
+	_mModelViewProjectionLocation(-1), _vCameraLocation(-1), _vPrimaryLightLocation(-1),
+	_mLightProjectionMatrixLocation(-1), _mTransformLocation(-1), _defines(defines)
+{
+#if defined(ET_CONSOLE_APPLICATION)
+	ET_FAIL("Attempt to create Program in console application");
+#endif
+}
+
 Program::~Program()
 {
 #if !defined(ET_CONSOLE_APPLICATION)
@@ -83,6 +94,32 @@ Program::Uniform Program::getUniform(const std::string& uniform) const
 	return (i == _uniforms.end()) ? Program::Uniform() : i->second;
 }
 
+Program::Uniform Program::getUniform(const InternedName& uniform) const
+{
+	ET_ASSERT(apiHandleValid());
+
+	auto i = _uniformsByName.find(uniform);
+	return (i == _uniformsByName.end()) ? Program::Uniform() : i->second;
+}
+
+bool Program::setUniformBlockBinding(const std::string& block, uint32_t bindingPoint)
+{
+	ET_ASSERT(apiHandleValid());
+
+	auto i = _uniformBlocks.find(block);
+	if (i == _uniformBlocks.end())
+		return false;
+
+#if defined(GL_UNIFORM_BUFFER)
+	glUniformBlockBinding(static_cast<GLuint>(apiHandle()), i->second.index, bindingPoint);
+	checkOpenGLError("glUniformBlockBinding(..., %u, %u) - %s", i->second.index, bindingPoint, name().c_str());
+	return true;
+#else
+	(void)bindingPoint;
+	return false;
+#endif
+}
+
 void Program::setModelViewMatrix(const mat4& m, bool forced)
 {
 	setUniform(_mModelViewLocation, GL_FLOAT_MAT4, m, forced);
@@ -160,12 +197,10 @@ void Program::printShaderLog(uint32_t shader, size_t initialSize, const char* ta
 void Program::buildProgram(const std::string& vertex_source, const std::string& geom_source,
 	const std::string& frag_source)
 {
-	_floatCache.clear();
-	_vec2Cache.clear();
-	_vec3Cache.clear();
-	_vec4Cache.clear();
-	_mat3Cache.clear();
-	_mat4Cache.clear();
+	_uniformShadows.clear();
+	_uniformShadowData.resize(0);
+	_uniformsByName.clear();
+	_uniformBlocks.clear();
 	_uniforms.clear();
 	
 #if !defined(ET_CONSOLE_APPLICATION)
@@ -289,77 +324,14 @@ void Program::buildProgram(const std::string& vertex_source, const std::string&
 
 	if (linkStatus == GL_TRUE)
 	{
-		int activeAttribs = 0;
-		int maxNameLength = 0;
-		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &activeAttribs);
-		checkOpenGLError("glGetProgramiv<GL_ACTIVE_ATTRIBUTES> - %s", name().c_str());
-
-		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxNameLength);
-		checkOpenGLError("glGetProgramiv<GL_ACTIVE_ATTRIBUTE_MAX_LENGTH> - %s", name().c_str());
-
-		for (uint32_t i = 0, e = static_cast<uint32_t>(activeAttribs); i < e; ++i)
-		{ 
-			int nameLength = 0;
-			int attribSize = 0; 
-			uint32_t attribType = 0;
-			StringDataStorage attribName(maxNameLength + 1, 0);
-
-			glGetActiveAttrib(program, i, maxNameLength, &nameLength, &attribSize, &attribType, attribName.binary());
-			checkOpenGLError("glGetActiveAttrib(..., %d, %d, ..., %s) - %s", maxNameLength, nameLength, 
-				attribName.binary(), name().c_str());
-
-			bool builtIn = false;
-			auto attrib = stringToVertexAttributeUsage(attribName.binary(), builtIn);
-
-			_attributes.emplace_back(std::string(attribName.binary()), attrib, builtIn);
-
-			if (!builtIn)
-			{
-				glBindAttribLocation(static_cast<uint32_t>(apiHandle()), static_cast<GLuint>(attrib),
-					attribName.binary());
-				checkOpenGLError("glBindAttribLocation - %s", attribName.data());
-			}
-		}
+		enumerateAttributes(true);
 
 		linkStatus = link();
 
 		_rc->renderState().bindProgram(static_cast<uint32_t>(apiHandle()), true);
 
 		if (linkStatus == GL_TRUE)
-		{
-			int activeUniforms = 0;
-			_uniforms.clear();
-			glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &activeUniforms);
-			glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
-			for (uint32_t i = 0, e = static_cast<uint32_t>(activeUniforms); i < e; i++)
-			{
-				int uSize = 0;
-				GLsizei uLenght = 0;
-				StringDataStorage uniformName(maxNameLength + 1, 0);
-				Program::Uniform P;
-				glGetActiveUniform(program, i, maxNameLength, &uLenght, &uSize, &P.type, uniformName.binary());
-				P.location = glGetUniformLocation(program, uniformName.binary());
-				_uniforms[uniformName.binary()] = P;
-
-				if (strcmp(uniformName.binary(), "mModelView") == 0)
-					_mModelViewLocation = P.location;
-
-				if (strcmp(uniformName.binary(), "mModelViewProjection") == 0)
-					_mModelViewProjectionLocation = P.location;
-
-				if (strcmp(uniformName.binary(), "vCamera") == 0)
-					_vCameraLocation = P.location;
-
-				if (strcmp(uniformName.binary(), "vPrimaryLight") == 0)
-					_vPrimaryLightLocation = P.location;
-
-				if (strcmp(uniformName.binary(), "mLightProjectionMatrix") == 0)
-					_mLightProjectionMatrixLocation = P.location;
-
-				if (strcmp(uniformName.binary(), "mTransform") == 0)
-					_mTransformLocation = P.location;
-			}
-		}
+			enumerateUniforms();
 	}
 
 	if (VertexShader != 0)
@@ -411,6 +383,14 @@ int Program::link()
 
 	const char* nameCStr = name().c_str();
 
+#	if defined(GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+	if (OpenGLCapabilities::instance().hasFeature(OpenGLFeature_ProgramBinary))
+	{
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		checkOpenGLError("glProgramParameteri(..., GL_PROGRAM_BINARY_RETRIEVABLE_HINT, ...) - %s", nameCStr);
+	}
+#	endif
+
 	glLinkProgram(program);
 	checkOpenGLError("glLinkProgram - %s", nameCStr);
 
@@ -438,6 +418,195 @@ int Program::link()
 	return result;
 }
 
+void Program::enumerateAttributes(bool bindLocations)
+{
+#if !defined(ET_CONSOLE_APPLICATION)
+	uint32_t program = static_cast<uint32_t>(apiHandle());
+	_attributes.clear();
+
+	int activeAttribs = 0;
+	int maxNameLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &activeAttribs);
+	checkOpenGLError("glGetProgramiv<GL_ACTIVE_ATTRIBUTES> - %s", name().c_str());
+
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxNameLength);
+	checkOpenGLError("glGetProgramiv<GL_ACTIVE_ATTRIBUTE_MAX_LENGTH> - %s", name().c_str());
+
+	for (uint32_t i = 0, e = static_cast<uint32_t>(activeAttribs); i < e; ++i)
+	{ 
+		int nameLength = 0;
+		int attribSize = 0; 
+		uint32_t attribType = 0;
+		StringDataStorage attribName(maxNameLength + 1, 0);
+
+		glGetActiveAttrib(program, i, maxNameLength, &nameLength, &attribSize, &attribType, attribName.binary());
+		checkOpenGLError("glGetActiveAttrib(..., %d, %d, ..., %s) - %s", maxNameLength, nameLength, 
+			attribName.binary(), name().c_str());
+
+		bool builtIn = false;
+		auto attrib = stringToVertexAttributeUsage(attribName.binary(), builtIn);
+
+		_attributes.emplace_back(std::string(attribName.binary()), attrib, builtIn);
+
+		if (bindLocations && !builtIn)
+		{
+			glBindAttribLocation(static_cast<uint32_t>(apiHandle()), static_cast<GLuint>(attrib),
+				attribName.binary());
+			checkOpenGLError("glBindAttribLocation - %s", attribName.data());
+		}
+	}
+#endif
+}
+
+void Program::enumerateUniforms()
+{
+#if !defined(ET_CONSOLE_APPLICATION)
+	uint32_t program = static_cast<uint32_t>(apiHandle());
+	int maxNameLength = 0;
+
+	int activeUniforms = 0;
+	_uniforms.clear();
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &activeUniforms);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	for (uint32_t i = 0, e = static_cast<uint32_t>(activeUniforms); i < e; i++)
+	{
+		int uSize = 0;
+		GLsizei uLenght = 0;
+		StringDataStorage uniformName(maxNameLength + 1, 0);
+		Program::Uniform P;
+		glGetActiveUniform(program, i, maxNameLength, &uLenght, &uSize, &P.type, uniformName.binary());
+		P.location = glGetUniformLocation(program, uniformName.binary());
+		_uniforms[uniformName.binary()] = P;
+
+		if (strcmp(uniformName.binary(), "mModelView") == 0)
+			_mModelViewLocation = P.location;
+
+		if (strcmp(uniformName.binary(), "mModelViewProjection") == 0)
+			_mModelViewProjectionLocation = P.location;
+
+		if (strcmp(uniformName.binary(), "vCamera") == 0)
+			_vCameraLocation = P.location;
+
+		if (strcmp(uniformName.binary(), "vPrimaryLight") == 0)
+			_vPrimaryLightLocation = P.location;
+
+		if (strcmp(uniformName.binary(), "mLightProjectionMatrix") == 0)
+			_mLightProjectionMatrixLocation = P.location;
+
+		if (strcmp(uniformName.binary(), "mTransform") == 0)
+			_mTransformLocation = P.location;
+	}
+
+#	if defined(GL_UNIFORM_BUFFER)
+	int activeBlocks = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &activeBlocks);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+	checkOpenGLError("glGetProgramiv<GL_ACTIVE_UNIFORM_BLOCKS> - %s", name().c_str());
+	for (uint32_t i = 0, e = static_cast<uint32_t>(activeBlocks); i < e; ++i)
+	{
+		GLsizei blockNameLength = 0;
+		GLint blockDataSize = 0;
+		StringDataStorage blockName(maxNameLength + 1, 0);
+		glGetActiveUniformBlockName(program, i, maxNameLength, &blockNameLength, blockName.binary());
+		glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &blockDataSize);
+		checkOpenGLError("glGetActiveUniformBlock... - %s", name().c_str());
+
+		Program::UniformBlock block;
+		block.index = i;
+		block.dataSize = static_cast<uint32_t>(blockDataSize);
+		_uniformBlocks[blockName.binary()] = block;
+	}
+#	endif
+
+	buildUniformShadows();
+
+	_binarySize = 0;
+#	if defined(GL_PROGRAM_BINARY_LENGTH)
+	if (OpenGLCapabilities::instance().hasFeature(OpenGLFeature_ProgramBinary))
+	{
+		int binaryLength = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+		checkOpenGLError("glGetProgramiv<GL_PROGRAM_BINARY_LENGTH> - %s", name().c_str());
+		_binarySize = static_cast<uint64_t>(etMax(0, binaryLength));
+	}
+#	endif
+#endif
+}
+
+bool Program::loadBinary(uint32_t format, const BinaryDataStorage& binary)
+{
+#if defined(GL_PROGRAM_BINARY_LENGTH) && !defined(ET_CONSOLE_APPLICATION)
+	_uniformShadows.clear();
+	_uniformShadowData.resize(0);
+	_uniformsByName.clear();
+	_uniformBlocks.clear();
+	_uniforms.clear();
+
+	uint32_t program = static_cast<uint32_t>(apiHandle());
+	if ((program == 0) || !glIsProgram(program))
+	{
+		program = glCreateProgram();
+		checkOpenGLError("glCreateProgram - %s", name().c_str());
+		
+		setAPIHandle(program);
+	}
+
+	glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.dataSize()));
+	checkOpenGLError("glProgramBinary(..., %u, ..., %u) - %s", format, binary.dataSize(), name().c_str());
+
+	int linkStatus = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	checkOpenGLError("glGetProgramiv<GL_LINK_STATUS> - %s", name().c_str());
+
+	if (linkStatus != GL_TRUE)
+		return false;
+
+	enumerateAttributes(false);
+
+	_rc->renderState().bindProgram(program, true);
+	enumerateUniforms();
+
+	return true;
+#else
+	(void)format;
+	(void)binary;
+	return false;
+#endif
+}
+
+bool Program::retrieveBinary(uint32_t& format, BinaryDataStorage& binary) const
+{
+#if defined(GL_PROGRAM_BINARY_LENGTH) && !defined(ET_CONSOLE_APPLICATION)
+	uint32_t program = static_cast<uint32_t>(apiHandle());
+	if (program == 0)
+		return false;
+
+	int linkStatus = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	
+	int binaryLength = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	checkOpenGLError("glGetProgramiv<GL_PROGRAM_BINARY_LENGTH> - %s", name().c_str());
+
+	if ((linkStatus != GL_TRUE) || (binaryLength <= 0))
+		return false;
+
+	GLenum binaryFormat = 0;
+	GLsizei bytesWritten = 0;
+	binary.resize(static_cast<size_t>(binaryLength));
+	glGetProgramBinary(program, binaryLength, &bytesWritten, &binaryFormat, binary.data());
+	checkOpenGLError("glGetProgramBinary - %s", name().c_str());
+
+	binary.resize(static_cast<size_t>(bytesWritten));
+	format = binaryFormat;
+	return (bytesWritten > 0);
+#else
+	(void)format;
+	(void)binary;
+	return false;
+#endif
+}
+
 bool Program::validate() const
 {
 	auto glId = static_cast<GLuint>(apiHandle());
@@ -461,13 +630,69 @@ bool Program::validate() const
 	return (result == GL_TRUE);
 }
 
+bool isSamplerUniform(uint32_t);
+size_t uniformValueSize(uint32_t);
+
+void Program::buildUniformShadows()
+{
+	int maxLocation = -1;
+	for (const auto& u : _uniforms)
+	{
+		maxLocation = etMax(maxLocation, u.second.location);
+		_uniformsByName.emplace(InternedName(u.first), u.second);
+	}
+
+	_uniformShadows.clear();
+	_uniformShadows.resize(static_cast<size_t>(maxLocation + 1));
+
+	uint32_t dataSize = 0;
+	for (const auto& u : _uniforms)
+	{
+		if (u.second.location >= 0)
+		{
+			UniformShadow& shadow = _uniformShadows[u.second.location];
+			shadow.offset = dataSize;
+			shadow.size = static_cast<uint32_t>(uniformValueSize(u.second.type));
+			dataSize += shadow.size;
+		}
+	}
+
+	_uniformShadowData.resize(dataSize);
+}
+
 /*
- * Uniform setters
+ * Compares value with the last one set to location, uniforms which could not
+ * be tracked (unknown type or array element) are always updated
  */
+bool Program::shouldUpdateUniform(int location, const void* value, size_t size, bool force)
+{
+	if (static_cast<size_t>(location) >= _uniformShadows.size())
+		return true;
 
-bool isSamplerUniform(uint32_t);
+	UniformShadow& shadow = _uniformShadows[location];
+	if (size > shadow.size)
+		return true;
+
+	uint8_t* shadowData = _uniformShadowData.element_ptr(shadow.offset);
+	if (!force && shadow.initialized && (memcmp(shadowData, value, size) == 0))
+		return false;
+
+	memcpy(shadowData, value, size);
+	shadow.initialized = true;
+	return true;
+}
+
+void Program::invalidateUniform(int location)
+{
+	if (static_cast<size_t>(location) < _uniformShadows.size())
+		_uniformShadows[location].initialized = false;
+}
+
+/*
+ * Uniform setters
+ */
 
-void Program::setUniform(int nLoc, uint32_t type, int32_t value, bool)
+void Program::setUniform(int nLoc, uint32_t type, int32_t value, bool forced)
 {
 #if !defined(ET_CONSOLE_APPLICATION)
 	if (nLoc == -1) return;
@@ -476,12 +701,16 @@ void Program::setUniform(int nLoc, uint32_t type, int32_t value, bool)
 	ET_ASSERT((type == GL_INT) || isSamplerUniform(type));
 	ET_ASSERT(apiHandleValid());
 	
-	glUniform1i(nLoc, value);
-	checkOpenGLError("glUniform1i");
+	GLint intValue = static_cast<GLint>(value);
+	if (shouldUpdateUniform(nLoc, &intValue, sizeof(intValue), forced))
+	{
+		glUniform1i(nLoc, intValue);
+		checkOpenGLError("glUniform1i");
+	}
 #endif
 }
 
-void Program::setUniform(int nLoc, uint32_t type, uint32_t value, bool)
+void Program::setUniform(int nLoc, uint32_t type, uint32_t value, bool forced)
 {
 #if !defined(ET_CONSOLE_APPLICATION)
 	if (nLoc == -1) return;
@@ -490,12 +719,16 @@ void Program::setUniform(int nLoc, uint32_t type, uint32_t value, bool)
 	ET_ASSERT((type == GL_INT) || isSamplerUniform(type));
 	ET_ASSERT(apiHandleValid());
 	
-	glUniform1i(nLoc, static_cast<GLint>(value));
-	checkOpenGLError("glUniform1i");
+	GLint intValue = static_cast<GLint>(value);
+	if (shouldUpdateUniform(nLoc, &intValue, sizeof(intValue), forced))
+	{
+		glUniform1i(nLoc, intValue);
+		checkOpenGLError("glUniform1i");
+	}
 #endif
 }
 
-void Program::setUniform(int nLoc, uint32_t type, int64_t value, bool)
+void Program::setUniform(int nLoc, uint32_t type, int64_t value, bool forced)
 {
 #if !defined(ET_CONSOLE_APPLICATION)
 	if (nLoc == -1) return;
@@ -504,12 +737,16 @@ void Program::setUniform(int nLoc, uint32_t type, int64_t value, bool)
 	ET_ASSERT((type == GL_INT) || isSamplerUniform(type));
 	ET_ASSERT(apiHandleValid());
 	
-	glUniform1i(nLoc, static_cast<GLint>(value));
-	checkOpenGLError("glUniform1i");
+	GLint intValue = static_cast<GLint>(value);
+	if (shouldUpdateUniform(nLoc, &intValue, sizeof(intValue), forced))
+	{
+		glUniform1i(nLoc, intValue);
+		checkOpenGLError("glUniform1i");
+	}
 #endif
 }
 
-void Program::setUniform(int nLoc, uint32_t type, uint64_t value, bool)
+void Program::setUniform(int nLoc, uint32_t type, uint64_t value, bool forced)
 {
 #if !defined(ET_CONSOLE_APPLICATION)
 	if (nLoc == -1) return;
@@ -518,12 +755,16 @@ void Program::setUniform(int nLoc, uint32_t type, uint64_t value, bool)
 	ET_ASSERT((type == GL_INT) || isSamplerUniform(type));
 	ET_ASSERT(apiHandleValid());
 
-	glUniform1i(nLoc, static_cast<GLint>(value));
-	checkOpenGLError("glUniform1i");
+	GLint intValue = static_cast<GLint>(value);
+	if (shouldUpdateUniform(nLoc, &intValue, sizeof(intValue), forced))
+	{
+		glUniform1i(nLoc, intValue);
+		checkOpenGLError("glUniform1i");
+	}
 #endif
 }
 
-void Program::setUniform(int nLoc, uint32_t type, const unsigned long value, bool)
+void Program::setUniform(int nLoc, uint32_t type, const unsigned long value, bool forced)
 {
 #if !defined(ET_CONSOLE_APPLICATION)
 	if (nLoc == -1) return;
@@ -532,8 +773,12 @@ void Program::setUniform(int nLoc, uint32_t type, const unsigned long value, boo
 	ET_ASSERT((type == GL_INT) || isSamplerUniform(type));
 	ET_ASSERT(apiHandleValid());
 	
-	glUniform1i(nLoc, static_cast<GLint>(value));
-	checkOpenGLError("glUniform1i");
+	GLint intValue = static_cast<GLint>(value);
+	if (shouldUpdateUniform(nLoc, &intValue, sizeof(intValue), forced))
+	{
+		glUniform1i(nLoc, intValue);
+		checkOpenGLError("glUniform1i");
+	}
 #endif
 }
 
@@ -546,9 +791,8 @@ void Program::setUniform(int nLoc, uint32_t type, const float value, bool forced
 	ET_ASSERT(type == GL_FLOAT);
 	ET_ASSERT(apiHandleValid());
 	
-	if (forced || ((_floatCache.count(nLoc) == 0) || (_floatCache[nLoc] != value)))
+	if (shouldUpdateUniform(nLoc, &value, sizeof(value), forced))
 	{
-		_floatCache[nLoc] = value;
 		glUniform1f(nLoc, value);
 		checkOpenGLError("glUniform1f");
 	}
@@ -564,9 +808,8 @@ void Program::setUniform(int nLoc, uint32_t type, const vec2& value, bool forced
 	ET_ASSERT(type == GL_FLOAT_VEC2);
 	ET_ASSERT(apiHandleValid());
 	
-	if (forced || ((_vec2Cache.count(nLoc) == 0) || (_vec2Cache[nLoc] != value)))
+	if (shouldUpdateUniform(nLoc, &value, sizeof(value), forced))
 	{
-		_vec2Cache[nLoc] = value;
 		glUniform2fv(nLoc, 1, value.data());
 		checkOpenGLError("glUniform2fv");
 	}
@@ -583,9 +826,8 @@ void Program::setUniform(int nLoc, uint32_t type, const vec3& value, bool forced
 	ET_ASSERT(type == GL_FLOAT_VEC3);
 	ET_ASSERT(apiHandleValid());
 	
-	if (forced || ((_vec3Cache.count(nLoc) == 0) || (_vec3Cache[nLoc] != value)))
+	if (shouldUpdateUniform(nLoc, &value, sizeof(value), forced))
 	{
-		_vec3Cache[nLoc] = value;
 		glUniform3fv(nLoc, 1, value.data());
 		checkOpenGLError("glUniform3fv");
 	}
@@ -602,9 +844,8 @@ void Program::setUniform(int nLoc, uint32_t type, const vec4& value, bool forced
 	ET_ASSERT(type == GL_FLOAT_VEC4);
 	ET_ASSERT(apiHandleValid());
 	
-	if (forced || ((_vec4Cache.count(nLoc) == 0) || (_vec4Cache[nLoc] != value)))
+	if (shouldUpdateUniform(nLoc, &value, sizeof(value), forced))
 	{
-		_vec4Cache[nLoc] = value;
 		glUniform4fv(nLoc, 1, value.data());
 		checkOpenGLError("glUniform4fv");
 	}
@@ -621,9 +862,8 @@ void Program::setUniform(int nLoc, uint32_t type, const vec2i& value, bool force
 	ET_ASSERT(type == GL_INT_VEC2);
 	ET_ASSERT(apiHandleValid());
 
-	if (forced || ((_vec2iCache.count(nLoc) == 0) || (_vec2iCache[nLoc] != value)))
+	if (shouldUpdateUniform(nLoc, &value, sizeof(value), forced))
 	{
-		_vec2iCache[nLoc] = value;
 		glUniform2iv(nLoc, 1, value.data());
 		checkOpenGLError("glUniform2iv");
 	}
@@ -640,9 +880,8 @@ void Program::setUniform(int nLoc, uint32_t type, const vec3i& value, bool force
 	ET_ASSERT(type == GL_INT_VEC3);
 	ET_ASSERT(apiHandleValid());
 
-	if (forced || ((_vec3iCache.count(nLoc) == 0) || (_vec3iCache[nLoc] != value)))
+	if (shouldUpdateUniform(nLoc, &value, sizeof(value), forced))
 	{
-		_vec3iCache[nLoc] = value;
 		glUniform3iv(nLoc, 1, value.data());
 		checkOpenGLError("glUniform3iv");
 	}
@@ -659,9 +898,8 @@ void Program::setUniform(int nLoc, uint32_t type, const vec4i& value, bool force
 	ET_ASSERT(type == GL_INT_VEC4);
 	ET_ASSERT(apiHandleValid());
 
-	if (forced || ((_vec4iCache.count(nLoc) == 0) || (_vec4iCache[nLoc] != value)))
+	if (shouldUpdateUniform(nLoc, &value, sizeof(value), forced))
 	{
-		_vec4iCache[nLoc] = value;
 		glUniform4iv(nLoc, 1, value.data());
 		checkOpenGLError("glUniform4iv");
 	}
@@ -678,6 +916,7 @@ void Program::setUniformDirectly(int nLoc, uint32_t type, const vec4& value)
 	ET_ASSERT(type == GL_FLOAT_VEC4);
 	ET_ASSERT(apiHandleValid());
 	
+	invalidateUniform(nLoc);
 	glUniform4fv(nLoc, 1, value.data());
 	checkOpenGLError("glUniform4fv");
 #endif
@@ -692,9 +931,8 @@ void Program::setUniform(int nLoc, uint32_t type, const mat3& value, bool forced
 	ET_ASSERT(type == GL_FLOAT_MAT3);
 	ET_ASSERT(apiHandleValid());
 	
-	if (forced || ((_mat3Cache.count(nLoc) == 0) || (_mat3Cache[nLoc] != value)))
+	if (shouldUpdateUniform(nLoc, &value, sizeof(value), forced))
 	{
-		_mat3Cache[nLoc] = value;
 		glUniformMatrix3fv(nLoc, 1, 0, value.data());
 		checkOpenGLError("glUniformMatrix3fv");
 	}
@@ -711,9 +949,8 @@ void Program::setUniform(int nLoc, uint32_t type, const mat4& value, bool forced
 	ET_ASSERT(type == GL_FLOAT_MAT4);
 	ET_ASSERT(apiHandleValid());
 	
-	if (forced || ((_mat4Cache.count(nLoc) == 0) || (_mat4Cache[nLoc] != value)))
+	if (shouldUpdateUniform(nLoc, &value, sizeof(value), forced))
 	{
-		_mat4Cache[nLoc] = value;
 		glUniformMatrix4fv(nLoc, 1, 0, value.data());
 		checkOpenGLError("glUniformMatrix4fv");
 	}
@@ -730,6 +967,7 @@ void Program::setUniformDirectly(int nLoc, uint32_t type, const mat4& value)
 	ET_ASSERT(type == GL_FLOAT_MAT4);
 	ET_ASSERT(apiHandleValid());
 	
+	invalidateUniform(nLoc);
 	glUniformMatrix4fv(nLoc, 1, 0, value.data());
 	checkOpenGLError("glUniformMatrix4fv");
 #endif
@@ -744,6 +982,7 @@ void Program::setUniform(int nLoc, uint32_t type, const int* value, size_t amoun
 	ET_ASSERT(type == GL_INT);
 	ET_ASSERT(apiHandleValid());
 
+	invalidateUniform(nLoc);
 	glUniform1iv(nLoc, static_cast<GLsizei>(amount), value);
 	checkOpenGLError("glUniform1iv");
 #endif
@@ -758,6 +997,7 @@ void Program::setUniform(int nLoc, uint32_t type, const float* value, size_t amo
 	ET_ASSERT(type == GL_FLOAT);
 	ET_ASSERT(apiHandleValid());
 
+	invalidateUniform(nLoc);
 	glUniform1fv(nLoc, static_cast<GLsizei>(amount), value);
 	checkOpenGLError("glUniform1fv");
 #endif
@@ -772,6 +1012,7 @@ void Program::setUniform(int nLoc, uint32_t type, const vec2* value, size_t amou
 	ET_ASSERT(type == GL_FLOAT_VEC2);
 	ET_ASSERT(apiHandleValid());
 	
+	invalidateUniform(nLoc);
 	glUniform2fv(nLoc, static_cast<GLsizei>(amount), value->data());
 	checkOpenGLError("glUniform2fv");
 #endif
@@ -786,6 +1027,7 @@ void Program::setUniform(int nLoc, uint32_t type, const vec3* value, size_t amou
 	ET_ASSERT(type == GL_FLOAT_VEC3);
 	ET_ASSERT(apiHandleValid());
 	
+	invalidateUniform(nLoc);
 	glUniform3fv(nLoc, static_cast<GLsizei>(amount), value->data());
 	checkOpenGLError("glUniform3fv");
 #endif
@@ -800,6 +1042,7 @@ void Program::setUniform(int nLoc, uint32_t type, const vec4* value, size_t amou
 	ET_ASSERT(type == GL_FLOAT_VEC4);
 	ET_ASSERT(apiHandleValid());
 	
+	invalidateUniform(nLoc);
 	glUniform4fv(nLoc, static_cast<GLsizei>(amount), value->data());
 	checkOpenGLError("glUniform4fv");
 #endif
@@ -814,6 +1057,7 @@ void Program::setUniform(int nLoc, uint32_t type, const mat4* value, size_t amou
 	ET_ASSERT(type == GL_FLOAT_MAT4);
 	ET_ASSERT(apiHandleValid());
 	
+	invalidateUniform(nLoc);
 	glUniformMatrix4fv(nLoc, static_cast<GLsizei>(amount), 0, value->data());
 	checkOpenGLError("glUniformMatrix4fv");
 #endif
@@ -822,6 +1066,37 @@ void Program::setUniform(int nLoc, uint32_t type, const mat4* value, size_t amou
 /*
  * Service stuff
  */
+size_t uniformValueSize(uint32_t type)
+{
+	switch (type)
+	{
+		case GL_FLOAT:
+		case GL_INT:
+			return sizeof(float);
+			
+		case GL_FLOAT_VEC2:
+		case GL_INT_VEC2:
+			return 2 * sizeof(float);
+			
+		case GL_FLOAT_VEC3:
+		case GL_INT_VEC3:
+			return 3 * sizeof(float);
+			
+		case GL_FLOAT_VEC4:
+		case GL_INT_VEC4:
+			return 4 * sizeof(float);
+			
+		case GL_FLOAT_MAT3:
+			return 9 * sizeof(float);
+			
+		case GL_FLOAT_MAT4:
+			return 16 * sizeof(float);
+			
+		default:
+			return isSamplerUniform(type) ? sizeof(GLint) : 0;
+	}
+}
+
 bool isSamplerUniform(uint32_t value)
 {
 	return (value == GL_SAMPLER_2D) || (value == GL_SAMPLER_CUBE) || (value == GL_SAMPLER_2D_SHADOW) ||
@@ -5,14 +5,46 @@
  *
  */
 
+#include <fstream>
 #include <et/app/application.h>
 #include <et/opengl/opengl.h>
 #include <et/opengl/openglcaps.h>
 #include <et/rendering/rendercontext.h>
 #include <et/rendering/programfactory.h>
+#include <et/threading/criticalsection.h>
 
 using namespace et;
 
+namespace
+{
+	enum : uint32_t
+	{
+		ProgramBinaryMagic = ET_COMPOSE_UINT32('E', 'T', 'P', 'B'),
+		MaxIncludeDepth = 32,
+	};
+	
+	struct ProgramBinaryHeader
+	{
+		uint32_t magic = ProgramBinaryMagic;
+		uint32_t format = 0;
+		uint64_t hash = 0;
+		uint64_t dataSize = 0;
+	};
+	
+	uint64_t combineHash(uint64_t hash, const std::string& value)
+	{
+		for (char c : value)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 0x100000001b3ull;
+		}
+		
+		hash ^= value.size();
+		hash *= 0x100000001b3ull;
+		return hash;
+	}
+}
+
 class et::ProgramFactoryPrivate 
 {
 public:
@@ -28,9 +60,33 @@ public:
 	};
 
 	IntrusivePtr<Loader> loader;
+	
+	/*
+	 * Contents of included files, shared by all programs;
+	 * accessed from preprocessing threads
+	 */
+	std::unordered_map<std::string, std::string> includes;
+	CriticalSection includesLock;
+	
+	std::string binaryCacheFolder;
+	std::vector<uint32_t> binaryFormats;
+	uint64_t driverHash = 0;
+	bool binaryCacheEnabled = false;
 
 	ProgramFactoryPrivate(ProgramFactory* owner) : 
 		loader(etCreateObject<Loader>(owner)) { }
+	
+	const std::string* includeSource(const std::string& fileName);
+	
+	void expandIncludes(std::string& output, const std::string& source,
+		const std::string& workFolder, uint32_t depth);
+	
+	std::string binaryFileName(uint64_t hash);
+	uint64_t programHash(const std::string& vs, const std::string& gs,
+		const std::string& fs, const StringList& defines);
+	
+	bool loadProgramBinary(Program*, uint64_t hash);
+	void saveProgramBinary(Program*, uint64_t hash);
 };
 
 StringList parseDefinesString(std::string defines, std::string separators = ",; \t");
@@ -85,6 +141,35 @@ ProgramFactory::ProgramFactory(RenderContext* rc) : APIObjectFactory(rc)
 		_vertShaderHeader = openGl3VertexHeader;
 		_fragShaderHeader = openGl3FragmentHeader;
 	}
+	
+#if defined(GL_PROGRAM_BINARY_FORMATS)
+	if (OpenGLCapabilities::instance().hasFeature(OpenGLFeature_ProgramBinary))
+	{
+		int binaryFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+		checkOpenGLError("glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, ...)");
+		
+		if (binaryFormats > 0)
+		{
+			DataStorage<GLint> formats(static_cast<size_t>(binaryFormats), 0);
+			glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+			checkOpenGLError("glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, ...)");
+			
+			for (GLint f : formats)
+				_private->binaryFormats.push_back(static_cast<uint32_t>(f));
+		}
+	}
+#endif
+	
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+	for (GLenum s : driverStrings)
+	{
+		const char* value = reinterpret_cast<const char*>(glGetString(s));
+		_private->driverHash = combineHash(_private->driverHash, (value == nullptr) ? emptyString : value);
+	}
+	checkOpenGLError("glGetString(...)");
+	
+	_private->binaryCacheEnabled = !_private->binaryFormats.empty();
 }
 
 ProgramFactory::~ProgramFactory()
@@ -92,19 +177,16 @@ ProgramFactory::~ProgramFactory()
 	ET_PIMPL_FINALIZE(ProgramFactory)
 }
 
-StringList ProgramFactory::loadProgramSources(const std::string& file, std::string& vertex_shader,
-	std::string& geom_shader, std::string& frag_shader, const StringList& defines)
+bool ProgramFactory::resolveProgramSources(const std::string& file, ProgramSourceFiles& files)
 {
-	StringList sources;
-	
 	std::string filename = application().resolveFileName(file);
 	if (!fileExists(filename))
 	{
 		log::error("Unable to find file: %s", file.c_str());
-		return sources;
+		return false;
 	}
 	
-	StringList resultDefines = defines;
+	StringList resultDefines;
 	std::string vertex_source;
 	std::string geometry_source;
 	std::string fragment_source;
@@ -141,56 +223,65 @@ StringList ProgramFactory::loadProgramSources(const std::string& file, std::stri
 	normalizeFilePath(trim(fragment_source));
 	
 	std::string programFolder = getFilePath(filename);
-	std::string fName = programFolder + vertex_source;
 	
-	if (!fileExists(fName))
-		fName = application().resolveFileName(fName);
-	
-	if (!fileExists(fName))
-		fName = application().resolveFileName(vertex_source);
-	
-	if (fileExists(fName))
+	auto resolveSource = [&programFolder](const std::string& source) -> std::string
 	{
-		sources.push_back(fName);
-		vertex_shader = loadTextFile(fName);
-		ET_ASSERT((vertex_shader.size() > 1) && "Vertex shader source should not be empty");
-	}
-	
-	if (!geometry_source.empty())
-	{
-		fName = programFolder + geometry_source;
+		std::string fName = programFolder + source;
+		
 		if (!fileExists(fName))
 			fName = application().resolveFileName(fName);
 		
 		if (!fileExists(fName))
-			fName = application().resolveFileName(geometry_source);
+			fName = application().resolveFileName(source);
 		
-		if (fileExists(fName))
-		{
-			geom_shader = loadTextFile(fName);
-			sources.push_back(fName);
-		}
-	}
+		return fName;
+	};
 	
-	fName = programFolder + fragment_source;
+	files.vertex = resolveSource(vertex_source);
+	files.geometry = geometry_source.empty() ? emptyString : resolveSource(geometry_source);
+	files.fragment = resolveSource(fragment_source);
+	return true;
+}
+
+StringList ProgramFactory::loadProgramSources(const ProgramSourceFiles& files, std::string& vertex_shader,
+	std::string& geom_shader, std::string& frag_shader)
+{
+	StringList sources;
 	
-	if (!fileExists(fName))
-		fName = application().resolveFileName(fName);
+	if (fileExists(files.vertex))
+	{
+		sources.push_back(files.vertex);
+		vertex_shader = loadTextFile(files.vertex);
+		ET_ASSERT((vertex_shader.size() > 1) && "Vertex shader source should not be empty");
+	}
 	
-	if (!fileExists(fName))
-		fName = application().resolveFileName(fragment_source);
+	if (!files.geometry.empty() && fileExists(files.geometry))
+	{
+		geom_shader = loadTextFile(files.geometry);
+		sources.push_back(files.geometry);
+	}
 	
-	if (fileExists(fName))
+	if (fileExists(files.fragment))
 	{
-		sources.push_back(fName);
-		frag_shader = loadTextFile(fName);
+		sources.push_back(files.fragment);
+		frag_shader = loadTextFile(files.fragment);
 		ET_ASSERT((frag_shader.size() > 1) && "Fragment shader source should not be empty");
 	}
 	
 	return sources;
 }
 
-Program::Pointer ProgramFactory::loadProgram(const std::string& file, ObjectsCache& cache,
+StringList ProgramFactory::loadProgramSources(const std::string& file, std::string& vertex_shader,
+	std::string& geom_shader, std::string& frag_shader, const StringList&)
+{
+	ProgramSourceFiles files;
+	if (!resolveProgramSources(file, files))
+		return StringList();
+	
+	return loadProgramSources(files, vertex_shader, geom_shader, frag_shader);
+}
+
+Program::Pointer ProgramFactory::findCachedProgram(const std::string& file, ObjectsCache& cache,
 	const StringList& defines)
 {
 	auto cachedPrograms = cache.findObjects(file);
@@ -221,23 +312,47 @@ Program::Pointer ProgramFactory::loadProgram(const std::string& file, ObjectsCac
 		}
 	}
 	
-	std::string vertex_shader;
-	std::string geom_shader;
-	std::string frag_shader;
+	return Program::Pointer();
+}
 
-	StringList sourceFiles = loadProgramSources(file, vertex_shader, geom_shader, frag_shader);
+bool ProgramFactory::preprocessProgram(const std::string& file, const ProgramSourceFiles& files,
+	const StringList& defines, std::string& vertex_shader, std::string& geom_shader, std::string& frag_shader,
+	StringList& sourceFiles)
+{
+	sourceFiles = loadProgramSources(files, vertex_shader, geom_shader, frag_shader);
 	
 	if (sourceFiles.empty())
-		return Program::Pointer::create(renderContext());
+		return false;
 	
 	std::string workFolder = getFilePath(file);
 	
 	parseSourceCode(ShaderType_Vertex, vertex_shader, defines, workFolder);
 	parseSourceCode(ShaderType_Geometry, geom_shader, defines, workFolder);
 	parseSourceCode(ShaderType_Fragment, frag_shader, defines, workFolder);
+	return true;
+}
+
+Program::Pointer ProgramFactory::loadProgram(const std::string& file, ObjectsCache& cache,
+	const StringList& defines)
+{
+	Program::Pointer cached = findCachedProgram(file, cache, defines);
+	if (cached.valid())
+		return cached;
 	
-	Program::Pointer program = Program::Pointer::create(renderContext(), vertex_shader, geom_shader,
-		frag_shader, getFileName(file), file, defines);
+	std::string vertex_shader;
+	std::string geom_shader;
+	std::string frag_shader;
+	StringList sourceFiles;
+	ProgramSourceFiles files;
+	
+	if (!resolveProgramSources(file, files) ||
+		!preprocessProgram(file, files, defines, vertex_shader, geom_shader, frag_shader, sourceFiles))
+	{
+		return Program::Pointer::create(renderContext());
+	}
+	
+	Program::Pointer program = createProgram(vertex_shader, geom_shader, frag_shader,
+		getFileName(file), file, defines);
 	
 	for (auto& s : sourceFiles)
 		program->addOrigin(s);
@@ -246,6 +361,83 @@ Program::Pointer ProgramFactory::loadProgram(const std::string& file, ObjectsCac
 	return program;
 }
 
+std::vector<Program::Pointer> ProgramFactory::loadPrograms(const std::vector<ProgramRequest>& requests,
+	ObjectsCache& cache)
+{
+	struct PreprocessedProgram
+	{
+		std::string file;
+		ProgramSourceFiles files;
+		std::string vertexShader;
+		std::string geometryShader;
+		std::string fragmentShader;
+		StringList sourceFiles;
+		bool resolved = false;
+		bool loaded = false;
+	};
+	
+	std::vector<Program::Pointer> result(requests.size());
+	std::vector<PreprocessedProgram> programs(requests.size());
+	
+	/*
+	 * Path resolvers are not thread-safe, so all file names are resolved here
+	 */
+	for (size_t i = 0, e = requests.size(); i < e; ++i)
+	{
+		PreprocessedProgram& p = programs[i];
+		p.file = application().resolveFileName(requests[i].file);
+		result[i] = findCachedProgram(p.file, cache, requests[i].defines);
+		
+		if (result[i].invalid())
+			p.resolved = resolveProgramSources(p.file, p.files);
+	}
+	
+	threading::parallelFor(requests.size(), 1, [this, &requests, &programs, &result](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			PreprocessedProgram& p = programs[i];
+			if (result[i].invalid() && p.resolved)
+			{
+				p.loaded = preprocessProgram(p.file, p.files, requests[i].defines, p.vertexShader,
+					p.geometryShader, p.fragmentShader, p.sourceFiles);
+			}
+		}
+	});
+	
+	for (size_t i = 0, e = requests.size(); i < e; ++i)
+	{
+		if (result[i].valid())
+			continue;
+		
+		const PreprocessedProgram& p = programs[i];
+		
+		/*
+		 * The same program could be requested more than once
+		 */
+		result[i] = findCachedProgram(p.file, cache, requests[i].defines);
+		if (result[i].valid())
+			continue;
+		
+		if (p.loaded)
+		{
+			result[i] = createProgram(p.vertexShader, p.geometryShader, p.fragmentShader,
+				getFileName(p.file), p.file, requests[i].defines);
+			
+			for (auto& s : p.sourceFiles)
+				result[i]->addOrigin(s);
+			
+			cache.manage(result[i], _private->loader);
+		}
+		else
+		{
+			result[i] = Program::Pointer::create(renderContext());
+		}
+	}
+	
+	return result;
+}
+
 Program::Pointer ProgramFactory::loadProgram(const std::string& file, ObjectsCache& cache, const std::string& defines)
 {
 	return loadProgram(application().resolveFileName(file), cache, parseDefinesString(defines));
@@ -263,7 +455,7 @@ Program::Pointer ProgramFactory::genProgram(const std::string& name, const std::
 	parseSourceCode(ShaderType_Geometry, gs, defines, workFolder);
 	parseSourceCode(ShaderType_Fragment, fs, defines, workFolder);
 	
-	return Program::Pointer::create(renderContext(), vs, gs, fs, name, name, defines);
+	return createProgram(vs, gs, fs, name, name, defines);
 }
 
 Program ::Pointer ProgramFactory::genProgram(const std::string& name, const std::string& vertexshader,
@@ -275,13 +467,41 @@ Program ::Pointer ProgramFactory::genProgram(const std::string& name, const std:
 	parseSourceCode(ShaderType_Vertex, vs, defines, workFolder);
 	parseSourceCode(ShaderType_Fragment, fs, defines, workFolder);
 	
-	return Program::Pointer::create(renderContext(), vs, emptyString, fs, name, name, defines);
+	return createProgram(vs, emptyString, fs, name, name, defines);
 }
 
 Program::Pointer ProgramFactory::genProgramAsIs(const std::string& name, const std::string& vs, const std::string& fs,
 	const StringList& defines, const std::string&)
 {
-	return Program::Pointer::create(renderContext(), vs, emptyString, fs, name, name, defines);
+	return createProgram(vs, emptyString, fs, name, name, defines);
+}
+
+Program::Pointer ProgramFactory::createProgram(const std::string& vs, const std::string& gs, const std::string& fs,
+	const std::string& name, const std::string& origin, const StringList& defines)
+{
+	if (!_private->binaryCacheEnabled)
+		return Program::Pointer::create(renderContext(), vs, gs, fs, name, origin, defines);
+	
+	uint64_t hash = _private->programHash(vs, gs, fs, defines);
+	
+	Program::Pointer program = Program::Pointer::create(renderContext(), name, origin, defines);
+	if (!_private->loadProgramBinary(program.ptr(), hash))
+	{
+		program->buildProgram(vs, gs, fs);
+		_private->saveProgramBinary(program.ptr(), hash);
+	}
+	
+	return program;
+}
+
+void ProgramFactory::setBinaryCacheFolder(const std::string& folder)
+{
+	_private->binaryCacheFolder = addTrailingSlash(folder);
+}
+
+void ProgramFactory::setBinaryCacheEnabled(bool enabled)
+{
+	_private->binaryCacheEnabled = enabled && !_private->binaryFormats.empty();
 }
 
 void ProgramFactory::parseSourceCode(ShaderType type, std::string& source, const StringList& defines,
@@ -299,73 +519,178 @@ void ProgramFactory::parseSourceCode(ShaderType type, std::string& source, const
 	for (const auto i : defines)
 		header += "\n" + i;
 	
-	source = header + "\n" + source;
+	std::string result = header + "\n";
+	result.reserve(result.size() + source.size());
+	
+	_private->expandIncludes(result, source, workFolder, 0);
+	source.swap(result);
+}
 
-	std::string::size_type ip = source.find("#include");
+void ProgramFactory::reloadObject(LoadableObject::Pointer obj, ObjectsCache&)
+{
+	std::string vertex_shader;
+	std::string geom_shader;
+	std::string frag_shader;
+	
+	/*
+	 * Included files could be changed as well
+	 */
+	{
+		CriticalSectionScope lock(_private->includesLock);
+		_private->includes.clear();
+	}
+	
+	StringList sourceFiles = loadProgramSources(obj->origin(), vertex_shader, geom_shader, frag_shader);
+	if (sourceFiles.empty()) return;
+	
+	// TODO: handle defines
+	std::string workFolder = getFilePath(obj->origin());
+	parseSourceCode(ShaderType_Vertex, vertex_shader, StringList(), workFolder);
+	parseSourceCode(ShaderType_Geometry, geom_shader, StringList(), workFolder);
+	parseSourceCode(ShaderType_Fragment, frag_shader, StringList(), workFolder);
+	
+	Program::Pointer(obj)->buildProgram(vertex_shader, geom_shader, frag_shader);
+}
 
-	bool hasIncludes = ip != std::string::npos;
-	while (hasIncludes)
+/*
+ * ProgramFactoryPrivate
+ */
+const std::string* ProgramFactoryPrivate::includeSource(const std::string& fileName)
+{
 	{
-		while (ip != std::string::npos)
+		CriticalSectionScope lock(includesLock);
+		auto i = includes.find(fileName);
+		if (i != includes.end())
+			return &i->second;
+	}
+	
+	if (!fileExists(fileName))
+		return nullptr;
+	
+	std::string source = loadTextFile(fileName);
+	
+	CriticalSectionScope lock(includesLock);
+	return &includes.emplace(fileName, std::move(source)).first->second;
+}
+
+void ProgramFactoryPrivate::expandIncludes(std::string& output, const std::string& source,
+	const std::string& workFolder, uint32_t depth)
+{
+	std::string::size_type position = 0;
+	std::string::size_type ip = source.find("#include");
+	
+	while (ip != std::string::npos)
+	{
+		output.append(source, position, ip - position);
+		
+		std::string::size_type lineEnd = source.find_first_of(char(10), ip);
+		position = (lineEnd == std::string::npos) ? source.size() : lineEnd;
+		
+		std::string ifname = source.substr(ip, position - ip);
+		std::string::size_type nameBegin = ifname.find_first_of("\"<");
+		std::string::size_type nameEnd = ifname.find_last_of("\">");
+		
+		if ((nameBegin == std::string::npos) || (nameEnd <= nameBegin))
 		{
-			std::string before = source.substr(0, ip);
-			
-			source.erase(0, before.size());
-			std::string ifname = source.substr(0, source.find_first_of(char(10)));
-			source.erase(0, ifname.size());
-			std::string after = source.substr();
-			
-			if (ifname.find_first_of('"') != std::string::npos)
-			{
-				ifname.erase(0, ifname.find_first_of('"') + 1);
-				ifname.erase(ifname.find_last_of('"'));
-			}
-			else 
-			{
-				ifname.erase(0, ifname.find_first_of('<') + 1);
-				ifname.erase(ifname.find_last_of('>'));
-			}
-			
-			std::string include = "";
+			log::error("invalid include directive: %s", ifname.c_str());
+		}
+		else
+		{
+			ifname = ifname.substr(nameBegin + 1, nameEnd - nameBegin - 1);
 			
 			std::string baseName = removeUpDir(workFolder + ifname);
 			while (baseName.find("..") != std::string::npos)
 				baseName = removeUpDir(baseName);
 			
-			if (fileExists(baseName))
-			{
-				include = loadTextFile(baseName);
-			}
-			else
-			{
-				log::error("failed to include %s, starting from folder %s", ifname.c_str(), workFolder.c_str());
-			}
+			const std::string* include = includeSource(baseName);
 			
-			source = before + include + after;
-			ip = source.find("#include");
+			if (include == nullptr)
+				log::error("failed to include %s, starting from folder %s", ifname.c_str(), workFolder.c_str());
+			else if (depth >= MaxIncludeDepth)
+				log::error("failed to include %s, too many nested includes", ifname.c_str());
+			else
+				expandIncludes(output, *include, workFolder, depth + 1);
 		}
 		
-		hasIncludes = ip != std::string::npos;
+		ip = source.find("#include", position);
 	}
+	
+	output.append(source, position, std::string::npos);
 }
 
+uint64_t ProgramFactoryPrivate::programHash(const std::string& vs, const std::string& gs,
+	const std::string& fs, const StringList& defines)
+{
+	uint64_t result = combineHash(driverHash, vs);
+	result = combineHash(result, gs);
+	result = combineHash(result, fs);
+	
+	for (const auto& d : defines)
+		result = combineHash(result, d);
+	
+	return result;
+}
 
-void ProgramFactory::reloadObject(LoadableObject::Pointer obj, ObjectsCache&)
+std::string ProgramFactoryPrivate::binaryFileName(uint64_t hash)
 {
-	std::string vertex_shader;
-	std::string geom_shader;
-	std::string frag_shader;
+	if (binaryCacheFolder.empty())
+		binaryCacheFolder = addTrailingSlash(application().environment().applicationDocumentsFolder() + "programcache");
 	
-	StringList sourceFiles = loadProgramSources(obj->origin(), vertex_shader, geom_shader, frag_shader);
-	if (sourceFiles.empty()) return;
+	char hashString[32] = { };
+	snprintf(hashString, sizeof(hashString), "%016llx", static_cast<unsigned long long>(hash));
+	return binaryCacheFolder + hashString + ".bin";
+}
+
+bool ProgramFactoryPrivate::loadProgramBinary(Program* program, uint64_t hash)
+{
+	std::string fileName = binaryFileName(hash);
+	if (!fileExists(fileName))
+		return false;
 	
-	// TODO: handle defines
-	std::string workFolder = getFilePath(obj->origin());
-	parseSourceCode(ShaderType_Vertex, vertex_shader, StringList(), workFolder);
-	parseSourceCode(ShaderType_Geometry, geom_shader, StringList(), workFolder);
-	parseSourceCode(ShaderType_Fragment, frag_shader, StringList(), workFolder);
+	ProgramBinaryHeader header;
+	std::ifstream fIn(fileName, std::ios::in | std::ios::binary);
+	fIn.read(reinterpret_cast<char*>(&header), sizeof(header));
 	
-	Program::Pointer(obj)->buildProgram(vertex_shader, geom_shader, frag_shader);
+	bool validHeader = !fIn.fail() && (header.magic == ProgramBinaryMagic) && (header.hash == hash) &&
+		(header.dataSize > 0) && (std::find(binaryFormats.begin(), binaryFormats.end(), header.format) != binaryFormats.end());
+	
+	BinaryDataStorage binary;
+	if (validHeader)
+	{
+		binary.resize(static_cast<size_t>(header.dataSize));
+		fIn.read(binary.binary(), static_cast<std::streamsize>(binary.dataSize()));
+	}
+	fIn.close();
+	
+	if (validHeader && !fIn.fail() && program->loadBinary(header.format, binary))
+		return true;
+	
+	log::warning("Program binary %s for %s is outdated and will be rebuilt", fileName.c_str(), program->name().c_str());
+	removeFile(fileName);
+	return false;
+}
+
+void ProgramFactoryPrivate::saveProgramBinary(Program* program, uint64_t hash)
+{
+	ProgramBinaryHeader header;
+	header.hash = hash;
+	
+	BinaryDataStorage binary;
+	if (!program->retrieveBinary(header.format, binary))
+		return;
+	
+	header.dataSize = binary.dataSize();
+	
+	std::string fileName = binaryFileName(hash);
+	if (!folderExists(binaryCacheFolder))
+		createDirectory(binaryCacheFolder, true);
+	
+	std::ofstream fOut(fileName, std::ios::out | std::ios::binary);
+	fOut.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	fOut.write(binary.binary(), static_cast<std::streamsize>(binary.dataSize()));
+	
+	if (fOut.fail())
+		log::warning("Unable to write program binary %s for %s", fileName.c_str(), program->name().c_str());
 }
 
 StringList parseDefinesString(std::string defines, std::string separators)
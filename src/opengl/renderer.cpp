@@ -5,6 +5,7 @@
  *
  */
 
+#include <et/core/profiler.h>
 #include <et/opengl/opengl.h>
 #include <et/rendering/rendercontext.h>
 #include <et/rendering/renderer.h>
@@ -26,6 +27,9 @@ Renderer::Renderer(RenderContext* rc) :
 #if !defined(ET_CONSOLE_APPLICATION)
 	checkOpenGLError("Renderer::Renderer", 0);
 
+	_streamingBuffer = StreamingBuffer::Pointer::create(rc, rc->parameters().streamingBufferSize,
+		"__et__streaming_buffer__");
+
 	IndexArray::Pointer ib = IndexArray::Pointer::create(IndexArrayFormat::Format_16bit, 4, PrimitiveType::TriangleStrips);
 	
 	ib->linearize(4);
@@ -214,6 +218,8 @@ void Renderer::renderTextureRotated(const Texture::Pointer& texture, float angle
 
 void Renderer::drawElements(const IndexBuffer::Pointer& ib, size_t first, size_t count)
 {
+	ET_PROFILE_SCOPE("Renderer::drawElements");
+
 #if !defined(ET_CONSOLE_APPLICATION)
 	ET_ASSERT(ib.valid());
 	
@@ -224,6 +230,8 @@ void Renderer::drawElements(const IndexBuffer::Pointer& ib, size_t first, size_t
 
 void Renderer::drawElementsInstanced(const IndexBuffer::Pointer& ib, size_t first, size_t count, size_t instances)
 {
+	ET_PROFILE_SCOPE("Renderer::drawElementsInstanced");
+
 #if !defined(ET_CONSOLE_APPLICATION)
 	ET_ASSERT(ib.valid());
 	
@@ -234,6 +242,8 @@ void Renderer::drawElementsInstanced(const IndexBuffer::Pointer& ib, size_t firs
 
 void Renderer::drawElements(PrimitiveType pt, const IndexBuffer::Pointer& ib, size_t first, size_t count)
 {
+	ET_PROFILE_SCOPE("Renderer::drawElements");
+
 #if !defined(ET_CONSOLE_APPLICATION)
 	ET_ASSERT(ib.valid());
 	
@@ -244,6 +254,8 @@ void Renderer::drawElements(PrimitiveType pt, const IndexBuffer::Pointer& ib, si
 
 void Renderer::drawAllElements(const IndexBuffer::Pointer& ib)
 {
+	ET_PROFILE_SCOPE("Renderer::drawAllElements");
+
 #if !defined(ET_CONSOLE_APPLICATION)
 	ET_ASSERT(ib.valid());
 	
@@ -254,6 +266,8 @@ void Renderer::drawAllElements(const IndexBuffer::Pointer& ib)
 
 void Renderer::drawElementsBaseIndex(const VertexArrayObject& vao, int base, size_t first, size_t count)
 {
+	ET_PROFILE_SCOPE("Renderer::drawElementsBaseIndex");
+
 #if !defined(ET_CONSOLE_APPLICATION)
 	ET_ASSERT(vao->indexBuffer().valid());
 	
@@ -281,6 +295,27 @@ void Renderer::drawElementsBaseIndex(const VertexArrayObject& vao, int base, siz
 #endif
 }
 
+void Renderer::multiDrawElements(const IndexBuffer::Pointer& ib, const uint32_t* first, const uint32_t* count,
+	size_t drawCount)
+{
+	ET_PROFILE_SCOPE("Renderer::multiDrawElements");
+
+#if !defined(ET_CONSOLE_APPLICATION)
+	ET_ASSERT(ib.valid());
+	
+	_multiDrawCounts.resize(drawCount);
+	_multiDrawOffsets.resize(drawCount);
+	for (size_t i = 0; i < drawCount; ++i)
+	{
+		_multiDrawCounts[i] = static_cast<int32_t>(count[i]);
+		_multiDrawOffsets[i] = ib->indexOffset(first[i]);
+	}
+	
+	etMultiDrawElements(primitiveTypeValue(ib->primitiveType()), _multiDrawCounts.data(),
+		dataTypeValue(ib->dataType()), _multiDrawOffsets.data(), static_cast<GLsizei>(drawCount));
+#endif
+}
+
 void Renderer::drawElementsSequentially(PrimitiveType primitiveType, size_t first, size_t count)
 {
 	auto pvalue = primitiveTypeValue(primitiveType);
@@ -309,6 +344,12 @@ void Renderer::finishRendering()
 	glFinish();
 }
 
+void Renderer::endFrame()
+{
+	if (_streamingBuffer.valid())
+		_streamingBuffer->nextFrame();
+}
+
 /*
  * Default shaders
  */
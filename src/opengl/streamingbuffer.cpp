@@ -0,0 +1,222 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/opengl/opengl.h>
+#include <et/opengl/openglcaps.h>
+#include <et/rendering/rendercontext.h>
+#include <et/rendering/streamingbuffer.h>
+
+using namespace et;
+
+#if defined(GL_MAP_PERSISTENT_BIT) && defined(GL_SYNC_GPU_COMMANDS_COMPLETE)
+#	define ET_PERSISTENT_MAPPING_AVAILABLE	1
+#else
+#	define ET_PERSISTENT_MAPPING_AVAILABLE	0
+#endif
+
+#if defined(GL_SYNC_GPU_COMMANDS_COMPLETE)
+#	define ET_FENCES_AVAILABLE				1
+#else
+#	define ET_FENCES_AVAILABLE				0
+#endif
+
+/*
+ * Binding to copy target does not affect vertex array object or render state
+ */
+#if defined(GL_COPY_WRITE_BUFFER)
+#	define ET_STREAMING_BUFFER_TARGET		GL_COPY_WRITE_BUFFER
+#else
+#	define ET_STREAMING_BUFFER_TARGET		GL_ARRAY_BUFFER
+#endif
+
+StreamingBuffer::StreamingBuffer(RenderContext* rc, size_t capacityPerFrame, const std::string& aName) :
+	APIObject(aName), _rc(rc), _capacityPerFrame(capacityPerFrame)
+{
+	ET_ASSERT(capacityPerFrame > 0);
+
+	GLsizeiptr totalSize = static_cast<GLsizeiptr>(FramesInFlight * _capacityPerFrame);
+
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	checkOpenGLError("glGenBuffers - %s", name().c_str());
+	setAPIHandle(buffer);
+
+	bindForWriting();
+
+#if (ET_PERSISTENT_MAPPING_AVAILABLE)
+	if (OpenGLCapabilities::instance().hasExtension("GL_ARB_buffer_storage"))
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		glBufferStorage(ET_STREAMING_BUFFER_TARGET, totalSize, nullptr, flags);
+		checkOpenGLError("glBufferStorage(..., %u, ...) - %s", totalSize, name().c_str());
+
+		_mappedData = static_cast<uint8_t*>(glMapBufferRange(ET_STREAMING_BUFFER_TARGET, 0, totalSize, flags));
+		checkOpenGLError("glMapBufferRange(..., 0, %u, ...) - %s", totalSize, name().c_str());
+
+		_persistentlyMapped = (_mappedData != nullptr);
+	}
+#endif
+
+	if (!_persistentlyMapped)
+	{
+		glBufferData(ET_STREAMING_BUFFER_TARGET, totalSize, nullptr, GL_STREAM_DRAW);
+		checkOpenGLError("glBufferData(..., %u, ...) - %s", totalSize, name().c_str());
+
+		_stagingData.resize(_capacityPerFrame);
+	}
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+#if (ET_FENCES_AVAILABLE)
+	for (void* fence : _fences)
+	{
+		if (fence != nullptr)
+			glDeleteSync(reinterpret_cast<GLsync>(fence));
+	}
+#endif
+
+	GLuint buffer = static_cast<GLuint>(apiHandle());
+	if (buffer != 0)
+	{
+		if (_persistentlyMapped)
+		{
+			bindForWriting();
+			glUnmapBuffer(ET_STREAMING_BUFFER_TARGET);
+			checkOpenGLError("glUnmapBuffer - %s", name().c_str());
+		}
+
+		_rc->renderState().vertexBufferDeleted(buffer);
+		glDeleteBuffers(1, &buffer);
+		checkOpenGLError("glDeleteBuffers - %s", name().c_str());
+	}
+}
+
+StreamingBuffer::Allocation StreamingBuffer::allocate(size_t size, size_t alignment)
+{
+	ET_ASSERT(size > 0);
+	ET_ASSERT(alignment > 0);
+
+	Allocation result;
+
+	size_t segmentOffset = _segment * _capacityPerFrame;
+	size_t alignedOffset = alignment * ((segmentOffset + _offset + alignment - 1) / alignment);
+	size_t localOffset = alignedOffset - segmentOffset;
+
+	if (localOffset + size > _capacityPerFrame)
+	{
+		log::warning("Streaming buffer %s is full: %llu bytes requested, %llu of %llu used", name().c_str(),
+			static_cast<unsigned long long>(size), static_cast<unsigned long long>(_offset),
+			static_cast<unsigned long long>(_capacityPerFrame));
+		return result;
+	}
+
+	result.offset = alignedOffset;
+	result.size = size;
+	result.data = _persistentlyMapped ? (_mappedData + alignedOffset) : _stagingData.element_ptr(localOffset);
+
+	_offset = localOffset + size;
+	return result;
+}
+
+StreamingBuffer::Allocation StreamingBuffer::upload(const void* data, size_t size, size_t alignment)
+{
+	Allocation result = allocate(size, alignment);
+
+	if (result.valid())
+		memcpy(result.data, data, size);
+
+	return result;
+}
+
+void StreamingBuffer::flush()
+{
+	if (_persistentlyMapped || (_offset <= _flushedOffset))
+		return;
+
+	bindForWriting();
+
+	glBufferSubData(ET_STREAMING_BUFFER_TARGET, static_cast<GLintptr>(_segment * _capacityPerFrame + _flushedOffset),
+		static_cast<GLsizeiptr>(_offset - _flushedOffset), _stagingData.element_ptr(_flushedOffset));
+	checkOpenGLError("glBufferSubData - %s", name().c_str());
+
+	_flushedOffset = _offset;
+}
+
+void StreamingBuffer::nextFrame()
+{
+	flush();
+
+#if (ET_FENCES_AVAILABLE)
+	if (_fences[_segment] != nullptr)
+		glDeleteSync(reinterpret_cast<GLsync>(_fences[_segment]));
+
+	_fences[_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	checkOpenGLError("glFenceSync - %s", name().c_str());
+#endif
+
+	_segment = (_segment + 1) % FramesInFlight;
+	_offset = 0;
+	_flushedOffset = 0;
+
+	waitForSegment();
+}
+
+/*
+ * Mapped memory could only be reused when GPU finished with it. Buffer which is
+ * written with glBufferSubData is orphaned instead, previous storage is released
+ * by driver when it is no longer used.
+ */
+void StreamingBuffer::waitForSegment()
+{
+#if (ET_FENCES_AVAILABLE)
+	GLsync fence = reinterpret_cast<GLsync>(_fences[_segment]);
+	if (fence == nullptr)
+		return;
+
+	GLuint64 timeout = _persistentlyMapped ? 1000000 : 0;
+	GLenum waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+	while (_persistentlyMapped && (waitResult == GL_TIMEOUT_EXPIRED))
+		waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+
+	checkOpenGLError("glClientWaitSync - %s", name().c_str());
+
+	if (waitResult != GL_TIMEOUT_EXPIRED)
+	{
+		glDeleteSync(fence);
+		_fences[_segment] = nullptr;
+		return;
+	}
+#else
+	if (_segment > 0)
+		return;
+#endif
+
+	bindForWriting();
+	glBufferData(ET_STREAMING_BUFFER_TARGET, static_cast<GLsizeiptr>(FramesInFlight * _capacityPerFrame),
+		nullptr, GL_STREAM_DRAW);
+	checkOpenGLError("glBufferData - %s", name().c_str());
+
+#if (ET_FENCES_AVAILABLE)
+	for (void*& f : _fences)
+	{
+		if (f != nullptr)
+			glDeleteSync(reinterpret_cast<GLsync>(f));
+		f = nullptr;
+	}
+#endif
+}
+
+void StreamingBuffer::bindForWriting()
+{
+#if defined(GL_COPY_WRITE_BUFFER)
+	etBindBuffer(GL_COPY_WRITE_BUFFER, static_cast<uint32_t>(apiHandle()));
+#else
+	_rc->renderState().bindBuffer(GL_ARRAY_BUFFER, static_cast<uint32_t>(apiHandle()));
+#endif
+}
@@ -0,0 +1,42 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/opengl/opengl.h>
+#include <et/rendering/uniformbufferring.h>
+
+using namespace et;
+
+UniformBufferRing::UniformBufferRing(RenderContext* rc, size_t capacityPerFrame, const std::string& aName)
+{
+#if defined(GL_UNIFORM_BUFFER)
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	checkOpenGLError("glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, ...)");
+
+	if (alignment > 0)
+		_alignment = static_cast<size_t>(alignment);
+#else
+	ET_FAIL("Uniform buffers are not supported on this platform");
+#endif
+
+	_buffer = StreamingBuffer::Pointer::create(rc, capacityPerFrame, aName);
+}
+
+void UniformBufferRing::bind(uint32_t bindingPoint, const Allocation& allocation)
+{
+	ET_ASSERT(allocation.valid());
+
+	_buffer->flush();
+
+#if defined(GL_UNIFORM_BUFFER)
+	glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, static_cast<GLuint>(_buffer->apiHandle()),
+		static_cast<GLintptr>(allocation.offset), static_cast<GLsizeiptr>(allocation.size));
+	checkOpenGLError("glBindBufferRange(GL_UNIFORM_BUFFER, %u, ...) - %s", bindingPoint, _buffer->name().c_str());
+#else
+	(void)bindingPoint;
+#endif
+}
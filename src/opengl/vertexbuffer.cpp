@@ -23,10 +23,17 @@ VertexBuffer::VertexBuffer(RenderContext* rc, const VertexDeclaration& decl,
 VertexBuffer::VertexBuffer(RenderContext* rc, const VertexArray::Description& desc, BufferDrawType drawType,
 	const std::string& aName) : VertexBuffer(rc, desc.declaration, desc.data, drawType, aName) { }
 
+VertexBuffer::VertexBuffer(RenderContext* rc, const VertexDeclaration& decl, const StreamingBuffer::Pointer& sb,
+	const std::string& aName) : APIObject(aName), _rc(rc), _decl(decl), _streamingBuffer(sb),
+	_dataSize(sb->capacityPerFrame()), _drawType(BufferDrawType::Stream)
+{
+	setAPIHandle(sb->apiHandle());
+}
+
 VertexBuffer::~VertexBuffer()
 {
 	uint32_t buffer = static_cast<uint32_t>(apiHandle());
-	if (buffer != 0)
+	if ((buffer != 0) && _streamingBuffer.invalid())
 	{
 		_rc->renderState().vertexBufferDeleted(buffer);
 		glDeleteBuffers(1, &buffer);
@@ -35,6 +42,8 @@ VertexBuffer::~VertexBuffer()
 
 void VertexBuffer::setData(const void* data, size_t dataSize, bool invalidateExistingData)
 {
+	ET_ASSERT(_streamingBuffer.invalid());
+	
 	_rc->renderState().bindBuffer(GL_ARRAY_BUFFER, static_cast<uint32_t>(apiHandle()));
 	
 	if (invalidateExistingData)
@@ -53,7 +62,7 @@ void VertexBuffer::setDataWithOffset(void* data, size_t offset, size_t dataSize)
 	_rc->renderState().bindBuffer(GL_ARRAY_BUFFER, static_cast<uint32_t>(apiHandle()));
 	
 	//Get pointer to the first element of the gl buffer object
-    unsigned char* bufferp = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, offset, dataSize, 														 GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+    unsigned char* bufferp = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, offset, dataSize, 														 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
     unsigned char* datap = static_cast<unsigned char*>(data);
 
 	//Copy all elements from data to buffer object
@@ -261,11 +261,44 @@ et::vec2i et::nativeScreenSize()
 	return vec2i(1);
 }
 
-int64_t et::getFileDate(const std::string& path)
+uint64_t et::getFileDate(const std::string& path)
 {
 	struct stat s = { };
 	stat(path.c_str(), &s);
-	return static_cast<int64_t>(s.st_mtime_nsec / 1000000);
+	return static_cast<uint64_t>(s.st_mtime) * 1000000000 + static_cast<uint64_t>(s.st_mtime_nsec);
+}
+
+bool et::getFolderEntries(const std::string& folder, StringList& files, StringList& folders)
+{
+	/*
+	 * Assets packed into APK are not listed, they are checked directly by path resolver
+	 */
+	DIR* dir = opendir(folder.c_str());
+	if (dir == nullptr)
+		return false;
+	
+	std::string base = addTrailingSlash(folder);
+	while (struct dirent* entry = readdir(dir))
+	{
+		std::string name(entry->d_name);
+		if ((name == ".") || (name == ".."))
+			continue;
+		
+		bool isFolder = (entry->d_type == DT_DIR);
+		if ((entry->d_type == DT_UNKNOWN) || (entry->d_type == DT_LNK))
+		{
+			struct stat s = { };
+			isFolder = (stat((base + name).c_str(), &s) == 0) && S_ISDIR(s.st_mode);
+		}
+		
+		if (isFolder)
+			folders.push_back(name);
+		else
+			files.push_back(name);
+	}
+	
+	closedir(dir);
+	return true;
 }
 
 void et::getFolderContent(const std::string& path, std::vector<std::string>& aList)
@@ -11,33 +11,9 @@
 #include <et/core/et.h>
 #include <et/platform-apple/apple.h>
 
-#define PASS_TO_OUTPUTS(FUNC)		for (Output::Pointer output : sharedLogOutputs()) \
-									{ \
-										va_list args; \
-										va_start(args, format); \
-										output->FUNC(format, args); \
-										va_end(args); \
-									}
-
 using namespace et;
 using namespace log;
 
-void et::log::addOutput(Output::Pointer ptr)
-{
-	sharedLogOutputs().push_back(ptr);
-}
-
-void et::log::removeOutput(Output::Pointer ptr)
-{
-	sharedLogOutputs().erase(std::remove_if(sharedLogOutputs().begin(), sharedLogOutputs().end(),
-		[ptr](Output::Pointer out) { return out == ptr; }), sharedLogOutputs().end());
-}
-
-void et::log::debug(const char* format, ...) { PASS_TO_OUTPUTS(debug) }
-void et::log::info(const char* format, ...) { PASS_TO_OUTPUTS(info) }
-void et::log::warning(const char* format, ...) { PASS_TO_OUTPUTS(warning) }
-void et::log::error(const char* format, ...) { PASS_TO_OUTPUTS(error) }
-
 ConsoleOutput::ConsoleOutput() :
 	FileOutput(stdout)
 {
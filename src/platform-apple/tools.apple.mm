@@ -5,6 +5,7 @@
  *
  */
 
+#include <dirent.h>
 #include <sys/time.h>
 #include <sys/stat.h>
 #include <et/core/datastorage.h>
@@ -69,7 +70,7 @@ uint64_t et::getFileDate(const std::string& path)
 {
 	struct stat s = { };
 	stat(path.c_str(), &s);
-	return s.st_mtimespec.tv_sec;
+	return static_cast<uint64_t>(s.st_mtimespec.tv_sec) * 1000000000 + static_cast<uint64_t>(s.st_mtimespec.tv_nsec);
 }
 
 std::string et::applicationPath()
@@ -230,6 +231,36 @@ void et::getFolderContent(const std::string& folder, StringList& list)
 		list.push_back(folder + std::string([file cStringUsingEncoding:NSUTF8StringEncoding]));
 }
 
+bool et::getFolderEntries(const std::string& folder, StringList& files, StringList& folders)
+{
+	DIR* dir = opendir(folder.c_str());
+	if (dir == nullptr)
+		return false;
+	
+	std::string base = addTrailingSlash(folder);
+	while (struct dirent* entry = readdir(dir))
+	{
+		std::string name(entry->d_name);
+		if ((name == ".") || (name == ".."))
+			continue;
+		
+		bool isFolder = (entry->d_type == DT_DIR);
+		if ((entry->d_type == DT_UNKNOWN) || (entry->d_type == DT_LNK))
+		{
+			struct stat s = { };
+			isFolder = (stat((base + name).c_str(), &s) == 0) && S_ISDIR(s.st_mode);
+		}
+		
+		if (isFolder)
+			folders.push_back(name);
+		else
+			files.push_back(name);
+	}
+	
+	closedir(dir);
+	return true;
+}
+
 void et::findFiles(const std::string& folder, const std::string& mask, bool /* recursive */, std::vector<std::string>& list)
 {
 	size_t maskLength = mask.length();
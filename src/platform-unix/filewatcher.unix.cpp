@@ -0,0 +1,544 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/core/tools.h>
+#include <et/core/filewatcher.h>
+
+#if (ET_PLATFORM_ANDROID)
+
+#include <set>
+#include <mutex>
+#include <unordered_map>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+namespace et
+{
+	class FileWatcherPrivate
+	{
+	public:
+		struct WatchedFile
+		{
+			int descriptor = -1;
+			uint32_t references = 0;
+		};
+
+		struct WatchedFolder
+		{
+			std::unordered_map<std::string, std::set<std::string>> files;
+			std::set<std::string> watchers;
+
+			bool empty() const
+				{ return files.empty() && watchers.empty(); }
+		};
+
+	public:
+		FileWatcherPrivate();
+		~FileWatcherPrivate();
+
+		int addFolder(const std::string& folder);
+		void releaseFolder(int descriptor);
+
+		void run();
+		void processEvents(const char* data, size_t length);
+		void markFolderChanged(const WatchedFolder&, uint64_t time);
+		void removeFolder(int descriptor);
+
+	public:
+		std::mutex lock;
+		std::thread thread;
+		std::unordered_map<std::string, WatchedFile> watchedFiles;
+		std::unordered_map<std::string, int> folderDescriptors;
+		std::unordered_map<int, WatchedFolder> folders;
+		std::unordered_map<std::string, uint64_t> pendingChanges;
+		std::atomic<size_t> pendingChangesCount;
+		uint64_t debounceInterval = 100;
+		int descriptor = -1;
+		int wakeupPipe[2] = { -1, -1 };
+	};
+}
+
+using namespace et;
+
+enum : uint32_t
+{
+	folderEventsMask = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE |
+		IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR,
+
+	folderEntriesMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+};
+
+FileWatcher::FileWatcher()
+{
+	ET_PIMPL_INIT(FileWatcher)
+}
+
+FileWatcher::~FileWatcher()
+{
+	ET_PIMPL_FINALIZE(FileWatcher)
+}
+
+bool FileWatcher::available() const
+{
+	return _private->descriptor != -1;
+}
+
+bool FileWatcher::watch(const std::string& fileName)
+{
+	if (!available() || fileName.empty())
+		return false;
+
+	std::lock_guard<std::mutex> lock(_private->lock);
+
+	auto existing = _private->watchedFiles.find(fileName);
+	if ((existing != _private->watchedFiles.end()) && (existing->second.descriptor != -1))
+	{
+		++existing->second.references;
+		return true;
+	}
+
+	int folderDescriptor = _private->addFolder(getFilePath(fileName));
+	if (folderDescriptor == -1)
+		return false;
+
+	_private->folders[folderDescriptor].files[getFileName(fileName)].insert(fileName);
+
+	/*
+	 * File which lost its folder watch keeps references of previous watchers
+	 */
+	auto& watchedFile = _private->watchedFiles[fileName];
+	watchedFile.descriptor = folderDescriptor;
+	++watchedFile.references;
+	return true;
+}
+
+void FileWatcher::unwatch(const std::string& fileName)
+{
+	std::lock_guard<std::mutex> lock(_private->lock);
+
+	auto i = _private->watchedFiles.find(fileName);
+	if (i == _private->watchedFiles.end())
+		return;
+
+	if (--i->second.references > 0)
+		return;
+
+	int folderDescriptor = i->second.descriptor;
+	_private->watchedFiles.erase(i);
+	_private->pendingChanges.erase(fileName);
+	_private->pendingChangesCount = _private->pendingChanges.size();
+
+	auto folder = _private->folders.find(folderDescriptor);
+	if (folder == _private->folders.end())
+		return;
+
+	auto name = folder->second.files.find(getFileName(fileName));
+	if (name != folder->second.files.end())
+	{
+		name->second.erase(fileName);
+		if (name->second.empty())
+			folder->second.files.erase(name);
+	}
+
+	_private->releaseFolder(folderDescriptor);
+}
+
+bool FileWatcher::watchFolder(const std::string& folder)
+{
+	if (!available() || folder.empty())
+		return false;
+
+	std::string folderName = addTrailingSlash(folder);
+
+	std::lock_guard<std::mutex> lock(_private->lock);
+
+	auto existing = _private->watchedFiles.find(folderName);
+	if ((existing != _private->watchedFiles.end()) && (existing->second.descriptor != -1))
+	{
+		++existing->second.references;
+		return true;
+	}
+
+	int folderDescriptor = _private->addFolder(folderName);
+	if (folderDescriptor == -1)
+		return false;
+
+	_private->folders[folderDescriptor].watchers.insert(folderName);
+
+	auto& watchedFolder = _private->watchedFiles[folderName];
+	watchedFolder.descriptor = folderDescriptor;
+	++watchedFolder.references;
+	return true;
+}
+
+void FileWatcher::unwatchFolder(const std::string& folder)
+{
+	if (folder.empty())
+		return;
+
+	std::string folderName = addTrailingSlash(folder);
+
+	std::lock_guard<std::mutex> lock(_private->lock);
+
+	auto i = _private->watchedFiles.find(folderName);
+	if (i == _private->watchedFiles.end())
+		return;
+
+	if (--i->second.references > 0)
+		return;
+
+	int folderDescriptor = i->second.descriptor;
+	_private->watchedFiles.erase(i);
+	_private->pendingChanges.erase(folderName);
+	_private->pendingChangesCount = _private->pendingChanges.size();
+
+	auto watchedFolder = _private->folders.find(folderDescriptor);
+	if (watchedFolder != _private->folders.end())
+	{
+		watchedFolder->second.watchers.erase(folderName);
+		_private->releaseFolder(folderDescriptor);
+	}
+}
+
+void FileWatcher::unwatchAll()
+{
+	std::lock_guard<std::mutex> lock(_private->lock);
+
+	for (const auto& folder : _private->folders)
+		inotify_rm_watch(_private->descriptor, folder.first);
+
+	_private->watchedFiles.clear();
+	_private->folderDescriptors.clear();
+	_private->folders.clear();
+	_private->pendingChanges.clear();
+	_private->pendingChangesCount = 0;
+}
+
+bool FileWatcher::watching(const std::string& fileName) const
+{
+	std::lock_guard<std::mutex> lock(_private->lock);
+
+	auto i = _private->watchedFiles.find(fileName);
+	return (i != _private->watchedFiles.end()) && (i->second.descriptor != -1);
+}
+
+void FileWatcher::setDebounceInterval(uint64_t milliseconds)
+{
+	std::lock_guard<std::mutex> lock(_private->lock);
+	_private->debounceInterval = milliseconds;
+}
+
+bool FileWatcher::hasChanges() const
+{
+	return _private->pendingChangesCount.load() > 0;
+}
+
+StringList FileWatcher::takeChanges()
+{
+	StringList result;
+
+	if (!hasChanges())
+		return result;
+
+	uint64_t currentTime = queryContiniousTimeInMilliSeconds();
+
+	std::lock_guard<std::mutex> lock(_private->lock);
+
+	auto i = _private->pendingChanges.begin();
+	while (i != _private->pendingChanges.end())
+	{
+		if (currentTime >= i->second + _private->debounceInterval)
+		{
+			result.push_back(i->first);
+			i = _private->pendingChanges.erase(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	_private->pendingChangesCount = _private->pendingChanges.size();
+	return result;
+}
+
+size_t FileWatcher::watchedFilesCount() const
+{
+	std::lock_guard<std::mutex> lock(_private->lock);
+	return _private->watchedFiles.size();
+}
+
+size_t FileWatcher::watchedFoldersCount() const
+{
+	std::lock_guard<std::mutex> lock(_private->lock);
+	return _private->folders.size();
+}
+
+/*
+ * Private implementation
+ */
+int FileWatcherPrivate::addFolder(const std::string& folder)
+{
+	auto knownFolder = folderDescriptors.find(folder);
+	if (knownFolder != folderDescriptors.end())
+		return knownFolder->second;
+
+	/*
+	 * inotify returns the same descriptor for different spellings of one folder
+	 */
+	const char* folderPath = folder.empty() ? "." : folder.c_str();
+	int folderDescriptor = inotify_add_watch(descriptor, folderPath, folderEventsMask);
+	if (folderDescriptor != -1)
+		folderDescriptors[folder] = folderDescriptor;
+
+	return folderDescriptor;
+}
+
+void FileWatcherPrivate::releaseFolder(int folderDescriptor)
+{
+	auto folder = folders.find(folderDescriptor);
+	if ((folder != folders.end()) && folder->second.empty())
+	{
+		inotify_rm_watch(descriptor, folderDescriptor);
+		removeFolder(folderDescriptor);
+	}
+}
+
+FileWatcherPrivate::FileWatcherPrivate() :
+	pendingChangesCount(0)
+{
+	descriptor = inotify_init();
+	if (descriptor == -1)
+	{
+		log::warning("[FileWatcher] inotify is not available, files should be polled.");
+		return;
+	}
+
+	if (pipe(wakeupPipe) == -1)
+	{
+		::close(descriptor);
+		descriptor = -1;
+		return;
+	}
+
+	fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+	fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL) | O_NONBLOCK);
+	fcntl(wakeupPipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(wakeupPipe[1], F_SETFD, FD_CLOEXEC);
+
+	thread = std::thread(&FileWatcherPrivate::run, this);
+}
+
+FileWatcherPrivate::~FileWatcherPrivate()
+{
+	if (thread.joinable())
+	{
+		char stop = 0;
+		while ((write(wakeupPipe[1], &stop, 1) == -1) && (errno == EINTR))
+			continue;
+
+		thread.join();
+	}
+
+	if (wakeupPipe[0] != -1)
+		::close(wakeupPipe[0]);
+
+	if (wakeupPipe[1] != -1)
+		::close(wakeupPipe[1]);
+
+	if (descriptor != -1)
+		::close(descriptor);
+}
+
+void FileWatcherPrivate::run()
+{
+	alignas(inotify_event) char buffer[4096];
+
+	pollfd descriptors[2] = { };
+	descriptors[0].fd = descriptor;
+	descriptors[0].events = POLLIN;
+	descriptors[1].fd = wakeupPipe[0];
+	descriptors[1].events = POLLIN;
+
+	for (;;)
+	{
+		if (poll(descriptors, 2, -1) == -1)
+		{
+			if (errno == EINTR)
+				continue;
+
+			log::error("[FileWatcher] Unable to wait for file system events, errno = %d", errno);
+			break;
+		}
+
+		if (descriptors[1].revents != 0)
+			break;
+
+		if ((descriptors[0].revents & POLLIN) == 0)
+			continue;
+
+		ssize_t bytesRead = 0;
+		while ((bytesRead = read(descriptor, buffer, sizeof(buffer))) > 0)
+			processEvents(buffer, static_cast<size_t>(bytesRead));
+	}
+}
+
+void FileWatcherPrivate::processEvents(const char* data, size_t length)
+{
+	uint64_t currentTime = queryContiniousTimeInMilliSeconds();
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	size_t offset = 0;
+	while (offset + sizeof(inotify_event) <= length)
+	{
+		const inotify_event* event = reinterpret_cast<const inotify_event*>(data + offset);
+		offset += sizeof(inotify_event) + event->len;
+
+		if (event->mask & IN_Q_OVERFLOW)
+		{
+			for (const auto& folder : folders)
+				markFolderChanged(folder.second, currentTime);
+			continue;
+		}
+
+		auto folder = folders.find(event->wd);
+		if (folder == folders.end())
+			continue;
+
+		/*
+		 * Watch of moved folder follows it to the new location, so it is removed as well
+		 */
+		if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+		{
+			markFolderChanged(folder->second, currentTime);
+			if ((event->mask & IN_IGNORED) == 0)
+				inotify_rm_watch(descriptor, event->wd);
+			removeFolder(event->wd);
+			continue;
+		}
+
+		if (event->len == 0)
+			continue;
+
+		if (event->mask & folderEntriesMask)
+		{
+			for (const auto& folderName : folder->second.watchers)
+				pendingChanges[folderName] = currentTime;
+		}
+
+		auto files = folder->second.files.find(event->name);
+		if (files != folder->second.files.end())
+		{
+			for (const auto& fileName : files->second)
+				pendingChanges[fileName] = currentTime;
+		}
+	}
+
+	pendingChangesCount = pendingChanges.size();
+}
+
+void FileWatcherPrivate::markFolderChanged(const WatchedFolder& folder, uint64_t time)
+{
+	for (const auto& files : folder.files)
+	{
+		for (const auto& fileName : files.second)
+			pendingChanges[fileName] = time;
+	}
+
+	for (const auto& folderName : folder.watchers)
+		pendingChanges[folderName] = time;
+}
+
+/*
+ * Files of folder removed by system stay referenced, but are not watched anymore
+ */
+void FileWatcherPrivate::removeFolder(int folderDescriptor)
+{
+	folders.erase(folderDescriptor);
+
+	for (auto& file : watchedFiles)
+	{
+		if (file.second.descriptor == folderDescriptor)
+			file.second.descriptor = -1;
+	}
+
+	auto i = folderDescriptors.begin();
+	while (i != folderDescriptors.end())
+	{
+		if (i->second == folderDescriptor)
+			i = folderDescriptors.erase(i);
+		else
+			++i;
+	}
+}
+
+#else
+
+/*
+ * Notifications are implemented with inotify only, ObjectsCache polls files on other platforms
+ */
+
+namespace et
+{
+	class FileWatcherPrivate
+	{
+	};
+}
+
+using namespace et;
+
+FileWatcher::FileWatcher()
+{
+	ET_PIMPL_INIT(FileWatcher)
+}
+
+FileWatcher::~FileWatcher()
+{
+	ET_PIMPL_FINALIZE(FileWatcher)
+}
+
+bool FileWatcher::available() const
+	{ return false; }
+
+bool FileWatcher::watch(const std::string&)
+	{ return false; }
+
+void FileWatcher::unwatch(const std::string&)
+	{ }
+
+bool FileWatcher::watchFolder(const std::string&)
+	{ return false; }
+
+void FileWatcher::unwatchFolder(const std::string&)
+	{ }
+
+void FileWatcher::unwatchAll()
+	{ }
+
+bool FileWatcher::watching(const std::string&) const
+	{ return false; }
+
+void FileWatcher::setDebounceInterval(uint64_t)
+	{ }
+
+bool FileWatcher::hasChanges() const
+	{ return false; }
+
+StringList FileWatcher::takeChanges()
+	{ return StringList(); }
+
+size_t FileWatcher::watchedFilesCount() const
+	{ return 0; }
+
+size_t FileWatcher::watchedFoldersCount() const
+	{ return 0; }
+
+#endif // ET_PLATFORM_ANDROID
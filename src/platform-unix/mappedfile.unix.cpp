@@ -0,0 +1,92 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/core/mappedfile.h>
+
+#if (ET_PLATFORM_IOS | ET_PLATFORM_MAC | ET_PLATFORM_ANDROID)
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace et
+{
+	class MappedFilePrivate
+	{
+	public:
+		void* address = nullptr;
+		size_t length = 0;
+	};
+}
+
+using namespace et;
+
+MappedFile::MappedFile()
+{
+	ET_PIMPL_INIT(MappedFile)
+}
+
+MappedFile::MappedFile(const std::string& fileName)
+{
+	ET_PIMPL_INIT(MappedFile)
+	open(fileName);
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+	ET_PIMPL_FINALIZE(MappedFile)
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+	close();
+
+	int descriptor = ::open(fileName.c_str(), O_RDONLY);
+	if (descriptor == -1)
+	{
+		log::error("Unable to open file for mapping: %s", fileName.c_str());
+		return false;
+	}
+
+	struct stat fileInfo = { };
+	if ((fstat(descriptor, &fileInfo) != 0) || (fileInfo.st_size <= 0))
+	{
+		::close(descriptor);
+		return false;
+	}
+
+	size_t length = static_cast<size_t>(fileInfo.st_size);
+	void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	::close(descriptor);
+
+	if (address == MAP_FAILED)
+	{
+		log::error("Unable to map file: %s", fileName.c_str());
+		return false;
+	}
+
+	_private->address = address;
+	_private->length = length;
+	_data = static_cast<const char*>(address);
+	_size = static_cast<uint64_t>(length);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (_private->address != nullptr)
+		munmap(_private->address, _private->length);
+
+	_private->address = nullptr;
+	_private->length = 0;
+	_data = nullptr;
+	_size = 0;
+}
+
+#endif // ET_PLATFORM_IOS | ET_PLATFORM_MAC | ET_PLATFORM_ANDROID
@@ -9,35 +9,9 @@
 
 #if (ET_PLATFORM_WIN)
 
-#define PASS_TO_OUTPUTS(FUNC)		for (Output::Pointer output : logOutputs) \
-									{ \
-										va_list args; \
-										va_start(args, format); \
-										output->FUNC(format, args); \
-										va_end(args); \
-									}
-
 using namespace et;
 using namespace log;
 
-static std::vector<Output::Pointer> logOutputs;
-
-void et::log::addOutput(Output::Pointer ptr)
-{
-	logOutputs.push_back(ptr);
-}
-
-void et::log::removeOutput(Output::Pointer ptr)
-{
-	logOutputs.erase(std::remove_if(logOutputs.begin(), logOutputs.end(),
-		[ptr](Output::Pointer out) { return out == ptr; }), logOutputs.end());
-}
-
-void et::log::debug(const char* format, ...) { PASS_TO_OUTPUTS(debug) }
-void et::log::info(const char* format, ...) { PASS_TO_OUTPUTS(info) }
-void et::log::warning(const char* format, ...) { PASS_TO_OUTPUTS(warning) }
-void et::log::error(const char* format, ...) { PASS_TO_OUTPUTS(error) }
-
 ConsoleOutput::ConsoleOutput() :
 	FileOutput(stdout)
 {
@@ -0,0 +1,96 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/core/mappedfile.h>
+
+#if (ET_PLATFORM_WIN)
+
+namespace et
+{
+	class MappedFilePrivate
+	{
+	public:
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+		const void* view = nullptr;
+	};
+}
+
+using namespace et;
+
+MappedFile::MappedFile()
+{
+	ET_PIMPL_INIT(MappedFile)
+}
+
+MappedFile::MappedFile(const std::string& fileName)
+{
+	ET_PIMPL_INIT(MappedFile)
+	open(fileName);
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+	ET_PIMPL_FINALIZE(MappedFile)
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+	close();
+
+	_private->file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (_private->file == INVALID_HANDLE_VALUE)
+	{
+		log::error("Unable to open file for mapping: %s", fileName.c_str());
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = { };
+	if (!GetFileSizeEx(_private->file, &fileSize) || (fileSize.QuadPart <= 0))
+	{
+		close();
+		return false;
+	}
+
+	_private->mapping = CreateFileMappingA(_private->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_private->mapping != nullptr)
+		_private->view = MapViewOfFile(_private->mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (_private->view == nullptr)
+	{
+		log::error("Unable to map file: %s", fileName.c_str());
+		close();
+		return false;
+	}
+
+	_data = static_cast<const char*>(_private->view);
+	_size = static_cast<uint64_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (_private->view != nullptr)
+		UnmapViewOfFile(_private->view);
+
+	if (_private->mapping != nullptr)
+		CloseHandle(_private->mapping);
+
+	if (_private->file != INVALID_HANDLE_VALUE)
+		CloseHandle(_private->file);
+
+	_private->view = nullptr;
+	_private->mapping = nullptr;
+	_private->file = INVALID_HANDLE_VALUE;
+	_data = nullptr;
+	_size = 0;
+}
+
+#endif // ET_PLATFORM_WIN
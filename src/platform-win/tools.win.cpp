@@ -85,6 +85,32 @@ bool et::folderExists(const std::string& folder)
 	return (attr != INVALID_FILE_ATTRIBUTES) && ((attr & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY);
 }
 
+bool et::getFolderEntries(const std::string& folder, StringList& files, StringList& folders)
+{
+	ET_STRING_TYPE searchPath = ET_STRING_TO_PARAM_TYPE(addTrailingSlash(folder)) + allFilesMask;
+
+	WIN32_FIND_DATA data = { };
+	HANDLE search = FindFirstFile(searchPath.c_str(), &data);
+	if (search == INVALID_HANDLE_VALUE)
+		return false;
+
+	do
+	{
+		ET_STRING_TYPE name(data.cFileName);
+		if ((name == currentFolder) || (name == previousFolder))
+			continue;
+
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
+			folders.push_back(ET_STRING_TO_OUTPUT_TYPE(name));
+		else
+			files.push_back(ET_STRING_TO_OUTPUT_TYPE(name));
+	}
+	while (FindNextFile(search, &data));
+	FindClose(search);
+
+	return true;
+}
+
 void et::findFiles(const std::string& folder, const std::string& mask, bool recursive, StringList& list)
 {
 	ET_STRING_TYPE normalizedFolder = ET_STRING_TO_PARAM_TYPE(addTrailingSlash(folder));
@@ -0,0 +1,724 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/core/et.h>
+#include <et/geometry/geometry.h>
+#include <et/primitives/primitives.h>
+
+#if (ET_PLATFORM_MAC || ET_PLATFORM_WIN)
+#	include <emmintrin.h>
+#	define ET_PRIMITIVES_SSE		1
+#elif (ET_PLATFORM_IOS) && defined(__aarch64__)
+#	include <arm_neon.h>
+#	define ET_PRIMITIVES_NEON		1
+#endif
+
+using namespace et;
+
+namespace
+{
+	enum : size_t
+	{
+		Width = 4,
+		RangesPerThread = 4
+	};
+
+#if (ET_PRIMITIVES_SSE)
+
+	typedef __m128 float4;
+
+	inline float4 f4load(const float* p)
+		{ return _mm_loadu_ps(p); }
+
+	inline void f4store(float* p, float4 v)
+		{ _mm_storeu_ps(p, v); }
+
+	inline float4 f4set(float v)
+		{ return _mm_set1_ps(v); }
+
+	inline float4 f4add(float4 a, float4 b)
+		{ return _mm_add_ps(a, b); }
+
+	inline float4 f4sub(float4 a, float4 b)
+		{ return _mm_sub_ps(a, b); }
+
+	inline float4 f4mul(float4 a, float4 b)
+		{ return _mm_mul_ps(a, b); }
+
+	inline float4 f4div(float4 a, float4 b)
+		{ return _mm_div_ps(a, b); }
+
+	inline float4 f4sqrt(float4 a)
+		{ return _mm_sqrt_ps(a); }
+
+	inline float4 f4max(float4 a, float4 b)
+		{ return _mm_max_ps(a, b); }
+
+	/*
+	 * Returns a where condition is positive and zero elsewhere
+	 */
+	inline float4 f4wherePositive(float4 condition, float4 a)
+		{ return _mm_and_ps(_mm_cmpgt_ps(condition, _mm_setzero_ps()), a); }
+
+#elif (ET_PRIMITIVES_NEON)
+
+	typedef float32x4_t float4;
+
+	inline float4 f4load(const float* p)
+		{ return vld1q_f32(p); }
+
+	inline void f4store(float* p, float4 v)
+		{ vst1q_f32(p, v); }
+
+	inline float4 f4set(float v)
+		{ return vdupq_n_f32(v); }
+
+	inline float4 f4add(float4 a, float4 b)
+		{ return vaddq_f32(a, b); }
+
+	inline float4 f4sub(float4 a, float4 b)
+		{ return vsubq_f32(a, b); }
+
+	inline float4 f4mul(float4 a, float4 b)
+		{ return vmulq_f32(a, b); }
+
+	inline float4 f4div(float4 a, float4 b)
+		{ return vdivq_f32(a, b); }
+
+	inline float4 f4sqrt(float4 a)
+		{ return vsqrtq_f32(a); }
+
+	inline float4 f4max(float4 a, float4 b)
+		{ return vmaxq_f32(a, b); }
+
+	inline float4 f4wherePositive(float4 condition, float4 a)
+	{
+		uint32x4_t mask = vcgtq_f32(condition, vdupq_n_f32(0.0f));
+		return vreinterpretq_f32_u32(vandq_u32(mask, vreinterpretq_u32_f32(a)));
+	}
+
+#else
+
+	struct float4
+	{
+		float v[Width];
+	};
+
+	inline float4 f4load(const float* p)
+		{ float4 r; for (size_t i = 0; i < Width; ++i) r.v[i] = p[i]; return r; }
+
+	inline void f4store(float* p, float4 a)
+		{ for (size_t i = 0; i < Width; ++i) p[i] = a.v[i]; }
+
+	inline float4 f4set(float value)
+		{ float4 r; for (size_t i = 0; i < Width; ++i) r.v[i] = value; return r; }
+
+	inline float4 f4add(float4 a, float4 b)
+		{ for (size_t i = 0; i < Width; ++i) a.v[i] += b.v[i]; return a; }
+
+	inline float4 f4sub(float4 a, float4 b)
+		{ for (size_t i = 0; i < Width; ++i) a.v[i] -= b.v[i]; return a; }
+
+	inline float4 f4mul(float4 a, float4 b)
+		{ for (size_t i = 0; i < Width; ++i) a.v[i] *= b.v[i]; return a; }
+
+	inline float4 f4div(float4 a, float4 b)
+		{ for (size_t i = 0; i < Width; ++i) a.v[i] /= b.v[i]; return a; }
+
+	inline float4 f4sqrt(float4 a)
+		{ for (size_t i = 0; i < Width; ++i) a.v[i] = std::sqrt(a.v[i]); return a; }
+
+	inline float4 f4max(float4 a, float4 b)
+		{ for (size_t i = 0; i < Width; ++i) a.v[i] = etMax(a.v[i], b.v[i]); return a; }
+
+	inline float4 f4wherePositive(float4 condition, float4 a)
+		{ for (size_t i = 0; i < Width; ++i) a.v[i] = (condition.v[i] > 0.0f) ? a.v[i] : 0.0f; return a; }
+
+#endif
+
+	struct vec3x4
+	{
+		float4 x;
+		float4 y;
+		float4 z;
+	};
+
+	struct ET_ALIGNED(16) vec3x4Storage
+	{
+		float x[Width];
+		float y[Width];
+		float z[Width];
+
+		void set(size_t lane, const vec3& v)
+			{ x[lane] = v.x; y[lane] = v.y; z[lane] = v.z; }
+
+		vec3 at(size_t lane) const
+			{ return vec3(x[lane], y[lane], z[lane]); }
+
+		vec3x4 load() const
+			{ return { f4load(x), f4load(y), f4load(z) }; }
+
+		void store(const vec3x4& v)
+			{ f4store(x, v.x); f4store(y, v.y); f4store(z, v.z); }
+	};
+
+	inline vec3x4 v4sub(const vec3x4& a, const vec3x4& b)
+		{ return { f4sub(a.x, b.x), f4sub(a.y, b.y), f4sub(a.z, b.z) }; }
+
+	inline vec3x4 v4scale(const vec3x4& a, float4 s)
+		{ return { f4mul(a.x, s), f4mul(a.y, s), f4mul(a.z, s) }; }
+
+	inline float4 v4dot(const vec3x4& a, const vec3x4& b)
+		{ return f4add(f4add(f4mul(a.x, b.x), f4mul(a.y, b.y)), f4mul(a.z, b.z)); }
+
+	inline vec3x4 v4cross(const vec3x4& a, const vec3x4& b)
+	{
+		return
+		{
+			f4sub(f4mul(a.y, b.z), f4mul(a.z, b.y)),
+			f4sub(f4mul(a.z, b.x), f4mul(a.x, b.z)),
+			f4sub(f4mul(a.x, b.y), f4mul(a.y, b.x))
+		};
+	}
+
+	/*
+	 * Zero vectors stay zero, as in et::normalize
+	 */
+	inline vec3x4 v4normalize(const vec3x4& a)
+	{
+		float4 lengthSquared = v4dot(a, a);
+		float4 length = f4sqrt(f4max(lengthSquared, f4set(std::numeric_limits<float>::min())));
+		return
+		{
+			f4wherePositive(lengthSquared, f4div(a.x, length)),
+			f4wherePositive(lengthSquared, f4div(a.y, length)),
+			f4wherePositive(lengthSquared, f4div(a.z, length))
+		};
+	}
+
+	inline float cornerAngle(const vec3& a, const vec3& b)
+	{
+		float lengths = std::sqrt(a.dotSelf() * b.dotSelf());
+		return (lengths > 0.0f) ? std::acos(clamp(a.dot(b) / lengths, -1.0f, 1.0f)) : 0.0f;
+	}
+
+	/*
+	 * Triangles are split into fixed ranges and vertices into buckets. Every range scatters
+	 * values of its corners into its own slots of each bucket, then every bucket is summed
+	 * by single thread in the same order as serial code accumulates values.
+	 */
+	struct CornerLayout
+	{
+		size_t triangles = 0;
+		size_t rangeSize = 0;
+		size_t ranges = 0;
+		size_t bucketSize = 0;
+		size_t buckets = 0;
+
+		/*
+		 * First slot of range in bucket, indexed by range * buckets + bucket
+		 */
+		std::vector<size_t> rangeOffsets;
+		std::vector<size_t> bucketOffsets;
+		std::vector<uint32_t> vertices;
+
+		CornerLayout(size_t aTriangles, size_t vertexCount) :
+			triangles(aTriangles)
+		{
+			size_t threads = etMax(size_t(1), threading::maxConcurrentThreads());
+			rangeSize = etMax(size_t(1), (triangles + RangesPerThread * threads - 1) / (RangesPerThread * threads));
+			ranges = (triangles + rangeSize - 1) / rangeSize;
+			bucketSize = etMax(size_t(1), (vertexCount + RangesPerThread * threads - 1) / (RangesPerThread * threads));
+			buckets = (vertexCount + bucketSize - 1) / bucketSize;
+		}
+
+		size_t rangeBegin(size_t range) const
+			{ return range * rangeSize; }
+
+		size_t rangeEnd(size_t range) const
+			{ return etMin(triangles, (range + 1) * rangeSize); }
+
+		template <typename IndexType>
+		void build(const IndexType* indices)
+		{
+			std::vector<size_t> counts(ranges * buckets, 0);
+			threading::parallelFor(ranges, 1, [this, indices, &counts](size_t begin, size_t end)
+			{
+				for (size_t range = begin; range < end; ++range)
+				{
+					size_t* rangeCounts = counts.data() + range * buckets;
+					for (size_t i = 3 * rangeBegin(range), e = 3 * rangeEnd(range); i < e; ++i)
+					{
+						ET_ASSERT(indices[i] / bucketSize < buckets);
+						++rangeCounts[indices[i] / bucketSize];
+					}
+				}
+			});
+
+			rangeOffsets.resize(ranges * buckets);
+			bucketOffsets.resize(buckets + 1);
+
+			size_t slot = 0;
+			for (size_t bucket = 0; bucket < buckets; ++bucket)
+			{
+				bucketOffsets[bucket] = slot;
+				for (size_t range = 0; range < ranges; ++range)
+				{
+					rangeOffsets[range * buckets + bucket] = slot;
+					slot += counts[range * buckets + bucket];
+				}
+			}
+			bucketOffsets[buckets] = slot;
+
+			vertices.resize(slot);
+		}
+	};
+
+	template <typename IndexType>
+	void scatterNormals(const IndexType* indices, CornerLayout& layout, RawDataAcessor<vec3>& pos,
+		primitives::NormalsWeighting weighting, std::vector<vec3>& values)
+	{
+		threading::parallelFor(layout.ranges, 1, [&](size_t begin, size_t end)
+		{
+			std::vector<size_t> cursor(layout.buckets);
+			vec3x4Storage p0;
+			vec3x4Storage p1;
+			vec3x4Storage p2;
+			vec3x4Storage faceNormals;
+
+			for (size_t range = begin; range < end; ++range)
+			{
+				std::copy_n(layout.rangeOffsets.begin() + range * layout.buckets, layout.buckets, cursor.begin());
+
+				for (size_t t = layout.rangeBegin(range), te = layout.rangeEnd(range); t < te; t += Width)
+				{
+					size_t lanes = etMin(size_t(Width), te - t);
+					for (size_t lane = 0; lane < Width; ++lane)
+					{
+						const IndexType* tri = indices + 3 * (t + etMin(lane, lanes - 1));
+						p0.set(lane, pos[static_cast<size_t>(tri[0])]);
+						p1.set(lane, pos[static_cast<size_t>(tri[1])]);
+						p2.set(lane, pos[static_cast<size_t>(tri[2])]);
+					}
+
+					vec3x4 v0 = p0.load();
+					vec3x4 faceCross = v4cross(v4sub(p1.load(), v0), v4sub(p2.load(), v0));
+
+					if (weighting == primitives::NormalsWeighting::Area)
+						faceNormals.store(v4scale(faceCross, f4set(0.5f)));
+					else
+						faceNormals.store(v4normalize(faceCross));
+
+					for (size_t lane = 0; lane < lanes; ++lane)
+					{
+						const IndexType* tri = indices + 3 * (t + lane);
+						vec3 n = faceNormals.at(lane);
+						vec3 corners[3] = { p0.at(lane), p1.at(lane), p2.at(lane) };
+
+						for (size_t k = 0; k < 3; ++k)
+						{
+							float weight = 1.0f;
+							if (weighting == primitives::NormalsWeighting::Angle)
+							{
+								const vec3& c = corners[k];
+								weight = cornerAngle(corners[(k + 1) % 3] - c, corners[(k + 2) % 3] - c);
+							}
+
+							size_t slot = cursor[tri[k] / layout.bucketSize]++;
+							layout.vertices[slot] = static_cast<uint32_t>(tri[k]);
+							values[slot] = n * weight;
+						}
+					}
+				}
+			}
+		});
+	}
+
+	template <typename IndexType>
+	void scatterTangents(const IndexType* indices, CornerLayout& layout, RawDataAcessor<vec3>& pos,
+		RawDataAcessor<vec2>& uv, std::vector<vec3>& sValues, std::vector<vec3>& tValues)
+	{
+		threading::parallelFor(layout.ranges, 1, [&](size_t begin, size_t end)
+		{
+			std::vector<size_t> cursor(layout.buckets);
+			vec3x4Storage p0;
+			vec3x4Storage p1;
+			vec3x4Storage p2;
+			vec3x4Storage w0;
+			vec3x4Storage w1;
+			vec3x4Storage w2;
+			vec3x4Storage sDirections;
+			vec3x4Storage tDirections;
+
+			for (size_t range = begin; range < end; ++range)
+			{
+				std::copy_n(layout.rangeOffsets.begin() + range * layout.buckets, layout.buckets, cursor.begin());
+
+				for (size_t t = layout.rangeBegin(range), te = layout.rangeEnd(range); t < te; t += Width)
+				{
+					size_t lanes = etMin(size_t(Width), te - t);
+					for (size_t lane = 0; lane < Width; ++lane)
+					{
+						const IndexType* tri = indices + 3 * (t + etMin(lane, lanes - 1));
+						p0.set(lane, pos[static_cast<size_t>(tri[0])]);
+						p1.set(lane, pos[static_cast<size_t>(tri[1])]);
+						p2.set(lane, pos[static_cast<size_t>(tri[2])]);
+						w0.set(lane, vec3(uv[static_cast<size_t>(tri[0])], 0.0f));
+						w1.set(lane, vec3(uv[static_cast<size_t>(tri[1])], 0.0f));
+						w2.set(lane, vec3(uv[static_cast<size_t>(tri[2])], 0.0f));
+					}
+
+					/*
+					 * Same operations in the same order as in serial calculateTangents
+					 */
+					vec3x4 v0 = p0.load();
+					vec3x4 e1 = v4sub(p1.load(), v0);
+					vec3x4 e2 = v4sub(p2.load(), v0);
+
+					vec3x4 uv0 = w0.load();
+					vec3x4 d1 = v4sub(w1.load(), uv0);
+					vec3x4 d2 = v4sub(w2.load(), uv0);
+
+					float4 r = f4div(f4set(1.0f), f4sub(f4mul(d1.x, d2.y), f4mul(d2.x, d1.y)));
+					sDirections.store(v4scale(v4sub(v4scale(e1, d2.y), v4scale(e2, d1.y)), r));
+					tDirections.store(v4scale(v4sub(v4scale(e2, d1.x), v4scale(e1, d2.x)), r));
+
+					for (size_t lane = 0; lane < lanes; ++lane)
+					{
+						const IndexType* tri = indices + 3 * (t + lane);
+						vec3 sdir = sDirections.at(lane);
+						vec3 tdir = tDirections.at(lane);
+
+						for (size_t k = 0; k < 3; ++k)
+						{
+							size_t slot = cursor[tri[k] / layout.bucketSize]++;
+							layout.vertices[slot] = static_cast<uint32_t>(tri[k]);
+							sValues[slot] = sdir;
+							tValues[slot] = tdir;
+						}
+					}
+				}
+			}
+		});
+	}
+
+	/*
+	 * Sums values of corners into bucket-local arrays, marks vertices which were referenced
+	 */
+	void accumulateBucket(const CornerLayout& layout, size_t bucket, const std::vector<vec3>& values,
+		std::vector<vec3>& sums, std::vector<char>& referenced)
+	{
+		size_t firstVertex = bucket * layout.bucketSize;
+
+		sums.assign(layout.bucketSize, vec3(0.0f));
+		referenced.assign(layout.bucketSize, 0);
+
+		for (size_t slot = layout.bucketOffsets[bucket], e = layout.bucketOffsets[bucket + 1]; slot < e; ++slot)
+		{
+			size_t local = layout.vertices[slot] - firstVertex;
+			sums[local] += values[slot];
+			referenced[local] = 1;
+		}
+	}
+
+	void gatherNormals(const CornerLayout& layout, const std::vector<vec3>& values, RawDataAcessor<vec3>& nrm)
+	{
+		threading::parallelFor(layout.buckets, 1, [&](size_t begin, size_t end)
+		{
+			std::vector<vec3> sums;
+			std::vector<char> referenced;
+			vec3x4Storage block;
+
+			for (size_t bucket = begin; bucket < end; ++bucket)
+			{
+				accumulateBucket(layout, bucket, values, sums, referenced);
+
+				size_t firstVertex = bucket * layout.bucketSize;
+				for (size_t i = 0; i < layout.bucketSize; i += Width)
+				{
+					size_t lanes = etMin(size_t(Width), layout.bucketSize - i);
+					for (size_t lane = 0; lane < Width; ++lane)
+						block.set(lane, (lane < lanes) ? sums[i + lane] : vec3(0.0f));
+
+					block.store(v4normalize(block.load()));
+
+					for (size_t lane = 0; lane < lanes; ++lane)
+					{
+						if (referenced[i + lane])
+							nrm[firstVertex + i + lane] = block.at(lane);
+					}
+				}
+			}
+		});
+	}
+
+	void gatherTangents(const CornerLayout& layout, const std::vector<vec3>& sValues,
+		const std::vector<vec3>& tValues, RawDataAcessor<vec3>& nrm, RawDataAcessor<vec3>& tan)
+	{
+		threading::parallelFor(layout.buckets, 1, [&](size_t begin, size_t end)
+		{
+			std::vector<vec3> sSums;
+			std::vector<vec3> tSums;
+			std::vector<char> referenced;
+			vec3x4Storage normals;
+			vec3x4Storage tangents;
+			vec3x4Storage bitangents;
+			vec3x4Storage result;
+			ET_ALIGNED(16) float handedness[Width];
+
+			for (size_t bucket = begin; bucket < end; ++bucket)
+			{
+				accumulateBucket(layout, bucket, tValues, tSums, referenced);
+				accumulateBucket(layout, bucket, sValues, sSums, referenced);
+
+				size_t firstVertex = bucket * layout.bucketSize;
+				for (size_t i = 0; i < layout.bucketSize; i += Width)
+				{
+					size_t lanes = etMin(size_t(Width), layout.bucketSize - i);
+					for (size_t lane = 0; lane < Width; ++lane)
+					{
+						bool valid = (lane < lanes) && referenced[i + lane];
+						normals.set(lane, valid ? nrm[firstVertex + i + lane] : vec3(0.0f));
+						tangents.set(lane, valid ? sSums[i + lane] : vec3(0.0f));
+						bitangents.set(lane, valid ? tSums[i + lane] : vec3(0.0f));
+					}
+
+					vec3x4 n = normals.load();
+					vec3x4 t = tangents.load();
+					vec3x4 orthogonal = v4sub(t, v4scale(n, v4dot(n, t)));
+					result.store(v4normalize(orthogonal));
+					f4store(handedness, v4dot(v4cross(n, t), bitangents.load()));
+
+					for (size_t lane = 0; lane < lanes; ++lane)
+					{
+						if (referenced[i + lane])
+							tan[firstVertex + i + lane] = result.at(lane) * signOrZero(handedness[lane]);
+					}
+				}
+			}
+		});
+	}
+
+	template <typename IndexType>
+	void calculateNormalsTyped(const IndexType* indices, size_t triangles, size_t vertexCount,
+		RawDataAcessor<vec3>& pos, RawDataAcessor<vec3>& nrm, primitives::NormalsWeighting weighting)
+	{
+		CornerLayout layout(triangles, vertexCount);
+		layout.build(indices);
+
+		std::vector<vec3> values(layout.vertices.size());
+		scatterNormals(indices, layout, pos, weighting, values);
+		gatherNormals(layout, values, nrm);
+	}
+
+	template <typename IndexType>
+	void calculateTangentsTyped(const IndexType* indices, size_t triangles, size_t vertexCount,
+		RawDataAcessor<vec3>& pos, RawDataAcessor<vec3>& nrm, RawDataAcessor<vec2>& uv, RawDataAcessor<vec3>& tan)
+	{
+		CornerLayout layout(triangles, vertexCount);
+		layout.build(indices);
+
+		std::vector<vec3> sValues(layout.vertices.size());
+		std::vector<vec3> tValues(layout.vertices.size());
+		scatterTangents(indices, layout, pos, uv, sValues, tValues);
+		gatherTangents(layout, sValues, tValues, nrm, tan);
+	}
+
+	void calculateNormalsParallel(const IndexArray::Pointer& buffer, size_t first, size_t last, size_t vertexCount,
+		RawDataAcessor<vec3>& pos, RawDataAcessor<vec3>& nrm, primitives::NormalsWeighting weighting)
+	{
+		last = etMin(last, buffer->primitivesCount());
+		if (first >= last)
+			return;
+
+		const unsigned char* data = buffer->data() + 3 * first * static_cast<size_t>(buffer->format());
+		size_t triangles = last - first;
+
+		switch (buffer->format())
+		{
+			case IndexArrayFormat::Format_8bit:
+				calculateNormalsTyped(data, triangles, vertexCount, pos, nrm, weighting);
+				break;
+
+			case IndexArrayFormat::Format_16bit:
+				calculateNormalsTyped(reinterpret_cast<const uint16_t*>(data), triangles, vertexCount, pos, nrm, weighting);
+				break;
+
+			case IndexArrayFormat::Format_32bit:
+				calculateNormalsTyped(reinterpret_cast<const uint32_t*>(data), triangles, vertexCount, pos, nrm, weighting);
+				break;
+
+			default:
+				ET_FAIL("Invalid IndexArrayFormat");
+		}
+	}
+
+	void calculateTangentsParallel(const IndexArray::Pointer& buffer, size_t first, size_t last, size_t vertexCount,
+		RawDataAcessor<vec3>& pos, RawDataAcessor<vec3>& nrm, RawDataAcessor<vec2>& uv, RawDataAcessor<vec3>& tan)
+	{
+		last = etMin(last, buffer->primitivesCount());
+		if (first >= last)
+			return;
+
+		const unsigned char* data = buffer->data() + 3 * first * static_cast<size_t>(buffer->format());
+		size_t triangles = last - first;
+
+		switch (buffer->format())
+		{
+			case IndexArrayFormat::Format_8bit:
+				calculateTangentsTyped(data, triangles, vertexCount, pos, nrm, uv, tan);
+				break;
+
+			case IndexArrayFormat::Format_16bit:
+				calculateTangentsTyped(reinterpret_cast<const uint16_t*>(data), triangles, vertexCount, pos, nrm, uv, tan);
+				break;
+
+			case IndexArrayFormat::Format_32bit:
+				calculateTangentsTyped(reinterpret_cast<const uint32_t*>(data), triangles, vertexCount, pos, nrm, uv, tan);
+				break;
+
+			default:
+				ET_FAIL("Invalid IndexArrayFormat");
+		}
+	}
+
+	/*
+	 * Non-triangle primitives and single core devices use serial path,
+	 * angle weighting has no serial counterpart
+	 */
+	bool runSerially(const IndexArray::Pointer& buffer, primitives::NormalsWeighting weighting)
+	{
+		if (buffer->primitiveType() != PrimitiveType::Triangles)
+			return true;
+
+		return (weighting == primitives::NormalsWeighting::Area) && (threading::maxConcurrentThreads() < 2);
+	}
+}
+
+void primitives::calculateNormalsParallel(VertexArray::Pointer data, const IndexArray::Pointer& buffer,
+	size_t first, size_t last, NormalsWeighting weighting)
+{
+	ET_ASSERT(first < last);
+
+	if (runSerially(buffer, weighting))
+	{
+		calculateNormals(data, buffer, first, last);
+		return;
+	}
+
+	VertexDataChunk posChunk = data->chunk(VertexAttributeUsage::Position);
+	VertexDataChunk nrmChunk = data->chunk(VertexAttributeUsage::Normal);
+
+	if (posChunk.invalid() || (posChunk->type() != VertexAttributeType::Vec3) || !nrmChunk.valid() ||
+		(nrmChunk->type() != VertexAttributeType::Vec3))
+	{
+		log::error("primitives::calculateNormalsParallel - data is invalid.");
+		return;
+	}
+
+	RawDataAcessor<vec3> pos = posChunk.accessData<vec3>(0);
+	RawDataAcessor<vec3> nrm = nrmChunk.accessData<vec3>(0);
+	::calculateNormalsParallel(buffer, first, last, data->size(), pos, nrm, weighting);
+}
+
+void primitives::calculateNormalsParallel(VertexStorage::Pointer data, const IndexArray::Pointer& buffer,
+	size_t first, size_t last, NormalsWeighting weighting)
+{
+	ET_ASSERT(first < last);
+
+	if (runSerially(buffer, weighting))
+	{
+		calculateNormals(data, buffer, first, last);
+		return;
+	}
+
+	if (!data->hasAttributeWithType(VertexAttributeUsage::Position, VertexAttributeType::Vec3))
+	{
+		log::error("primitives::calculateNormalsParallel - vertex storage does not contain positions of type vec3.");
+		return;
+	}
+	if (!data->hasAttributeWithType(VertexAttributeUsage::Normal, VertexAttributeType::Vec3))
+	{
+		log::error("primitives::calculateNormalsParallel - vertex storage does not contain normals of type vec3.");
+		return;
+	}
+
+	RawDataAcessor<vec3> pos = data->accessData<VertexAttributeType::Vec3>(VertexAttributeUsage::Position, 0);
+	RawDataAcessor<vec3> nrm = data->accessData<VertexAttributeType::Vec3>(VertexAttributeUsage::Normal, 0);
+	::calculateNormalsParallel(buffer, first, last, data->capacity(), pos, nrm, weighting);
+}
+
+void primitives::calculateTangentsParallel(VertexArray::Pointer data, const IndexArray::Pointer& buffer,
+	uint32_t first, uint32_t last)
+{
+	ET_ASSERT(first < last);
+
+	if (runSerially(buffer, NormalsWeighting::Area))
+	{
+		calculateTangents(data, buffer, first, last);
+		return;
+	}
+
+	VertexDataChunk posChunk = data->chunk(VertexAttributeUsage::Position);
+	VertexDataChunk nrmChunk = data->chunk(VertexAttributeUsage::Normal);
+	VertexDataChunk uvChunk = data->chunk(VertexAttributeUsage::TexCoord0);
+	VertexDataChunk tanChunk = data->chunk(VertexAttributeUsage::Tangent);
+
+	if (posChunk.invalid() || (posChunk->type() != VertexAttributeType::Vec3) ||
+		nrmChunk.invalid() || (nrmChunk->type() != VertexAttributeType::Vec3) ||
+		tanChunk.invalid() || (tanChunk->type() != VertexAttributeType::Vec3) ||
+		uvChunk.invalid() || (uvChunk->type() != VertexAttributeType::Vec2))
+	{
+		log::error("primitives::calculateTangentsParallel - data is invalid.");
+		return;
+	}
+
+	RawDataAcessor<vec3> pos = posChunk.accessData<vec3>(0);
+	RawDataAcessor<vec3> nrm = nrmChunk.accessData<vec3>(0);
+	RawDataAcessor<vec3> tan = tanChunk.accessData<vec3>(0);
+	RawDataAcessor<vec2> uv = uvChunk.accessData<vec2>(0);
+	::calculateTangentsParallel(buffer, first, last, data->size(), pos, nrm, uv, tan);
+}
+
+void primitives::calculateTangentsParallel(VertexStorage::Pointer data, const IndexArray::Pointer& buffer,
+	uint32_t first, uint32_t last)
+{
+	ET_ASSERT(first < last);
+
+	if (runSerially(buffer, NormalsWeighting::Area))
+	{
+		calculateTangents(data, buffer, first, last);
+		return;
+	}
+
+	if (!data->hasAttributeWithType(VertexAttributeUsage::Position, VertexAttributeType::Vec3))
+	{
+		log::error("primitives::calculateTangentsParallel - vertex storage does not contain positions of type vec3.");
+		return;
+	}
+	if (!data->hasAttributeWithType(VertexAttributeUsage::Normal, VertexAttributeType::Vec3))
+	{
+		log::error("primitives::calculateTangentsParallel - vertex storage does not contain normals of type vec3.");
+		return;
+	}
+	if (!data->hasAttributeWithType(VertexAttributeUsage::TexCoord0, VertexAttributeType::Vec2))
+	{
+		log::error("primitives::calculateTangentsParallel - vertex storage does not contain TexCoord0 of type vec2.");
+		return;
+	}
+	if (!data->hasAttributeWithType(VertexAttributeUsage::Tangent, VertexAttributeType::Vec3))
+	{
+		log::error("primitives::calculateTangentsParallel - vertex storage does not contain tangents of type vec3.");
+		return;
+	}
+
+	RawDataAcessor<vec3> pos = data->accessData<VertexAttributeType::Vec3>(VertexAttributeUsage::Position, 0);
+	RawDataAcessor<vec3> nrm = data->accessData<VertexAttributeType::Vec3>(VertexAttributeUsage::Normal, 0);
+	RawDataAcessor<vec3> tan = data->accessData<VertexAttributeType::Vec3>(VertexAttributeUsage::Tangent, 0);
+	RawDataAcessor<vec2> uv = data->accessData<VertexAttributeType::Vec2>(VertexAttributeUsage::TexCoord0, 0);
+	::calculateTangentsParallel(buffer, first, last, data->capacity(), pos, nrm, uv, tan);
+}
@@ -0,0 +1,288 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <functional>
+#include <et/rendering/rendercontext.h>
+#include <et/rendering/drawcommandbuffer.h>
+
+using namespace et;
+
+namespace
+{
+	template <typename T>
+	int comparePointers(const T* l, const T* r)
+		{ return std::less<const T*>()(l, r) ? -1 : (std::less<const T*>()(r, l) ? 1 : 0); }
+
+	int compareState(const DrawCommandBuffer::Packet& l, const DrawCommandBuffer::Packet& r)
+	{
+		int result = comparePointers(l.program, r.program);
+
+		for (size_t i = 0; (result == 0) && (i < DrawCommandBuffer::MaxTextures); ++i)
+			result = comparePointers(l.textures[i], r.textures[i]);
+
+		return (result == 0) ? comparePointers(l.vertexArrayObject, r.vertexArrayObject) : result;
+	}
+
+	class RenderContextBackend : public DrawCommandBuffer::Backend
+	{
+	public:
+		RenderContextBackend(RenderContext* rc) :
+			_rc(rc) { }
+
+		void bindProgram(Program* program) override
+		{
+			_rc->renderState().bindProgram((program == nullptr) ? 0 :
+				static_cast<uint32_t>(program->apiHandle()));
+		}
+
+		void bindVertexArray(VertexArrayObjectData* vao) override
+			{ _rc->renderState().bindVertexArray(VertexArrayObject(vao)); }
+
+		void bindTexture(uint32_t unit, Texture* texture) override
+		{
+			_rc->renderState().bindTexture(unit, static_cast<uint32_t>(texture->apiHandle()),
+				texture->target());
+		}
+
+		void setBlendState(BlendState blend) override
+			{ _rc->renderState().setBlend(blend != BlendState::Disabled, blend); }
+
+		void drawElements(VertexArrayObjectData* vao, uint32_t first, uint32_t count, uint32_t instances) override
+		{
+			if (instances > 1)
+				_rc->renderer()->drawElementsInstanced(vao->indexBuffer(), first, count, instances);
+			else
+				_rc->renderer()->drawElements(vao->indexBuffer(), first, count);
+		}
+
+		void multiDrawElements(VertexArrayObjectData* vao, const uint32_t* first, const uint32_t* count,
+			size_t drawCount) override
+		{
+			_rc->renderer()->multiDrawElements(vao->indexBuffer(), first, count, drawCount);
+		}
+
+	private:
+		RenderContext* _rc = nullptr;
+	};
+
+	/*
+	 * Ranges of these primitives could be joined when one follows another
+	 */
+	bool isListPrimitive(PrimitiveType pt)
+	{
+		return (pt == PrimitiveType::Points) || (pt == PrimitiveType::Lines) ||
+			(pt == PrimitiveType::Triangles) || (pt == PrimitiveType::LinesAdjacency);
+	}
+}
+
+void DrawCommandBuffer::reset()
+{
+	_packets.clear();
+}
+
+void DrawCommandBuffer::record(const Packet& packet)
+{
+	ET_ASSERT(packet.vertexArrayObject != nullptr);
+	ET_ASSERT(packet.vertexArrayObject->indexBuffer().valid());
+
+	if ((packet.indexCount > 0) && (packet.instanceCount > 0))
+		_packets.push_back(packet);
+}
+
+void DrawCommandBuffer::submit(RenderContext* rc)
+{
+	RenderContextBackend backend(rc);
+	submit(backend);
+}
+
+void DrawCommandBuffer::submit(Backend& backend)
+{
+	_statistics = Statistics();
+	_statistics.packets = _packets.size();
+
+	if (_packets.empty())
+		return;
+
+	size_t unsortedStateChanges = countUnsortedStateChanges();
+
+	_sortEntries.resize(_packets.size());
+	for (uint32_t i = 0, e = static_cast<uint32_t>(_packets.size()); i < e; ++i)
+	{
+		SortEntry& entry = _sortEntries[i];
+		entry.key = sortKey(_packets[i], i);
+		entry.firstIndex = _packets[i].firstIndex;
+		entry.packetIndex = i;
+	}
+
+	/*
+	 * Fields of key are truncated handles and hashes, so equal keys
+	 * are ordered by full state to keep packets of the same state together
+	 */
+	std::sort(_sortEntries.begin(), _sortEntries.end(), [this](const SortEntry& l, const SortEntry& r)
+	{
+		if (l.key != r.key)
+			return l.key < r.key;
+
+		int state = compareState(_packets[l.packetIndex], _packets[r.packetIndex]);
+		if (state != 0)
+			return state < 0;
+
+		return (l.firstIndex != r.firstIndex) ? (l.firstIndex < r.firstIndex) : (l.packetIndex < r.packetIndex);
+	});
+
+	BoundState bound;
+	size_t i = 0;
+	while (i < _sortEntries.size())
+	{
+		const Packet& packet = _packets[_sortEntries[i].packetIndex];
+
+		_statistics.stateChanges += applyState(packet, bound, &backend);
+
+		if (packet.callback != nullptr)
+			packet.callback(packet);
+
+		bool joinRanges = isListPrimitive(packet.vertexArrayObject->indexBuffer()->primitiveType());
+
+		_drawFirst.clear();
+		_drawCount.clear();
+		_drawFirst.push_back(packet.firstIndex);
+		_drawCount.push_back(packet.indexCount);
+
+		size_t next = i + 1;
+		while ((next < _sortEntries.size()) && canMerge(packet, _packets[_sortEntries[next].packetIndex]))
+		{
+			const Packet& merged = _packets[_sortEntries[next].packetIndex];
+			if (joinRanges && (_drawFirst.back() + _drawCount.back() == merged.firstIndex))
+			{
+				_drawCount.back() += merged.indexCount;
+			}
+			else
+			{
+				_drawFirst.push_back(merged.firstIndex);
+				_drawCount.push_back(merged.indexCount);
+			}
+			++next;
+		}
+
+		if (_drawFirst.size() == 1)
+		{
+			backend.drawElements(packet.vertexArrayObject, _drawFirst.front(), _drawCount.front(),
+				packet.instanceCount);
+		}
+		else
+		{
+			backend.multiDrawElements(packet.vertexArrayObject, _drawFirst.data(), _drawCount.data(),
+				_drawFirst.size());
+		}
+
+		++_statistics.drawCalls;
+		i = next;
+	}
+
+	_statistics.drawCallsSaved = _statistics.packets - _statistics.drawCalls;
+	if (unsortedStateChanges > _statistics.stateChanges)
+		_statistics.stateChangesSaved = unsortedStateChanges - _statistics.stateChanges;
+
+	reset();
+}
+
+/*
+ * Opaque packets: program, texture set and vertex array object, most expensive change first.
+ * Blended packets go after opaque ones and keep recorded order.
+ */
+uint64_t DrawCommandBuffer::sortKey(const Packet& packet, uint32_t packetIndex) const
+{
+	if (packet.blendState != BlendState::Disabled)
+		return (1ull << 63) | packetIndex;
+
+	uint64_t program = (packet.program == nullptr) ? 0 : (packet.program->apiHandle() & 0xffff);
+
+	uint64_t textures = 0;
+	for (const Texture* texture : packet.textures)
+		textures = 31 * textures + ((texture == nullptr) ? 0 : texture->apiHandle());
+
+	uint64_t vao = (reinterpret_cast<uintptr_t>(packet.vertexArrayObject) >> 4) & 0xffff;
+
+	return (program << 40) | ((textures & 0xffff) << 24) | (vao << 8);
+}
+
+size_t DrawCommandBuffer::applyState(const Packet& packet, BoundState& bound, Backend* backend)
+{
+	size_t changes = 0;
+
+	if (packet.program != bound.program)
+	{
+		bound.program = packet.program;
+		if (backend != nullptr)
+			backend->bindProgram(packet.program);
+		++changes;
+	}
+
+	for (uint32_t unit = 0; unit < MaxTextures; ++unit)
+	{
+		Texture* texture = packet.textures[unit];
+		if ((texture != nullptr) && (texture != bound.textures[unit]))
+		{
+			bound.textures[unit] = texture;
+			if (backend != nullptr)
+				backend->bindTexture(unit, texture);
+			++changes;
+		}
+	}
+
+	if (packet.blendState != bound.blendState)
+	{
+		bound.blendState = packet.blendState;
+		if (backend != nullptr)
+			backend->setBlendState(packet.blendState);
+		++changes;
+	}
+
+	if (packet.vertexArrayObject != bound.vertexArrayObject)
+	{
+		bound.vertexArrayObject = packet.vertexArrayObject;
+		if (backend != nullptr)
+			backend->bindVertexArray(packet.vertexArrayObject);
+		++changes;
+	}
+
+	return changes;
+}
+
+size_t DrawCommandBuffer::countUnsortedStateChanges()
+{
+	BoundState bound;
+
+	size_t changes = 0;
+	for (const Packet& packet : _packets)
+		changes += applyState(packet, bound, nullptr);
+
+	return changes;
+}
+
+bool DrawCommandBuffer::canMerge(const Packet& first, const Packet& next) const
+{
+	if ((first.callback != nullptr) || (next.callback != nullptr))
+		return false;
+
+	if ((first.instanceCount != 1) || (next.instanceCount != 1))
+		return false;
+
+	if ((first.program != next.program) || (first.vertexArrayObject != next.vertexArrayObject) ||
+		(first.blendState != next.blendState))
+	{
+		return false;
+	}
+
+	for (size_t unit = 0; unit < MaxTextures; ++unit)
+	{
+		if (first.textures[unit] != next.textures[unit])
+			return false;
+	}
+
+	return true;
+}
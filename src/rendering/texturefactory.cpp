@@ -78,7 +78,7 @@ std::string TextureFactory::resolveTextureName(const std::string& fileName) cons
 {
 	auto result = application().resolveFileName(fileName);
 
-	if (fileExists(result))
+	if (application().cachedFileExists(result))
 		return result;
 
 	auto fileExt = lowercase(getFileExt(fileName));
@@ -90,7 +90,7 @@ std::string TextureFactory::resolveTextureName(const std::string& fileName) cons
 		result = replaceFileExt(fileName, "." + ext);
 		result = application().resolveFileName(result);
 
-		if (fileExists(result))
+		if (application().cachedFileExists(result))
 			return result;
 	}
 
@@ -106,7 +106,7 @@ Texture::Pointer TextureFactory::loadTexture(const std::string& fileName, Object
 	CriticalSectionScope lock(_csTextureLoading);
 	
 	auto file = resolveTextureName(fileName);
-	if (!fileExists(file))
+	if (!application().cachedFileExists(file))
 		return Texture::Pointer();
 	
 	uint64_t cachedFileProperty = 0;
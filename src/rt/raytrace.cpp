@@ -7,6 +7,7 @@
 
 #include <thread>
 #include <mutex>
+#include <et/core/profiler.h>
 #include <et/rt/raytrace.h>
 #include <et/rt/raytraceobjects.h>
 #include <et/app/application.h>
@@ -94,7 +95,7 @@ namespace
 
 		void buildMaterialAndTriangles(s3d::Scene::Pointer);
 
-		size_t materialIndexWithName(const std::string&);
+		size_t materialIndexWithName(const InternedName&);
 
 		void buildRegions(vec2i size);
 		void estimateRegionsOrder();
@@ -132,6 +133,7 @@ namespace
 		std::vector<std::thread> workerThreads;
 		std::atomic<bool> running;
 		std::vector<rt::Material> materials;
+		std::unordered_map<InternedName, size_t> materialIndices;
 		std::vector<rt::Region> regions;
 		std::mutex regionsLock;
 		std::atomic<size_t> threadCounter;
@@ -241,21 +243,25 @@ void RaytracePrivate::stopWorkerThreads()
 
 void RaytracePrivate::buildMaterialAndTriangles(s3d::Scene::Pointer scene)
 {
+	ET_PROFILE_SCOPE("Raytrace::buildMaterialAndTriangles");
+
 	materials.clear();
+	materialIndices.clear();
 	rt::TriangleList triangles;
 	
-	auto meshes = scene->childrenOfType(s3d::ElementType::Mesh);
-	for (s3d::Mesh::Pointer mesh : meshes)
+	for (s3d::Mesh* mesh : scene->registry().elementsOfType<s3d::Mesh>(s3d::ElementType::Mesh))
 	{
 		auto& vs = mesh->vertexStorage();
 		auto& ia = mesh->indexArray();
 		if (vs.invalid() || ia.invalid()) continue;
 
 		auto meshMaterial = mesh->material();
-		auto materialIndex = materialIndexWithName(meshMaterial->name());
+		InternedName materialName(meshMaterial->name());
+		auto materialIndex = materialIndexWithName(materialName);
 		if (materialIndex == InvalidIndex)
 		{
 			materialIndex = materials.size();
+			materialIndices.emplace(materialName, materialIndex);
 			materials.emplace_back();
 			auto& mat = materials.back();
 			
@@ -310,14 +316,10 @@ void RaytracePrivate::buildMaterialAndTriangles(s3d::Scene::Pointer scene)
 		kdTree.printStructure();
 }
 
-size_t RaytracePrivate::materialIndexWithName(const std::string& n)
+size_t RaytracePrivate::materialIndexWithName(const InternedName& n)
 {
-	for (size_t i = 0, e = materials.size(); i < e; ++i)
-	{
-		if (materials.at(i).name == n)
-			return i;
-	}
-	return InvalidIndex;
+	auto i = materialIndices.find(n);
+	return (i == materialIndices.end()) ? InvalidIndex : i->second;
 }
 
 void RaytracePrivate::buildRegions(vec2i size)
@@ -395,12 +397,16 @@ rt::Region RaytracePrivate::getNextRegion()
  */
 void RaytracePrivate::threadFunction()
 {
+	profiler::setThreadName("Raytrace worker");
+
 	while (running)
 	{
 		auto region = getNextRegion();
 		if (!region.sampled)
 			break;
 
+		ET_PROFILE_SCOPE("Raytrace::region");
+
 		vec2i pixel;
 
 		for (pixel.y = region.origin.y; pixel.y < region.origin.y + region.size.y; ++pixel.y)
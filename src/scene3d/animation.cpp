@@ -38,18 +38,11 @@ void Animation::setFrameRate(float r)
 	_frameRate = r;
 }
 
-void Animation::transformation(float time, vec3& t, quaternion& o, vec3& s) const
+float Animation::normalizedTime(float time) const
 {
 	float d = duration();
-	
 	if (d == 0.0f)
-	{
-		auto mainTransform = _frames.front();
-		t = mainTransform.translation;
-		o = mainTransform.orientation;
-		s = mainTransform.scale;
-		return;
-	}
+		return _startTime;
 	
 	switch (_outOfRangeMode)
 	{
@@ -71,15 +64,27 @@ void Animation::transformation(float time, vec3& t, quaternion& o, vec3& s) cons
 			break;
 	}
 	
-	time = clamp(time, _startTime, _stopTime);
-	
-	int nearestLowerFrame = static_cast<int>(_frames.size()) - 1;
-	for (auto i = _frames.rbegin(), e = _frames.rend(); (i != e) && (nearestLowerFrame >= 0); ++i)
+	return clamp(time, _startTime, _stopTime);
+}
+
+void Animation::transformation(float time, vec3& t, quaternion& o, vec3& s) const
+{
+	if (duration() == 0.0f)
 	{
-		if (i->time <= time) break;
-		--nearestLowerFrame;
+		auto mainTransform = _frames.front();
+		t = mainTransform.translation;
+		o = mainTransform.orientation;
+		s = mainTransform.scale;
+		return;
 	}
 	
+	time = normalizedTime(time);
+	
+	auto upper = std::upper_bound(_frames.begin(), _frames.end(), time,
+		[](float value, const Frame& frame) { return value < frame.time; });
+	
+	int nearestLowerFrame = std::max(0, static_cast<int>(upper - _frames.begin()) - 1);
+	
 	if (static_cast<size_t>(nearestLowerFrame + 1) >= _frames.size())
 	{
 		const auto& frame = _frames.at(nearestLowerFrame);
@@ -0,0 +1,493 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/scene3d/animationsampler.h>
+
+#if (ET_PLATFORM_MAC || ET_PLATFORM_WIN)
+#	include <xmmintrin.h>
+#	define ET_ANIMATION_SSE	1
+#endif
+
+namespace et
+{
+	namespace s3d
+	{
+		enum : size_t
+		{
+			Stream_Lower = 0,
+			Stream_Upper = AnimationClip::Channel_max,
+			Stream_Factor = 2 * AnimationClip::Channel_max,
+			Stream_Weight,
+			Stream_max,
+
+			ParallelRangeSize = 256,
+			CursorLinearSteps = 4
+		};
+
+		inline quaternion alignedOrientation(const quaternion& q, const quaternion& reference)
+			{ return (q.vector.dot(reference.vector) + q.scalar * reference.scalar < 0.0f) ? -q : q; }
+
+		inline quaternion nlerp(const quaternion& a, const quaternion& b, float t)
+		{
+			quaternion result = a * (1.0f - t) + alignedOrientation(b, a) * t;
+			result.normalize();
+			return result;
+		}
+
+		inline float frameError(const Animation::Frame& frame, const Animation::Frame& lower,
+			const Animation::Frame& upper)
+		{
+			float t = (frame.time - lower.time) / (upper.time - lower.time);
+			vec3 dt = mix(lower.translation, upper.translation, t) - frame.translation;
+			vec3 ds = mix(lower.scale, upper.scale, t) - frame.scale;
+			quaternion dq = nlerp(lower.orientation, upper.orientation, t) + (-frame.orientation);
+			vec4 error = maxv(vec4(absv(dt), std::abs(dq.scalar)), vec4(absv(ds), 0.0f));
+			error = maxv(error, vec4(absv(dq.vector), 0.0f));
+			return etMax(etMax(error.x, error.y), etMax(error.z, error.w));
+		}
+	}
+}
+
+using namespace et;
+using namespace et::s3d;
+
+/*
+ * Animation clip
+ */
+AnimationClip::AnimationClip(const Animation& a, Compression compression, float tolerance) :
+	_startTime(a.startTime()), _stopTime(a.stopTime()), _outOfRangeMode(a.outOfRangeMode()),
+	_compression(compression)
+{
+	std::vector<Animation::Frame> frames = a.frames();
+
+	for (size_t i = 1, e = frames.size(); i < e; ++i)
+		frames[i].orientation = alignedOrientation(frames[i].orientation, frames[i - 1].orientation);
+
+	if (tolerance > 0.0f)
+		reduceKeyFrames(frames, tolerance);
+
+	size_t keys = frames.size();
+	_times.reserve(keys);
+	_values.resize(Channel_max * keys);
+	for (size_t i = 0; i < keys; ++i)
+	{
+		const auto& f = frames[i];
+		_times.push_back(f.time);
+		_values[Channel_TranslationX * keys + i] = f.translation.x;
+		_values[Channel_TranslationY * keys + i] = f.translation.y;
+		_values[Channel_TranslationZ * keys + i] = f.translation.z;
+		_values[Channel_OrientationX * keys + i] = f.orientation.vector.x;
+		_values[Channel_OrientationY * keys + i] = f.orientation.vector.y;
+		_values[Channel_OrientationZ * keys + i] = f.orientation.vector.z;
+		_values[Channel_OrientationW * keys + i] = f.orientation.scalar;
+		_values[Channel_ScaleX * keys + i] = f.scale.x;
+		_values[Channel_ScaleY * keys + i] = f.scale.y;
+		_values[Channel_ScaleZ * keys + i] = f.scale.z;
+	}
+
+	if (compression == Compression::Quantized)
+		quantize();
+}
+
+void AnimationClip::reduceKeyFrames(std::vector<Animation::Frame>& frames, float tolerance)
+{
+	if (frames.size() < 3) return;
+
+	std::vector<Animation::Frame> result;
+	result.reserve(frames.size());
+	result.push_back(frames.front());
+
+	size_t lastKept = 0;
+	for (size_t i = 1, e = frames.size() - 1; i < e; ++i)
+	{
+		/*
+		 * Key i could be dropped if all frames between last kept key and key i + 1
+		 * are reproduced by interpolation between them
+		 */
+		const auto& lower = frames[lastKept];
+		const auto& upper = frames[i + 1];
+
+		bool canDrop = (upper.time > lower.time);
+		for (size_t j = lastKept + 1; canDrop && (j <= i); ++j)
+			canDrop = frameError(frames[j], lower, upper) <= tolerance;
+
+		if (!canDrop)
+		{
+			result.push_back(frames[i]);
+			lastKept = i;
+		}
+	}
+
+	result.push_back(frames.back());
+	frames.swap(result);
+}
+
+void AnimationClip::quantize()
+{
+	size_t keys = _times.size();
+	_quantizedValues.resize(_values.size());
+
+	for (size_t c = 0; c < Channel_max; ++c)
+	{
+		const float* values = _values.data() + c * keys;
+
+		float minValue = std::numeric_limits<float>::max();
+		float maxValue = -std::numeric_limits<float>::max();
+		for (size_t i = 0; i < keys; ++i)
+		{
+			minValue = etMin(minValue, values[i]);
+			maxValue = etMax(maxValue, values[i]);
+		}
+
+		float range = maxValue - minValue;
+		_channelOffset[c] = minValue;
+		_channelScale[c] = (range > 0.0f) ? range / 65535.0f : 0.0f;
+
+		float invScale = (range > 0.0f) ? 65535.0f / range : 0.0f;
+		uint16_t* quantized = _quantizedValues.data() + c * keys;
+		for (size_t i = 0; i < keys; ++i)
+			quantized[i] = static_cast<uint16_t>(clamp((values[i] - minValue) * invScale + 0.5f, 0.0f, 65535.0f));
+	}
+
+	_values.clear();
+	_values.shrink_to_fit();
+}
+
+size_t AnimationClip::dataSize() const
+{
+	return _times.size() * sizeof(float) + _values.size() * sizeof(float) +
+		_quantizedValues.size() * sizeof(uint16_t);
+}
+
+float AnimationClip::normalizedTime(float time) const
+{
+	float d = duration();
+	if (d == 0.0f)
+		return _startTime;
+
+	if (_outOfRangeMode == Animation::OutOfRangeMode_Loop)
+	{
+		float timeAspect = time / d;
+		time = _startTime + d * (timeAspect - std::floor(timeAspect));
+	}
+	else if (_outOfRangeMode == Animation::OutOfRangeMode_PingPong)
+	{
+		float timeAspect = time / d;
+		time = _startTime + d * (1.0f - 2.0f * std::abs(0.5f * (timeAspect - 1.0f) - std::floor(0.5f * timeAspect)));
+	}
+
+	return clamp(time, _startTime, _stopTime);
+}
+
+size_t AnimationClip::findKeyFrame(float time, uint32_t& cursor) const
+{
+	ET_ASSERT(!_times.empty());
+
+	size_t lastKey = _times.size() - 1;
+	size_t i = etMin(static_cast<size_t>(cursor), lastKey);
+
+	if (_times[i] <= time)
+	{
+		size_t steps = 0;
+		while ((i < lastKey) && (_times[i + 1] <= time) && (steps++ < CursorLinearSteps))
+			++i;
+
+		if ((i < lastKey) && (_times[i + 1] <= time))
+			i = static_cast<size_t>(std::upper_bound(_times.begin() + i, _times.end(), time) - _times.begin()) - 1;
+	}
+	else
+	{
+		/*
+		 * Time went backwards (looped animation or reset)
+		 */
+		auto upper = std::upper_bound(_times.begin(), _times.begin() + i, time);
+		i = (upper == _times.begin()) ? 0 : static_cast<size_t>(upper - _times.begin()) - 1;
+	}
+
+	cursor = static_cast<uint32_t>(i);
+	return i;
+}
+
+/*
+ * Animation sampler
+ */
+size_t AnimationSampler::addInstance(BaseElement::Pointer element)
+{
+	ET_ASSERT(element.valid());
+
+	size_t index = _instances.size();
+	if (_freeInstances.empty())
+	{
+		_instances.emplace_back();
+	}
+	else
+	{
+		index = _freeInstances.back();
+		_freeInstances.pop_back();
+	}
+
+	_instances[index].element = element;
+	return index;
+}
+
+void AnimationSampler::removeInstance(size_t index)
+{
+	ET_ASSERT(index < _instances.size());
+
+	_instances[index] = Instance();
+	_freeInstances.push_back(index);
+}
+
+void AnimationSampler::setLayer(size_t instance, size_t layer, AnimationClip::Pointer clip, float weight, float speed)
+{
+	ET_ASSERT(instance < _instances.size());
+	ET_ASSERT(layer < MaxLayers);
+
+	Layer& l = _instances[instance].layers[layer];
+	l.clip = clip;
+	l.time = clip.valid() ? clip->startTime() : 0.0f;
+	l.speed = speed;
+	l.weight = weight;
+	l.cursor = 0;
+}
+
+void AnimationSampler::removeLayer(size_t instance, size_t layer)
+{
+	ET_ASSERT(instance < _instances.size());
+	ET_ASSERT(layer < MaxLayers);
+
+	_instances[instance].layers[layer] = Layer();
+}
+
+void AnimationSampler::setLayerWeight(size_t instance, size_t layer, float w)
+{
+	ET_ASSERT((instance < _instances.size()) && (layer < MaxLayers));
+	_instances[instance].layers[layer].weight = w;
+}
+
+void AnimationSampler::setLayerSpeed(size_t instance, size_t layer, float s)
+{
+	ET_ASSERT((instance < _instances.size()) && (layer < MaxLayers));
+	_instances[instance].layers[layer].speed = s;
+}
+
+void AnimationSampler::setLayerTime(size_t instance, size_t layer, float t)
+{
+	ET_ASSERT((instance < _instances.size()) && (layer < MaxLayers));
+	_instances[instance].layers[layer].time = t;
+}
+
+void AnimationSampler::update(float dt)
+{
+	for (auto& instance : _instances)
+	{
+		for (auto& layer : instance.layers)
+			layer.time += layer.speed * dt;
+	}
+
+	sample();
+}
+
+void AnimationSampler::sample()
+{
+	uint32_t totalSamples = 0;
+	for (auto& instance : _instances)
+	{
+		instance.firstSample = totalSamples;
+		instance.samplesCount = 0;
+
+		if (instance.element.invalid()) continue;
+
+		for (const auto& layer : instance.layers)
+		{
+			if (layer.clip.valid() && (layer.clip->keyFramesCount() > 0) && (layer.weight > 0.0f))
+				++instance.samplesCount;
+		}
+		totalSamples += instance.samplesCount;
+	}
+
+	if (totalSamples == 0) return;
+
+	size_t blocks = (totalSamples + 3) / 4;
+	if (4 * blocks > _samplesCapacity)
+	{
+		_samplesCapacity = 4 * blocks;
+		_samples.resize(Stream_max * _samplesCapacity);
+	}
+
+	/*
+	 * Tail of the last block is interpolated too, keep it valid
+	 */
+	for (size_t i = totalSamples; i < 4 * blocks; ++i)
+	{
+		for (size_t s = 0; s < Stream_max; ++s)
+			_samples[s * _samplesCapacity + i] = 1.0f;
+	}
+
+	_transforms.resize(_instances.size());
+
+	threading::parallelFor(_instances.size(), ParallelRangeSize,
+		[this](size_t begin, size_t end) { gatherKeyFrames(begin, end); });
+
+	threading::parallelFor(blocks, ParallelRangeSize / 4,
+		[this](size_t begin, size_t end) { interpolate(begin, end); });
+
+	threading::parallelFor(_instances.size(), ParallelRangeSize,
+		[this](size_t begin, size_t end) { blend(begin, end); });
+
+	/*
+	 * Invalidating transforms touches hierarchy, so it is done on this thread
+	 */
+	for (size_t i = 0, e = _instances.size(); i < e; ++i)
+	{
+		if (_instances[i].samplesCount > 0)
+			_instances[i].element->setAnimationTransform(_transforms[i]);
+	}
+}
+
+void AnimationSampler::gatherKeyFrames(size_t begin, size_t end)
+{
+	float* samples = _samples.data();
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		Instance& instance = _instances[i];
+		if (instance.samplesCount == 0) continue;
+
+		size_t sampleIndex = instance.firstSample;
+		for (Layer& layer : instance.layers)
+		{
+			if (layer.clip.invalid() || (layer.clip->keyFramesCount() == 0) || (layer.weight <= 0.0f)) continue;
+
+			const AnimationClip& clip = layer.clip.reference();
+			float time = clip.normalizedTime(layer.time);
+			size_t lower = clip.findKeyFrame(time, layer.cursor);
+			size_t upper = etMin(lower + 1, clip.keyFramesCount() - 1);
+
+			float interval = clip.keyFrameTime(upper) - clip.keyFrameTime(lower);
+			float factor = (interval > 0.0f) ? clamp((time - clip.keyFrameTime(lower)) / interval, 0.0f, 1.0f) : 0.0f;
+
+			for (size_t c = 0; c < AnimationClip::Channel_max; ++c)
+			{
+				samples[(Stream_Lower + c) * _samplesCapacity + sampleIndex] = clip.value(c, lower);
+				samples[(Stream_Upper + c) * _samplesCapacity + sampleIndex] = clip.value(c, upper);
+			}
+			samples[Stream_Factor * _samplesCapacity + sampleIndex] = factor;
+			samples[Stream_Weight * _samplesCapacity + sampleIndex] = layer.weight;
+			++sampleIndex;
+		}
+	}
+}
+
+void AnimationSampler::interpolate(size_t beginBlock, size_t endBlock)
+{
+	float* samples = _samples.data();
+	const size_t stride = _samplesCapacity;
+
+	float* lower[AnimationClip::Channel_max];
+	const float* upper[AnimationClip::Channel_max];
+	for (size_t c = 0; c < AnimationClip::Channel_max; ++c)
+	{
+		lower[c] = samples + (Stream_Lower + c) * stride;
+		upper[c] = samples + (Stream_Upper + c) * stride;
+	}
+	const float* factors = samples + Stream_Factor * stride;
+
+	/*
+	 * Results are written over lower key values; orientations were made continuous
+	 * when clips were built, so nlerp does not need to check sign of dot product
+	 */
+	for (size_t i = 4 * beginBlock, e = 4 * endBlock; i < e; i += 4)
+	{
+#	if (ET_ANIMATION_SSE)
+		__m128 t = _mm_loadu_ps(factors + i);
+
+		__m128 r[AnimationClip::Channel_max];
+		for (size_t c = 0; c < AnimationClip::Channel_max; ++c)
+		{
+			__m128 a = _mm_loadu_ps(lower[c] + i);
+			__m128 b = _mm_loadu_ps(upper[c] + i);
+			r[c] = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+		}
+
+		__m128 lengthSquared = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(r[AnimationClip::Channel_OrientationX], r[AnimationClip::Channel_OrientationX]),
+				_mm_mul_ps(r[AnimationClip::Channel_OrientationY], r[AnimationClip::Channel_OrientationY])),
+			_mm_add_ps(_mm_mul_ps(r[AnimationClip::Channel_OrientationZ], r[AnimationClip::Channel_OrientationZ]),
+				_mm_mul_ps(r[AnimationClip::Channel_OrientationW], r[AnimationClip::Channel_OrientationW])));
+
+		__m128 length = _mm_sqrt_ps(_mm_max_ps(lengthSquared, _mm_set1_ps(std::numeric_limits<float>::epsilon())));
+		for (size_t c = AnimationClip::Channel_OrientationX; c <= AnimationClip::Channel_OrientationW; ++c)
+			r[c] = _mm_div_ps(r[c], length);
+
+		for (size_t c = 0; c < AnimationClip::Channel_max; ++c)
+			_mm_storeu_ps(lower[c] + i, r[c]);
+#	else
+		for (size_t j = i; j < i + 4; ++j)
+		{
+			float t = factors[j];
+			for (size_t c = 0; c < AnimationClip::Channel_max; ++c)
+				lower[c][j] += (upper[c][j] - lower[c][j]) * t;
+
+			float qx = lower[AnimationClip::Channel_OrientationX][j];
+			float qy = lower[AnimationClip::Channel_OrientationY][j];
+			float qz = lower[AnimationClip::Channel_OrientationZ][j];
+			float qw = lower[AnimationClip::Channel_OrientationW][j];
+			float length = std::sqrt(etMax(qx * qx + qy * qy + qz * qz + qw * qw, std::numeric_limits<float>::epsilon()));
+			for (size_t c = AnimationClip::Channel_OrientationX; c <= AnimationClip::Channel_OrientationW; ++c)
+				lower[c][j] /= length;
+		}
+#	endif
+	}
+}
+
+void AnimationSampler::blend(size_t begin, size_t end)
+{
+	const float* samples = _samples.data();
+	const size_t stride = _samplesCapacity;
+
+	auto value = [samples, stride](size_t channel, size_t sample)
+		{ return samples[(Stream_Lower + channel) * stride + sample]; };
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		const Instance& instance = _instances[i];
+		if (instance.samplesCount == 0) continue;
+
+		vec3 translation(0.0f);
+		vec3 scale(0.0f);
+		quaternion orientation(0.0f, 0.0f, 0.0f, 0.0f);
+		quaternion reference;
+		float totalWeight = 0.0f;
+
+		for (size_t s = instance.firstSample, e = s + instance.samplesCount; s < e; ++s)
+		{
+			float w = samples[Stream_Weight * stride + s];
+
+			quaternion q(value(AnimationClip::Channel_OrientationW, s), value(AnimationClip::Channel_OrientationX, s),
+				value(AnimationClip::Channel_OrientationY, s), value(AnimationClip::Channel_OrientationZ, s));
+
+			if (s == instance.firstSample)
+				reference = q;
+
+			translation += w * vec3(value(AnimationClip::Channel_TranslationX, s),
+				value(AnimationClip::Channel_TranslationY, s), value(AnimationClip::Channel_TranslationZ, s));
+			scale += w * vec3(value(AnimationClip::Channel_ScaleX, s),
+				value(AnimationClip::Channel_ScaleY, s), value(AnimationClip::Channel_ScaleZ, s));
+			orientation = orientation + alignedOrientation(q, reference) * w;
+			totalWeight += w;
+		}
+
+		translation /= totalWeight;
+		scale /= totalWeight;
+		orientation.normalize();
+
+		mat4& m = _transforms[i];
+		m = orientation.toMatrix() * scaleMatrix(scale);
+		m[3] = vec4(translation, 1.0f);
+	}
+}
@@ -31,24 +31,70 @@ BaseElement::BaseElement(const std::string& name, BaseElement* parent) :
 		}
 		setAnimationTime(dt);
 	});
+	
+	if ((parent != nullptr) && (parent->_transformHierarchy != nullptr))
+		parent->_transformHierarchy->invalidateStructure();
+}
+
+BaseElement::~BaseElement()
+{
+	if (_transformHierarchy != nullptr)
+		_transformHierarchy->elementDestroyed(_transformIndex);
 }
 
 void BaseElement::setParent(BaseElement* p)
 {
+	if (_transformHierarchy != nullptr)
+		_transformHierarchy->invalidateStructure();
+	
 	invalidateTransform();
 	ElementHierarchy::setParent(p);
+	
+	if ((p != nullptr) && (p->_transformHierarchy != nullptr))
+		p->_transformHierarchy->invalidateStructure();
 }
 
 void BaseElement::invalidateTransform()
 {
 	ComponentTransformable::invalidateTransform();
 	
+	/*
+	 * Descendants are updated and notified by hierarchy
+	 */
+	if (_transformHierarchy != nullptr)
+	{
+		_transformHierarchy->invalidateLocalTransform(_transformIndex);
+		return;
+	}
+	
 	for (auto i : children())
 		i->invalidateTransform();
 	
 	transformInvalidated();
 }
 
+TransformHierarchy* BaseElement::activeTransformHierarchy()
+{
+	if (_transformHierarchy != nullptr)
+	{
+		_transformHierarchy->update();
+	}
+	else
+	{
+		/*
+		 * Element could be just added to managed tree, update will attach it
+		 */
+		BaseElement* p = parent();
+		while ((p != nullptr) && (p->_transformHierarchy == nullptr))
+			p = p->parent();
+		
+		if (p != nullptr)
+			p->_transformHierarchy->update();
+	}
+	
+	return _transformHierarchy;
+}
+
 void BaseElement::buildTransform()
 {
 	_cachedFinalTransform = localTransform();
@@ -61,12 +107,17 @@ void BaseElement::buildTransform()
 
 const mat4& BaseElement::localTransform()
 {
-	_cachedLocalTransform = _animations.empty() ? transform() : _animationTransform;
+	bool animated = hasFlag(Flag_HasAnimations) || !_animations.empty();
+	_cachedLocalTransform = animated ? _animationTransform : transform();
 	return _cachedLocalTransform;
 }
 
 const mat4& BaseElement::finalTransform()
 {
+	TransformHierarchy* hierarchy = activeTransformHierarchy();
+	if (hierarchy != nullptr)
+		return hierarchy->worldTransform(_transformIndex);
+	
 	if (!transformValid())
 		buildTransform();
 	
@@ -75,6 +126,10 @@ const mat4& BaseElement::finalTransform()
 
 const mat4& BaseElement::finalInverseTransform()
 {
+	TransformHierarchy* hierarchy = activeTransformHierarchy();
+	if (hierarchy != nullptr)
+		return hierarchy->worldInverseTransform(_transformIndex);
+	
 	if (!transformValid())
 		buildTransform();
 	
@@ -86,13 +141,59 @@ bool BaseElement::isKindOf(ElementType t) const
 	return (t == ElementType::DontCare) || (type() == t);
 }
 
+void BaseElement::setName(const std::string& name)
+{
+	ElementHierarchy::setName(name);
+	_internedName = InternedName(name);
+	
+	if (_transformHierarchy != nullptr)
+		_transformHierarchy->invalidateStructure();
+}
+
+const ElementRegistry* BaseElement::activeRegistry() const
+{
+	if (_transformHierarchy == nullptr)
+		return nullptr;
+	
+	/*
+	 * Pending rebuild could detach this element from hierarchy
+	 */
+	const ElementRegistry& registry = _transformHierarchy->registry();
+	return (_transformHierarchy == nullptr) ? nullptr : &registry;
+}
+
+bool BaseElement::hasAncestor(const BaseElement* ancestor) const
+{
+	for (const BaseElement* p = parent(); p != nullptr; p = p->parent())
+	{
+		if (p == ancestor)
+			return true;
+	}
+	return false;
+}
+
 BaseElement::Pointer BaseElement::childWithName(const std::string& name, ElementType ofType, bool assertFail)
 {
-	for (const BaseElement::Pointer& i : children())
+	const ElementRegistry* registry = activeRegistry();
+	if (registry != nullptr)
 	{
-		BaseElement::Pointer element = childWithNameCallback(name, i, ofType);
-		if (element.valid())
-			return element;
+		/*
+		 * Candidates are ordered from root, so the least deep descendant is returned
+		 */
+		for (BaseElement* element : registry->elementsWithName(InternedName::find(name)))
+		{
+			if (element->isKindOf(ofType) && element->hasAncestor(this))
+				return BaseElement::Pointer(element);
+		}
+	}
+	else
+	{
+		for (const BaseElement::Pointer& i : children())
+		{
+			BaseElement::Pointer element = childWithNameCallback(name, i, ofType);
+			if (element.valid())
+				return element;
+		}
 	}
 
 	if (assertFail)
@@ -105,8 +206,24 @@ BaseElement::List BaseElement::childrenOfType(ElementType ofType) const
 {
 	BaseElement::List list;
 	
-	for (const BaseElement::Pointer& i : children())
-		childrenOfTypeCallback(ofType, list, i);
+	const ElementRegistry* registry = (ofType == ElementType::DontCare) ? nullptr : activeRegistry();
+	if (registry != nullptr)
+	{
+		const auto& elements = registry->elementsOfType(ofType);
+		list.reserve(elements.size());
+		
+		bool isRoot = (_transformIndex == 0);
+		for (BaseElement* element : elements)
+		{
+			if ((element != this) && (isRoot || element->hasAncestor(this)))
+				list.emplace_back(element);
+		}
+	}
+	else
+	{
+		for (const BaseElement::Pointer& i : children())
+			childrenOfTypeCallback(ofType, list, i);
+	}
 	
 	return list;
 }
@@ -370,6 +487,13 @@ void BaseElement::setAnimationTime(float t)
 	invalidateTransform();
 }
 
+void BaseElement::setAnimationTransform(const mat4& m)
+{
+	_animationTransform = m;
+	setFlag(Flag_HasAnimations);
+	invalidateTransform();
+}
+
 void BaseElement::setAnimationTimeRecursive(float a)
 {
 	setAnimationTime(a);
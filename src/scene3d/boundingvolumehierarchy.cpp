@@ -0,0 +1,570 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <queue>
+#include <et/scene3d/transformhierarchy.h>
+#include <et/scene3d/boundingvolumehierarchy.h>
+
+#if (ET_PLATFORM_MAC || ET_PLATFORM_WIN)
+#	include <xmmintrin.h>
+#	define ET_BVH_SSE	1
+#endif
+
+namespace et
+{
+	namespace s3d
+	{
+		enum : size_t
+		{
+			ChildrenMask = (1 << BoundingVolumeHierarchy::Arity) - 1
+		};
+
+		const float maxRefittedSurfaceAreaRatio = 2.0f;
+
+		inline bool isLeaf(int32_t child)
+			{ return child < 0; }
+
+		inline uint32_t itemIndex(int32_t child)
+			{ return static_cast<uint32_t>(~child); }
+
+		inline float surfaceArea(const vec3& minVertex, const vec3& maxVertex)
+		{
+			vec3 d = maxv(maxVertex - minVertex, vec3(0.0f));
+			return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+
+		inline float distanceSquared(const vec3& p, const vec3& minVertex, const vec3& maxVertex)
+		{
+			vec3 d = maxv(maxv(minVertex - p, p - maxVertex), vec3(0.0f));
+			return d.dotSelf();
+		}
+	}
+}
+
+using namespace et;
+using namespace et::s3d;
+
+void BoundingVolumeHierarchy::attach(TransformHierarchy* hierarchy)
+{
+	detach();
+	_hierarchy = hierarchy;
+}
+
+void BoundingVolumeHierarchy::detach()
+{
+	_hierarchy = nullptr;
+	_nodes.clear();
+	_items.clear();
+	_itemByElement.clear();
+	_structureVersion = 0;
+}
+
+void BoundingVolumeHierarchy::update()
+{
+	if (_hierarchy == nullptr) return;
+
+	_hierarchy->update();
+
+	if ((_structureVersion != _hierarchy->structureVersion()) || (_items.empty() != _nodes.empty()))
+	{
+		_hierarchy->takeMovedElements(_movedElements);
+		gatherMeshes();
+		rebuild();
+		_structureVersion = _hierarchy->structureVersion();
+	}
+	else
+	{
+		refit();
+	}
+}
+
+void BoundingVolumeHierarchy::gatherMeshes()
+{
+	_items.clear();
+	_itemByElement.assign(_hierarchy->size(), TransformHierarchy::InvalidIndex);
+
+	for (uint32_t i = 0, e = static_cast<uint32_t>(_hierarchy->size()); i < e; ++i)
+	{
+		BaseElement* element = _hierarchy->element(i);
+		if ((element == nullptr) || !(element->isKindOf(ElementType::Mesh) || element->isKindOf(ElementType::SupportMesh)))
+			continue;
+
+		Mesh* mesh = static_cast<Mesh*>(element);
+		if (!mesh->supportData().valid) continue;
+
+		const AABB& box = mesh->boundingBox();
+
+		Item item;
+		item.mesh = mesh;
+		item.minVertex = box.minVertex();
+		item.maxVertex = box.maxVertex();
+		item.centroid = box.center;
+		_itemByElement[i] = static_cast<uint32_t>(_items.size());
+		_items.push_back(item);
+	}
+}
+
+void BoundingVolumeHierarchy::rebuild()
+{
+	_nodes.clear();
+	_builtSurfaceArea = 0.0f;
+
+	if (_items.empty()) return;
+
+	_nodes.reserve(2 * _items.size() / (Arity - 1) + 1);
+
+	_buildItems.resize(_items.size());
+	for (uint32_t i = 0, e = static_cast<uint32_t>(_items.size()); i < e; ++i)
+		_buildItems[i] = i;
+
+	buildNode(_buildItems.data(), _buildItems.size(), 0, 0);
+
+	vec3 minVertex;
+	vec3 maxVertex;
+	nodeBounds(_nodes.front(), minVertex, maxVertex);
+	_builtSurfaceArea = surfaceArea(minVertex, maxVertex);
+}
+
+uint32_t BoundingVolumeHierarchy::buildNode(uint32_t* items, size_t count, uint32_t parent, uint32_t parentSlot)
+{
+	uint32_t nodeIndex = static_cast<uint32_t>(_nodes.size());
+	_nodes.emplace_back();
+	_nodes[nodeIndex].parent = parent;
+	_nodes[nodeIndex].parentSlot = parentSlot;
+
+	/*
+	 * Items are split into (up to) four groups by median of centroids
+	 * along the longest axis, twice
+	 */
+	uint32_t* groups[Arity + 1] = { items, items, items, items, items + count };
+	if (count <= Arity)
+	{
+		for (size_t i = 0; i <= Arity; ++i)
+			groups[i] = items + etMin(i, count);
+	}
+	else
+	{
+		auto split = [this](uint32_t* begin, uint32_t* end) -> uint32_t*
+		{
+			vec3 minCentroid(std::numeric_limits<float>::max());
+			vec3 maxCentroid(-std::numeric_limits<float>::max());
+			for (uint32_t* i = begin; i != end; ++i)
+			{
+				minCentroid = minv(minCentroid, _items[*i].centroid);
+				maxCentroid = maxv(maxCentroid, _items[*i].centroid);
+			}
+
+			vec3 extent = maxCentroid - minCentroid;
+			int axis = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2) : ((extent.y > extent.z) ? 1 : 2);
+
+			uint32_t* middle = begin + (end - begin) / 2;
+			std::nth_element(begin, middle, end, [this, axis](uint32_t a, uint32_t b)
+				{ return _items[a].centroid[axis] < _items[b].centroid[axis]; });
+			return middle;
+		};
+
+		groups[2] = split(items, items + count);
+		groups[1] = split(items, groups[2]);
+		groups[3] = split(groups[2], items + count);
+	}
+
+	for (uint32_t slot = 0; slot < Arity; ++slot)
+	{
+		size_t groupSize = static_cast<size_t>(groups[slot + 1] - groups[slot]);
+		if (groupSize == 0) continue;
+
+		uint32_t childSlot = _nodes[nodeIndex].childrenCount++;
+		if (groupSize == 1)
+		{
+			Item& item = _items[*groups[slot]];
+			item.node = nodeIndex;
+			item.slot = childSlot;
+
+			Node& node = _nodes[nodeIndex];
+			node.children[childSlot] = ~static_cast<int32_t>(*groups[slot]);
+			setChildBounds(node, childSlot, item.minVertex, item.maxVertex);
+		}
+		else
+		{
+			uint32_t child = buildNode(groups[slot], groupSize, nodeIndex, childSlot);
+
+			vec3 minVertex;
+			vec3 maxVertex;
+			nodeBounds(_nodes[child], minVertex, maxVertex);
+
+			Node& node = _nodes[nodeIndex];
+			node.children[childSlot] = static_cast<int32_t>(child);
+			setChildBounds(node, childSlot, minVertex, maxVertex);
+		}
+	}
+
+	return nodeIndex;
+}
+
+void BoundingVolumeHierarchy::refit()
+{
+	_hierarchy->takeMovedElements(_movedElements);
+
+	bool changed = false;
+
+	for (uint32_t element : _movedElements)
+	{
+		uint32_t index = _itemByElement[element];
+		if (index == TransformHierarchy::InvalidIndex) continue;
+
+		Item& item = _items[index];
+		const AABB& box = item.mesh->boundingBox();
+		if ((box.minVertex() == item.minVertex) && (box.maxVertex() == item.maxVertex)) continue;
+
+		item.minVertex = box.minVertex();
+		item.maxVertex = box.maxVertex();
+		item.centroid = box.center;
+		setChildBounds(_nodes[item.node], item.slot, item.minVertex, item.maxVertex);
+		_nodes[item.node].dirty = true;
+		changed = true;
+	}
+
+	if (!changed) return;
+
+	/*
+	 * Nodes are created in depth-first order, so children always follow parents
+	 */
+	for (size_t i = _nodes.size(); i-- > 1;)
+	{
+		Node& node = _nodes[i];
+		if (!node.dirty) continue;
+
+		vec3 minVertex;
+		vec3 maxVertex;
+		nodeBounds(node, minVertex, maxVertex);
+
+		Node& parent = _nodes[node.parent];
+		setChildBounds(parent, node.parentSlot, minVertex, maxVertex);
+		parent.dirty = true;
+		node.dirty = false;
+	}
+	_nodes.front().dirty = false;
+
+	vec3 minVertex;
+	vec3 maxVertex;
+	nodeBounds(_nodes.front(), minVertex, maxVertex);
+	if (surfaceArea(minVertex, maxVertex) > maxRefittedSurfaceAreaRatio * _builtSurfaceArea)
+		rebuild();
+}
+
+void BoundingVolumeHierarchy::setChildBounds(Node& node, size_t slot, const vec3& minVertex, const vec3& maxVertex)
+{
+	node.minX[slot] = minVertex.x;
+	node.minY[slot] = minVertex.y;
+	node.minZ[slot] = minVertex.z;
+	node.maxX[slot] = maxVertex.x;
+	node.maxY[slot] = maxVertex.y;
+	node.maxZ[slot] = maxVertex.z;
+}
+
+void BoundingVolumeHierarchy::nodeBounds(const Node& node, vec3& minVertex, vec3& maxVertex) const
+{
+	minVertex = vec3(std::numeric_limits<float>::max());
+	maxVertex = vec3(-std::numeric_limits<float>::max());
+	for (uint32_t i = 0; i < node.childrenCount; ++i)
+	{
+		minVertex = minv(minVertex, vec3(node.minX[i], node.minY[i], node.minZ[i]));
+		maxVertex = maxv(maxVertex, vec3(node.maxX[i], node.maxY[i], node.maxZ[i]));
+	}
+}
+
+void BoundingVolumeHierarchy::collectItems(int32_t child, std::vector<Mesh*>& result) const
+{
+	if (isLeaf(child))
+	{
+		result.push_back(_items[itemIndex(child)].mesh);
+		return;
+	}
+
+	const Node& node = _nodes[child];
+	for (uint32_t i = 0; i < node.childrenCount; ++i)
+		collectItems(node.children[i], result);
+}
+
+void BoundingVolumeHierarchy::query(const Frustum& frustum, std::vector<Mesh*>& result)
+{
+	update();
+	if (_nodes.empty()) return;
+
+	const auto& planes = frustum.planes();
+
+	_stack.clear();
+	_stack.push_back(0);
+	while (!_stack.empty())
+	{
+		const Node& node = _nodes[_stack.back()];
+		_stack.pop_back();
+
+		/*
+		 * Box is outside of plane if its vertex farthest along plane normal is behind it,
+		 * and inside if the nearest one is in front of it
+		 */
+		uint32_t outsideMask = 0;
+		uint32_t insideMask = ChildrenMask;
+		for (const vec4& p : planes)
+		{
+			const float* farX = (p.x > 0.0f) ? node.maxX : node.minX;
+			const float* farY = (p.y > 0.0f) ? node.maxY : node.minY;
+			const float* farZ = (p.z > 0.0f) ? node.maxZ : node.minZ;
+			const float* nearX = (p.x > 0.0f) ? node.minX : node.maxX;
+			const float* nearY = (p.y > 0.0f) ? node.minY : node.maxY;
+			const float* nearZ = (p.z > 0.0f) ? node.minZ : node.maxZ;
+#		if (ET_BVH_SSE)
+			__m128 nx = _mm_set1_ps(p.x);
+			__m128 ny = _mm_set1_ps(p.y);
+			__m128 nz = _mm_set1_ps(p.z);
+			__m128 w = _mm_set1_ps(p.w);
+			__m128 farDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_load_ps(farX)), _mm_mul_ps(ny, _mm_load_ps(farY))),
+				_mm_add_ps(_mm_mul_ps(nz, _mm_load_ps(farZ)), w));
+			__m128 nearDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_load_ps(nearX)), _mm_mul_ps(ny, _mm_load_ps(nearY))),
+				_mm_add_ps(_mm_mul_ps(nz, _mm_load_ps(nearZ)), w));
+			outsideMask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(farDistance, _mm_setzero_ps())));
+			insideMask &= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(nearDistance, _mm_setzero_ps())));
+#		else
+			for (uint32_t i = 0; i < Arity; ++i)
+			{
+				if (p.x * farX[i] + p.y * farY[i] + p.z * farZ[i] + p.w < 0.0f)
+					outsideMask |= 1 << i;
+				if (p.x * nearX[i] + p.y * nearY[i] + p.z * nearZ[i] + p.w < 0.0f)
+					insideMask &= ~(1 << i);
+			}
+#		endif
+		}
+
+		for (uint32_t i = 0; i < node.childrenCount; ++i)
+		{
+			if (outsideMask & (1 << i)) continue;
+
+			int32_t child = node.children[i];
+			if (isLeaf(child) || (insideMask & (1 << i)))
+				collectItems(child, result);
+			else
+				_stack.push_back(child);
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::query(const AABB& box, std::vector<Mesh*>& result)
+{
+	update();
+	if (_nodes.empty()) return;
+
+	vec3 boxMin = box.center - box.halfDimension;
+	vec3 boxMax = box.center + box.halfDimension;
+
+	_stack.clear();
+	_stack.push_back(0);
+	while (!_stack.empty())
+	{
+		const Node& node = _nodes[_stack.back()];
+		_stack.pop_back();
+
+		uint32_t overlapMask = 0;
+#	if (ET_BVH_SSE)
+		__m128 overlap = _mm_and_ps(
+			_mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minX), _mm_set1_ps(boxMax.x)),
+				_mm_cmpge_ps(_mm_load_ps(node.maxX), _mm_set1_ps(boxMin.x))),
+			_mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minY), _mm_set1_ps(boxMax.y)),
+				_mm_cmpge_ps(_mm_load_ps(node.maxY), _mm_set1_ps(boxMin.y))));
+		overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minZ), _mm_set1_ps(boxMax.z)),
+			_mm_cmpge_ps(_mm_load_ps(node.maxZ), _mm_set1_ps(boxMin.z))));
+		overlapMask = static_cast<uint32_t>(_mm_movemask_ps(overlap));
+#	else
+		for (uint32_t i = 0; i < Arity; ++i)
+		{
+			if ((node.minX[i] <= boxMax.x) && (node.maxX[i] >= boxMin.x) &&
+				(node.minY[i] <= boxMax.y) && (node.maxY[i] >= boxMin.y) &&
+				(node.minZ[i] <= boxMax.z) && (node.maxZ[i] >= boxMin.z))
+			{
+				overlapMask |= 1 << i;
+			}
+		}
+#	endif
+
+		for (uint32_t i = 0; i < node.childrenCount; ++i)
+		{
+			if ((overlapMask & (1 << i)) == 0) continue;
+
+			int32_t child = node.children[i];
+			if (isLeaf(child))
+				result.push_back(_items[itemIndex(child)].mesh);
+			else
+				_stack.push_back(child);
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::query(const Sphere& sphere, std::vector<Mesh*>& result)
+{
+	update();
+	if (_nodes.empty()) return;
+
+	const vec3& c = sphere.center();
+	float radiusSquared = sqr(sphere.radius());
+
+	_stack.clear();
+	_stack.push_back(0);
+	while (!_stack.empty())
+	{
+		const Node& node = _nodes[_stack.back()];
+		_stack.pop_back();
+
+		uint32_t overlapMask = 0;
+#	if (ET_BVH_SSE)
+		__m128 zero = _mm_setzero_ps();
+		__m128 cx = _mm_set1_ps(c.x);
+		__m128 cy = _mm_set1_ps(c.y);
+		__m128 cz = _mm_set1_ps(c.z);
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.minX), cx), _mm_sub_ps(cx, _mm_load_ps(node.maxX))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.minY), cy), _mm_sub_ps(cy, _mm_load_ps(node.maxY))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.minZ), cz), _mm_sub_ps(cz, _mm_load_ps(node.maxZ))), zero);
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		overlapMask = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(d, _mm_set1_ps(radiusSquared))));
+#	else
+		for (uint32_t i = 0; i < Arity; ++i)
+		{
+			vec3 minVertex(node.minX[i], node.minY[i], node.minZ[i]);
+			vec3 maxVertex(node.maxX[i], node.maxY[i], node.maxZ[i]);
+			if (distanceSquared(c, minVertex, maxVertex) <= radiusSquared)
+				overlapMask |= 1 << i;
+		}
+#	endif
+
+		for (uint32_t i = 0; i < node.childrenCount; ++i)
+		{
+			if ((overlapMask & (1 << i)) == 0) continue;
+
+			int32_t child = node.children[i];
+			if (isLeaf(child))
+				result.push_back(_items[itemIndex(child)].mesh);
+			else
+				_stack.push_back(child);
+		}
+	}
+}
+
+Mesh* BoundingVolumeHierarchy::pick(const ray3d& ray, float* distance)
+{
+	update();
+	if (_nodes.empty()) return nullptr;
+
+	vec3 invDirection(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+	float closestDistance = std::numeric_limits<float>::max();
+	Mesh* closestMesh = nullptr;
+
+	_stack.clear();
+	_stack.push_back(0);
+	while (!_stack.empty())
+	{
+		const Node& node = _nodes[_stack.back()];
+		_stack.pop_back();
+
+		ET_ALIGNED(16) float entry[Arity];
+		ET_ALIGNED(16) float exit[Arity];
+#	if (ET_BVH_SSE)
+		__m128 ox = _mm_set1_ps(ray.origin.x);
+		__m128 oy = _mm_set1_ps(ray.origin.y);
+		__m128 oz = _mm_set1_ps(ray.origin.z);
+		__m128 ix = _mm_set1_ps(invDirection.x);
+		__m128 iy = _mm_set1_ps(invDirection.y);
+		__m128 iz = _mm_set1_ps(invDirection.z);
+		__m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), ox), ix);
+		__m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), ox), ix);
+		__m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), oy), iy);
+		__m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), oy), iy);
+		__m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), oz), iz);
+		__m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), oz), iz);
+		__m128 tEntry = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)),
+			_mm_max_ps(_mm_min_ps(tz0, tz1), _mm_setzero_ps()));
+		__m128 tExit = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)), _mm_max_ps(tz0, tz1));
+		_mm_store_ps(entry, tEntry);
+		_mm_store_ps(exit, tExit);
+#	else
+		for (uint32_t i = 0; i < Arity; ++i)
+		{
+			float tx0 = (node.minX[i] - ray.origin.x) * invDirection.x;
+			float tx1 = (node.maxX[i] - ray.origin.x) * invDirection.x;
+			float ty0 = (node.minY[i] - ray.origin.y) * invDirection.y;
+			float ty1 = (node.maxY[i] - ray.origin.y) * invDirection.y;
+			float tz0 = (node.minZ[i] - ray.origin.z) * invDirection.z;
+			float tz1 = (node.maxZ[i] - ray.origin.z) * invDirection.z;
+			entry[i] = etMax(etMax(etMin(tx0, tx1), etMin(ty0, ty1)), etMax(etMin(tz0, tz1), 0.0f));
+			exit[i] = etMin(etMin(etMax(tx0, tx1), etMax(ty0, ty1)), etMax(tz0, tz1));
+		}
+#	endif
+
+		/*
+		 * Farther children are pushed first, so closer ones are visited earlier
+		 * and shrink closestDistance
+		 */
+		uint32_t order[Arity] = { 0, 1, 2, 3 };
+		std::sort(order, order + node.childrenCount, [&entry](uint32_t a, uint32_t b)
+			{ return entry[a] > entry[b]; });
+
+		for (uint32_t k = 0; k < node.childrenCount; ++k)
+		{
+			uint32_t i = order[k];
+			if ((exit[i] < entry[i]) || (entry[i] >= closestDistance)) continue;
+
+			int32_t child = node.children[i];
+			if (isLeaf(child))
+			{
+				closestDistance = entry[i];
+				closestMesh = _items[itemIndex(child)].mesh;
+			}
+			else
+			{
+				_stack.push_back(child);
+			}
+		}
+	}
+
+	if ((closestMesh != nullptr) && (distance != nullptr))
+		*distance = closestDistance;
+
+	return closestMesh;
+}
+
+void BoundingVolumeHierarchy::nearest(const vec3& point, size_t count, std::vector<Mesh*>& result)
+{
+	update();
+	if (_nodes.empty() || (count == 0)) return;
+
+	typedef std::pair<float, int32_t> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+	queue.emplace(0.0f, 0);
+
+	size_t found = 0;
+	while (!queue.empty() && (found < count))
+	{
+		int32_t current = queue.top().second;
+		queue.pop();
+
+		/*
+		 * Leaves are queued with exact distance, so they are popped in order
+		 */
+		if (isLeaf(current))
+		{
+			result.push_back(_items[itemIndex(current)].mesh);
+			++found;
+			continue;
+		}
+
+		const Node& node = _nodes[current];
+		for (uint32_t i = 0; i < node.childrenCount; ++i)
+		{
+			vec3 minVertex(node.minX[i], node.minY[i], node.minZ[i]);
+			vec3 maxVertex(node.maxX[i], node.maxY[i], node.maxZ[i]);
+			queue.emplace(distanceSquared(point, minVertex, maxVertex), node.children[i]);
+		}
+	}
+}
@@ -0,0 +1,60 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/scene3d/baseelement.h>
+#include <et/scene3d/elementregistry.h>
+
+using namespace et;
+using namespace et::s3d;
+
+void ElementRegistry::clear()
+{
+	for (auto& list : _elementsByType)
+		list.clear();
+
+	_elementsByName.clear();
+}
+
+void ElementRegistry::rebuild(const ElementList& elements)
+{
+	clear();
+
+	for (BaseElement* element : elements)
+	{
+		if (element == nullptr) continue;
+
+		uint32_t typeIndex = static_cast<uint32_t>(element->type());
+		if (typeIndex < ElementType_Max)
+			_elementsByType[typeIndex].push_back(element);
+
+		if (!element->internedName().empty())
+			_elementsByName[element->internedName()].push_back(element);
+	}
+}
+
+const ElementRegistry::ElementList& ElementRegistry::elementsOfType(ElementType t) const
+{
+	uint32_t typeIndex = static_cast<uint32_t>(t);
+	return (typeIndex < ElementType_Max) ? _elementsByType[typeIndex] : _emptyList;
+}
+
+BaseElement* ElementRegistry::elementWithName(const InternedName& name, ElementType ofType) const
+{
+	for (BaseElement* element : elementsWithName(name))
+	{
+		if (element->isKindOf(ofType))
+			return element;
+	}
+
+	return nullptr;
+}
+
+const ElementRegistry::ElementList& ElementRegistry::elementsWithName(const InternedName& name) const
+{
+	auto i = _elementsByName.find(name);
+	return (i == _elementsByName.end()) ? _emptyList : i->second;
+}
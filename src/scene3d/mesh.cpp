@@ -10,6 +10,11 @@
 #include <et/scene3d/mesh.h>
 #include <et/scene3d/storage.h>
 
+#if (ET_PLATFORM_MAC || ET_PLATFORM_WIN)
+#	include <xmmintrin.h>
+#	define ET_SKINNING_SSE	1
+#endif
+
 using namespace et;
 using namespace et::s3d;
 
@@ -322,9 +327,12 @@ const Sphere& Mesh::boundingSphereUntransformed()
 
 const Sphere& Mesh::boundingSphere()
 {
+	/*
+	 * Transform is requested first, so pending hierarchy updates are applied
+	 */
+	const auto& ft = finalTransform();
 	if (_shouldUpdateBoundingSphere && _supportData.valid)
 	{
-		const auto& ft = finalTransform();
 		_cachedBoundingSphere = Sphere(ft * _supportData.averageCenter,
 			finalTransformScale() * _supportData.boundingSphereRadius);
 		_shouldUpdateBoundingSphere = false;
@@ -334,6 +342,7 @@ const Sphere& Mesh::boundingSphere()
 
 const AABB& Mesh::boundingBox()
 {
+	const auto& ft = finalTransform();
 	if (_shouldUpdateBoundingBox && _supportData.valid)
 	{
 		AABB originalAABB = AABB(_supportData.averageCenter, 0.5f * _supportData.dimensions);
@@ -341,7 +350,6 @@ const AABB& Mesh::boundingBox()
 		vec3 minVertex(+std::numeric_limits<float>::max());
 		vec3 maxVertex(-std::numeric_limits<float>::max());
 		
-		const auto& ft = finalTransform();
 		for (size_t i = 0; i < AABBCorner_max; ++i)
 		{
 			vec3 transformedCorner = ft * originalAABB.corners[i];
@@ -358,9 +366,9 @@ const AABB& Mesh::boundingBox()
 
 const OBB& Mesh::orientedBoundingBox()
 {
+	mat4 ft = finalTransform();
 	if (_shouldUpdateOrientedBoundingBox)
 	{
-		mat4 ft = finalTransform();
 		mat3 r = ft.mat3();
 		vec3 s = removeMatrixScale(r);
 		_cachedOrientedBoundingBox = OBB(ft * _supportData.averageCenter, 0.5f * s * _supportData.dimensions, r);
@@ -385,104 +393,106 @@ const std::vector<mat4>& Mesh::deformationMatrices()
  * Bake deformations + stuff for it
  */
 
-template <VertexAttributeType attribType>
-void copyAttributeWithType(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib)
+namespace
 {
-	auto c0 = from->accessData<attribType>(attrib, 0);
-	auto c1 = to->accessData<attribType>(attrib, 0);
-	for (size_t i = 0; i < from->capacity(); ++i)
-		c1[i] = c0[i];
-}
+	const size_t missingAttribute = std::numeric_limits<size_t>::max();
+	const size_t deformationRangeSize = 2048;
 
-void copyAttribute(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib)
-{
-	if (!from->hasAttribute(attrib)) return;
-	
-	switch (from->attributeType(attrib))
+	struct DeformationLayout
 	{
-		case VertexAttributeType::Float:
-			copyAttributeWithType<VertexAttributeType::Float>(from, to, attrib);
-			break;
-		case VertexAttributeType::Int:
-			copyAttributeWithType<VertexAttributeType::Int>(from, to, attrib);
-			break;
-		case VertexAttributeType::Vec2:
-			copyAttributeWithType<VertexAttributeType::Vec2>(from, to, attrib);
-			break;
-		case VertexAttributeType::Vec3:
-			copyAttributeWithType<VertexAttributeType::Vec3>(from, to, attrib);
-			break;
-		case VertexAttributeType::Vec4:
-			copyAttributeWithType<VertexAttributeType::Vec4>(from, to, attrib);
-			break;
-		case VertexAttributeType::IntVec2:
-			copyAttributeWithType<VertexAttributeType::IntVec2>(from, to, attrib);
-			break;
-		case VertexAttributeType::IntVec3:
-			copyAttributeWithType<VertexAttributeType::IntVec3>(from, to, attrib);
-			break;
-		case VertexAttributeType::IntVec4:
-			copyAttributeWithType<VertexAttributeType::IntVec4>(from, to, attrib);
-			break;
-		default:
-			ET_FAIL("Unhandled attribute type");
-	}
-}
-
-void copyVector3Rotated(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib,
-	const mat4& transform)
-{
-	if (!from->hasAttribute(attrib)) return;
-	
-	auto c0 = from->accessData<VertexAttributeType::Vec3>(attrib, 0);
-	auto c1 = to->accessData<VertexAttributeType::Vec3>(attrib, 0);
-	for (size_t i = 0; i < from->capacity(); ++i)
-		c1[i] = transform.rotationMultiply(c0[i]);
-}
-
-void copyVector3Transformed(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib,
-	const mat4& transform)
-{
-	if (!from->hasAttribute(attrib)) return;
-	
-	auto c0 = from->accessData<VertexAttributeType::Vec3>(attrib, 0);
-	auto c1 = to->accessData<VertexAttributeType::Vec3>(attrib, 0);
-	for (size_t i = 0; i < from->capacity(); ++i)
-		c1[i] = transform * c0[i];
-}
-
-void skinVector3Rotated(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib,
-	const std::vector<mat4>& transforms)
-{
-	if (!from->hasAttribute(attrib)) return;
-	
-	auto c0 = from->accessData<VertexAttributeType::Vec3>(attrib, 0);
-	auto c1 = to->accessData<VertexAttributeType::Vec3>(attrib, 0);
-	auto bi = to->accessData<VertexAttributeType::IntVec4>(VertexAttributeUsage::BlendIndices, 0);
-	auto bw = to->accessData<VertexAttributeType::Vec4>(VertexAttributeUsage::BlendWeights, 0);
-	for (size_t i = 0; i < from->capacity(); ++i)
-	{
-		c1[i] =
-			transforms[bi[i][0]].rotationMultiply(c0[i]) * bw[i][0] +
-			transforms[bi[i][1]].rotationMultiply(c0[i]) * bw[i][1] +
-			transforms[bi[i][2]].rotationMultiply(c0[i]) * bw[i][2] +
-			transforms[bi[i][3]].rotationMultiply(c0[i]) * bw[i][3];
-	}
-}
-
-void skinVector3Transformed(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib,
-	const std::vector<mat4>& transforms)
-{
-	if (!from->hasAttribute(attrib)) return;
-	
-	auto c0 = from->accessData<VertexAttributeType::Vec3>(attrib, 0);
-	auto c1 = to->accessData<VertexAttributeType::Vec3>(attrib, 0);
-	auto bi = to->accessData<VertexAttributeType::IntVec4>(VertexAttributeUsage::BlendIndices, 0);
-	auto bw = to->accessData<VertexAttributeType::Vec4>(VertexAttributeUsage::BlendWeights, 0);
-	for (size_t i = 0; i < from->capacity(); ++i)
+		const char* source = nullptr;
+		char* destination = nullptr;
+		size_t stride = 0;
+		size_t vec3Attributes[4] = { missingAttribute, missingAttribute, missingAttribute, missingAttribute };
+		size_t blendIndices = missingAttribute;
+		size_t blendWeights = missingAttribute;
+		const mat4* transforms = nullptr;
+		size_t transformsCount = 0;
+	};
+
+	/*
+	 * First vec3 attribute (position) is transformed, others are rotated.
+	 * Bone matrices are blended once per vertex and assumed to be affine.
+	 */
+	void deformVertices(const DeformationLayout& layout, size_t begin, size_t end)
 	{
-		c1[i] = (transforms[bi[i][0]] * c0[i]) * bw[i][0] + (transforms[bi[i][1]] * c0[i]) * bw[i][1] +
-			(transforms[bi[i][2]] * c0[i]) * bw[i][2] +  (transforms[bi[i][3]] * c0[i]) * bw[i][3];
+		for (size_t i = begin; i < end; ++i)
+		{
+			const char* src = layout.source + i * layout.stride;
+			char* dst = layout.destination + i * layout.stride;
+
+			const mat4* m = layout.transforms;
+			const int32_t* bi = nullptr;
+			const float* bw = nullptr;
+			if (layout.blendIndices != missingAttribute)
+			{
+				bi = reinterpret_cast<const int32_t*>(src + layout.blendIndices);
+				bw = reinterpret_cast<const float*>(src + layout.blendWeights);
+				ET_ASSERT((static_cast<size_t>(bi[0]) < layout.transformsCount) &&
+					(static_cast<size_t>(bi[1]) < layout.transformsCount) &&
+					(static_cast<size_t>(bi[2]) < layout.transformsCount) &&
+					(static_cast<size_t>(bi[3]) < layout.transformsCount));
+			}
+
+#		if (ET_SKINNING_SSE)
+			__m128 c[4];
+			for (size_t k = 0; k < 4; ++k)
+			{
+				if (bi == nullptr)
+				{
+					c[k] = _mm_loadu_ps(m->mat[k].data());
+				}
+				else
+				{
+					c[k] = _mm_add_ps(
+						_mm_add_ps(_mm_mul_ps(_mm_set1_ps(bw[0]), _mm_loadu_ps(m[bi[0]].mat[k].data())),
+							_mm_mul_ps(_mm_set1_ps(bw[1]), _mm_loadu_ps(m[bi[1]].mat[k].data()))),
+						_mm_add_ps(_mm_mul_ps(_mm_set1_ps(bw[2]), _mm_loadu_ps(m[bi[2]].mat[k].data())),
+							_mm_mul_ps(_mm_set1_ps(bw[3]), _mm_loadu_ps(m[bi[3]].mat[k].data()))));
+				}
+			}
+
+			for (size_t a = 0; a < 4; ++a)
+			{
+				if (layout.vec3Attributes[a] == missingAttribute) continue;
+
+				const float* v = reinterpret_cast<const float*>(src + layout.vec3Attributes[a]);
+				float* r = reinterpret_cast<float*>(dst + layout.vec3Attributes[a]);
+
+				__m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[0], _mm_set1_ps(v[0])),
+					_mm_mul_ps(c[1], _mm_set1_ps(v[1]))), _mm_mul_ps(c[2], _mm_set1_ps(v[2])));
+
+				if (a == 0)
+					result = _mm_add_ps(result, c[3]);
+
+				_mm_storel_pi(reinterpret_cast<__m64*>(r), result);
+				_mm_store_ss(r + 2, _mm_movehl_ps(result, result));
+			}
+#		else
+			vec4 c[4];
+			for (size_t k = 0; k < 4; ++k)
+			{
+				c[k] = (bi == nullptr) ? m->mat[k] :
+					m[bi[0]].mat[k] * bw[0] + m[bi[1]].mat[k] * bw[1] + m[bi[2]].mat[k] * bw[2] + m[bi[3]].mat[k] * bw[3];
+			}
+
+			for (size_t a = 0; a < 4; ++a)
+			{
+				if (layout.vec3Attributes[a] == missingAttribute) continue;
+
+				const float* v = reinterpret_cast<const float*>(src + layout.vec3Attributes[a]);
+				float* r = reinterpret_cast<float*>(dst + layout.vec3Attributes[a]);
+
+				vec4 result = c[0] * v[0] + c[1] * v[1] + c[2] * v[2];
+				if (a == 0)
+					result += c[3];
+
+				r[0] = result.x;
+				r[1] = result.y;
+				r[2] = result.z;
+			}
+#		endif
+		}
 	}
 }
 
@@ -494,35 +504,51 @@ bool Mesh::skinned() const
 
 VertexStorage::Pointer Mesh::bakeDeformations()
 {
-	const auto& transforms = deformationMatrices();
-	
 	VertexStorage::Pointer result =
 		VertexStorage::Pointer::create(_vertexStorage->declaration(), _vertexStorage->capacity());
 	
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::Color);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::TexCoord0);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::TexCoord1);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::TexCoord2);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::TexCoord3);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::Smoothing);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::BlendIndices);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::BlendWeights);
+	bakeDeformations(result);
+	return result;
+}
+
+void Mesh::bakeDeformations(VertexStorage::Pointer result)
+{
+	ET_ASSERT(result.valid() && (result->declaration() == _vertexStorage->declaration()) &&
+		(result->capacity() == _vertexStorage->capacity()));
+	
+	etCopyMemory(result->data().data(), _vertexStorage->data().data(), _vertexStorage->data().dataSize());
+	
+	DeformationLayout layout;
+	layout.source = _vertexStorage->data().binary();
+	layout.destination = result->data().binary();
+	layout.stride = _vertexStorage->stride();
+	
+	const VertexAttributeUsage vec3Attributes[] = { VertexAttributeUsage::Position, VertexAttributeUsage::Normal,
+		VertexAttributeUsage::Tangent, VertexAttributeUsage::Binormal };
+	
+	for (size_t a = 0; a < 4; ++a)
+	{
+		if (_vertexStorage->hasAttributeWithType(vec3Attributes[a], VertexAttributeType::Vec3))
+			layout.vec3Attributes[a] = _vertexStorage->offsetOfAttribute(vec3Attributes[a]);
+	}
 	
 	if (skinned())
 	{
-		skinVector3Transformed(_vertexStorage, result, VertexAttributeUsage::Position, transforms);
-		skinVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Normal, transforms);
-		skinVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Tangent, transforms);
-		skinVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Binormal, transforms);
+		const auto& transforms = deformationMatrices();
+		ET_ASSERT(_vertexStorage->hasAttributeWithType(VertexAttributeUsage::BlendIndices, VertexAttributeType::IntVec4));
+		ET_ASSERT(_vertexStorage->hasAttributeWithType(VertexAttributeUsage::BlendWeights, VertexAttributeType::Vec4));
+		
+		layout.blendIndices = _vertexStorage->offsetOfAttribute(VertexAttributeUsage::BlendIndices);
+		layout.blendWeights = _vertexStorage->offsetOfAttribute(VertexAttributeUsage::BlendWeights);
+		layout.transforms = transforms.data();
+		layout.transformsCount = transforms.size();
 	}
 	else
 	{
-		const mat4& ft = finalTransform();
-		copyVector3Transformed(_vertexStorage, result, VertexAttributeUsage::Position, ft);
-		copyVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Normal, ft);
-		copyVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Tangent, ft);
-		copyVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Binormal, ft);
+		layout.transforms = &finalTransform();
+		layout.transformsCount = 1;
 	}
 	
-	return result;
+	threading::parallelFor(_vertexStorage->capacity(), deformationRangeSize, [&layout](size_t begin, size_t end)
+		{ deformVertices(layout, begin, end); });
 }
@@ -12,29 +12,27 @@
 using namespace et;
 using namespace et::s3d;
 
-ParticleSystem::ParticleSystem(RenderContext* rc, size_t maxSize, const std::string& name, BaseElement* parent) :
-	BaseElement(name, parent), _rc(rc), _decl(true, VertexAttributeUsage::Position, VertexAttributeType::Vec3),
-	_emitter(maxSize)
+ParticleSystem::ParticleSystem(RenderContext* rc, size_t maxSize, const std::string& name, BaseElement* parent,
+	StorageMode storageMode) : BaseElement(name, parent), _rc(rc),
+	_decl(true, VertexAttributeUsage::Position, VertexAttributeType::Vec3),
+	_emitter((storageMode == StorageMode::ArrayOfStructures) ? maxSize : 0),
+	_soaEmitter((storageMode == StorageMode::StructureOfArrays) ? maxSize : 0), _storageMode(storageMode)
 {
 	_decl.push_back(VertexAttributeUsage::Color, VertexAttributeType::Vec4);
 
 	/*
-	 * Init geometry
+	 * Vertices are written to streaming buffer of renderer every update
 	 */
-	VertexArray::Pointer va = VertexArray::Pointer::create(_decl, maxSize);
-	IndexArray::Pointer ia = IndexArray::Pointer::create(IndexArrayFormat::Format_16bit, maxSize, PrimitiveType::Points);
-	auto pos = va->chunk(VertexAttributeUsage::Position).accessData<vec3>(0);
-	auto clr = va->chunk(VertexAttributeUsage::Color).accessData<vec4>(0);
-	for (size_t i = 0; i < pos.size(); ++i)
-	{
-		const auto& p = _emitter.particle(i);
-		pos[i] = p.position;
-		clr[i] = p.color;
-	}
-	ia->linearize(va->size());
+	const StreamingBuffer::Pointer& streamingBuffer = rc->renderer()->streamingBuffer();
+	ET_ASSERT(streamingBuffer.valid());
+	
+	IndexArrayFormat indexFormat = (maxSize > 65535) ? IndexArrayFormat::Format_32bit : IndexArrayFormat::Format_16bit;
+	IndexArray::Pointer ia = IndexArray::Pointer::create(indexFormat, maxSize, PrimitiveType::Points);
+	ia->linearize(maxSize);
 	
-	_vao = rc->vertexBufferFactory().createVertexArrayObject(name, va, BufferDrawType::Stream, ia, BufferDrawType::Static);
-	_vertexData = va->generateDescription();
+	_vao = rc->vertexBufferFactory().createVertexArrayObject(name);
+	_vao->setBuffers(VertexBuffer::Pointer::create(rc, _decl, streamingBuffer, name + "-vb"),
+		rc->vertexBufferFactory().createIndexBuffer(name + "-ib", ia, BufferDrawType::Static));
 	
 	_timer.expired.connect(this, &ParticleSystem::onTimerUpdated);
 	_timer.start(currentTimerPool(), 0.0f, NotifyTimer::RepeatForever);
@@ -48,22 +46,64 @@ ParticleSystem* ParticleSystem::duplicate()
 
 void ParticleSystem::onTimerUpdated(NotifyTimer* timer)
 {
-	_emitter.update(timer->actualTime());
-	
-	_rc->renderState().bindVertexArray(_vao);
-	void* bufferData = bufferData = _vao->vertexBuffer()->map(0, _vertexData.data.dataSize(), MapBufferMode::WriteOnly);
-
-	auto posOffset = _decl.elementForUsage(VertexAttributeUsage::Position).offset();
-	auto clrOffset = _decl.elementForUsage(VertexAttributeUsage::Color).offset();
+	if (_storageMode == StorageMode::StructureOfArrays)
+	{
+		_soaEmitter.update(timer->actualTime());
+		
+		ET_ASSERT(_decl.dataSize() == particles::SoAEmitter::VertexSize);
+		
+		StreamingBuffer::Allocation vertices = allocateVertices();
+		if (vertices.valid())
+		{
+			_soaEmitter.writeVertices(vertices.data);
+			setVertexSource(vertices);
+		}
+		return;
+	}
 	
-	RawDataAcessor<vec3> pos(reinterpret_cast<char*>(bufferData), _vertexData.data.dataSize(), _decl.dataSize(), posOffset);
-	RawDataAcessor<vec4> clr(reinterpret_cast<char*>(bufferData), _vertexData.data.dataSize() + clrOffset, _decl.dataSize(), clrOffset);
+	_emitter.update(timer->actualTime());
 	
-	for (size_t i = 0; i < _emitter.activeParticlesCount(); ++i)
+	StreamingBuffer::Allocation vertices = allocateVertices();
+	if (vertices.valid())
 	{
-		const auto& p = _emitter.particle(i);
-		pos[i] = p.position;
-		clr[i] = p.color;
+		auto posOffset = _decl.elementForUsage(VertexAttributeUsage::Position).offset();
+		auto clrOffset = _decl.elementForUsage(VertexAttributeUsage::Color).offset();
+		
+		RawDataAcessor<vec3> pos(reinterpret_cast<char*>(vertices.data), vertices.size, _decl.dataSize(), posOffset);
+		RawDataAcessor<vec4> clr(reinterpret_cast<char*>(vertices.data), vertices.size, _decl.dataSize(), clrOffset);
+		
+		for (size_t i = 0; i < _emitter.activeParticlesCount(); ++i)
+		{
+			const auto& p = _emitter.particle(i);
+			pos[i] = p.position;
+			clr[i] = p.color;
+		}
+		setVertexSource(vertices);
 	}
-	_vao->vertexBuffer()->unmap();
+}
+
+/*
+ * Four vertices are 16-byte aligned, so SoA emitter could write them with aligned stores
+ */
+StreamingBuffer::Allocation ParticleSystem::allocateVertices()
+{
+	size_t vertexCount = activeParticlesCount();
+	if (vertexCount == 0)
+		return StreamingBuffer::Allocation();
+	
+	return _rc->renderer()->streamingBuffer()->allocate(vertexCount * _decl.dataSize(), 4 * _decl.dataSize());
+}
+
+/*
+ * Without persistent mapping vertices are written to staging memory,
+ * they should be uploaded before particles are drawn in this frame
+ */
+void ParticleSystem::setVertexSource(const StreamingBuffer::Allocation& vertices)
+{
+	_rc->renderer()->streamingBuffer()->flush();
+
+	RenderState& rs = _rc->renderState();
+	rs.bindVertexArray(_vao);
+	rs.bindBuffer(_vao->vertexBuffer());
+	rs.setVertexAttributesBaseIndex(_decl, vertices.offset / _decl.dataSize());
 }
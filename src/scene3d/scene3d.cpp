@@ -16,7 +16,8 @@ using namespace s3d;
 Scene::Scene(const std::string& name) :
 	ElementContainer(name, nullptr)
 {
-
+	_transformHierarchy.attach(this);
+	_boundingVolumeHierarchy.attach(&_transformHierarchy);
 }
 
 VertexStorage::Pointer Scene::vertexStorageWithName(const std::string& name)
@@ -0,0 +1,258 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/scene3d/baseelement.h>
+#include <et/scene3d/transformhierarchy.h>
+
+#if (ET_PLATFORM_MAC || ET_PLATFORM_WIN)
+#	include <xmmintrin.h>
+#	define ET_TRANSFORMS_SSE	1
+#endif
+
+namespace et
+{
+	namespace s3d
+	{
+		enum : size_t
+		{
+			ParallelLevelSize = 4096,
+			ParallelRangeSize = 1024
+		};
+
+		/*
+		 * result = a * b, same as mat4::operator *
+		 */
+		inline void multiplyTransforms(const mat4& a, const mat4& b, mat4& result)
+		{
+#		if (ET_TRANSFORMS_SSE)
+			__m128 b0 = _mm_loadu_ps(b[0].data());
+			__m128 b1 = _mm_loadu_ps(b[1].data());
+			__m128 b2 = _mm_loadu_ps(b[2].data());
+			__m128 b3 = _mm_loadu_ps(b[3].data());
+			for (size_t i = 0; i < 4; ++i)
+			{
+				const vec4& r = a[i];
+				_mm_storeu_ps(result[i].data(), _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r.x), b0), _mm_mul_ps(_mm_set1_ps(r.y), b1)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r.z), b2), _mm_mul_ps(_mm_set1_ps(r.w), b3))));
+			}
+#		else
+			result = a * b;
+#		endif
+		}
+	}
+}
+
+using namespace et;
+using namespace et::s3d;
+
+TransformHierarchy::~TransformHierarchy()
+{
+	detach();
+}
+
+void TransformHierarchy::attach(BaseElement* root)
+{
+	detach();
+
+	_root = root;
+	rebuild();
+}
+
+void TransformHierarchy::detach()
+{
+	releaseElements();
+
+	_root = nullptr;
+	_elements.clear();
+	_parents.clear();
+	_localTransforms.clear();
+	_worldTransforms.clear();
+	_worldInverseTransforms.clear();
+	_flags.clear();
+	_movedElements.clear();
+	_levels.clear();
+	_registry.clear();
+	_structureValid = false;
+	_hasDirtyElements = false;
+}
+
+void TransformHierarchy::releaseElements()
+{
+	for (BaseElement* element : _elements)
+	{
+		if (element != nullptr)
+			element->_transformHierarchy = nullptr;
+	}
+}
+
+void TransformHierarchy::rebuild()
+{
+	releaseElements();
+
+	_elements.clear();
+	_parents.clear();
+	_levels.clear();
+
+	if (_root != nullptr)
+	{
+		_elements.push_back(_root);
+		_parents.push_back(InvalidIndex);
+		_levels.push_back(0);
+
+		size_t levelBegin = 0;
+		while (levelBegin < _elements.size())
+		{
+			size_t levelEnd = _elements.size();
+			for (size_t i = levelBegin; i < levelEnd; ++i)
+			{
+				for (auto& child : _elements[i]->children())
+				{
+					_elements.push_back(child.ptr());
+					_parents.push_back(static_cast<uint32_t>(i));
+				}
+			}
+			_levels.push_back(levelEnd);
+			levelBegin = levelEnd;
+		}
+	}
+
+	for (size_t i = 0, e = _elements.size(); i < e; ++i)
+	{
+		_elements[i]->_transformHierarchy = this;
+		_elements[i]->_transformIndex = static_cast<uint32_t>(i);
+	}
+
+	_localTransforms.resize(_elements.size());
+	_worldTransforms.resize(_elements.size());
+	_worldInverseTransforms.resize(_elements.size());
+	_flags.assign(_elements.size(), Flag_LocalDirty);
+	_movedElements.clear();
+	_registry.rebuild(_elements);
+
+	_hasDirtyElements = !_elements.empty();
+	_structureValid = true;
+	++_structureVersion;
+}
+
+const ElementRegistry& TransformHierarchy::registry()
+{
+	if (!_structureValid)
+		rebuild();
+
+	return _registry;
+}
+
+void TransformHierarchy::invalidateLocalTransform(uint32_t index)
+{
+	ET_ASSERT(index < _flags.size());
+
+	_flags[index] |= Flag_LocalDirty;
+	_hasDirtyElements = true;
+}
+
+void TransformHierarchy::elementDestroyed(uint32_t index)
+{
+	ET_ASSERT(index < _elements.size());
+
+	if (_elements[index] == _root)
+		_root = nullptr;
+
+	_elements[index] = nullptr;
+	_structureValid = false;
+}
+
+void TransformHierarchy::update()
+{
+	if (_updating) return;
+
+	if (!_structureValid)
+		rebuild();
+
+	if (!_hasDirtyElements) return;
+
+	_updating = true;
+
+	for (size_t level = 0; level + 1 < _levels.size(); ++level)
+	{
+		size_t levelBegin = _levels[level];
+		size_t levelSize = _levels[level + 1] - levelBegin;
+
+		if (levelSize >= ParallelLevelSize)
+		{
+			threading::parallelFor(levelSize, ParallelRangeSize, [this, levelBegin](size_t begin, size_t end)
+				{ updateRange(levelBegin + begin, levelBegin + end); });
+		}
+		else
+		{
+			updateRange(levelBegin, levelBegin + levelSize);
+		}
+	}
+
+	_hasDirtyElements = false;
+
+	/*
+	 * Notifications are sent after all transforms are valid,
+	 * elements could query any transform from transformInvalidated
+	 */
+	for (size_t i = 0, e = _elements.size(); i < e; ++i)
+	{
+		if (_flags[i] & Flag_WorldChanged)
+		{
+			if ((_flags[i] & Flag_Moved) == 0)
+				_movedElements.push_back(static_cast<uint32_t>(i));
+
+			_flags[i] = static_cast<uint8_t>((_flags[i] & ~Flag_WorldChanged) | Flag_Moved);
+			_elements[i]->transformInvalidated();
+		}
+	}
+
+	_updating = false;
+}
+
+void TransformHierarchy::updateRange(size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		uint8_t flags = _flags[i];
+		uint32_t parent = _parents[i];
+		bool parentChanged = (parent != InvalidIndex) && (_flags[parent] & Flag_WorldChanged);
+
+		if (flags & Flag_LocalDirty)
+			_localTransforms[i] = _elements[i]->localTransform();
+
+		if ((flags & Flag_LocalDirty) || parentChanged)
+		{
+			if (parent == InvalidIndex)
+				_worldTransforms[i] = _localTransforms[i];
+			else
+				multiplyTransforms(_localTransforms[i], _worldTransforms[parent], _worldTransforms[i]);
+
+			_flags[i] = static_cast<uint8_t>(Flag_WorldChanged | (flags & Flag_Moved));
+		}
+	}
+}
+
+void TransformHierarchy::takeMovedElements(std::vector<uint32_t>& elements)
+{
+	elements.clear();
+	elements.swap(_movedElements);
+
+	for (uint32_t i : elements)
+		_flags[i] &= ~Flag_Moved;
+}
+
+const mat4& TransformHierarchy::worldInverseTransform(uint32_t index)
+{
+	if ((_flags[index] & Flag_InverseValid) == 0)
+	{
+		_worldInverseTransforms[index] = _worldTransforms[index].inverse();
+		_flags[index] |= Flag_InverseValid;
+	}
+
+	return _worldInverseTransforms[index];
+}
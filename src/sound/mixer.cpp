@@ -0,0 +1,887 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/core/profiler.h>
+#include <et/sound/sound.h>
+#include <et/sound/mixer.h>
+
+#if (ET_PLATFORM_IOS)
+#	include <arm_neon.h>
+#	define ET_MIXER_NEON	1
+#elif (ET_PLATFORM_MAC || ET_PLATFORM_WIN)
+#	include <emmintrin.h>
+#	define ET_MIXER_SSE		1
+#endif
+
+namespace et
+{
+	namespace audio
+	{
+		enum : size_t
+		{
+			MixerBlockSize = 256,
+			MixerOutputBuffers = 3,
+			MixerOutputBufferFrames = 2048,
+		};
+
+		const float inaudibleVolume = 0.0005f;
+
+		struct MixerVoice
+		{
+			PCMData::Pointer data;
+			uint64_t position = 0;
+			uint64_t step = 0;
+			float pitch = 1.0f;
+			float gain = 0.0f;
+			float targetGain = 0.0f;
+			float gainStep = 0.0f;
+			uint64_t fadeFrames = 0;
+			float pan = 0.0f;
+			uint32_t generation = 1;
+			int priority = 0;
+			bool active = false;
+			bool looped = false;
+			bool audible = false;
+			bool stopRequested = false;
+		};
+
+		class MixerPrivate
+		{
+		public:
+			MixerPrivate(size_t sampleRate, size_t maxAudible, size_t maxVoices);
+
+			MixerVoice* voice(Mixer::Voice);
+			const MixerVoice* voice(Mixer::Voice) const;
+
+			void updateAudibility();
+			void mixBlock(float* output, size_t frames);
+			bool resampleVoice(MixerVoice&, size_t frames);
+			void releaseVoice(size_t index);
+			void computeStep(MixerVoice&);
+
+		public:
+			mutable CriticalSection lock;
+
+			std::vector<MixerVoice> voices;
+			std::vector<uint32_t> freeVoices;
+			std::vector<uint32_t> activeVoices;
+			std::vector<uint32_t> sortedVoices;
+
+			std::vector<float> sourceLeft;
+			std::vector<float> sourceRight;
+			std::vector<float> accumLeft;
+			std::vector<float> accumRight;
+			std::vector<float> floatOutput;
+
+			Mixer::Statistics statistics;
+			size_t sampleRate = 0;
+			size_t maxAudibleVoices = 0;
+
+			ALuint source = 0;
+			ALuint buffers[MixerOutputBuffers] = { };
+			BinaryDataStorage outputData;
+			bool outputStarted = false;
+		};
+
+		void mixWithRamp(float* accum, const float* source, size_t frames, float gainFrom, float gainTo);
+		void convertToInterleaved(const float* left, const float* right, float* output, size_t frames);
+		void convertToInt16(const float* input, int16_t* output, size_t samples);
+
+#	if (ET_MIXER_SSE || ET_MIXER_NEON)
+		/*
+		 * Frames count should be multiple of four, all frames should be inside of data
+		 */
+		void resampleFrames(const int16_t* samples, size_t channels, uint64_t position,
+			uint64_t step, float* left, float* right, size_t frames);
+#	endif
+	}
+}
+
+using namespace et;
+using namespace et::audio;
+
+/*
+ * Voice identifiers are composed of slot index (low 16 bits) and slot generation (high 16 bits),
+ * so stale identifiers never affect voices which reused their slots.
+ */
+inline Mixer::Voice composeVoice(size_t index, uint32_t generation)
+	{ return static_cast<Mixer::Voice>(((generation & 0xffff) << 16) | ((index + 1) & 0xffff)); }
+
+inline size_t voiceIndex(Mixer::Voice v)
+	{ return static_cast<size_t>(v & 0xffff) - 1; }
+
+inline uint32_t voiceGeneration(Mixer::Voice v)
+	{ return (v >> 16) & 0xffff; }
+
+Mixer::Mixer(size_t sampleRate, size_t maxAudibleVoices, size_t maxVoices)
+{
+	ET_PIMPL_INIT(Mixer, sampleRate, maxAudibleVoices, maxVoices)
+}
+
+Mixer::~Mixer()
+{
+	stopOutput();
+	ET_PIMPL_FINALIZE(Mixer)
+}
+
+Mixer::Voice Mixer::play(PCMData::Pointer data, float volume, float pan, int priority, bool looped)
+{
+	if (data.invalid() || (data->frames() == 0))
+		return InvalidVoice;
+
+	CriticalSectionScope scope(_private->lock);
+
+	if (_private->freeVoices.empty())
+	{
+		++_private->statistics.voicesRejected;
+		return InvalidVoice;
+	}
+
+	uint32_t index = _private->freeVoices.back();
+	_private->freeVoices.pop_back();
+
+	MixerVoice& v = _private->voices[index];
+	v.data = data;
+	v.position = 0;
+	v.pitch = 1.0f;
+	v.gain = volume;
+	v.targetGain = volume;
+	v.gainStep = 0.0f;
+	v.fadeFrames = 0;
+	v.pan = clamp(pan, -1.0f, 1.0f);
+	v.priority = priority;
+	v.looped = looped;
+	v.audible = false;
+	v.stopRequested = false;
+	v.active = true;
+	_private->computeStep(v);
+
+	_private->activeVoices.push_back(index);
+	++_private->statistics.voicesStarted;
+
+	return composeVoice(index, v.generation);
+}
+
+void Mixer::stop(Voice id)
+{
+	CriticalSectionScope scope(_private->lock);
+
+	auto v = _private->voice(id);
+	if (v != nullptr)
+		v->stopRequested = true;
+}
+
+void Mixer::stopAll()
+{
+	CriticalSectionScope scope(_private->lock);
+
+	for (auto i : _private->activeVoices)
+		_private->voices[i].stopRequested = true;
+}
+
+void Mixer::setVolume(Voice id, float value, float duration)
+{
+	CriticalSectionScope scope(_private->lock);
+
+	auto v = _private->voice(id);
+	if (v == nullptr) return;
+
+	uint64_t frames = static_cast<uint64_t>(etMax(0.0f, duration) * static_cast<float>(_private->sampleRate));
+	v->targetGain = etMax(0.0f, value);
+	v->fadeFrames = frames;
+
+	if (frames == 0)
+	{
+		v->gain = v->targetGain;
+		v->gainStep = 0.0f;
+	}
+	else
+	{
+		v->gainStep = (v->targetGain - v->gain) / static_cast<float>(frames);
+	}
+}
+
+void Mixer::setPan(Voice id, float pan)
+{
+	CriticalSectionScope scope(_private->lock);
+
+	auto v = _private->voice(id);
+	if (v != nullptr)
+		v->pan = clamp(pan, -1.0f, 1.0f);
+}
+
+void Mixer::setPitch(Voice id, float pitch)
+{
+	CriticalSectionScope scope(_private->lock);
+
+	auto v = _private->voice(id);
+	if (v != nullptr)
+	{
+		v->pitch = etMax(0.0f, pitch);
+		_private->computeStep(*v);
+	}
+}
+
+bool Mixer::playing(Voice id) const
+{
+	CriticalSectionScope scope(_private->lock);
+	return _private->voice(id) != nullptr;
+}
+
+bool Mixer::audible(Voice id) const
+{
+	CriticalSectionScope scope(_private->lock);
+
+	auto v = _private->voice(id);
+	return (v != nullptr) && v->audible;
+}
+
+void Mixer::mix(float* output, size_t frames)
+{
+	ET_PROFILE_SCOPE("Mixer::mix");
+
+	CriticalSectionScope scope(_private->lock);
+
+	uint64_t startTime = profiler::timestamp();
+
+	while (frames > 0)
+	{
+		size_t framesToMix = etMin(frames, static_cast<size_t>(MixerBlockSize));
+		_private->mixBlock(output, framesToMix);
+		output += 2 * framesToMix;
+		frames -= framesToMix;
+		_private->statistics.framesMixed += framesToMix;
+	}
+
+	uint64_t mixTime = profiler::timestamp() - startTime;
+	_private->statistics.mixTimeInNanoseconds += mixTime;
+
+	if (_private->statistics.framesMixed > 0)
+	{
+		double audioTime = 1.0e+9 * static_cast<double>(_private->statistics.framesMixed) /
+			static_cast<double>(_private->sampleRate);
+		_private->statistics.cpuLoad = static_cast<float>(static_cast<double>(_private->statistics.mixTimeInNanoseconds) / audioTime);
+	}
+}
+
+void Mixer::mix(int16_t* output, size_t frames)
+{
+	CriticalSectionScope scope(_private->lock);
+	
+	auto& floatOutput = _private->floatOutput;
+	while (frames > 0)
+	{
+		size_t framesToMix = etMin(frames, static_cast<size_t>(MixerOutputBufferFrames));
+		floatOutput.resize(2 * framesToMix);
+
+		mix(floatOutput.data(), framesToMix);
+		convertToInt16(floatOutput.data(), output, 2 * framesToMix);
+
+		output += 2 * framesToMix;
+		frames -= framesToMix;
+	}
+}
+
+BinaryDataStorage Mixer::renderToWAV(float duration)
+{
+	size_t frames = static_cast<size_t>(etMax(0.0f, duration) * static_cast<float>(_private->sampleRate));
+	uint32_t dataSize = static_cast<uint32_t>(frames * 2 * sizeof(int16_t));
+
+	const uint32_t headerSize = 44;
+	BinaryDataStorage result(headerSize + dataSize, 0);
+
+	auto write16 = [&result](size_t offset, uint16_t value)
+		{ etCopyMemory(result.binary() + offset, &value, sizeof(value)); };
+
+	auto write32 = [&result](size_t offset, uint32_t value)
+		{ etCopyMemory(result.binary() + offset, &value, sizeof(value)); };
+
+	write32(0, ET_COMPOSE_UINT32_INVERTED('R', 'I', 'F', 'F'));
+	write32(4, headerSize - 8 + dataSize);
+	write32(8, ET_COMPOSE_UINT32_INVERTED('W', 'A', 'V', 'E'));
+	write32(12, ET_COMPOSE_UINT32_INVERTED('f', 'm', 't', ' '));
+	write32(16, 16);
+	write16(20, 1);
+	write16(22, 2);
+	write32(24, static_cast<uint32_t>(_private->sampleRate));
+	write32(28, static_cast<uint32_t>(_private->sampleRate * 2 * sizeof(int16_t)));
+	write16(32, 2 * sizeof(int16_t));
+	write16(34, 16);
+	write32(36, ET_COMPOSE_UINT32_INVERTED('d', 'a', 't', 'a'));
+	write32(40, dataSize);
+
+	mix(reinterpret_cast<int16_t*>(result.binary() + headerSize), frames);
+
+	return result;
+}
+
+Mixer::Statistics Mixer::statistics() const
+{
+	CriticalSectionScope scope(_private->lock);
+	return _private->statistics;
+}
+
+void Mixer::resetStatistics()
+{
+	CriticalSectionScope scope(_private->lock);
+
+	auto& s = _private->statistics;
+	s.voicesStarted = 0;
+	s.voicesFinished = 0;
+	s.voicesRejected = 0;
+	s.framesMixed = 0;
+	s.mixTimeInNanoseconds = 0;
+	s.cpuLoad = 0.0f;
+}
+
+size_t Mixer::sampleRate() const
+{
+	return _private->sampleRate;
+}
+
+void Mixer::setMaxAudibleVoices(size_t value)
+{
+	CriticalSectionScope scope(_private->lock);
+	_private->maxAudibleVoices = value;
+}
+
+size_t Mixer::maxAudibleVoices() const
+{
+	return _private->maxAudibleVoices;
+}
+
+void Mixer::startOutput()
+{
+	if (_private->outputStarted) return;
+
+	alGenSources(1, &_private->source);
+	checkOpenALError("alGenSources");
+
+	alGenBuffers(MixerOutputBuffers, _private->buffers);
+	checkOpenALError("alGenBuffers");
+
+	_private->outputData.resize(2 * MixerOutputBufferFrames * sizeof(int16_t));
+	for (size_t i = 0; i < MixerOutputBuffers; ++i)
+	{
+		mix(reinterpret_cast<int16_t*>(_private->outputData.binary()), MixerOutputBufferFrames);
+
+		alBufferData(_private->buffers[i], AL_FORMAT_STEREO16, _private->outputData.data(),
+			static_cast<ALsizei>(_private->outputData.size()), static_cast<ALsizei>(_private->sampleRate));
+		checkOpenALError("alBufferData");
+	}
+
+	alSourceQueueBuffers(_private->source, MixerOutputBuffers, _private->buffers);
+	checkOpenALError("alSourceQueueBuffers");
+
+	alSourcePlay(_private->source);
+	checkOpenALError("alSourcePlay");
+
+	_private->outputStarted = true;
+	manager().streamingThread().addMixer(Mixer::Pointer(this));
+}
+
+void Mixer::stopOutput()
+{
+	if (!_private->outputStarted) return;
+
+	if (atomicCounterValue() > 0)
+		manager().streamingThread().removeMixer(Mixer::Pointer(this));
+
+	alSourceStop(_private->source);
+	checkOpenALError("alSourceStop");
+
+	alSourcei(_private->source, AL_BUFFER, 0);
+	checkOpenALError("alSourcei(..., AL_BUFFER, 0)");
+
+	alDeleteSources(1, &_private->source);
+	checkOpenALError("alDeleteSources");
+
+	alDeleteBuffers(MixerOutputBuffers, _private->buffers);
+	checkOpenALError("alDeleteBuffers");
+
+	_private->source = 0;
+	_private->outputStarted = false;
+}
+
+void Mixer::handleProcessedBuffers()
+{
+	if (!_private->outputStarted) return;
+
+	int processed = 0;
+	alGetSourcei(_private->source, AL_BUFFERS_PROCESSED, &processed);
+	checkOpenALError("alGetSourcei(%d, AL_BUFFERS_PROCESSED, %d)", _private->source, processed);
+
+	while (processed-- > 0)
+	{
+		ALuint buffer = 0;
+		alSourceUnqueueBuffers(_private->source, 1, &buffer);
+		checkOpenALError("alSourceUnqueueBuffers");
+
+		mix(reinterpret_cast<int16_t*>(_private->outputData.binary()), MixerOutputBufferFrames);
+
+		alBufferData(buffer, AL_FORMAT_STEREO16, _private->outputData.data(),
+			static_cast<ALsizei>(_private->outputData.size()), static_cast<ALsizei>(_private->sampleRate));
+		checkOpenALError("alBufferData");
+
+		alSourceQueueBuffers(_private->source, 1, &buffer);
+		checkOpenALError("alSourceQueueBuffers");
+	}
+
+	ALint state = 0;
+	alGetSourcei(_private->source, AL_SOURCE_STATE, &state);
+	if (state != AL_PLAYING)
+	{
+		alSourcePlay(_private->source);
+		checkOpenALError("alSourcePlay");
+	}
+}
+
+float Mixer::timeToNextUpdate() const
+{
+	if (!_private->outputStarted)
+		return std::numeric_limits<float>::max();
+
+	int sampleOffset = 0;
+	alGetSourcei(_private->source, AL_SAMPLE_OFFSET, &sampleOffset);
+	checkOpenALError("alGetSourcei(%d, AL_SAMPLE_OFFSET, %d)", _private->source, sampleOffset);
+
+	size_t offset = static_cast<size_t>(etMax(0, sampleOffset)) % MixerOutputBufferFrames;
+	return static_cast<float>(MixerOutputBufferFrames - offset) / static_cast<float>(_private->sampleRate);
+}
+
+/*
+ * Mixer private
+ */
+MixerPrivate::MixerPrivate(size_t rate, size_t maxAudible, size_t maxVoices) :
+	sampleRate(rate), maxAudibleVoices(maxAudible)
+{
+	ET_ASSERT(maxVoices < 0xffff);
+
+	voices.resize(maxVoices);
+	freeVoices.reserve(maxVoices);
+	activeVoices.reserve(maxVoices);
+	sortedVoices.reserve(maxVoices);
+
+	for (size_t i = maxVoices; i > 0; --i)
+		freeVoices.push_back(static_cast<uint32_t>(i - 1));
+
+	sourceLeft.resize(MixerBlockSize);
+	sourceRight.resize(MixerBlockSize);
+	accumLeft.resize(MixerBlockSize);
+	accumRight.resize(MixerBlockSize);
+}
+
+MixerVoice* MixerPrivate::voice(Mixer::Voice id)
+{
+	size_t index = voiceIndex(id);
+	if ((id == Mixer::InvalidVoice) || (index >= voices.size())) return nullptr;
+
+	MixerVoice& v = voices[index];
+	return (v.active && !v.stopRequested && ((v.generation & 0xffff) == voiceGeneration(id))) ? &v : nullptr;
+}
+
+const MixerVoice* MixerPrivate::voice(Mixer::Voice id) const
+{
+	return const_cast<MixerPrivate*>(this)->voice(id);
+}
+
+void MixerPrivate::computeStep(MixerVoice& v)
+{
+	double ratio = static_cast<double>(v.pitch) * static_cast<double>(v.data->sampleRate()) /
+		static_cast<double>(sampleRate);
+	v.step = static_cast<uint64_t>(ratio * 4294967296.0);
+}
+
+void MixerPrivate::releaseVoice(size_t index)
+{
+	MixerVoice& v = voices[index];
+	v.data.reset(nullptr);
+	v.active = false;
+	v.audible = false;
+	++v.generation;
+	freeVoices.push_back(static_cast<uint32_t>(index));
+	++statistics.voicesFinished;
+}
+
+/*
+ * Chooses voices to be mixed: the most important (by priority and then by volume)
+ * audible voices up to maxAudibleVoices, all others are virtualized.
+ */
+void MixerPrivate::updateAudibility()
+{
+	sortedVoices.clear();
+	for (auto i : activeVoices)
+	{
+		const MixerVoice& v = voices[i];
+		if (etMax(v.gain, v.targetGain) > inaudibleVolume)
+			sortedVoices.push_back(i);
+	}
+
+	auto compare = [this](uint32_t l, uint32_t r)
+	{
+		const MixerVoice& lv = voices[l];
+		const MixerVoice& rv = voices[r];
+		return (lv.priority == rv.priority) ? (lv.targetGain > rv.targetGain) : (lv.priority > rv.priority);
+	};
+
+	if (sortedVoices.size() > maxAudibleVoices)
+	{
+		std::nth_element(sortedVoices.begin(), sortedVoices.begin() + static_cast<ptrdiff_t>(maxAudibleVoices),
+			sortedVoices.end(), compare);
+		sortedVoices.resize(maxAudibleVoices);
+	}
+}
+
+void MixerPrivate::mixBlock(float* output, size_t frames)
+{
+	etFillMemory(accumLeft.data(), 0, frames * sizeof(float));
+	etFillMemory(accumRight.data(), 0, frames * sizeof(float));
+
+	updateAudibility();
+	std::sort(sortedVoices.begin(), sortedVoices.end());
+
+	size_t audibleCount = 0;
+	size_t virtualCount = 0;
+
+	for (auto i : activeVoices)
+	{
+		MixerVoice& v = voices[i];
+
+		bool shouldBeAudible = !v.stopRequested && std::binary_search(sortedVoices.begin(), sortedVoices.end(), i);
+
+		float gainFrom = v.gain;
+		float gainTo = v.gain;
+		if (v.fadeFrames > 0)
+		{
+			uint64_t fade = etMin(v.fadeFrames, static_cast<uint64_t>(frames));
+			gainTo = (fade == v.fadeFrames) ? v.targetGain : v.gain + v.gainStep * static_cast<float>(fade);
+			v.fadeFrames -= fade;
+		}
+		v.gain = gainTo;
+
+		/*
+		 * Voices which become audible fade in, voices which become virtual (or stopped) fade out
+		 * over a single block to avoid clicks.
+		 */
+		float envelopeFrom = v.audible ? 1.0f : 0.0f;
+		float envelopeTo = shouldBeAudible ? 1.0f : 0.0f;
+		bool render = v.audible || shouldBeAudible;
+		v.audible = shouldBeAudible;
+
+		bool finished = false;
+		if (render)
+		{
+			finished = !resampleVoice(v, frames);
+
+			float angle = 0.25f * PI * (v.pan + 1.0f);
+			float panLeft = (v.data->channels() == 1) ? std::cos(angle) : etMin(1.0f, 1.0f - v.pan);
+			float panRight = (v.data->channels() == 1) ? std::sin(angle) : etMin(1.0f, 1.0f + v.pan);
+
+			mixWithRamp(accumLeft.data(), sourceLeft.data(), frames,
+				panLeft * gainFrom * envelopeFrom, panLeft * gainTo * envelopeTo);
+			mixWithRamp(accumRight.data(), sourceRight.data(), frames,
+				panRight * gainFrom * envelopeFrom, panRight * gainTo * envelopeTo);
+
+			++audibleCount;
+		}
+		else
+		{
+			uint64_t end = v.position + v.step * frames;
+			uint64_t length = static_cast<uint64_t>(v.data->frames()) << 32;
+			if (end >= length)
+			{
+				if (v.looped && (length > 0))
+					end %= length;
+				else
+					finished = true;
+			}
+			v.position = end;
+			++virtualCount;
+		}
+
+		if (v.stopRequested && !v.audible)
+			finished = true;
+
+		if (finished)
+			v.active = false;
+	}
+
+	for (auto i = activeVoices.begin(); i != activeVoices.end(); )
+	{
+		if (voices[*i].active)
+		{
+			++i;
+		}
+		else
+		{
+			releaseVoice(*i);
+			*i = activeVoices.back();
+			activeVoices.pop_back();
+		}
+	}
+
+	statistics.playingVoices = activeVoices.size();
+	statistics.audibleVoices = audibleCount;
+	statistics.virtualVoices = virtualCount;
+
+	convertToInterleaved(accumLeft.data(), accumRight.data(), output, frames);
+}
+
+/*
+ * Linear interpolation resampler, position is 32.32 fixed point.
+ * Runs of frames which do not reach end of data are interpolated with SIMD by four,
+ * remaining frames and frames near the end (wrapping or finishing) are processed one by one.
+ * Returns false when non-looped voice reached its end.
+ */
+bool MixerPrivate::resampleVoice(MixerVoice& v, size_t frames)
+{
+	const int16_t* samples = v.data->samples();
+	const uint64_t totalFrames = v.data->frames();
+	const uint64_t length = totalFrames << 32;
+	const size_t channels = v.data->channels();
+	const float scale = 1.0f / 32768.0f;
+
+	float* left = sourceLeft.data();
+	float* right = sourceRight.data();
+
+#if (ET_MIXER_SSE || ET_MIXER_NEON)
+	/*
+	 * Frames up to this position and following ones are inside of data
+	 */
+	const uint64_t lastInnerPosition = (totalFrames > 1) ? ((totalFrames - 1) << 32) - 1 : 0;
+#endif
+
+	for (size_t i = 0; i < frames; ++i)
+	{
+#	if (ET_MIXER_SSE || ET_MIXER_NEON)
+		if ((totalFrames > 1) && (v.position <= lastInnerPosition))
+		{
+			uint64_t available = (v.step > 0) ? (lastInnerPosition - v.position) / v.step + 1 : frames;
+			size_t run = static_cast<size_t>(etMin(available, static_cast<uint64_t>(frames - i))) & ~static_cast<size_t>(3);
+			if (run > 0)
+			{
+				resampleFrames(samples, channels, v.position, v.step, left + i, right + i, run);
+				v.position += run * v.step;
+				i += run - 1;
+				continue;
+			}
+		}
+#	endif
+
+		if (v.position >= length)
+		{
+			if (v.looped)
+			{
+				v.position %= length;
+			}
+			else
+			{
+				etFillMemory(left + i, 0, (frames - i) * sizeof(float));
+				etFillMemory(right + i, 0, (frames - i) * sizeof(float));
+				return false;
+			}
+		}
+
+		uint64_t index = v.position >> 32;
+		uint64_t nextIndex = index + 1;
+		if (nextIndex >= totalFrames)
+			nextIndex = v.looped ? 0 : index;
+
+		float t = static_cast<float>(v.position & 0xffffffff) * (1.0f / 4294967296.0f);
+
+		if (channels == 1)
+		{
+			float s0 = static_cast<float>(samples[index]);
+			float s1 = static_cast<float>(samples[nextIndex]);
+			left[i] = scale * (s0 + t * (s1 - s0));
+			right[i] = left[i];
+		}
+		else
+		{
+			float l0 = static_cast<float>(samples[2 * index]);
+			float l1 = static_cast<float>(samples[2 * nextIndex]);
+			float r0 = static_cast<float>(samples[2 * index + 1]);
+			float r1 = static_cast<float>(samples[2 * nextIndex + 1]);
+			left[i] = scale * (l0 + t * (l1 - l0));
+			right[i] = scale * (r0 + t * (r1 - r0));
+		}
+
+		v.position += v.step;
+	}
+
+	return v.looped || (v.position < length);
+}
+
+/*
+ * SIMD kernels
+ */
+#if (ET_MIXER_SSE)
+typedef __m128 MixerFloat4;
+
+inline MixerFloat4 mixerFloats4(float a, float b, float c, float d)
+	{ return _mm_setr_ps(a, b, c, d); }
+
+inline MixerFloat4 mixerSamples4(int32_t a, int32_t b, int32_t c, int32_t d)
+	{ return _mm_cvtepi32_ps(_mm_setr_epi32(a, b, c, d)); }
+
+inline void mixerStoreInterpolated(float* output, MixerFloat4 s0, MixerFloat4 s1, MixerFloat4 t)
+	{ _mm_storeu_ps(output, _mm_mul_ps(_mm_set1_ps(1.0f / 32768.0f), _mm_add_ps(s0, _mm_mul_ps(t, _mm_sub_ps(s1, s0))))); }
+#elif (ET_MIXER_NEON)
+typedef float32x4_t MixerFloat4;
+
+inline MixerFloat4 mixerFloats4(float a, float b, float c, float d)
+{
+	float32x4_t result = vdupq_n_f32(a);
+	result = vsetq_lane_f32(b, result, 1);
+	result = vsetq_lane_f32(c, result, 2);
+	return vsetq_lane_f32(d, result, 3);
+}
+
+inline MixerFloat4 mixerSamples4(int32_t a, int32_t b, int32_t c, int32_t d)
+{
+	int32x4_t result = vdupq_n_s32(a);
+	result = vsetq_lane_s32(b, result, 1);
+	result = vsetq_lane_s32(c, result, 2);
+	result = vsetq_lane_s32(d, result, 3);
+	return vcvtq_f32_s32(result);
+}
+
+inline void mixerStoreInterpolated(float* output, MixerFloat4 s0, MixerFloat4 s1, MixerFloat4 t)
+	{ vst1q_f32(output, vmulq_n_f32(vmlaq_f32(s0, t, vsubq_f32(s1, s0)), 1.0f / 32768.0f)); }
+#endif
+
+#if (ET_MIXER_SSE || ET_MIXER_NEON)
+void et::audio::resampleFrames(const int16_t* samples, size_t channels, uint64_t position,
+	uint64_t step, float* left, float* right, size_t frames)
+{
+	/*
+	 * Samples are gathered directly into registers (storing them to memory and loading
+	 * as vector stalls on store forwarding), conversion and interpolation are vectorized.
+	 */
+	const float fractionScale = 1.0f / 4294967296.0f;
+
+	for (size_t i = 0; i < frames; i += 4)
+	{
+		uint64_t p0 = position;
+		uint64_t p1 = p0 + step;
+		uint64_t p2 = p1 + step;
+		uint64_t p3 = p2 + step;
+		position = p3 + step;
+
+		MixerFloat4 t = mixerFloats4(static_cast<float>(p0 & 0xffffffff) * fractionScale,
+			static_cast<float>(p1 & 0xffffffff) * fractionScale, static_cast<float>(p2 & 0xffffffff) * fractionScale,
+			static_cast<float>(p3 & 0xffffffff) * fractionScale);
+
+		size_t i0 = static_cast<size_t>(p0 >> 32) * channels;
+		size_t i1 = static_cast<size_t>(p1 >> 32) * channels;
+		size_t i2 = static_cast<size_t>(p2 >> 32) * channels;
+		size_t i3 = static_cast<size_t>(p3 >> 32) * channels;
+
+		MixerFloat4 l0 = mixerSamples4(samples[i0], samples[i1], samples[i2], samples[i3]);
+		MixerFloat4 l1 = mixerSamples4(samples[i0 + channels], samples[i1 + channels],
+			samples[i2 + channels], samples[i3 + channels]);
+		mixerStoreInterpolated(left + i, l0, l1, t);
+
+		if (channels == 1)
+		{
+			mixerStoreInterpolated(right + i, l0, l1, t);
+		}
+		else
+		{
+			MixerFloat4 r0 = mixerSamples4(samples[i0 + 1], samples[i1 + 1], samples[i2 + 1], samples[i3 + 1]);
+			MixerFloat4 r1 = mixerSamples4(samples[i0 + 3], samples[i1 + 3], samples[i2 + 3], samples[i3 + 3]);
+			mixerStoreInterpolated(right + i, r0, r1, t);
+		}
+	}
+}
+#endif
+
+void et::audio::mixWithRamp(float* accum, const float* source, size_t frames, float gainFrom, float gainTo)
+{
+	if ((gainFrom == 0.0f) && (gainTo == 0.0f)) return;
+
+	float gainStep = (gainTo - gainFrom) / static_cast<float>(frames);
+	size_t i = 0;
+
+#if (ET_MIXER_SSE)
+	__m128 gain = _mm_set_ps(gainFrom + 3.0f * gainStep, gainFrom + 2.0f * gainStep, gainFrom + gainStep, gainFrom);
+	__m128 step = _mm_set1_ps(4.0f * gainStep);
+	for (; i + 4 <= frames; i += 4)
+	{
+		__m128 a = _mm_loadu_ps(accum + i);
+		__m128 s = _mm_loadu_ps(source + i);
+		_mm_storeu_ps(accum + i, _mm_add_ps(a, _mm_mul_ps(s, gain)));
+		gain = _mm_add_ps(gain, step);
+	}
+#elif (ET_MIXER_NEON)
+	float32x4_t gain = { gainFrom, gainFrom + gainStep, gainFrom + 2.0f * gainStep, gainFrom + 3.0f * gainStep };
+	float32x4_t step = vdupq_n_f32(4.0f * gainStep);
+	for (; i + 4 <= frames; i += 4)
+	{
+		float32x4_t a = vld1q_f32(accum + i);
+		float32x4_t s = vld1q_f32(source + i);
+		vst1q_f32(accum + i, vmlaq_f32(a, s, gain));
+		gain = vaddq_f32(gain, step);
+	}
+#endif
+
+	for (; i < frames; ++i)
+		accum[i] += source[i] * (gainFrom + static_cast<float>(i) * gainStep);
+}
+
+void et::audio::convertToInterleaved(const float* left, const float* right, float* output, size_t frames)
+{
+	size_t i = 0;
+
+#if (ET_MIXER_SSE)
+	for (; i + 4 <= frames; i += 4)
+	{
+		__m128 l = _mm_loadu_ps(left + i);
+		__m128 r = _mm_loadu_ps(right + i);
+		_mm_storeu_ps(output + 2 * i, _mm_unpacklo_ps(l, r));
+		_mm_storeu_ps(output + 2 * i + 4, _mm_unpackhi_ps(l, r));
+	}
+#elif (ET_MIXER_NEON)
+	for (; i + 4 <= frames; i += 4)
+	{
+		float32x4x2_t lr = { { vld1q_f32(left + i), vld1q_f32(right + i) } };
+		vst2q_f32(output + 2 * i, lr);
+	}
+#endif
+
+	for (; i < frames; ++i)
+	{
+		output[2 * i] = left[i];
+		output[2 * i + 1] = right[i];
+	}
+}
+
+void et::audio::convertToInt16(const float* input, int16_t* output, size_t samples)
+{
+	size_t i = 0;
+
+#if (ET_MIXER_SSE)
+	__m128 scale = _mm_set1_ps(32767.0f);
+	for (; i + 8 <= samples; i += 8)
+	{
+		__m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(input + i), scale));
+		__m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(input + i + 4), scale));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packs_epi32(a, b));
+	}
+#elif (ET_MIXER_NEON)
+	float32x4_t scale = vdupq_n_f32(32767.0f);
+	for (; i + 8 <= samples; i += 8)
+	{
+		int32x4_t a = vcvtq_s32_f32(vmulq_f32(vld1q_f32(input + i), scale));
+		int32x4_t b = vcvtq_s32_f32(vmulq_f32(vld1q_f32(input + i + 4), scale));
+		vst1q_s16(output + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+	}
+#endif
+
+	for (; i < samples; ++i)
+		output[i] = static_cast<int16_t>(32767.0f * clamp(input[i], -1.0f, 1.0f));
+}
@@ -267,6 +267,35 @@ void Player::handleProcessedBuffers()
 	}
 }
 
+float Player::timeToNextUpdate() const
+{
+	if (_track.invalid() || !playing())
+		return std::numeric_limits<float>::max();
+	
+	int sampleOffset = 0;
+	alGetSourcei(_private->source, AL_SAMPLE_OFFSET, &sampleOffset);
+	checkOpenALError("alGetSourcei(%d, AL_SAMPLE_OFFSET, %d)", _private->source, sampleOffset);
+	
+	size_t offset = static_cast<size_t>(etMax(0, sampleOffset));
+	size_t samplesToNextEvent = 0;
+	
+	if (_track->streamed())
+	{
+		size_t samplesPerBuffer = _track->samplesPerBuffer();
+		samplesToNextEvent = samplesPerBuffer - offset % samplesPerBuffer;
+	}
+	else if (_private->playingLooped)
+	{
+		return std::numeric_limits<float>::max();
+	}
+	else if (offset < _track->samples())
+	{
+		samplesToNextEvent = _track->samples() - offset;
+	}
+	
+	return static_cast<float>(samplesToNextEvent) / static_cast<float>(_track->sampleRate());
+}
+
 void Player::setActualVolume(float v)
 {
 	alSourcef(_private->source, AL_GAIN, clamp(v, 0.0f, 1.0f));
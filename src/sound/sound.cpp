@@ -75,6 +75,8 @@ Manager::Manager()
 Manager::~Manager()
 {
 	stopStreamingThread();
+	_trackCache.flush();
+	
 	if (sharedDevice == nullptr) return;
 	
 	nativeRelease();
@@ -90,13 +92,57 @@ Manager::~Manager()
 
 void Manager::stopStreamingThread()
 {
-	_streamingThread.stopAndWaitForTermination();
+	if (_streamingThread.running())
+	{
+		_streamingThread.stop();
+		_streamingThread.wake();
+		_streamingThread.join();
+	}
 	_streamingThread.release();
 }
 
 Track::Pointer Manager::loadTrack(const std::string& fileName)
 {
-	return Track::Pointer::create(fileName);
+	uint64_t fileProperty = getFileDate(fileName);
+	
+	DecodedTrack::Pointer decoded = _trackCache.find(fileName, fileProperty);
+	if (decoded.valid())
+		return Track::Pointer::create(fileName, decoded);
+	
+	Track::Pointer track = Track::Pointer::create(fileName);
+	if (!track->streamed() && (_trackCache.memoryBudget() > 0))
+	{
+		PCMData::Pointer pcm = track->decodePCM();
+		if (pcm.valid())
+			track->attachDecodedTrack(_trackCache.insert(fileName, fileProperty, pcm));
+	}
+	
+	return track;
+}
+
+Track::Pointer Manager::loadTrack(const std::string& fileName, ObjectsCache& cache)
+{
+	uint64_t cachedProperty = 0;
+	Track::Pointer track = cache.findAnyObject(fileName, &cachedProperty);
+	
+	if (track.valid() && !track->streamed())
+	{
+		if (cachedProperty == cache.getFileProperty(fileName))
+			return track;
+		
+		cache.discard(track);
+		_trackCache.invalidate(fileName);
+	}
+	
+	track = loadTrack(fileName);
+	
+	/*
+	 * Streamed tracks keep playback state and could not be shared
+	 */
+	if (!track->streamed())
+		cache.manage(track, ObjectLoader::Pointer());
+	
+	return track;
 }
 
 Player::Pointer Manager::genPlayer(Track::Pointer track)
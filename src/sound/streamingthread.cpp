@@ -5,22 +5,51 @@
  *
  */
 
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <et/core/et.h>
 #include <et/threading/criticalsection.h>
 #include <et/sound/sound.h>
+#include <et/sound/mixer.h>
 
 namespace et
 {
 	namespace audio
 	{
+		const float minimumStreamingInterval = 0.005f;
+		const float maximumStreamingInterval = 0.25f;
+		const size_t maximumDecodingThreads = 4;
+		
 		class StreamingThreadPrivate
 		{
+		public:
+			StreamingThreadPrivate();
+			~StreamingThreadPrivate();
+			
+			void scheduleDecoding(Track::Pointer);
+			void decodingThreadFunction();
+			
+			void wake();
+			void waitFor(float seconds);
+			
 		public:
 			CriticalSection csLock;
 
 			std::list<Player::Pointer> playersList;
 			std::list<Player::Pointer> playersToAdd;
 			std::list<Player::Pointer> playersToRemove;
+			std::vector<Mixer::Pointer> mixers;
+			
+			std::mutex wakeLock;
+			std::condition_variable wakeCondition;
+			bool wakeRequested = false;
+			
+			std::mutex decodingLock;
+			std::condition_variable decodingCondition;
+			std::deque<Track::Pointer> decodingQueue;
+			std::vector<std::thread> decodingThreads;
+			bool decodingThreadsRunning = true;
 		};
 	}
 }
@@ -40,6 +69,12 @@ void StreamingThread::release()
 	ET_PIMPL_FINALIZE(StreamingThread)
 }
 
+void StreamingThread::wake()
+{
+	if (_private != nullptr)
+		_private->wake();
+}
+
 uint64_t StreamingThread::main()
 {
 	while (running())
@@ -57,21 +92,39 @@ uint64_t StreamingThread::main()
 			_private->playersToRemove.clear();
 		}
 
+		float timeToNextUpdate = maximumStreamingInterval;
 		for (auto player : _private->playersList)
 		{
-			if (player->track().valid() && player->track()->streamed())
+			auto track = player->track();
+			if (track.valid() && track->streamed())
+			{
 				player->handleProcessedBuffers();
+				
+				if (track->decodeAheadRequired())
+					_private->scheduleDecoding(track);
+			}
 			
 			player->handleProcessedSamples();
+			timeToNextUpdate = etMin(timeToNextUpdate, player->timeToNextUpdate());
 		}
 		
-		threading::sleepMSec(50);
+		{
+			CriticalSectionScope scope(_private->csLock);
+			for (auto& mixer : _private->mixers)
+			{
+				mixer->handleProcessedBuffers();
+				timeToNextUpdate = etMin(timeToNextUpdate, mixer->timeToNextUpdate());
+			}
+		}
+		
+		_private->waitFor(etMax(minimumStreamingInterval, timeToNextUpdate));
 	}
 
 	CriticalSectionScope scope(_private->csLock);
 	_private->playersToAdd.clear();
 	_private->playersToRemove.clear();
 	_private->playersList.clear();
+	_private->mixers.clear();
 	
 	return 0;
 }
@@ -80,19 +133,23 @@ void StreamingThread::addPlayer(Player::Pointer player)
 {
 	ET_ASSERT(_private != nullptr);
 	
-	CriticalSectionScope scope(_private->csLock);
-	
-	auto i = std::find(_private->playersList.begin(), _private->playersList.end(), player);
-	if (i == _private->playersList.end())
 	{
-		i = std::find(_private->playersToAdd.begin(), _private->playersToAdd.end(), player);
-		if (i == _private->playersToAdd.end())
-			_private->playersToAdd.push_back(player);
+		CriticalSectionScope scope(_private->csLock);
 		
-		i = std::find(_private->playersToRemove.begin(), _private->playersToRemove.end(), player);
-		if (i != _private->playersToRemove.end())
-			_private->playersToRemove.erase(i);
+		auto i = std::find(_private->playersList.begin(), _private->playersList.end(), player);
+		if (i == _private->playersList.end())
+		{
+			i = std::find(_private->playersToAdd.begin(), _private->playersToAdd.end(), player);
+			if (i == _private->playersToAdd.end())
+				_private->playersToAdd.push_back(player);
+			
+			i = std::find(_private->playersToRemove.begin(), _private->playersToRemove.end(), player);
+			if (i != _private->playersToRemove.end())
+				_private->playersToRemove.erase(i);
+		}
 	}
+	
+	_private->wake();
 }
 
 void StreamingThread::removePlayer(Player::Pointer player)
@@ -113,3 +170,100 @@ void StreamingThread::removePlayer(Player::Pointer player)
 			_private->playersToAdd.erase(i);
 	}
 };
+
+void StreamingThread::addMixer(Mixer::Pointer mixer)
+{
+	ET_ASSERT(_private != nullptr);
+	
+	{
+		CriticalSectionScope scope(_private->csLock);
+		if (std::find(_private->mixers.begin(), _private->mixers.end(), mixer) == _private->mixers.end())
+			_private->mixers.push_back(mixer);
+	}
+	
+	_private->wake();
+}
+
+void StreamingThread::removeMixer(Mixer::Pointer mixer)
+{
+	if (_private == nullptr) return;
+	
+	CriticalSectionScope scope(_private->csLock);
+	
+	auto i = std::find(_private->mixers.begin(), _private->mixers.end(), mixer);
+	if (i != _private->mixers.end())
+		_private->mixers.erase(i);
+}
+
+/*
+ * Private implementation
+ */
+StreamingThreadPrivate::StreamingThreadPrivate()
+{
+	size_t threadsCount = etMax(size_t(1), etMin(maximumDecodingThreads, threading::maxConcurrentThreads() / 2));
+	for (size_t i = 0; i < threadsCount; ++i)
+		decodingThreads.emplace_back(&StreamingThreadPrivate::decodingThreadFunction, this);
+}
+
+StreamingThreadPrivate::~StreamingThreadPrivate()
+{
+	{
+		std::lock_guard<std::mutex> lock(decodingLock);
+		decodingThreadsRunning = false;
+		decodingQueue.clear();
+	}
+	decodingCondition.notify_all();
+	
+	for (auto& t : decodingThreads)
+		t.join();
+}
+
+void StreamingThreadPrivate::scheduleDecoding(Track::Pointer track)
+{
+	if (!track->scheduleDecodeAhead())
+		return;
+	
+	{
+		std::lock_guard<std::mutex> lock(decodingLock);
+		decodingQueue.push_back(track);
+	}
+	decodingCondition.notify_one();
+}
+
+void StreamingThreadPrivate::decodingThreadFunction()
+{
+	for (;;)
+	{
+		Track::Pointer track;
+		{
+			std::unique_lock<std::mutex> lock(decodingLock);
+			decodingCondition.wait(lock, [this]() { return !decodingThreadsRunning || !decodingQueue.empty(); });
+			
+			if (!decodingThreadsRunning)
+				break;
+			
+			track = decodingQueue.front();
+			decodingQueue.pop_front();
+		}
+		track->decodeAhead();
+	}
+}
+
+void StreamingThreadPrivate::wake()
+{
+	{
+		std::lock_guard<std::mutex> lock(wakeLock);
+		wakeRequested = true;
+	}
+	wakeCondition.notify_one();
+}
+
+void StreamingThreadPrivate::waitFor(float seconds)
+{
+	std::unique_lock<std::mutex> lock(wakeLock);
+	
+	wakeCondition.wait_for(lock, std::chrono::microseconds(static_cast<int64_t>(1000000.0f * seconds)),
+		[this]() { return wakeRequested; });
+	
+	wakeRequested = false;
+}
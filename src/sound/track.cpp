@@ -11,6 +11,7 @@
 #endif
 
 
+#include <mutex>
 #include <et/core/containers.h>
 #include <et/sound/sound.h>
 
@@ -20,6 +21,13 @@ namespace et
     {
 		const int BuffersCount = 3;
 		const int BufferDuration = 4;
+		const size_t DecodeAheadChunks = 2;
+		
+		struct DecodedChunk
+		{
+			BinaryDataStorage data;
+			size_t size = 0;
+		};
 		
         class TrackPrivate
         {
@@ -29,15 +37,25 @@ namespace et
 			
 			void loadWAVE();
 			bool fillNextBuffer();
+			void processRewindRequest();
+			bool uploadChunk(const DecodedChunk&);
+			
+			void allocateChunks();
+			bool decodeAheadRequired();
+			void decodeAhead();
+			bool decodeNextChunk(DecodedChunk&);
+
+			PCMData::Pointer decodePCM();
+			void attachDecodedTrack(DecodedTrack::Pointer);
 
 			void rewind();
 			void rewindPCM();
-			bool fillNextPCMBuffer();
+			size_t decodeNextPCMChunk(unsigned char*);
 
 #		if !defined(ET_DISABLE_OGG)
 			void loadOGG();
 			void rewindOGG();
-			bool fillNextOGGBuffer();
+			size_t decodeNextOGGChunk(unsigned char*, bool&);
 #		endif
 
 			enum SourceFormat
@@ -54,6 +72,7 @@ namespace et
 			Track* owner = nullptr;
 			
 			InputStream::Pointer stream;
+			DecodedTrack::Pointer decodedTrack;
 			std::string _filename;
 			
 			float duration = 0.0f;
@@ -75,6 +94,22 @@ namespace et
 			int bufferIndex = 0;
 			int buffersCount = 0;
 			int totalBuffers = 0;
+			bool staticBufferLoaded = false;
+			
+			/*
+			 * Single producer (decoding worker) / single consumer (streaming thread)
+			 * ring of preallocated chunks. Decoder state is guarded by decoderLock,
+			 * chunk is published while lock is held, so rewind never sees stale data.
+			 * Rewind is only requested by Track::rewind and performed by consumer,
+			 * which is the only thread writing chunksRead and bufferIndex.
+			 */
+			DecodedChunk decodedChunks[DecodeAheadChunks];
+			DecodedChunk synchronousChunk;
+			std::atomic<size_t> chunksWritten;
+			std::atomic<size_t> chunksRead;
+			std::atomic<bool> decodingScheduled;
+			std::atomic<bool> rewindRequested;
+			std::mutex decoderLock;
 			
 #		if !defined(ET_DISABLE_OGG)
 			OggVorbis_File oggFile;
@@ -133,6 +168,17 @@ Track::Track(const std::string& fileName)
 	}
 }
 
+Track::Track(const std::string& fileName, DecodedTrack::Pointer data)
+{
+	ET_PIMPL_INIT(Track, fileName)
+	
+	setName(fileName);
+	setOrigin(fileName);
+	
+	_private->owner = this;
+	_private->attachDecodedTrack(data);
+}
+
 Track::~Track()
 {
 	ET_PIMPL_FINALIZE(Track)
@@ -163,6 +209,11 @@ size_t Track::samples() const
 	return _private->numSamples;
 }
 
+size_t Track::samplesPerBuffer() const
+{
+	return (_private->sampleSize > 0) ? _private->pcmBufferSize / _private->sampleSize : 0;
+}
+
 int Track::totalBuffersCount() const
 {
 	return _private->totalBuffers;
@@ -188,22 +239,68 @@ bool Track::streamed() const
 	return _private->buffersCount > 1;
 }
 
+uint64_t Track::memoryUsage() const
+{
+	uint64_t result = static_cast<uint64_t>(_private->buffersCount) * _private->pcmBufferSize +
+		_private->synchronousChunk.data.dataSize();
+	
+	for (const auto& chunk : _private->decodedChunks)
+		result += chunk.data.dataSize();
+	
+	if (_private->decodedTrack.valid())
+		result += _private->decodedTrack->pcm()->dataSize();
+	
+	return result;
+}
+
 unsigned int Track::loadNextBuffer()
 {
+	_private->processRewindRequest();
+	
 	int bufferToLoad = _private->bufferIndex;
 	return _private->fillNextBuffer() ? _private->buffers[bufferToLoad] : 0;
 }
 
 void Track::rewind()
 {
-	_private->bufferIndex = 0;
-	_private->rewind();
+	if (!streamed()) return;
+	
+	_private->rewindRequested.store(true, std::memory_order_release);
 }
 
 void Track::preloadBuffers()
 {
+	if (_private->staticBufferLoaded) return;
+	
 	for (int i = 0; i < _private->buffersCount; ++i)
 		_private->fillNextBuffer();
+	
+	_private->staticBufferLoaded = !streamed() && (_private->buffersCount > 0);
+}
+
+bool Track::decodeAheadRequired()
+{
+	return streamed() && _private->decodeAheadRequired();
+}
+
+bool Track::scheduleDecodeAhead()
+{
+	return !_private->decodingScheduled.exchange(true);
+}
+
+void Track::decodeAhead()
+{
+	_private->decodeAhead();
+}
+
+PCMData::Pointer Track::decodePCM()
+{
+	return _private->decodePCM();
+}
+
+void Track::attachDecodedTrack(DecodedTrack::Pointer data)
+{
+	_private->attachDecodedTrack(data);
 }
 
 /*
@@ -250,7 +347,7 @@ const uint32_t WAVDataChunkID = ET_COMPOSE_UINT32_INVERTED('d', 'a', 't', 'a');
 const uint32_t WAVFormatChunkID = ET_COMPOSE_UINT32_INVERTED('f', 'm', 't', ' ');
 
 TrackPrivate::TrackPrivate(const std::string& filename) :
-	_filename(filename)
+	_filename(filename), chunksWritten(0), chunksRead(0), decodingScheduled(false), rewindRequested(false)
 {
 	etFillMemory(&buffers, 0, sizeof(buffers));
 
@@ -297,25 +394,217 @@ TrackPrivate::~TrackPrivate()
 		ov_clear(&oggFile);
 #endif
 
-	alDeleteBuffers(buffersCount, buffers);
-	checkOpenALError("alDeleteBuffers(%d, ...", buffersCount);
+	if (decodedTrack.invalid())
+	{
+		alDeleteBuffers(buffersCount, buffers);
+		checkOpenALError("alDeleteBuffers(%d, ...", buffersCount);
+	}
+}
+
+PCMData::Pointer TrackPrivate::decodePCM()
+{
+	if ((buffersCount != 1) || (sourceFormat == SourceFormat_Undefined))
+		return PCMData::Pointer();
+	
+	std::lock_guard<std::mutex> lock(decoderLock);
+	
+	DecodedChunk chunk;
+	chunk.data.resize(pcmBufferSize);
+	
+	rewind();
+	bool decoded = decodeNextChunk(chunk);
+	rewind();
+	
+	if (!decoded)
+		return PCMData::Pointer();
+	
+	BinaryDataStorage samples;
+	if (bitDepth == 8)
+	{
+		samples.resize(chunk.size * sizeof(int16_t));
+		int16_t* output = reinterpret_cast<int16_t*>(samples.data());
+		for (size_t i = 0; i < chunk.size; ++i)
+			output[i] = static_cast<int16_t>((static_cast<int>(chunk.data[i]) - 128) << 8);
+	}
+	else if (bitDepth == 16)
+	{
+		chunk.data.resize(chunk.size);
+		samples = std::move(chunk.data);
+	}
+	else
+	{
+		return PCMData::Pointer();
+	}
+	
+	return PCMData::Pointer::create(channels, static_cast<size_t>(sampleRate), samples);
+}
+
+void TrackPrivate::attachDecodedTrack(DecodedTrack::Pointer data)
+{
+	ET_ASSERT(data.valid());
+	
+	if (decodedTrack.invalid())
+	{
+		alDeleteBuffers(buffersCount, buffers);
+		checkOpenALError("alDeleteBuffers(%d, ...", buffersCount);
+	}
+	
+#if !defined(ET_DISABLE_OGG)
+	if (sourceFormat == SourceFormat_OGG)
+		ov_clear(&oggFile);
+#endif
+	
+	stream.reset(nullptr);
+	sourceFormat = SourceFormat_Undefined;
+	
+	decodedTrack = data;
+	auto pcm = decodedTrack->pcm();
+	
+	etFillMemory(&buffers, 0, sizeof(buffers));
+	buffers[0] = decodedTrack->buffer();
+	buffersCount = 1;
+	totalBuffers = 1;
+	bufferIndex = 0;
+	staticBufferLoaded = true;
+	
+	channels = pcm->channels();
+	bitDepth = 16;
+	sampleRate = static_cast<ALsizei>(pcm->sampleRate());
+	sampleSize = channels * bitDepth / 8;
+	format = openALFormatFromChannelsAndBitDepth(channels, bitDepth);
+	numSamples = pcm->frames();
+	pcmDataSize = pcm->dataSize();
+	pcmBufferSize = pcmDataSize;
+	pcmReadOffset = 0;
+	duration = pcm->duration();
+}
+
+void TrackPrivate::allocateChunks()
+{
+	if (buffersCount > 1)
+	{
+		for (auto& chunk : decodedChunks)
+			chunk.data.resize(pcmBufferSize);
+	}
+}
+
+void TrackPrivate::processRewindRequest()
+{
+	if (!rewindRequested.exchange(false, std::memory_order_acquire))
+		return;
+	
+	/*
+	 * Decoder publishes chunks while holding lock, so no chunk
+	 * decoded before rewind could be published after it
+	 */
+	std::lock_guard<std::mutex> lock(decoderLock);
+	bufferIndex = 0;
+	chunksRead.store(chunksWritten.load(std::memory_order_relaxed), std::memory_order_release);
+	rewind();
 }
 
 bool TrackPrivate::fillNextBuffer()
+{
+	processRewindRequest();
+	
+	size_t read = chunksRead.load(std::memory_order_relaxed);
+	if (read < chunksWritten.load(std::memory_order_acquire))
+	{
+		bool uploaded = uploadChunk(decodedChunks[read % DecodeAheadChunks]);
+		chunksRead.store(read + 1, std::memory_order_release);
+		return uploaded;
+	}
+
+	/*
+	 * Nothing was decoded ahead (first buffers or decoder is late),
+	 * decode synchronously into temporary chunk
+	 */
+	bool uploaded = false;
+	{
+		std::lock_guard<std::mutex> lock(decoderLock);
+		
+		if (synchronousChunk.data.size() < pcmBufferSize)
+			synchronousChunk.data.resize(pcmBufferSize);
+		
+		if (decodeNextChunk(synchronousChunk))
+			uploaded = uploadChunk(synchronousChunk);
+	}
+	
+	if (buffersCount == 1)
+		synchronousChunk.data.resize(0);
+	
+	return uploaded;
+}
+
+bool TrackPrivate::uploadChunk(const DecodedChunk& chunk)
+{
+	if (chunk.size == 0)
+		return false;
+	
+	checkOpenALError("Clear error");
+	
+	alBufferData(buffers[bufferIndex], static_cast<ALenum>(format), chunk.data.data(),
+		static_cast<ALsizei>(chunk.size), sampleRate);
+	
+	checkOpenALError("alBufferData(%d, %llu, 0x%08x, %llu, %llu)", buffers[bufferIndex],
+		uint64_t(format), chunk.data.data(), uint64_t(chunk.size), uint64_t(sampleRate));
+	
+	bufferIndex = (bufferIndex + 1) % buffersCount;
+	return true;
+}
+
+bool TrackPrivate::decodeAheadRequired()
+{
+	return !decodingScheduled.load() &&
+		(chunksWritten.load(std::memory_order_relaxed) - chunksRead.load(std::memory_order_acquire) < DecodeAheadChunks);
+}
+
+void TrackPrivate::decodeAhead()
+{
+	while (chunksWritten.load(std::memory_order_relaxed) - chunksRead.load(std::memory_order_acquire) < DecodeAheadChunks)
+	{
+		std::lock_guard<std::mutex> lock(decoderLock);
+		
+		size_t written = chunksWritten.load(std::memory_order_relaxed);
+		if (!decodeNextChunk(decodedChunks[written % DecodeAheadChunks]))
+			break;
+		
+		chunksWritten.store(written + 1, std::memory_order_release);
+	}
+	
+	decodingScheduled.store(false);
+}
+
+bool TrackPrivate::decodeNextChunk(DecodedChunk& chunk)
 {
 	switch (sourceFormat)
 	{
 		case SourceFormat_PCM:
-			return fillNextPCMBuffer();
-
+		{
+			chunk.size = decodeNextPCMChunk(chunk.data.data());
+			break;
+		}
+			
 #if !defined(ET_DISABLE_OGG)
 		case SourceFormat_OGG:
-			return fillNextOGGBuffer();
+		{
+			bool errorOccured = false;
+			chunk.size = decodeNextOGGChunk(chunk.data.data(), errorOccured);
+			
+			if ((chunk.size == 0) && !errorOccured)
+			{
+				rewindOGG();
+				chunk.size = decodeNextOGGChunk(chunk.data.data(), errorOccured);
+			}
+			break;
+		}
 #	endif
-
+			
 		default:
-			return false;
+			chunk.size = 0;
 	}
+	
+	return (chunk.size > 0);
 }
 
 void TrackPrivate::rewind()
@@ -403,6 +692,7 @@ void TrackPrivate::loadWAVE()
 	checkOpenALError("alGenBuffers(%d, ...)", buffersCount);
 	
 	sourceFormat = SourceFormat_PCM;
+	allocateChunks();
 }
 
 void TrackPrivate::rewindPCM()
@@ -413,31 +703,18 @@ void TrackPrivate::rewindPCM()
 	pcmReadOffset = 0;
 }
 
-bool TrackPrivate::fillNextPCMBuffer()
+size_t TrackPrivate::decodeNextPCMChunk(unsigned char* data)
 {
-	checkOpenALError("fillNextPCMBuffer");
-	
-	BinaryDataStorage data(pcmBufferSize, 0);
 	auto& inStream = stream->stream();
-	inStream.read(data.binary(), etMin(pcmBufferSize, pcmDataSize - pcmReadOffset));
-	pcmReadOffset += static_cast<size_t>(inStream.gcount());
-	
-	ALsizei bytesRead = static_cast<ALsizei>(inStream.gcount());
+	inStream.read(reinterpret_cast<char*>(data), etMin(pcmBufferSize, pcmDataSize - pcmReadOffset));
 	
-	if (bytesRead > 0)
-	{
-		alBufferData(buffers[bufferIndex], static_cast<ALenum>(format), data.data(), bytesRead, sampleRate);
-		
-		checkOpenALError("alBufferData(%d, %llu, 0x%08x, %llu, %llu) - PCM", buffers[bufferIndex],
-			uint64_t(format), data.data(), uint64_t(bytesRead), uint64_t(sampleRate));
-		
-		bufferIndex = (bufferIndex + 1) % buffersCount;
-	}
+	size_t bytesRead = static_cast<size_t>(inStream.gcount());
+	pcmReadOffset += bytesRead;
 	
 	if ((pcmReadOffset >= pcmDataSize) || inStream.eof())
 		rewindPCM();
 	
-	return (bytesRead > 0);
+	return bytesRead;
 }
 
 /*
@@ -488,16 +765,13 @@ void TrackPrivate::loadOGG()
 	checkOpenALError("alGenBuffers(%d, ...)", buffersCount);
 	
 	sourceFormat = SourceFormat_OGG;
+	allocateChunks();
 }
 
-bool TrackPrivate::fillNextOGGBuffer()
+size_t TrackPrivate::decodeNextOGGChunk(unsigned char* data, bool& errorOccured)
 {
 	if (stream.invalid())
-		return false;
-	
-	BinaryDataStorage data(pcmBufferSize, 0);
-	
-	bool errorOccured = false;
+		return 0;
 	
 	size_t bytesRead = 0;
 	while (bytesRead < pcmBufferSize)
@@ -505,7 +779,7 @@ bool TrackPrivate::fillNextOGGBuffer()
 		int section = -1;
 		int bytesToRead = etMin(4096, static_cast<int>(pcmBufferSize - bytesRead));
 		
-		long lastRead = ov_read(&oggFile, data.binary() + bytesRead, bytesToRead, 0, 2, 1, &section);
+		long lastRead = ov_read(&oggFile, reinterpret_cast<char*>(data) + bytesRead, bytesToRead, 0, 2, 1, &section);
 		
 		if (lastRead > 0)
 		{
@@ -525,28 +799,10 @@ bool TrackPrivate::fillNextOGGBuffer()
 		
 	pcmReadOffset = etMin(pcmReadOffset + bytesRead, pcmDataSize);
 	
-	if (bytesRead > 0)
-	{
-		checkOpenALError("Clear error");
-		
-		alBufferData(buffers[bufferIndex], static_cast<ALenum>(format), data.data(),
-			static_cast<ALsizei>(bytesRead), sampleRate);
-		
-		checkOpenALError("alBufferData(%d, %llu, 0x%08x, %llu, %llu) - OGG", buffers[bufferIndex],
-			uint64_t(format), data.data(), uint64_t(bytesRead), uint64_t(sampleRate));
-		
-		bufferIndex = (bufferIndex + 1) % buffersCount;
-	}
-	else if (!errorOccured)
-	{
-		rewindOGG();
-		return fillNextBuffer();
-	}
-	
-	if (pcmReadOffset >= pcmDataSize)
+	if ((bytesRead > 0) && (pcmReadOffset >= pcmDataSize))
 		rewindOGG();
 	
-	return (bytesRead > 0);
+	return bytesRead;
 }
 
 void TrackPrivate::rewindOGG()
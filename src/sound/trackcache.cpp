@@ -0,0 +1,160 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/sound/trackcache.h>
+
+using namespace et;
+using namespace et::audio;
+
+/*
+ * DecodedTrack
+ */
+DecodedTrack::DecodedTrack(PCMData::Pointer pcm, uint64_t contentHash) :
+	_pcm(pcm), _contentHash(contentHash)
+{
+	alGenBuffers(1, &_buffer);
+	checkOpenALError("alGenBuffers(1, ...)");
+
+	ALenum format = static_cast<ALenum>(openALFormatFromChannelsAndBitDepth(_pcm->channels(), 16));
+	alBufferData(_buffer, format, _pcm->data().data(), static_cast<ALsizei>(_pcm->dataSize()),
+		static_cast<ALsizei>(_pcm->sampleRate()));
+	checkOpenALError("alBufferData(%u, ...)", _buffer);
+}
+
+DecodedTrack::~DecodedTrack()
+{
+	alDeleteBuffers(1, &_buffer);
+	checkOpenALError("alDeleteBuffers(1, %u)", _buffer);
+}
+
+/*
+ * TrackCache
+ */
+namespace
+{
+	uint64_t computeContentHash(const PCMData& pcm)
+	{
+		uint64_t result = 0xcbf29ce484222325ull;
+		auto combine = [&result](uint64_t value)
+		{
+			result ^= value;
+			result *= 0x100000001b3ull;
+		};
+
+		combine(pcm.channels());
+		combine(pcm.sampleRate());
+
+		const unsigned char* bytes = pcm.data().data();
+		for (size_t i = 0, e = pcm.dataSize(); i < e; ++i)
+			combine(bytes[i]);
+
+		return result;
+	}
+
+	bool sameContents(const PCMData& a, const PCMData& b)
+	{
+		return (a.channels() == b.channels()) && (a.sampleRate() == b.sampleRate()) &&
+			(a.dataSize() == b.dataSize()) && (memcmp(a.data().data(), b.data().data(), a.dataSize()) == 0);
+	}
+}
+
+DecodedTrack::Pointer TrackCache::find(const std::string& fileName, uint64_t fileProperty)
+{
+	CriticalSectionScope lock(_lock);
+
+	auto file = _files.find(fileName);
+	if (file == _files.end())
+		return DecodedTrack::Pointer();
+
+	auto content = _contentMap.find(file->second.contentHash);
+	if ((file->second.fileProperty != fileProperty) || (content == _contentMap.end()))
+		return DecodedTrack::Pointer();
+
+	_contents.splice(_contents.begin(), _contents, content->second);
+	return content->second->track;
+}
+
+DecodedTrack::Pointer TrackCache::insert(const std::string& fileName, uint64_t fileProperty, PCMData::Pointer pcm)
+{
+	uint64_t hash = computeContentHash(pcm.reference());
+
+	CriticalSectionScope lock(_lock);
+
+	auto existing = _contentMap.find(hash);
+	if (existing != _contentMap.end())
+	{
+		ContentEntry& entry = *existing->second;
+		if (sameContents(entry.track->pcm().reference(), pcm.reference()))
+		{
+			if (std::find(entry.fileNames.begin(), entry.fileNames.end(), fileName) == entry.fileNames.end())
+				entry.fileNames.push_back(fileName);
+
+			_files[fileName] = { fileProperty, hash };
+			_contents.splice(_contents.begin(), _contents, existing->second);
+			return entry.track;
+		}
+
+		log::warning("[TrackCache] Content hash collision for %s, track will not be cached.", fileName.c_str());
+		return DecodedTrack::Pointer::create(pcm, hash);
+	}
+
+	DecodedTrack::Pointer result = DecodedTrack::Pointer::create(pcm, hash);
+	if (pcm->dataSize() > _memoryBudget)
+		return result;
+
+	evict(pcm->dataSize());
+
+	_contents.emplace_front();
+	_contents.front().track = result;
+	_contents.front().fileNames.push_back(fileName);
+	_contentMap[hash] = _contents.begin();
+	_files[fileName] = { fileProperty, hash };
+	_memoryUsage += pcm->dataSize();
+
+	return result;
+}
+
+void TrackCache::invalidate(const std::string& fileName)
+{
+	CriticalSectionScope lock(_lock);
+	_files.erase(fileName);
+}
+
+void TrackCache::flush()
+{
+	CriticalSectionScope lock(_lock);
+	_contents.clear();
+	_contentMap.clear();
+	_files.clear();
+	_memoryUsage = 0;
+}
+
+void TrackCache::setMemoryBudget(size_t budget)
+{
+	CriticalSectionScope lock(_lock);
+	_memoryBudget = budget;
+	evict(0);
+}
+
+void TrackCache::evict(size_t requiredSize)
+{
+	while (!_contents.empty() && (_memoryUsage + requiredSize > _memoryBudget))
+	{
+		ContentEntry& entry = _contents.back();
+
+		for (const auto& fileName : entry.fileNames)
+		{
+			auto file = _files.find(fileName);
+			if ((file != _files.end()) && (file->second.contentHash == entry.track->contentHash()))
+				_files.erase(file);
+		}
+
+		_memoryUsage -= entry.track->pcm()->dataSize();
+		_contentMap.erase(entry.track->contentHash());
+		_contents.pop_back();
+	}
+}
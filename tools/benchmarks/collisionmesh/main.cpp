@@ -0,0 +1,167 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+/*
+ * Compares CollisionMesh queries with brute force tests over random triangle soup,
+ * reports build time, average query time and number of mismatching results.
+ *
+ * Using: collisionmesh [TRIANGLES COUNT], default: 100000
+ */
+
+#include <random>
+#include <et/core/tools.h>
+#include <et/collision/collisionmesh.h>
+
+using namespace et;
+
+namespace
+{
+	const int queriesCount = 200;
+	const float sweepRadius = 0.5f;
+	const int sweepSteps = 4000;
+}
+
+int main(int argc, char* argv[])
+{
+	log::addOutput(log::ConsoleOutput::Pointer::create());
+
+	size_t trianglesCount = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 100000;
+
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+	auto randomOffset = [&generator, &offset]()
+		{ return vec3(offset(generator), offset(generator), offset(generator)); };
+
+	std::vector<triangle> triangles;
+	triangles.reserve(trianglesCount);
+	for (size_t i = 0; i < trianglesCount; ++i)
+	{
+		vec3 center(position(generator), position(generator), position(generator));
+		triangles.emplace_back(center + randomOffset(), center + randomOffset(), center + randomOffset());
+	}
+
+	uint64_t buildStart = queryCurrentTimeInMicroSeconds();
+	CollisionMesh mesh(triangles.data(), triangles.size());
+	uint64_t buildTime = queryCurrentTimeInMicroSeconds() - buildStart;
+
+	log::info("%llu triangles, build %.3f s, %llu nodes", static_cast<unsigned long long>(trianglesCount),
+		static_cast<double>(buildTime) / 1000000.0, static_cast<unsigned long long>(mesh.nodeCount()));
+
+	int hits = 0;
+	int mismatches = 0;
+	uint64_t meshTime = 0;
+	uint64_t linearTime = 0;
+	for (int q = 0; q < queriesCount; ++q)
+	{
+		vec3 origin(position(generator), position(generator), position(generator));
+		ray3d r(origin, normalize(randomOffset()));
+
+		uint64_t t0 = queryCurrentTimeInMicroSeconds();
+		CollisionMesh::RayHit hit;
+		bool meshHit = mesh.rayClosestHit(r, std::numeric_limits<float>::max(), hit, true);
+		uint64_t t1 = queryCurrentTimeInMicroSeconds();
+		vec3 linearPoint;
+		intersect::rayTriangles(r, triangles.data(), triangles.size(), &linearPoint);
+		meshTime += t1 - t0;
+		linearTime += queryCurrentTimeInMicroSeconds() - t1;
+
+		float closestDistance = std::numeric_limits<float>::max();
+		for (const auto& t : triangles)
+		{
+			vec3 point;
+			if (intersect::rayTriangleTwoSided(r, t, &point))
+				closestDistance = etMin(closestDistance, length(point - r.origin));
+		}
+
+		bool bruteForceHit = closestDistance < std::numeric_limits<float>::max();
+		if ((meshHit != bruteForceHit) || (meshHit && (std::abs(hit.distance - closestDistance) > 1.0e-3f)))
+			++mismatches;
+
+		if (mesh.rayAnyHit(r, std::numeric_limits<float>::max(), true) != meshHit)
+			++mismatches;
+
+		hits += meshHit ? 1 : 0;
+	}
+	log::info("rays: %d hits, %d mismatches, mesh %.2f us, linear %.2f us", hits, mismatches,
+		static_cast<double>(meshTime) / queriesCount, static_cast<double>(linearTime) / queriesCount);
+
+	hits = 0;
+	mismatches = 0;
+	meshTime = 0;
+	linearTime = 0;
+	for (int q = 0; q < queriesCount; ++q)
+	{
+		Sphere sphere(triangles[(q * 7) % trianglesCount].v1() + randomOffset(), 1.0f);
+
+		uint64_t t0 = queryCurrentTimeInMicroSeconds();
+		CollisionMesh::Contact contact;
+		bool meshHit = mesh.sphereOverlap(sphere, contact);
+		uint64_t t1 = queryCurrentTimeInMicroSeconds();
+		vec3 linearPoint;
+		vec3 linearNormal;
+		float linearPenetration = 0.0f;
+		intersect::sphereTriangles(sphere, triangles.data(), triangles.size(), linearPoint,
+			linearNormal, linearPenetration);
+		meshTime += t1 - t0;
+		linearTime += queryCurrentTimeInMicroSeconds() - t1;
+
+		float deepestPenetration = -1.0f;
+		for (const auto& t : triangles)
+		{
+			vec3 point;
+			vec3 normal;
+			float penetration = 0.0f;
+			if (intersect::sphereTriangle(sphere.center(), sphere.radius(), t, point, normal, penetration))
+				deepestPenetration = etMax(deepestPenetration, penetration);
+		}
+
+		bool bruteForceHit = deepestPenetration >= 0.0f;
+		if ((meshHit != bruteForceHit) || (meshHit && (std::abs(contact.penetration - deepestPenetration) > 1.0e-5f)))
+			++mismatches;
+
+		hits += meshHit ? 1 : 0;
+	}
+	log::info("spheres: %d hits, %d mismatches, mesh %.2f us, linear %.2f us", hits, mismatches,
+		static_cast<double>(meshTime) / queriesCount, static_cast<double>(linearTime) / queriesCount);
+
+	/*
+	 * Time of impact is compared with the first overlap found by stepping along velocity
+	 */
+	hits = 0;
+	mismatches = 0;
+	meshTime = 0;
+	for (int q = 0; q < queriesCount; ++q)
+	{
+		Sphere sphere(vec3(position(generator), position(generator), position(generator)), sweepRadius);
+		vec3 velocity = 20.0f * randomOffset();
+
+		uint64_t t0 = queryCurrentTimeInMicroSeconds();
+		CollisionMesh::SweepHit hit;
+		bool meshHit = mesh.sphereSweep(sphere, velocity, hit);
+		meshTime += queryCurrentTimeInMicroSeconds() - t0;
+
+		float firstOverlap = -1.0f;
+		for (int step = 0; (step <= sweepSteps) && (firstOverlap < 0.0f); ++step)
+		{
+			float t = static_cast<float>(step) / static_cast<float>(sweepSteps);
+			CollisionMesh::Contact contact;
+			if (mesh.sphereOverlap(Sphere(sphere.center() + t * velocity, sweepRadius), contact))
+				firstOverlap = t;
+		}
+
+		bool steppedHit = firstOverlap >= 0.0f;
+		if ((meshHit != steppedHit) || (meshHit && (std::abs(hit.time - firstOverlap) > 2.0f / sweepSteps)))
+			++mismatches;
+
+		hits += meshHit ? 1 : 0;
+	}
+	log::info("sweeps: %d hits, %d mismatches, mesh %.2f us", hits, mismatches,
+		static_cast<double>(meshTime) / queriesCount);
+
+	return 0;
+}
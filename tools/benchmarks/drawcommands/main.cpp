@@ -0,0 +1,369 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+/*
+ * Records random packets into DrawCommandBuffer and submits them to recording backend,
+ * which checks that every recorded index range is drawn exactly once with state of its packet,
+ * that each opaque state is bound once and forms contiguous run, that blended packets
+ * are drawn after opaque ones in recorded order and that no redundant state is bound.
+ * Reports draw calls and state changes saved by sorting and merging, and submit time.
+ * Packets reference programs, textures and vertex array objects, so this tool is built as application.
+ *
+ * Using: drawcommands [PACKETS COUNT] [FRAMES], default: 4096 100
+ */
+
+#include <map>
+#include <set>
+#include <random>
+#include <algorithm>
+#include <et/core/tools.h>
+#include <et/app/application.h>
+#include <et/rendering/rendercontext.h>
+#include <et/rendering/drawcommandbuffer.h>
+
+using namespace et;
+
+namespace
+{
+	const int programsCount = 8;
+	const int texturesCount = 16;
+	const int vertexArrayObjectsCount = 16;
+	const uint32_t indicesPerSlot = 6;
+	const int blendedPercent = 10;
+	const int instancedPercent = 2;
+
+	int packetsCount = 4096;
+	int frames = 100;
+	int slotsPerObject = 256;
+
+	typedef DrawCommandBuffer::Packet Packet;
+
+	/*
+	 * Orders packets by state, blending is not compared since only opaque runs are checked
+	 */
+	struct StateLess
+	{
+		bool operator()(const Packet* l, const Packet* r) const
+		{
+			if (l->program != r->program)
+				return std::less<const Program*>()(l->program, r->program);
+
+			for (size_t unit = 0; unit < DrawCommandBuffer::MaxTextures; ++unit)
+			{
+				if (l->textures[unit] != r->textures[unit])
+					return std::less<const Texture*>()(l->textures[unit], r->textures[unit]);
+			}
+
+			return std::less<const VertexArrayObjectData*>()(l->vertexArrayObject, r->vertexArrayObject);
+		}
+	};
+
+	/*
+	 * Indices of vertex array object are split into slots, every recorded packet
+	 * owns one slot, so drawn index tells which packet it belongs to
+	 */
+	class RecordingBackend : public DrawCommandBuffer::Backend
+	{
+	public:
+		RecordingBackend(const std::vector<Packet>& packets, const std::map<VertexArrayObjectData*, size_t>& objects) :
+			_packets(packets), _objects(objects)
+		{
+			_bound.blendState = BlendState::Current;
+
+			_owners.resize(_objects.size() * slotsPerObject * indicesPerSlot, -1);
+			_drawn.resize(_owners.size(), 0);
+
+			for (size_t i = 0; i < _packets.size(); ++i)
+			{
+				const Packet& packet = _packets[i];
+				size_t base = _objects.at(packet.vertexArrayObject) * slotsPerObject * indicesPerSlot;
+				for (uint32_t index = packet.firstIndex; index < packet.firstIndex + packet.indexCount; ++index)
+					_owners[base + index] = static_cast<int>(i);
+			}
+		}
+
+		void bindProgram(Program* program) override
+		{
+			failures += (program == _bound.program) ? 1 : 0;
+			_bound.program = program;
+			++stateChanges;
+		}
+
+		void bindVertexArray(VertexArrayObjectData* vao) override
+		{
+			failures += (vao == _bound.vertexArrayObject) ? 1 : 0;
+			_bound.vertexArrayObject = vao;
+			++stateChanges;
+		}
+
+		void bindTexture(uint32_t unit, Texture* texture) override
+		{
+			failures += (texture == _bound.textures[unit]) ? 1 : 0;
+			_bound.textures[unit] = texture;
+			++stateChanges;
+		}
+
+		void setBlendState(BlendState blend) override
+		{
+			failures += (blend == _bound.blendState) ? 1 : 0;
+			_bound.blendState = blend;
+			++stateChanges;
+		}
+
+		void drawElements(VertexArrayObjectData* vao, uint32_t first, uint32_t count, uint32_t instances) override
+		{
+			++drawCalls;
+			draw(vao, first, count, instances);
+		}
+
+		void multiDrawElements(VertexArrayObjectData* vao, const uint32_t* first, const uint32_t* count,
+			size_t drawCount) override
+		{
+			++drawCalls;
+			for (size_t i = 0; i < drawCount; ++i)
+				draw(vao, first[i], count[i], 1);
+		}
+
+		/*
+		 * Returns number of failed checks, should be called after submit
+		 */
+		int validate()
+		{
+			for (size_t i = 0; i < _owners.size(); ++i)
+				failures += (_drawn[i] == ((_owners[i] >= 0) ? 1 : 0)) ? 0 : 1;
+
+			StateLess less;
+			std::set<const Packet*, StateLess> finishedRuns;
+			const Packet* previous = nullptr;
+			int lastBlended = -1;
+			for (int index : _order)
+			{
+				const Packet* packet = _packets.data() + index;
+				if (packet->blendState != BlendState::Disabled)
+				{
+					failures += (index > lastBlended) ? 0 : 1;
+					lastBlended = index;
+					continue;
+				}
+
+				failures += (lastBlended >= 0) ? 1 : 0;
+
+				if ((previous != nullptr) && (less(previous, packet) || less(packet, previous)))
+				{
+					finishedRuns.insert(previous);
+					failures += (finishedRuns.count(packet) > 0) ? 1 : 0;
+				}
+				previous = packet;
+			}
+
+			return failures;
+		}
+
+	public:
+		int failures = 0;
+		size_t drawCalls = 0;
+		size_t stateChanges = 0;
+
+	private:
+		void draw(VertexArrayObjectData* vao, uint32_t first, uint32_t count, uint32_t instances)
+		{
+			failures += (vao == _bound.vertexArrayObject) ? 0 : 1;
+
+			size_t base = _objects.at(vao) * slotsPerObject * indicesPerSlot;
+			for (uint32_t index = first; index < first + count; ++index)
+			{
+				++_drawn[base + index];
+
+				int owner = _owners[base + index];
+				if (owner < 0)
+				{
+					++failures;
+					continue;
+				}
+
+				const Packet& packet = _packets[owner];
+				failures += (packet.program == _bound.program) ? 0 : 1;
+				failures += (packet.blendState == _bound.blendState) ? 0 : 1;
+				failures += (packet.instanceCount == instances) ? 0 : 1;
+				for (size_t unit = 0; unit < DrawCommandBuffer::MaxTextures; ++unit)
+				{
+					if (packet.textures[unit] != nullptr)
+						failures += (packet.textures[unit] == _bound.textures[unit]) ? 0 : 1;
+				}
+
+				if (_order.empty() || (_order.back() != owner))
+					_order.push_back(owner);
+			}
+		}
+
+	private:
+		const std::vector<Packet>& _packets;
+		const std::map<VertexArrayObjectData*, size_t>& _objects;
+		std::vector<int> _owners;
+		std::vector<int> _drawn;
+		std::vector<int> _order;
+		Packet _bound;
+	};
+
+	class DrawCommandsBenchmark : public IApplicationDelegate
+	{
+	private:
+		ApplicationIdentifier applicationIdentifier() const
+			{ return ApplicationIdentifier("com.cheetek.et.benchmarks.drawcommands", "Cheetek", "Draw Commands Benchmark"); }
+
+		void applicationDidLoad(RenderContext* rc)
+		{
+			log::addOutput(log::ConsoleOutput::Pointer::create());
+
+			createObjects(rc);
+
+			std::mt19937 generator(17);
+			std::vector<Packet> packets;
+			DrawCommandBuffer buffer;
+			int failures = 0;
+			uint64_t submitTime = 0;
+			for (int frame = 0; frame < frames; ++frame)
+			{
+				generatePackets(generator, packets);
+				for (const Packet& packet : packets)
+					buffer.record(packet);
+
+				RecordingBackend backend(packets, _objectIndices);
+
+				uint64_t startTime = queryCurrentTimeInMicroSeconds();
+				buffer.submit(backend);
+				submitTime += queryCurrentTimeInMicroSeconds() - startTime;
+
+				const DrawCommandBuffer::Statistics& stats = buffer.statistics();
+				failures += backend.validate();
+				failures += (backend.drawCalls == stats.drawCalls) ? 0 : 1;
+				failures += (backend.stateChanges == stats.stateChanges) ? 0 : 1;
+
+				if (frame + 1 == frames)
+				{
+					log::info("%llu packets: %llu draw calls (%llu saved), %llu state changes (%llu saved)",
+						static_cast<unsigned long long>(stats.packets), static_cast<unsigned long long>(stats.drawCalls),
+						static_cast<unsigned long long>(stats.drawCallsSaved), static_cast<unsigned long long>(stats.stateChanges),
+						static_cast<unsigned long long>(stats.stateChangesSaved));
+				}
+			}
+
+			log::info("submit: %.1f us per frame, failed checks: %d", static_cast<double>(submitTime) / frames, failures);
+
+			application().quit((failures > 0) ? 1 : 0);
+		}
+
+		void createObjects(RenderContext* rc)
+		{
+			const std::string vertexShader =
+			R"(
+				etVertexIn vec3 Vertex;
+				void main()
+				{
+					gl_Position = vec4(Vertex, 1.0);
+				}
+			)";
+
+			const std::string fragmentShader =
+			R"(
+				void main()
+				{
+					etFragmentOut = vec4(1.0);
+				}
+			)";
+
+			for (int i = 0; i < programsCount; ++i)
+			{
+				_programs.push_back(rc->programFactory().genProgram("program-" + intToStr(i),
+					vertexShader, fragmentShader));
+			}
+
+			BinaryDataStorage pixel(4, 255);
+			for (int i = 0; i < texturesCount; ++i)
+			{
+				_textures.push_back(rc->textureFactory().genTexture(TextureTarget::Texture_2D, TextureFormat::RGBA,
+					vec2i(1), TextureFormat::RGBA, DataType::UnsignedChar, pixel, "texture-" + intToStr(i)));
+			}
+
+			/*
+			 * Ranges of strips are never joined, so both ways of merging are exercised
+			 */
+			VertexDeclaration decl(true, VertexAttributeUsage::Position, VertexAttributeType::Vec3);
+			slotsPerObject = (packetsCount + vertexArrayObjectsCount - 1) / vertexArrayObjectsCount;
+			uint32_t indicesCount = static_cast<uint32_t>(slotsPerObject) * indicesPerSlot;
+			for (int i = 0; i < vertexArrayObjectsCount; ++i)
+			{
+				VertexArray::Pointer vertices = VertexArray::Pointer::create(decl, static_cast<size_t>(indicesCount));
+				IndexArray::Pointer indices = IndexArray::Pointer::create(IndexArrayFormat::Format_32bit,
+					indicesCount, (i % 2 == 0) ? PrimitiveType::Triangles : PrimitiveType::TriangleStrips);
+				indices->linearize(indicesCount);
+
+				_objects.push_back(rc->vertexBufferFactory().createVertexArrayObject("object-" + intToStr(i),
+					vertices, BufferDrawType::Static, indices, BufferDrawType::Static));
+				_objectIndices[_objects.back().ptr()] = static_cast<size_t>(i);
+			}
+		}
+
+		/*
+		 * Consecutive slots of object mostly share state, like parts of one mesh,
+		 * packets are recorded in random order
+		 */
+		void generatePackets(std::mt19937& generator, std::vector<Packet>& packets)
+		{
+			packets.clear();
+
+			int slotsCount = vertexArrayObjectsCount * slotsPerObject;
+			std::vector<int> slots(slotsCount);
+			for (int i = 0; i < slotsCount; ++i)
+				slots[i] = i;
+			std::shuffle(slots.begin(), slots.end(), generator);
+			slots.resize(packetsCount);
+
+			for (int slot : slots)
+			{
+				int object = slot / slotsPerObject;
+				std::mt19937 stateGenerator(static_cast<uint32_t>(object * 31 + (slot % slotsPerObject) / 3));
+
+				Packet packet;
+				packet.vertexArrayObject = _objects.at(object).ptr();
+				packet.program = _programs.at(stateGenerator() % programsCount).ptr();
+				packet.textures[0] = _textures.at(stateGenerator() % texturesCount).ptr();
+				if (stateGenerator() % 2 == 0)
+					packet.textures[1] = _textures.at(stateGenerator() % texturesCount).ptr();
+
+				if (static_cast<int>(generator() % 100) < blendedPercent)
+					packet.blendState = BlendState::Default;
+				else if (static_cast<int>(generator() % 100) < instancedPercent)
+					packet.instanceCount = 2;
+
+				packet.firstIndex = static_cast<uint32_t>(slot % slotsPerObject) * indicesPerSlot;
+				packet.indexCount = indicesPerSlot;
+				packets.push_back(packet);
+			}
+		}
+
+	private:
+		std::vector<Program::Pointer> _programs;
+		std::vector<Texture::Pointer> _textures;
+		std::vector<VertexArrayObject> _objects;
+		std::map<VertexArrayObjectData*, size_t> _objectIndices;
+	};
+}
+
+IApplicationDelegate* Application::initApplicationDelegate()
+	{ return sharedObjectFactory().createObject<DrawCommandsBenchmark>(); }
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1)
+		packetsCount = atoi(argv[1]);
+
+	if (argc > 2)
+		frames = atoi(argv[2]);
+
+	return application().run(argc, argv);
+}
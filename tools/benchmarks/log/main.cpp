@@ -0,0 +1,214 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+/*
+ * Compares messages formatted by synchronous and asynchronous log with vsnprintf,
+ * checks that messages of each thread are delivered in order and reports time spent
+ * by producer threads per message in synchronous mode and with both overflow policies.
+ * Asynchronous log truncates strings longer than 8 KB, so long strings are shorter here.
+ *
+ * Using: log [PRODUCERS COUNT] [MESSAGES PER PRODUCER], default: 16 20000
+ */
+
+#include <thread>
+#include <cwchar>
+#include <climits>
+#include <et/core/tools.h>
+
+using namespace et;
+
+namespace
+{
+	class CaptureOutput : public log::Output
+	{
+	public:
+		ET_DECLARE_POINTER(CaptureOutput)
+
+	public:
+		void debug(const char* format, va_list args)
+			{ put(format, args); }
+
+		void info(const char* format, va_list args)
+			{ put(format, args); }
+
+		void warning(const char* format, va_list args)
+			{ put(format, args); }
+
+		void error(const char* format, va_list args)
+			{ put(format, args); }
+
+	public:
+		StringList lines;
+		std::atomic<size_t> count = { 0 };
+		FILE* file = nullptr;
+
+	private:
+		void put(const char* format, va_list args)
+		{
+			++count;
+			if (file != nullptr)
+			{
+				vfprintf(file, format, args);
+				fputc('\n', file);
+				fflush(file);
+			}
+			else
+			{
+				char buffer[65536] = { };
+				vsnprintf(buffer, sizeof(buffer), format, args);
+				lines.push_back(buffer);
+			}
+		}
+	};
+
+	std::string format(const char* format, ...)
+	{
+		char buffer[65536] = { };
+		va_list args;
+		va_start(args, format);
+		vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+		return buffer;
+	}
+
+	const char* policyName(int pass)
+	{
+		return (pass == 0) ? "sync" : ((pass == 1) ? "async, wait for space" : "async, drop message");
+	}
+}
+
+#define ET_CHECK_LOG_FORMAT(...) \
+	{ \
+		capture->lines.clear(); \
+		log::info(__VA_ARGS__); \
+		log::flush(); \
+		if ((capture->lines.size() != 1) || (capture->lines.front() != format(__VA_ARGS__))) \
+		{ \
+			console->info("mismatch: %s", #__VA_ARGS__); \
+			++mismatches; \
+		} \
+	}
+
+int main(int argc, char* argv[])
+{
+	log::ConsoleOutput::Pointer console = log::ConsoleOutput::Pointer::create();
+	CaptureOutput::Pointer capture = CaptureOutput::Pointer::create();
+	log::addOutput(capture);
+
+	int producersCount = (argc > 1) ? atoi(argv[1]) : 16;
+	int messagesPerProducer = (argc > 2) ? atoi(argv[2]) : 20000;
+
+	int mismatches = 0;
+	std::string longString(4000, 'x');
+	const char* nullString = nullptr;
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		if (pass > 0)
+			log::enableAsyncOutput(log::OverflowPolicy::WaitForSpace);
+
+		ET_CHECK_LOG_FORMAT("plain text")
+		ET_CHECK_LOG_FORMAT("%d %i %5d %-5d| %05d %+d", -42, 7, 3, 4, 5, 6)
+		ET_CHECK_LOG_FORMAT("%hhd %hhu %hd %hu %ld %lu %lld %llu", 300, 300, 70000, 70000, -5L, 5UL, -1LL << 40, ~0ULL)
+		ET_CHECK_LOG_FORMAT("%zu %zd %td %jd %x %X %#o %o", size_t(123456789), ptrdiff_t(-3), ptrdiff_t(9), intmax_t(-77), 0xbeef, 0xBEEF, 8, 9)
+		ET_CHECK_LOG_FORMAT("%f %.3f %10.2e %g %G %a %Lf", 3.14159, 2.5, 12345.678, 0.0001, 1e20, 1.0, static_cast<long double>(1.5))
+		ET_CHECK_LOG_FORMAT("%*d|%-*d|%.*f|%*.*s|", 6, 1, 4, 2, 3, 3.14159, 8, 3, "abcdef")
+		ET_CHECK_LOG_FORMAT("%s %10s %-10s| %.2s %s", "hello", "r", "l", "trunc", nullString)
+		ET_CHECK_LOG_FORMAT("%c%c%c %% %p", 'a', 'b', 'c', reinterpret_cast<void*>(0x1234))
+		ET_CHECK_LOG_FORMAT("%ls %lc", L"wide", static_cast<wint_t>(L'W'))
+		ET_CHECK_LOG_FORMAT("%s", longString.c_str())
+		ET_CHECK_LOG_FORMAT("%s %s %s", longString.c_str(), longString.c_str(), "end")
+		ET_CHECK_LOG_FORMAT("%d%i%u%s%ld%lu%zu%lld", INT_MIN, 0, 4000000000u, "x", LONG_MIN, ULONG_MAX, size_t(0), LLONG_MIN)
+	}
+	console->info("format: %d mismatches", mismatches);
+
+	/*
+	 * Messages are delivered in timestamp order, so each thread should see its own in sequence
+	 */
+	const int orderingThreads = 4;
+	const int orderingMessages = 2000;
+	capture->lines.clear();
+	{
+		std::vector<std::thread> threads;
+		for (int t = 0; t < orderingThreads; ++t)
+		{
+			threads.emplace_back([t, orderingMessages]()
+			{
+				for (int i = 0; i < orderingMessages; ++i)
+					log::info("%d %d", t, i);
+			});
+		}
+
+		for (auto& thread : threads)
+			thread.join();
+	}
+	log::flush();
+
+	bool ordered = (capture->lines.size() == orderingThreads * orderingMessages);
+	std::vector<int> lastMessage(orderingThreads, -1);
+	for (const auto& line : capture->lines)
+	{
+		int t = 0;
+		int i = 0;
+		ordered = ordered && (sscanf(line.c_str(), "%d %d", &t, &i) == 2) && (t >= 0) &&
+			(t < orderingThreads) && (i == lastMessage[t] + 1);
+
+		if (ordered)
+			lastMessage[t] = i;
+	}
+	console->info("ordering: %llu messages, ordered %d",
+		static_cast<unsigned long long>(capture->lines.size()), ordered ? 1 : 0);
+
+	/*
+	 * Messages are written to temporary file, as FileOutput does
+	 */
+	log::disableAsyncOutput();
+	capture->lines.clear();
+	capture->file = std::tmpfile();
+
+	for (int pass = 0; pass < 3; ++pass)
+	{
+		if (pass == 1)
+			log::enableAsyncOutput(log::OverflowPolicy::WaitForSpace);
+		else if (pass == 2)
+			log::enableAsyncOutput(log::OverflowPolicy::DropMessage);
+
+		capture->count = 0;
+		uint64_t droppedBefore = log::droppedMessages();
+		uint64_t startTime = queryCurrentTimeInMicroSeconds();
+
+		std::vector<std::thread> threads;
+		for (int t = 0; t < producersCount; ++t)
+		{
+			threads.emplace_back([t, messagesPerProducer]()
+			{
+				for (int i = 0; i < messagesPerProducer; ++i)
+					log::info("worker %d processed tile %d of %s in %.3f ms", t, i, "scene", 0.01 * i);
+			});
+		}
+
+		for (auto& thread : threads)
+			thread.join();
+
+		uint64_t producersTime = queryCurrentTimeInMicroSeconds() - startTime;
+		log::flush();
+		uint64_t totalTime = queryCurrentTimeInMicroSeconds() - startTime;
+
+		console->info("%s: %.0f ns per message, %.1f ms with flush, delivered %llu, dropped %llu", policyName(pass),
+			1000.0 * static_cast<double>(producersTime) / static_cast<double>(producersCount * messagesPerProducer),
+			static_cast<double>(totalTime) / 1000.0, static_cast<unsigned long long>(capture->count.load()),
+			static_cast<unsigned long long>(log::droppedMessages() - droppedBefore));
+
+		log::disableAsyncOutput();
+	}
+
+	log::removeOutput(capture);
+	if (capture->file != nullptr)
+		fclose(capture->file);
+
+	return ((mismatches > 0) || !ordered) ? 1 : 0;
+}
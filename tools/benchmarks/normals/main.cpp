@@ -0,0 +1,143 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+/*
+ * Computes normals and tangents of generated height field grids with serial and parallel
+ * functions, reports time of both and the largest difference of results. Grid of the given
+ * size uses 32-bit indices, smaller grid is added to check 16-bit indices.
+ *
+ * Using: normals [GRID SIZE], default: 1001 (2M triangles)
+ */
+
+#include <limits>
+#include <et/core/tools.h>
+#include <et/primitives/primitives.h>
+
+using namespace et;
+
+namespace
+{
+	/*
+	 * Serial functions compute area weights and normalization in other order,
+	 * so results of unit length are allowed to differ by few units in last place
+	 */
+	const float maxDifference = 4.0f * std::numeric_limits<float>::epsilon();
+
+	VertexArray::Pointer createGrid(const vec2i& dim)
+	{
+		VertexDeclaration decl(true);
+		decl.push_back(VertexAttributeUsage::Position, VertexAttributeType::Vec3);
+		decl.push_back(VertexAttributeUsage::Normal, VertexAttributeType::Vec3);
+		decl.push_back(VertexAttributeUsage::TexCoord0, VertexAttributeType::Vec2);
+		decl.push_back(VertexAttributeUsage::Tangent, VertexAttributeType::Vec3);
+
+		VertexArray::Pointer data = VertexArray::Pointer::create(decl, dim.square());
+		RawDataAcessor<vec3> pos = data->chunk(VertexAttributeUsage::Position).accessData<vec3>(0);
+		RawDataAcessor<vec2> uv = data->chunk(VertexAttributeUsage::TexCoord0).accessData<vec2>(0);
+
+		/*
+		 * Hills with small bumps, texture coordinates are distorted
+		 * so tangents differ from vertex to vertex
+		 */
+		for (int z = 0; z < dim.y; ++z)
+		{
+			for (int x = 0; x < dim.x; ++x)
+			{
+				float fx = static_cast<float>(x);
+				float fz = static_cast<float>(z);
+				float h = 20.0f * std::sin(0.05f * fx) * std::cos(0.07f * fz) + 0.5f * std::sin(0.9f * fx + 0.3f * fz);
+
+				size_t i = static_cast<size_t>(x + z * dim.x);
+				pos[i] = vec3(fx, h, fz);
+				uv[i] = vec2(fx + 0.1f * h, fz - 0.05f * h) / static_cast<float>(dim.x);
+			}
+		}
+
+		return data;
+	}
+
+	void resetResults(VertexArray::Pointer data)
+	{
+		RawDataAcessor<vec3> nrm = data->chunk(VertexAttributeUsage::Normal).accessData<vec3>(0);
+		RawDataAcessor<vec3> tan = data->chunk(VertexAttributeUsage::Tangent).accessData<vec3>(0);
+		for (size_t i = 0, e = data->size(); i < e; ++i)
+		{
+			nrm[i] = vec3(0.0f);
+			tan[i] = vec3(0.0f);
+		}
+	}
+
+	std::vector<vec3> copyChunk(VertexArray::Pointer data, VertexAttributeUsage usage)
+	{
+		RawDataAcessor<vec3> values = data->chunk(usage).accessData<vec3>(0);
+
+		std::vector<vec3> result(data->size());
+		for (size_t i = 0, e = data->size(); i < e; ++i)
+			result[i] = values[i];
+
+		return result;
+	}
+
+	float difference(const std::vector<vec3>& a, const std::vector<vec3>& b)
+	{
+		float result = 0.0f;
+		for (size_t i = 0, e = a.size(); i < e; ++i)
+		{
+			vec3 d = a[i] - b[i];
+			result = etMax(result, etMax(std::abs(d.x), etMax(std::abs(d.y), std::abs(d.z))));
+		}
+		return result;
+	}
+
+	bool compare(const vec2i& dim, IndexArrayFormat format)
+	{
+		VertexArray::Pointer data = createGrid(dim);
+
+		uint32_t indexCount = primitives::indexCountForRegularMesh(dim, PrimitiveType::Triangles);
+		IndexArray::Pointer indices = IndexArray::Pointer::create(format, indexCount, PrimitiveType::Triangles);
+		primitives::buildTrianglesIndexes(indices, dim, 0, 0);
+
+		size_t triangles = indices->primitivesCount();
+		uint32_t lastTriangle = static_cast<uint32_t>(triangles);
+
+		uint64_t startTime = queryCurrentTimeInMicroSeconds();
+		primitives::calculateNormals(data, indices, 0, triangles);
+		primitives::calculateTangents(data, indices, 0, lastTriangle);
+		uint64_t serialTime = queryCurrentTimeInMicroSeconds() - startTime;
+
+		std::vector<vec3> serialNormals = copyChunk(data, VertexAttributeUsage::Normal);
+		std::vector<vec3> serialTangents = copyChunk(data, VertexAttributeUsage::Tangent);
+
+		resetResults(data);
+		startTime = queryCurrentTimeInMicroSeconds();
+		primitives::calculateNormalsParallel(data, indices, 0, triangles);
+		primitives::calculateTangentsParallel(data, indices, 0, lastTriangle);
+		uint64_t parallelTime = queryCurrentTimeInMicroSeconds() - startTime;
+
+		float normalsDifference = difference(serialNormals, copyChunk(data, VertexAttributeUsage::Normal));
+		float tangentsDifference = difference(serialTangents, copyChunk(data, VertexAttributeUsage::Tangent));
+
+		log::info("%llu triangles, %s indices: serial %.1f ms, parallel %.1f ms, difference of normals %g, tangents %g",
+			static_cast<unsigned long long>(triangles), (format == IndexArrayFormat::Format_32bit) ? "32-bit" : "16-bit",
+			static_cast<double>(serialTime) / 1000.0, static_cast<double>(parallelTime) / 1000.0,
+			normalsDifference, tangentsDifference);
+
+		return (normalsDifference <= maxDifference) && (tangentsDifference <= maxDifference);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	log::addOutput(log::ConsoleOutput::Pointer::create());
+
+	int gridSize = (argc > 1) ? atoi(argv[1]) : 1001;
+
+	bool succeeded = compare(vec2i(gridSize), IndexArrayFormat::Format_32bit);
+	succeeded = compare(vec2i(181), IndexArrayFormat::Format_16bit) && succeeded;
+
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+/*
+ * Manages objects in ObjectsCache with files in the given folder and checks how they are
+ * reloaded: reports cost of idle update, latency of reload after burst of writes, and checks
+ * reloading of objects sharing file, of objects whose folder was removed and created again
+ * and of objects whose folder was replaced by rename. Cache is updated by its own run loop.
+ * Also checks eviction of objects exceeding memory budget of their type, and that evicted
+ * objects are destroyed on the main thread even when they were evicted on another thread.
+ * Folder should be on local file system, tmpfs is preferred to exclude disk latency.
+ * File notifications are available on Android only, on other platforms objects are polled,
+ * so checks wait longer and burst of writes could be seen by several polls.
+ * Cache is timed object and needs application, so this tool is built as application.
+ *
+ * Using: objectscache [FOLDER] [OBJECTS COUNT], default: objectscache-benchmark 1000
+ */
+
+#include <thread>
+#include <chrono>
+#include <et/core/tools.h>
+#include <et/app/application.h>
+#include <et/core/objectscache.h>
+#include <et/core/filewatcher.h>
+
+using namespace et;
+
+namespace
+{
+	const int idleUpdates = 100000;
+	const int burstWrites = 20;
+	const int budgetObjects = 10;
+	const uint64_t fakeObjectSize = 100;
+
+	std::string benchmarkFolder = "objectscache-benchmark";
+	int objectsCount = 1000;
+
+	class MonitoredCache : public ObjectsCache
+	{
+	public:
+		void startMonitoring(RunLoop& runLoop)
+			{ startUpdates(runLoop.firstTimerPool().ptr()); }
+	};
+
+	class ReloadCounter : public ObjectLoader
+	{
+	public:
+		ET_DECLARE_POINTER(ReloadCounter)
+
+	public:
+		void reloadObject(LoadableObject::Pointer, ObjectsCache&)
+		{
+			++reloads;
+			lastReloadTime = queryContiniousTimeInMilliSeconds();
+		}
+
+	public:
+		std::atomic<int> reloads = { 0 };
+		std::atomic<uint64_t> lastReloadTime = { 0 };
+	};
+
+	void writeFile(const std::string& fileName, const char* content)
+	{
+		FILE* file = fopen(fileName.c_str(), "wb");
+		if (file != nullptr)
+		{
+			fputs(content, file);
+			fclose(file);
+		}
+	}
+
+	void runFor(RunLoop& runLoop, uint64_t milliseconds)
+	{
+		uint64_t endTime = queryContiniousTimeInMilliSeconds() + milliseconds;
+		while (queryContiniousTimeInMilliSeconds() < endTime)
+		{
+			runLoop.update(queryContiniousTimeInMilliSeconds());
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	bool check(bool condition, const char* description)
+	{
+		if (!condition)
+			log::error("failed: %s", description);
+		return condition;
+	}
+
+	class FakeObject : public LoadableObject
+	{
+	public:
+		ET_DECLARE_POINTER(FakeObject)
+
+	public:
+		FakeObject(const std::string& name) :
+			LoadableObject(name, name) { ++alive; }
+
+		~FakeObject()
+		{
+			--alive;
+			destroyedOnMainThread = destroyedOnMainThread && threading::inMainThread();
+		}
+
+		uint64_t memoryUsage() const override
+			{ return fakeObjectSize; }
+
+	public:
+		static std::atomic<int> alive;
+		static std::atomic<bool> destroyedOnMainThread;
+	};
+
+	std::atomic<int> FakeObject::alive = { 0 };
+	std::atomic<bool> FakeObject::destroyedOnMainThread = { true };
+
+	bool checkMemoryBudget()
+	{
+		bool succeeded = true;
+
+		ObjectsCache cache;
+		cache.setMemoryBudget<FakeObject>(budgetObjects * fakeObjectSize);
+		for (int i = 0; i < 2 * budgetObjects; ++i)
+			cache.manage(FakeObject::Pointer::create("fake-" + intToStr(i)), ObjectLoader::Pointer());
+
+		log::info("memory budget: %d objects alive, usage %llu bytes, evictions %llu", FakeObject::alive.load(),
+			static_cast<unsigned long long>(cache.memoryUsage(typeid(FakeObject))),
+			static_cast<unsigned long long>(cache.statistics().evictions));
+		succeeded = check(FakeObject::alive == budgetObjects, "objects exceeding budget should be evicted") && succeeded;
+
+		/*
+		 * Objects evicted on another thread are kept until the next call on the main thread
+		 */
+		std::thread([&cache]()
+		{
+			for (int i = 2 * budgetObjects; i < 4 * budgetObjects; ++i)
+				cache.manage(FakeObject::Pointer::create("fake-" + intToStr(i)), ObjectLoader::Pointer());
+		}).join();
+
+		log::info("memory budget, background thread: %d objects alive, usage %llu bytes", FakeObject::alive.load(),
+			static_cast<unsigned long long>(cache.memoryUsage(typeid(FakeObject))));
+		succeeded = check(cache.memoryUsage(typeid(FakeObject)) == budgetObjects * fakeObjectSize,
+			"objects managed on another thread should stay within budget") && succeeded;
+
+		cache.flush();
+		succeeded = check(FakeObject::alive == 0, "flush should release all evicted objects") && succeeded;
+		succeeded = check(FakeObject::destroyedOnMainThread, "evicted objects should be destroyed on the main thread") && succeeded;
+
+		return succeeded;
+	}
+
+	class ObjectsCacheBenchmark : public IApplicationDelegate
+	{
+	private:
+		ApplicationIdentifier applicationIdentifier() const
+			{ return ApplicationIdentifier("com.cheetek.et.benchmarks.objectscache", "Cheetek", "Objects Cache Benchmark"); }
+
+		void applicationDidLoad(RenderContext*)
+		{
+			log::addOutput(log::ConsoleOutput::Pointer::create());
+
+			std::string folder = addTrailingSlash(benchmarkFolder);
+
+			std::string objectsFolder = folder + "objects";
+			std::string sharedFolder = folder + "shared";
+			std::string removedFolder = folder + "removed";
+			std::string replacedFolder = folder + "replaced";
+			std::string replacedFolderBackup = folder + "replaced-backup";
+			for (const auto& f : { objectsFolder, sharedFolder, removedFolder, replacedFolder })
+				createDirectory(f, true);
+
+			std::string sharedFile = sharedFolder + "/shared.txt";
+			writeFile(sharedFile, "shared");
+
+			/*
+			 * Polled files are checked twice per second and file dates could have resolution of one second
+			 */
+			FileWatcher watcher;
+			bool notifications = watcher.available();
+			uint64_t settleTime = notifications ? 500 : 1500;
+			log::info("file notifications available: %d", notifications ? 1 : 0);
+
+			RunLoop runLoop;
+			MonitoredCache cache;
+			cache.startMonitoring(runLoop);
+
+			ReloadCounter::Pointer loader = ReloadCounter::Pointer::create();
+			std::vector<LoadableObject::Pointer> objects;
+			for (int i = 0; i < objectsCount; ++i)
+			{
+				std::string fileName = objectsFolder + "/object-" + intToStr(i) + ".txt";
+				writeFile(fileName, "object");
+
+				LoadableObject::Pointer object = LoadableObject::Pointer::create(fileName, fileName);
+				object->addOrigin(sharedFile);
+				cache.manage(object, loader);
+				objects.push_back(object);
+			}
+
+			/*
+			 * Notifications about files written before they were managed are received first
+			 */
+			runFor(runLoop, settleTime);
+			loader->reloads = 0;
+
+			bool succeeded = true;
+
+			uint64_t startTime = queryCurrentTimeInMicroSeconds();
+			for (int i = 0; i < idleUpdates; ++i)
+				runLoop.update(queryContiniousTimeInMilliSeconds());
+			uint64_t idleTime = queryCurrentTimeInMicroSeconds() - startTime;
+
+			log::info("idle: %d objects, %.1f ns per update, reloads %d", objectsCount,
+				1000.0 * static_cast<double>(idleTime) / idleUpdates, loader->reloads.load());
+			succeeded = check(loader->reloads == 0, "idle updates should not reload objects") && succeeded;
+
+			std::string burstFile = objectsFolder + "/object-0.txt";
+			for (int i = 0; i < burstWrites; ++i)
+			{
+				writeFile(burstFile, "burst");
+				runFor(runLoop, 5);
+			}
+			uint64_t lastWriteTime = queryContiniousTimeInMilliSeconds();
+			runFor(runLoop, settleTime);
+
+			log::info("burst of %d writes: reloads %d, latency after last write %llu ms", burstWrites, loader->reloads.load(),
+				static_cast<unsigned long long>(loader->lastReloadTime - lastWriteTime));
+			if (notifications)
+				succeeded = check(loader->reloads == 1, "burst of writes should reload object once") && succeeded;
+			else
+				succeeded = check(loader->reloads >= 1, "burst of writes should reload object") && succeeded;
+
+			loader->reloads = 0;
+			writeFile(sharedFile, "changed");
+			runFor(runLoop, settleTime);
+			log::info("shared file: reloads %d", loader->reloads.load());
+			succeeded = check(loader->reloads == objectsCount, "shared file should reload all objects") && succeeded;
+
+			/*
+			 * Object of removed folder is polled and reloaded when file appears again
+			 */
+			std::string removedFile = removedFolder + "/removed.txt";
+			writeFile(removedFile, "removed");
+			LoadableObject::Pointer removed = LoadableObject::Pointer::create(removedFile, removedFile);
+			cache.manage(removed, loader);
+			removeFile(removedFile);
+			removeDirectory(removedFolder);
+			runFor(runLoop, settleTime);
+
+			loader->reloads = 0;
+			createDirectory(removedFolder, true);
+			writeFile(removedFile, "created again");
+			runFor(runLoop, settleTime + 1000);
+			log::info("removed folder: reloads %d", loader->reloads.load());
+			succeeded = check(loader->reloads == 1, "object of removed folder should be reloaded") && succeeded;
+
+			/*
+			 * Objects are watched again in the folder which replaced their one
+			 */
+			std::string replacedFile = replacedFolder + "/replaced.txt";
+			writeFile(replacedFile, "replaced");
+			LoadableObject::Pointer replaced = LoadableObject::Pointer::create(replacedFile, replacedFile);
+			LoadableObject::Pointer replacedToo = LoadableObject::Pointer::create(replacedFile + "-too", replacedFile);
+			cache.manage(replaced, loader);
+			cache.manage(replacedToo, loader);
+			rename(replacedFolder.c_str(), replacedFolderBackup.c_str());
+			createDirectory(replacedFolder, true);
+			writeFile(replacedFile, "new");
+			runFor(runLoop, settleTime);
+
+			loader->reloads = 0;
+			writeFile(replacedFile, "changed");
+			runFor(runLoop, settleTime);
+			log::info("replaced folder: reloads %d", loader->reloads.load());
+			succeeded = check(loader->reloads == 2, "objects of replaced folder should be reloaded") && succeeded;
+
+			succeeded = checkMemoryBudget() && succeeded;
+
+			cache.discard(removed);
+			cache.discard(replaced);
+			cache.discard(replacedToo);
+			objects.clear();
+			cache.flush();
+			cache.report();
+
+			for (int i = 0; i < objectsCount; ++i)
+				removeFile(objectsFolder + "/object-" + intToStr(i) + ".txt");
+			for (const auto& f : { sharedFile, removedFile, replacedFile, replacedFolderBackup + "/replaced.txt" })
+				removeFile(f);
+			for (const auto& f : { objectsFolder, sharedFolder, removedFolder, replacedFolder, replacedFolderBackup, folder })
+				removeDirectory(f);
+
+			application().quit(succeeded ? 0 : 1);
+		}
+	};
+}
+
+IApplicationDelegate* Application::initApplicationDelegate()
+	{ return sharedObjectFactory().createObject<ObjectsCacheBenchmark>(); }
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1)
+		benchmarkFolder = argv[1];
+
+	if (argc > 2)
+		objectsCount = atoi(argv[2]);
+
+	return application().run(argc, argv);
+}
@@ -0,0 +1,188 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+/*
+ * Packs random glyph, sprite and thin rects into 2048x2048 pages with every
+ * RectPlacer method, reports pages count, occupancy, time and validates placement.
+ *
+ * With -sequential option rects are sorted by area and placed one by one into pages
+ * created on demand, using only RectPlacer(size, addSpace) and place(). Define
+ * ET_RECT_PLACER_SEQUENTIAL_ONLY to build this mode against previous revisions
+ * of RectPlacer for comparison.
+ *
+ * Using: rectplacer [RECTS COUNT] [-sequential], default: 20000
+ */
+
+#include <random>
+#include <functional>
+#include <et/core/tools.h>
+#include <et/geometry/rectplacer.h>
+
+using namespace et;
+
+namespace
+{
+	const vec2i pageSize(2048, 2048);
+
+	struct Workload
+	{
+		const char* name;
+		std::function<vec2i()> generate;
+	};
+
+	bool overlaps(const recti& a, const recti& b)
+	{
+		return (a.left < b.right()) && (b.left < a.right()) && (a.top < b.bottom()) && (b.top < a.bottom());
+	}
+
+	bool validatePage(const RectPlacer::RectList& placed)
+	{
+		for (size_t i = 0, e = placed.size(); i < e; ++i)
+		{
+			const recti& r = placed[i];
+			if ((r.left < 0) || (r.top < 0) || (r.right() > pageSize.x) || (r.bottom() > pageSize.y))
+				return false;
+
+			for (size_t j = i + 1; j < e; ++j)
+			{
+				if (overlaps(r, placed[j]))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	void placeSequentially(const Workload& workload, std::vector<vec2i> sizes)
+	{
+		std::sort(sizes.begin(), sizes.end(), [](const vec2i& a, const vec2i& b)
+			{ return a.square() > b.square(); });
+
+		uint64_t startTime = queryCurrentTimeInMicroSeconds();
+
+		std::vector<RectPlacer> pages;
+		for (const auto& size : sizes)
+		{
+			recti place;
+			bool placed = false;
+			for (auto& page : pages)
+			{
+				if ((placed = page.place(size, place)))
+					break;
+			}
+
+			if (!placed)
+			{
+				pages.emplace_back(pageSize, true);
+				pages.back().place(size, place);
+			}
+		}
+
+		uint64_t time = queryCurrentTimeInMicroSeconds() - startTime;
+
+		bool valid = true;
+		for (const auto& page : pages)
+			valid = valid && validatePage(page.placedItems());
+
+		log::info("%-8s sequential pages %llu, time %.3f s, valid %d", workload.name,
+			static_cast<unsigned long long>(pages.size()), static_cast<double>(time) / 1000000.0, valid ? 1 : 0);
+	}
+
+#if !defined(ET_RECT_PLACER_SEQUENTIAL_ONLY)
+	void placeBatch(const Workload& workload, const std::vector<vec2i>& sizes, RectPlacer::Method method,
+		bool allowRotation)
+	{
+		std::vector<RectPlacer::BatchItem> items(sizes.begin(), sizes.end());
+
+		uint64_t startTime = queryCurrentTimeInMicroSeconds();
+		RectPlacer::List pages = RectPlacer::placeBatch(items, pageSize, true, method, allowRotation);
+		uint64_t time = queryCurrentTimeInMicroSeconds() - startTime;
+
+		bool valid = true;
+		float occupancy = 0.0f;
+		for (const auto& page : pages)
+		{
+			valid = valid && validatePage(page.placedItems());
+			occupancy += page.occupancy();
+		}
+
+		size_t unplaced = 0;
+		for (const auto& item : items)
+		{
+			if (item.page == RectPlacer::InvalidPage)
+			{
+				++unplaced;
+				continue;
+			}
+
+			vec2i size = item.rotated ? vec2i(item.size.y, item.size.x) : item.size;
+			valid = valid && (item.place.width == size.x + 1) && (item.place.height == size.y + 1);
+		}
+
+		log::info("%-8s %-8s rotation %d: pages %llu, average occupancy %.3f, unplaced %llu, time %.3f s, valid %d",
+			workload.name, (method == RectPlacer::Method::Skyline) ? "skyline" : "maxrects", allowRotation ? 1 : 0,
+			static_cast<unsigned long long>(pages.size()), pages.empty() ? 0.0f : occupancy / static_cast<float>(pages.size()),
+			static_cast<unsigned long long>(unplaced), static_cast<double>(time) / 1000000.0, valid ? 1 : 0);
+	}
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+	log::addOutput(log::ConsoleOutput::Pointer::create());
+
+	size_t rectsCount = 20000;
+#if defined(ET_RECT_PLACER_SEQUENTIAL_ONLY)
+	bool sequential = true;
+#else
+	bool sequential = false;
+#endif
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-sequential") == 0)
+			sequential = true;
+		else
+			rectsCount = strtoul(argv[i], nullptr, 10);
+	}
+
+	std::mt19937 generator(5);
+	std::uniform_int_distribution<int> glyph(6, 40);
+	std::uniform_int_distribution<int> sprite(8, 200);
+	std::uniform_int_distribution<int> thin(2, 12);
+	std::uniform_int_distribution<int> wide(40, 300);
+
+	Workload workloads[] =
+	{
+		{ "glyphs", [&]() { return vec2i(glyph(generator), glyph(generator)); } },
+		{ "sprites", [&]() { return vec2i(sprite(generator), sprite(generator)); } },
+		{ "thin", [&]() { return (generator() & 1) ? vec2i(thin(generator), wide(generator)) :
+			vec2i(wide(generator), thin(generator)); } },
+	};
+
+	for (const auto& workload : workloads)
+	{
+		std::vector<vec2i> sizes;
+		sizes.reserve(rectsCount);
+		for (size_t i = 0; i < rectsCount; ++i)
+			sizes.push_back(workload.generate());
+
+		if (sequential)
+		{
+			placeSequentially(workload, sizes);
+			continue;
+		}
+
+#	if !defined(ET_RECT_PLACER_SEQUENTIAL_ONLY)
+		for (auto method : { RectPlacer::Method::MaxRects, RectPlacer::Method::Skyline })
+		{
+			placeBatch(workload, sizes, method, false);
+			placeBatch(workload, sizes, method, true);
+		}
+#	endif
+	}
+
+	return 0;
+}
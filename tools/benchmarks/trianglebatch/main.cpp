@@ -0,0 +1,136 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2015 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+/*
+ * Compares TriangleBatch ray, sphere and closest point queries with scalar functions
+ * on random batches, reports number of mismatching results.
+ * Should be built with each instruction set used by TriangleBatch (scalar, SSE, AVX, NEON).
+ *
+ * Using: trianglebatch [BATCHES COUNT], default: 200000
+ */
+
+#include <random>
+#include <et/collision/trianglebatch.h>
+
+using namespace et;
+
+namespace
+{
+	const float maxRayDistance = 3.0f;
+}
+
+int main(int argc, char* argv[])
+{
+	log::addOutput(log::ConsoleOutput::Pointer::create());
+
+	int batchesCount = (argc > 1) ? atoi(argv[1]) : 200000;
+
+	std::mt19937 generator(3);
+	std::uniform_real_distribution<float> coordinate(-2.0f, 2.0f);
+	auto randomVector = [&generator, &coordinate]()
+		{ return vec3(coordinate(generator), coordinate(generator), coordinate(generator)); };
+
+	int rayHits = 0;
+	int rayMismatches = 0;
+	int sphereHits = 0;
+	int sphereMismatches = 0;
+	int pointMismatches = 0;
+
+	for (int b = 0; b < batchesCount; ++b)
+	{
+		triangle triangles[TriangleBatch::Width];
+		uint32_t count = 1 + generator() % TriangleBatch::Width;
+		for (uint32_t i = 0; i < count; ++i)
+			triangles[i] = triangle(randomVector(), randomVector(), randomVector());
+
+		TriangleBatch batch;
+		batch.pack(triangles, count);
+
+		vec3 p = randomVector();
+		float radius = 0.2f + 0.8f * std::abs(coordinate(generator));
+		ray3d r(p, normalize(randomVector()));
+
+		TriangleBatch::PointResult pointResult;
+		uint32_t closestLane = batch.closestPoint(p, pointResult);
+		TriangleBatch::SphereResult sphereResult;
+		uint32_t deepestLane = batch.intersectSphere(p, radius, sphereResult);
+		TriangleBatch::RayResult rayResult;
+		uint32_t hitLane = batch.intersectRay(r, maxRayDistance, true, rayResult);
+
+		vec3 closestPoints[TriangleBatch::Width];
+		bool sphereHit[TriangleBatch::Width] = { };
+		vec3 spherePoints[TriangleBatch::Width];
+		vec3 sphereNormals[TriangleBatch::Width];
+		float penetrations[TriangleBatch::Width] = { };
+		float rayDistance = std::numeric_limits<float>::max();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			closestPoints[i] = closestPointOnTriangle(p, triangles[i]);
+			sphereHit[i] = intersect::sphereTriangle(p, radius, triangles[i], spherePoints[i],
+				sphereNormals[i], penetrations[i]);
+
+			vec3 hitPoint;
+			if (intersect::rayTriangleTwoSided(r, triangles[i], &hitPoint))
+			{
+				float distance = length(hitPoint - r.origin);
+				if (distance <= maxRayDistance)
+					rayDistance = etMin(rayDistance, distance);
+			}
+		}
+
+		float closestDistanceSquared = std::numeric_limits<float>::max();
+		float deepestPenetration = -1.0f;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			closestDistanceSquared = etMin(closestDistanceSquared, (closestPoints[i] - p).dotSelf());
+			if (length(pointResult.point.at(i) - closestPoints[i]) > 1.0e-3f)
+				++pointMismatches;
+
+			bool batchHit = ((sphereResult.hitMask >> i) & 1) != 0;
+			if (batchHit != sphereHit[i])
+			{
+				++sphereMismatches;
+			}
+			else if (batchHit && ((std::abs(penetrations[i] - sphereResult.penetration[i]) > 1.0e-4f) ||
+				(length(spherePoints[i] - sphereResult.point.at(i)) > 1.0e-4f) ||
+				(length(sphereNormals[i] - sphereResult.normal.at(i)) > 1.0e-3f)))
+			{
+				++sphereMismatches;
+			}
+
+			if (sphereHit[i])
+				deepestPenetration = etMax(deepestPenetration, penetrations[i]);
+		}
+
+		if (std::abs(pointResult.distanceSquared[closestLane] - closestDistanceSquared) > 1.0e-3f)
+			++pointMismatches;
+
+		bool anySphereHit = deepestPenetration >= 0.0f;
+		if ((anySphereHit != (deepestLane != TriangleBatch::InvalidLane)) ||
+			(anySphereHit && (sphereResult.penetration[deepestLane] != deepestPenetration)))
+		{
+			++sphereMismatches;
+		}
+
+		bool anyRayHit = rayDistance < std::numeric_limits<float>::max();
+		if ((anyRayHit != (hitLane != TriangleBatch::InvalidLane)) ||
+			(anyRayHit && (std::abs(rayResult.distance[hitLane] - rayDistance) > 1.0e-3f)))
+		{
+			++rayMismatches;
+		}
+
+		rayHits += anyRayHit ? 1 : 0;
+		sphereHits += anySphereHit ? 1 : 0;
+	}
+
+	log::info("width %u, %d batches", static_cast<uint32_t>(TriangleBatch::Width), batchesCount);
+	log::info("rays: %d hits, %d mismatches", rayHits, rayMismatches);
+	log::info("spheres: %d hits, %d mismatches", sphereHits, sphereMismatches);
+	log::info("points: %d mismatches", pointMismatches);
+
+	return (rayMismatches + sphereMismatches + pointMismatches > 0) ? 1 : 0;
+}